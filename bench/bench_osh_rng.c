@@ -0,0 +1,432 @@
+/*
+ * RNG throughput benchmark
+ *
+ * Measures ns/draw and draws/ns for every engine and output type, through
+ * the runtime dispatched API (osh_rng_u32() etc.), the engine functions
+ * called directly, and the batched *_vec() functions, which hoist the
+ * dispatch out of the loop. The distribution samplers of osh_rng_dist.h
+ * are measured as well.
+ *
+ * Each case is run several times and the fastest run is reported, which
+ * filters out scheduler noise. Build with -DCMAKE_BUILD_TYPE=Release,
+ * a Debug build measures -Og code.
+ *
+ * Usage: bench_osh_rng [-n draws] [-r repetitions] [-e pcg32|xoshiro256ss]
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "common/osh_rc.h"
+#include "random/osh_rng.h"
+#include "random/osh_rng_dist.h"
+
+#define BENCH_BLOCK 4096     /* elements per call for the _vec cases */
+#define BENCH_DRAWS 10000000 /* default number of draws per case */
+#define BENCH_REPS 3         /* default number of repetitions per case */
+#define BENCH_ALIAS_N 100    /* number of outcomes of the alias table */
+
+static uint32_t _b32[BENCH_BLOCK];
+static uint64_t _b64[BENCH_BLOCK];
+static float _bf[BENCH_BLOCK];
+static float _bf2[BENCH_BLOCK];
+static float _bf3[BENCH_BLOCK];
+static double _bd[BENCH_BLOCK];
+static double _bd2[BENCH_BLOCK];
+static double _bd3[BENCH_BLOCK];
+static struct osh_rng_alias _alias;
+
+/* the result of every case is folded into this, so no loop can be optimised away */
+static volatile double _sink;
+
+struct bench_case {
+    const char *output;                        /* output type */
+    const char *path;                          /* dispatch path */
+    enum osh_rng_gauss_type gauss;             /* Gaussian method, for the gauss cases */
+    int engine;                                /* 0: all engines, else only this one */
+    double (*fn)(struct osh_rng *rng, long n); /* runs n draws, returns a checksum */
+};
+
+/* uniform integers */
+
+static double b_u32(struct osh_rng *rng, long n) {
+    uint32_t acc = 0;
+    long i;
+
+    for (i = 0; i < n; i++)
+        acc ^= osh_rng_u32(rng);
+    return (double) acc;
+}
+
+static double b_u32_pcg32(struct osh_rng *rng, long n) {
+    uint32_t acc = 0;
+    long i;
+
+    for (i = 0; i < n; i++)
+        acc ^= osh_rng_pcg32_u32(rng);
+    return (double) acc;
+}
+
+static double b_u32_vec(struct osh_rng *rng, long n) {
+    uint32_t acc = 0;
+    long i;
+
+    for (i = 0; i < n; i += BENCH_BLOCK) {
+        osh_rng_u32_vec(rng, _b32, BENCH_BLOCK);
+        acc ^= _b32[BENCH_BLOCK - 1];
+    }
+    return (double) acc;
+}
+
+static double b_u64(struct osh_rng *rng, long n) {
+    uint64_t acc = 0;
+    long i;
+
+    for (i = 0; i < n; i++)
+        acc ^= osh_rng_u64(rng);
+    return (double) acc;
+}
+
+static double b_u64_xoshiro(struct osh_rng *rng, long n) {
+    uint64_t acc = 0;
+    long i;
+
+    for (i = 0; i < n; i++)
+        acc ^= osh_rng_xoshiro256ss_u64(rng);
+    return (double) acc;
+}
+
+static double b_u64_vec(struct osh_rng *rng, long n) {
+    uint64_t acc = 0;
+    long i;
+
+    for (i = 0; i < n; i += BENCH_BLOCK) {
+        osh_rng_u64_vec(rng, _b64, BENCH_BLOCK);
+        acc ^= _b64[BENCH_BLOCK - 1];
+    }
+    return (double) acc;
+}
+
+/* uniform reals */
+
+static double b_float(struct osh_rng *rng, long n) {
+    float acc = 0.0f;
+    long i;
+
+    for (i = 0; i < n; i++)
+        acc += osh_rng_float(rng);
+    return acc;
+}
+
+static double b_float_vec(struct osh_rng *rng, long n) {
+    float acc = 0.0f;
+    long i;
+
+    for (i = 0; i < n; i += BENCH_BLOCK) {
+        osh_rng_float_vec(rng, _bf, BENCH_BLOCK);
+        acc += _bf[BENCH_BLOCK - 1];
+    }
+    return acc;
+}
+
+static double b_double(struct osh_rng *rng, long n) {
+    double acc = 0.0;
+    long i;
+
+    for (i = 0; i < n; i++)
+        acc += osh_rng_double(rng);
+    return acc;
+}
+
+static double b_double_vec(struct osh_rng *rng, long n) {
+    double acc = 0.0;
+    long i;
+
+    for (i = 0; i < n; i += BENCH_BLOCK) {
+        osh_rng_double_vec(rng, _bd, BENCH_BLOCK);
+        acc += _bd[BENCH_BLOCK - 1];
+    }
+    return acc;
+}
+
+/* normal variates, method selected by bench_case.gauss */
+
+static double b_gauss(struct osh_rng *rng, long n) {
+    double acc = 0.0;
+    long i;
+
+    for (i = 0; i < n; i++)
+        acc += osh_rng_gauss01(rng);
+    return acc;
+}
+
+static double b_gauss_vec(struct osh_rng *rng, long n) {
+    double acc = 0.0;
+    long i;
+
+    for (i = 0; i < n; i += BENCH_BLOCK) {
+        osh_rng_gauss01_vec(rng, _bd, BENCH_BLOCK);
+        acc += _bd[BENCH_BLOCK - 1];
+    }
+    return acc;
+}
+
+static double b_gaussf_vec(struct osh_rng *rng, long n) {
+    float acc = 0.0f;
+    long i;
+
+    for (i = 0; i < n; i += BENCH_BLOCK) {
+        osh_rng_gauss01f_vec(rng, _bf, BENCH_BLOCK);
+        acc += _bf[BENCH_BLOCK - 1];
+    }
+    return acc;
+}
+
+/* distributions */
+
+static double b_iso(struct osh_rng *rng, long n) {
+    double u[3];
+    double acc = 0.0;
+    long i;
+
+    for (i = 0; i < n; i++) {
+        osh_rng_iso(rng, u);
+        acc += u[2];
+    }
+    return acc;
+}
+
+static double b_iso_vec(struct osh_rng *rng, long n) {
+    double acc = 0.0;
+    long i;
+
+    for (i = 0; i < n; i += BENCH_BLOCK) {
+        osh_rng_iso_vec(rng, _bd, _bd2, _bd3, BENCH_BLOCK);
+        acc += _bd3[BENCH_BLOCK - 1];
+    }
+    return acc;
+}
+
+static double b_isof_vec(struct osh_rng *rng, long n) {
+    float acc = 0.0f;
+    long i;
+
+    for (i = 0; i < n; i += BENCH_BLOCK) {
+        osh_rng_isof_vec(rng, _bf, _bf2, _bf3, BENCH_BLOCK);
+        acc += _bf3[BENCH_BLOCK - 1];
+    }
+    return acc;
+}
+
+static double b_exp(struct osh_rng *rng, long n) {
+    double acc = 0.0;
+    long i;
+
+    for (i = 0; i < n; i++)
+        acc += osh_rng_exp(rng, 1.0);
+    return acc;
+}
+
+static double b_exp_vec(struct osh_rng *rng, long n) {
+    double acc = 0.0;
+    long i;
+
+    for (i = 0; i < n; i += BENCH_BLOCK) {
+        osh_rng_exp_vec(rng, 1.0, _bd, BENCH_BLOCK);
+        acc += _bd[BENCH_BLOCK - 1];
+    }
+    return acc;
+}
+
+static double b_expf_vec(struct osh_rng *rng, long n) {
+    float acc = 0.0f;
+    long i;
+
+    for (i = 0; i < n; i += BENCH_BLOCK) {
+        osh_rng_expf_vec(rng, 1.0f, _bf, BENCH_BLOCK);
+        acc += _bf[BENCH_BLOCK - 1];
+    }
+    return acc;
+}
+
+static double b_landau(struct osh_rng *rng, long n) {
+    double acc = 0.0;
+    long i;
+
+    for (i = 0; i < n; i++)
+        acc += osh_rng_landau(rng);
+    return acc;
+}
+
+static double b_landau_vec(struct osh_rng *rng, long n) {
+    double acc = 0.0;
+    long i;
+
+    for (i = 0; i < n; i += BENCH_BLOCK) {
+        osh_rng_landau_vec(rng, _bd, BENCH_BLOCK);
+        acc += _bd[BENCH_BLOCK - 1];
+    }
+    return acc;
+}
+
+static double b_alias(struct osh_rng *rng, long n) {
+    uint32_t acc = 0;
+    long i;
+
+    for (i = 0; i < n; i++)
+        acc += osh_rng_alias_sample(&_alias, rng);
+    return (double) acc;
+}
+
+static double b_alias_vec(struct osh_rng *rng, long n) {
+    uint32_t acc = 0;
+    long i;
+
+    for (i = 0; i < n; i += BENCH_BLOCK) {
+        osh_rng_alias_vec(&_alias, rng, _b32, BENCH_BLOCK);
+        acc += _b32[BENCH_BLOCK - 1];
+    }
+    return (double) acc;
+}
+
+// clang-format off
+static const struct bench_case _cases[] = {
+    {"u32",    "dispatch",  OSH_RNG_GAUSS_POLAR,    0,                         b_u32},
+    {"u32",    "direct",    OSH_RNG_GAUSS_POLAR,    OSH_RNG_TYPE_PCG32,        b_u32_pcg32},
+    {"u32",    "vec",       OSH_RNG_GAUSS_POLAR,    0,                         b_u32_vec},
+    {"u64",    "dispatch",  OSH_RNG_GAUSS_POLAR,    0,                         b_u64},
+    {"u64",    "direct",    OSH_RNG_GAUSS_POLAR,    OSH_RNG_TYPE_XOSHIRO256SS, b_u64_xoshiro},
+    {"u64",    "vec",       OSH_RNG_GAUSS_POLAR,    0,                         b_u64_vec},
+    {"float",  "dispatch",  OSH_RNG_GAUSS_POLAR,    0,                         b_float},
+    {"float",  "vec",       OSH_RNG_GAUSS_POLAR,    0,                         b_float_vec},
+    {"double", "dispatch",  OSH_RNG_GAUSS_POLAR,    0,                         b_double},
+    {"double", "vec",       OSH_RNG_GAUSS_POLAR,    0,                         b_double_vec},
+    {"gauss",  "polar",     OSH_RNG_GAUSS_POLAR,    0,                         b_gauss},
+    {"gauss",  "polar_vec", OSH_RNG_GAUSS_POLAR,    0,                         b_gauss_vec},
+    {"gauss",  "zig",       OSH_RNG_GAUSS_ZIGGURAT, 0,                         b_gauss},
+    {"gauss",  "zig_vec",   OSH_RNG_GAUSS_ZIGGURAT, 0,                         b_gauss_vec},
+    {"gaussf", "vec",       OSH_RNG_GAUSS_POLAR,    0,                         b_gaussf_vec},
+    {"iso",    "dispatch",  OSH_RNG_GAUSS_POLAR,    0,                         b_iso},
+    {"iso",    "vec",       OSH_RNG_GAUSS_POLAR,    0,                         b_iso_vec},
+    {"isof",   "vec",       OSH_RNG_GAUSS_POLAR,    0,                         b_isof_vec},
+    {"exp",    "dispatch",  OSH_RNG_GAUSS_POLAR,    0,                         b_exp},
+    {"exp",    "vec",       OSH_RNG_GAUSS_POLAR,    0,                         b_exp_vec},
+    {"expf",   "vec",       OSH_RNG_GAUSS_POLAR,    0,                         b_expf_vec},
+    {"landau", "dispatch",  OSH_RNG_GAUSS_POLAR,    0,                         b_landau},
+    {"landau", "vec",       OSH_RNG_GAUSS_POLAR,    0,                         b_landau_vec},
+    {"alias",  "dispatch",  OSH_RNG_GAUSS_POLAR,    0,                         b_alias},
+    {"alias",  "vec",       OSH_RNG_GAUSS_POLAR,    0,                         b_alias_vec},
+};
+// clang-format on
+
+static double now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+static const char *engine_name(enum osh_rng_type type) {
+    switch (type) {
+    case OSH_RNG_TYPE_PCG32:
+        return "pcg32";
+    case OSH_RNG_TYPE_XOSHIRO256SS:
+        return "xoshiro256ss";
+    default:
+        return "unknown";
+    }
+}
+
+static void run_engine(enum osh_rng_type type, long ndraws, int nreps) {
+    struct osh_rng rng;
+    struct bench_case const *c;
+    double t0;
+    double t;
+    double tmin;
+    size_t i;
+    int j;
+
+    for (i = 0; i < sizeof(_cases) / sizeof(_cases[0]); i++) {
+        c = &_cases[i];
+        if (c->engine != 0 && c->engine != (int) type)
+            continue;
+
+        osh_rng_init(&rng, type, 12345u, 1u);
+        osh_rng_set_gauss(&rng, c->gauss);
+
+        _sink += c->fn(&rng, BENCH_BLOCK); /* warm up caches and branch predictors */
+
+        tmin = 0.0;
+        for (j = 0; j < nreps; j++) {
+            t0 = now_ns();
+            _sink += c->fn(&rng, ndraws);
+            t = now_ns() - t0;
+            if (j == 0 || t < tmin)
+                tmin = t;
+        }
+
+        printf("%-14s %-8s %-10s %10.3f %10.4f\n", engine_name(type), c->output, c->path, tmin / (double) ndraws,
+               (double) ndraws / tmin);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    double w[BENCH_ALIAS_N];
+    long ndraws = BENCH_DRAWS;
+    int nreps = BENCH_REPS;
+    int engine = 0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            ndraws = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            nreps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "pcg32") == 0)
+                engine = OSH_RNG_TYPE_PCG32;
+            else if (strcmp(argv[i], "xoshiro256ss") == 0)
+                engine = OSH_RNG_TYPE_XOSHIRO256SS;
+            else {
+                fprintf(stderr, "Unknown engine '%s'\n", argv[i]);
+                return 1;
+            }
+        } else {
+            printf("Usage: %s [-n draws] [-r repetitions] [-e pcg32|xoshiro256ss]\n", argv[0]);
+            return (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) ? 0 : 1;
+        }
+    }
+
+    /* round up to whole blocks, so the _vec cases draw exactly ndraws */
+    if (ndraws < BENCH_BLOCK)
+        ndraws = BENCH_BLOCK;
+    ndraws = (ndraws + BENCH_BLOCK - 1) / BENCH_BLOCK * BENCH_BLOCK;
+    if (nreps < 1)
+        nreps = 1;
+
+    /* Zipf-like weights, so that aliases are actually followed */
+    for (i = 0; i < BENCH_ALIAS_N; i++)
+        w[i] = 1.0 / (i + 1);
+    if (osh_rng_alias_init(&_alias, w, BENCH_ALIAS_N) != OSH_OK) {
+        fprintf(stderr, "Could not build alias table\n");
+        return 1;
+    }
+
+    printf("# %ld draws per case, best of %d\n", ndraws, nreps);
+    printf("%-14s %-8s %-10s %10s %10s\n", "# engine", "output", "path", "ns/draw", "draws/ns");
+
+    if (engine == 0 || engine == OSH_RNG_TYPE_PCG32)
+        run_engine(OSH_RNG_TYPE_PCG32, ndraws, nreps);
+    if (engine == 0 || engine == OSH_RNG_TYPE_XOSHIRO256SS)
+        run_engine(OSH_RNG_TYPE_XOSHIRO256SS, ndraws, nreps);
+
+    osh_rng_alias_free(&_alias);
+
+    return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Raw RNG output stream for external statistical test batteries
+ *
+ * Writes the raw output of one engine to stdout, so it can be piped into
+ * PractRand or TestU01, e.g.
+ *
+ *   osh_rng_stream -e xoshiro256ss | RNG_test stdin64
+ *   osh_rng_stream -e pcg32 -w 32 | RNG_test stdin32
+ *
+ * Words are written in host byte order, as the stdinNN readers expect.
+ * Without -b the stream is endless and terminates when the reader closes
+ * the pipe.
+ *
+ * With -c no data is written. Instead a quick self contained smoke test is
+ * run on the stream: a chi-square test on the byte frequencies, a monobit
+ * test and the lag-1 serial correlation of the doubles. This catches
+ * broken engines and broken seeding, not subtle defects; use the external
+ * batteries for those.
+ *
+ * Usage: osh_rng_stream [-e pcg32|xoshiro256ss] [-s seed] [-t stream] [-w 32|64] [-b bytes] [-c]
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "random/osh_rng.h"
+
+#define STREAM_BLOCK 8192            /* 64-bit words per fwrite() */
+#define STREAM_CHECK_BYTES (1 << 26) /* bytes inspected by -c */
+
+/* 32-bit words are written through u32, all statistics read u64 */
+static union {
+    uint64_t u64[STREAM_BLOCK];
+    uint32_t u32[2 * STREAM_BLOCK];
+} _buf;
+
+static void fill_block(struct osh_rng *rng, int width) {
+    if (width == 64)
+        osh_rng_u64_vec(rng, _buf.u64, STREAM_BLOCK);
+    else
+        osh_rng_u32_vec(rng, _buf.u32, 2 * STREAM_BLOCK);
+}
+
+static int popcount64(uint64_t x) {
+    int n = 0;
+
+    while (x) {
+        x &= x - 1;
+        n++;
+    }
+    return n;
+}
+
+/*
+ * Returns 0 if all statistics are within 5 sigma of their expectation.
+ * The chi-square with 255 degrees of freedom is converted with the
+ * Wilson-Hilferty approximation.
+ */
+static int smoke(struct osh_rng *rng, int width, long long nbytes) {
+    static long long count[256];
+    unsigned char const *p;
+    long long done;
+    long long ones;
+    double chi2;
+    double e;
+    double z_chi2;
+    double z_bits;
+    double z_corr;
+    double x;
+    double xprev;
+    double sxy;
+    double sx;
+    double sxx;
+    long long nx;
+    size_t i;
+    int k;
+
+    memset(count, 0, sizeof(count));
+    ones = 0;
+    sxy = sx = sxx = 0.0;
+    xprev = 0.0;
+    nx = 0;
+
+    for (done = 0; done < nbytes; done += sizeof(_buf)) {
+        fill_block(rng, width);
+        p = (unsigned char const *) _buf.u64;
+        for (i = 0; i < sizeof(_buf); i++)
+            count[p[i]]++;
+        for (i = 0; i < STREAM_BLOCK; i++) {
+            ones += popcount64(_buf.u64[i]);
+            x = (double) (_buf.u64[i] >> 11) * (1.0 / 9007199254740992.0) - 0.5;
+            sx += x;
+            sxx += x * x;
+            if (nx > 0)
+                sxy += x * xprev;
+            xprev = x;
+            nx++;
+        }
+    }
+
+    e = (double) done / 256.0;
+    chi2 = 0.0;
+    for (k = 0; k < 256; k++)
+        chi2 += ((double) count[k] - e) * ((double) count[k] - e) / e;
+    z_chi2 = (cbrt(chi2 / 255.0) - (1.0 - 2.0 / (9.0 * 255.0))) / sqrt(2.0 / (9.0 * 255.0));
+
+    z_bits = ((double) ones - 4.0 * (double) done) / sqrt(2.0 * (double) done);
+
+    /* correlation of centred uniforms, sigma = 1/sqrt(n) */
+    z_corr = (sxy / (nx - 1) - (sx / nx) * (sx / nx)) / (sxx / nx - (sx / nx) * (sx / nx)) * sqrt((double) nx);
+
+    fprintf(stderr, "bytes %lld  chi2(255) %.1f (z %.2f)  monobit z %.2f  serial corr z %.2f\n", done, chi2, z_chi2,
+            z_bits, z_corr);
+
+    return (fabs(z_chi2) > 5.0 || fabs(z_bits) > 5.0 || fabs(z_corr) > 5.0);
+}
+
+int main(int argc, char *argv[]) {
+    struct osh_rng rng;
+    enum osh_rng_type type = OSH_RNG_TYPE_XOSHIRO256SS;
+    uint64_t seed = 12345u;
+    uint64_t stream = 1u;
+    long long nbytes = -1;
+    long long left;
+    size_t len;
+    int width = 64;
+    int check = 0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "pcg32") == 0)
+                type = OSH_RNG_TYPE_PCG32;
+            else if (strcmp(argv[i], "xoshiro256ss") == 0)
+                type = OSH_RNG_TYPE_XOSHIRO256SS;
+            else {
+                fprintf(stderr, "Unknown engine '%s'\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            stream = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            width = atoi(argv[++i]);
+            if (width != 32 && width != 64) {
+                fprintf(stderr, "Word width must be 32 or 64\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            nbytes = strtoll(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-c") == 0) {
+            check = 1;
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [-e pcg32|xoshiro256ss] [-s seed] [-t stream] [-w 32|64] [-b bytes] [-c]\n", argv[0]);
+            return (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) ? 0 : 1;
+        }
+    }
+
+    osh_rng_init(&rng, type, seed, stream);
+
+    if (check)
+        return smoke(&rng, width, nbytes > 0 ? nbytes : STREAM_CHECK_BYTES);
+
+#ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    left = nbytes;
+    while (nbytes < 0 || left > 0) {
+        fill_block(&rng, width);
+        len = sizeof(_buf);
+        if (nbytes >= 0 && (long long) len > left)
+            len = (size_t) left;
+        if (fwrite(_buf.u64, 1, len, stdout) != len)
+            return 0; /* reader closed the pipe */
+        left -= (long long) len;
+    }
+    fflush(stdout);
+
+    return 0;
+}
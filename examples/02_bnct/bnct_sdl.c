@@ -13,6 +13,7 @@
 #include "common/osh_vect.h"
 #include "gemca/osh_gemca2.h"
 #include "random/osh_rng.h"
+#include "random/osh_rng_dist.h"
 #include "transport/osh_transport.h"
 
 #define WINDOW_WIDTH 800
@@ -54,22 +55,6 @@ static inline double urand(void) {
     return osh_rng_double(&g_rng);
 }
 
-static inline void osh_rng_unit_sphere(double out[3]) {
-    /* Marsaglia (1972): sample uniformly on sphere using two uniforms */
-    double u, v, s;
-
-    do {
-        u = 2.0 * osh_rng_double(&g_rng) - 1.0;
-        v = 2.0 * osh_rng_double(&g_rng) - 1.0;
-        s = u * u + v * v;
-    } while (s >= 1.0 || s == 0.0);
-
-    const double k = 2.0 * sqrt(1.0 - s);
-    out[0] = u * k;
-    out[1] = v * k;
-    out[2] = 1.0 - 2.0 * s;
-}
-
 /* define struct which is an array of rays */
 struct ray_array {
     struct ray *rays;
@@ -167,7 +152,7 @@ int random_ray_3d(struct ray *r) {
     r->p[1] = urand() * (SIM_YWIDTH) -SIM_YWIDTH * 0.5;
     r->p[2] = urand() * (SIM_ZWIDTH) -SIM_ZWIDTH * 0.5;
 
-    osh_rng_unit_sphere(cp);
+    osh_rng_iso(&g_rng, cp);
 
     /* assign direction to first ray */
     osh_vect_copy(cp, r->cp);
@@ -227,7 +212,7 @@ int rays_b10(struct ray_array *ra) {
     osh_vect_copy(ra->rays[0].p, ra->rays[1].p);
 
     /* generate a random direction */
-    osh_rng_unit_sphere(cp);
+    osh_rng_iso(&g_rng, cp);
 
     /* assign direction to first ray */
     osh_vect_copy(cp, ra->rays[0].cp);
@@ -264,14 +249,14 @@ int rays_b11(struct ray_array *ra) {
     osh_vect_copy(ra->rays[0].p, ra->rays[2].p);
 
     /* generate a random direction */
-    osh_rng_unit_sphere(cp);
+    osh_rng_iso(&g_rng, cp);
 
     /* assign direction to first ray */
     osh_vect_copy(cp, ra->rays[0].cp);
 
     /* generate another random direction TODO   */
     /* this is not really correct, as this particle has momentum before disintegration */
-    osh_rng_unit_sphere(cp);
+    osh_rng_iso(&g_rng, cp);
     osh_vect_copy(cp, ra->rays[1].cp);
     osh_vect_reverse(cp, ra->rays[2].cp);
     return 1;
@@ -4,12 +4,16 @@
 #include <stdlib.h>
 
 #include "beam/osh_beam_parse.h"
+#include "beam/osh_beam_phsp.h"
 #include "beam/osh_beam_spots.h"
+#include "common/osh_const.h"
 #include "common/osh_file.h"
 #include "common/osh_logger.h"
 #include "common/osh_rc.h"
+#include "particle/osh_particle_pdg.h"
 
 static void _wb_defaults(struct beam_workspace *wb);
+static int _wb_particle(struct beam_workspace *wb, const char *filename);
 static int _wb_validate(const struct beam_workspace *wb);
 
 int osh_beam_setup(const char *filename, const char *wdir, struct beam_workspace **wb_out) {
@@ -30,24 +34,24 @@ int osh_beam_setup(const char *filename, const char *wdir, struct beam_workspace
         osh_fclose(sf);
         return OSH_ENOMEM;
     }
+    _wb_defaults(wb);
 
+    /* a single spot, BEAMPOS, BEAMSIGMA, TMAX0 ... describe it */
     rc = osh_beam_spots_init(&wb->spots, 1);
-    if (rc != OSH_OK) {
-        osh_fclose(sf);
-        free(wb);
-        return rc;
+    if (rc == OSH_OK) {
+        wb->nspots = 1;
+        wb->spots->wt = 1.0;
+        wb->spots->shape = OSH_BEAM_SHAPE_PENCIL;
+        wb->spots->part = (struct particle *) calloc(1, sizeof *wb->spots->part);
+        wb->shared = (struct beam_shared *) malloc(sizeof *wb->shared);
+        rc = (wb->spots->part && wb->shared) ? osh_beam_shared_init(wb->shared) : OSH_ENOMEM;
     }
-
-    rc = osh_beam_shared_init(wb->shared);
     if (rc != OSH_OK) {
         osh_fclose(sf);
-        osh_beam_spots_free(wb->spots);
-        free(wb);
+        osh_beam_workspace_free(wb);
         return rc;
     }
 
-    _wb_defaults(wb);
-
     if (wdir && *wdir) {
         size_t L = strlen(wdir);
         wb->wdir = (char *) malloc(L + 1);
@@ -70,7 +74,9 @@ int osh_beam_setup(const char *filename, const char *wdir, struct beam_workspace
         return rc;
     }
 
-    rc = _wb_validate(wb);
+    rc = _wb_particle(wb, filename);
+    if (rc == OSH_OK)
+        rc = _wb_validate(wb);
     if (rc != OSH_OK) {
         osh_beam_workspace_free(wb);
         return rc;
@@ -81,19 +87,22 @@ int osh_beam_setup(const char *filename, const char *wdir, struct beam_workspace
 }
 
 int osh_beam_workspace_free(struct beam_workspace *wb) {
+    size_t i;
+
     if (!wb)
         return OSH_OK;
     if (wb->wdir)
         free(wb->wdir);
     if (wb->spots) {
+        for (i = 0; i < wb->nspots; i++)
+            free(wb->spots[i].part);
         osh_beam_spots_free(wb->spots);
     }
     if (wb->shared) {
         osh_beam_shared_free(wb->shared);
     }
     if (wb->phsp) {
-        // TODO osh_beam_phsp_free(wb->phsp);
-        free(wb->phsp);
+        osh_beam_phsp_free(wb->phsp);
     }
     if (wb->rifi) {
         // TODO osh_beam_rifi_free(wb->rifi);
@@ -123,6 +132,7 @@ static void _wb_defaults(struct beam_workspace *wb) {
     wb->parlev = NULL;
 
     wb->nspots = 0;
+    wb->jpart0 = OSH_JPART_PROTON;
     wb->nstat = 0;
     wb->nsave = 0;
     wb->rndseed = 0;
@@ -140,6 +150,47 @@ static void _wb_defaults(struct beam_workspace *wb) {
     wb->neutrfast = 0;
 }
 
+/* fill the primary particle from JPART0, and from HIPROJ for heavy ions */
+static int _wb_particle(struct beam_workspace *wb, const char *filename) {
+    struct particle *part = wb->spots->part;
+    unsigned int i, z;
+
+    part->id = OSH_PART_HADRON;
+    part->weight = 1.0;
+    if (wb->jpart0 == OSH_JPART_HEAVYION) {
+        z = (part->z > 0) ? (unsigned int) part->z : 0;
+        if (z == 0 || z >= _OSH_ISODB_NELEM) {
+            osh_warn("in %s: JPART0 %d needs HIPROJ\n", filename, OSH_JPART_HEAVYION);
+            return OSH_EPARSE;
+        }
+        for (i = _isotopes_idx[z]; i < _isotopes_idx[z] + _isotopes_len[z]; i++)
+            if (_isotopes[i].a == part->a)
+                break;
+        if (i == _isotopes_idx[z] + _isotopes_len[z]) {
+            osh_warn("in %s: HIPROJ %u %u is not a known isotope\n", filename, part->a, z);
+            return OSH_EPARSE;
+        }
+        part->amu = _isotopes[i].amass;
+        part->pdg = OSH_PART_PDG_HIBASE + 10000 * part->z + 10 * (int) part->a;
+    } else if (wb->jpart0 == OSH_JPART_PROTON || wb->jpart0 == OSH_JPART_NEUTRON ||
+               (wb->jpart0 >= OSH_JPART_DEUTERON && wb->jpart0 <= OSH_JPART_HE4)) {
+        part->amu = _jpart_amass[wb->jpart0];
+        part->z = _jpart_charge[wb->jpart0];
+        part->a = _jpart_nucleons[wb->jpart0];
+        if (wb->jpart0 == OSH_JPART_PROTON)
+            part->pdg = OSH_PART_PDG_PROTON;
+        else if (wb->jpart0 == OSH_JPART_NEUTRON)
+            part->pdg = OSH_PART_PDG_NEUTRON;
+        else
+            part->pdg = OSH_PART_PDG_HIBASE + 10000 * part->z + 10 * (int) part->a;
+    } else {
+        osh_warn("in %s: JPART0 %d is not supported, only hadrons can be primaries\n", filename, wb->jpart0);
+        return OSH_ENOTSUP;
+    }
+    part->amass = (part->amu - part->z * _jpart_amass[OSH_JPART_ELECTRON]) * OSH_AMU; /* without the electrons */
+    return OSH_OK;
+}
+
 static int _wb_validate(const struct beam_workspace *wb) {
     if (!wb)
         return OSH_EINVAL;
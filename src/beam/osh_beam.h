@@ -1,5 +1,6 @@
 #ifndef _OSH_BEAM
 #define _OSH_BEAM
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -16,11 +17,19 @@
 
 #define OSH_BEAM_TMIN0 0.1 /* MeV or MeV/nucleon */
 
+/* lateral beam profiles, selected by the signs of the BEAMSIGMA arguments */
+#define OSH_BEAM_SHAPE_PENCIL 0   /* no lateral extension */
+#define OSH_BEAM_SHAPE_GAUSSIAN 1 /* size[0], size[1]: sigma in x and y [cm] */
+#define OSH_BEAM_SHAPE_SQUARE 2   /* size[0], size[1]: half widths in x and y [cm] */
+#define OSH_BEAM_SHAPE_CIRCULAR 3 /* size[0]: radius [cm] */
+
 /* forward declarations */
 struct ripple_filter;
 struct parlev;
 struct shfile;
 struct ray_c;
+struct position;
+struct osh_rng;
 
 /* a single beam spot */
 struct beam_spot {
@@ -76,14 +85,17 @@ struct beam_shared {
 //     // double norm;
 // };
 
-/* a phase-space file */
+/* a phase-space file, see io/osh_phsp.h and osh_beam_phsp.h */
 struct beam_phsp {
     struct particle **part; /* list of pointers to particles */
     size_t len;             /* array length */
     double *p[3];           /* list of positions */
     double *d[3];           /* list of directions */
+    double *e;              /* list of kinetic energies [MeV] */
     double *wt;             /* list of weights */
     char *fname;            /* input file */
+    struct particle *_part; /* the particles pointed to by part */
+    uint64_t nprim;         /* primaries of the run which recorded the file */
 };
 
 /* defining beam parameters */
@@ -97,6 +109,7 @@ struct beam_workspace {
     char *fname;                /* filename of beam input file */
     char *fname_spotlist;       /* filename of optional external spotlist */
     size_t nspots;              /* Number of spots */
+    int jpart0;                 /* primary particle, OSH_JPART_*, HIPROJ gives a and z of OSH_JPART_HEAVYION */
 
     size_t nstat;   /* Number of requested primaries */
     size_t nsave;   /* saving step of primaries, 0 for disable */
@@ -201,4 +214,24 @@ void osh_beam_print(struct beam_workspace const *wb);
  */
 void osh_beam_print_spot(struct beam_spot const *spot);
 
+/**
+ * @brief Sample the starting point of a primary particle from a beam spot.
+ *
+ * The lateral position is drawn from the spot shape (OSH_BEAM_SHAPE_*) around
+ * spot->p, the direction from the Gaussian divergences spot->div around +Z,
+ * and the kinetic energy from a Gaussian of width tsigma around t0, truncated
+ * at zero. t0 and tsigma are per nucleon for particles with a > 1, the
+ * returned energy is the total kinetic energy.
+ *
+ * The position is returned in the nominal beam frame, spot->_tm is not
+ * applied. Medium, zone and density are set to unknown.
+ *
+ * @param spot Beam spot, spot->part must be set.
+ * @param rng Pointer to the RNG state.
+ * @param pos Output starting point, direction and energy.
+ *
+ * @return OSH_OK, or OSH_EINVAL for an unknown shape.
+ */
+int osh_beam_spot_sample(struct beam_spot const *spot, struct osh_rng *rng, struct position *pos);
+
 #endif /* !_OSH_BEAM */
\ No newline at end of file
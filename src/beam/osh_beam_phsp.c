@@ -0,0 +1,89 @@
+#include "beam/osh_beam_phsp.h"
+
+#include <string.h>
+
+#include "common/osh_rc.h"
+#include "io/osh_phsp.h"
+
+int osh_beam_phsp_load(struct beam_phsp **phsp, char const *filename) {
+    struct osh_phsp_record *r;
+    struct beam_phsp *ph;
+    struct particle *part;
+    uint64_t nprim;
+    size_t i, n, m;
+    int k, rc;
+
+    if (!phsp || !filename)
+        return OSH_EINVAL;
+    *phsp = NULL;
+
+    rc = osh_phsp_read(filename, &nprim, &r, &n);
+    if (rc != OSH_OK)
+        return rc;
+
+    ph = calloc(1, sizeof(*ph));
+    if (!ph) {
+        free(r);
+        return OSH_ENOMEM;
+    }
+    m = n ? n : 1;
+    ph->len = n;
+    ph->nprim = nprim;
+    ph->part = malloc(m * sizeof(*ph->part));
+    ph->_part = calloc(m, sizeof(*ph->_part));
+    for (k = 0; k < 3; k++) {
+        ph->p[k] = malloc(m * sizeof(*ph->p[k]));
+        ph->d[k] = malloc(m * sizeof(*ph->d[k]));
+    }
+    ph->e = malloc(m * sizeof(*ph->e));
+    ph->wt = malloc(m * sizeof(*ph->wt));
+    ph->fname = malloc(strlen(filename) + 1);
+    if (!ph->part || !ph->_part || !ph->p[0] || !ph->p[1] || !ph->p[2] || !ph->d[0] || !ph->d[1] || !ph->d[2] ||
+        !ph->e || !ph->wt || !ph->fname) {
+        free(r);
+        osh_beam_phsp_free(ph);
+        return OSH_ENOMEM;
+    }
+    strcpy(ph->fname, filename);
+
+    for (i = 0; i < n; i++) {
+        part = &ph->_part[i];
+        part->amass = r[i].amass;
+        part->amu = r[i].amu;
+        part->weight = r[i].wt;
+        part->id = r[i].id;
+        part->z = r[i].z;
+        part->a = r[i].a;
+        part->gen = r[i].gen;
+        part->pdg = r[i].pdg;
+        ph->part[i] = part;
+        for (k = 0; k < 3; k++) {
+            ph->p[k][i] = r[i].p[k];
+            ph->d[k][i] = r[i].v[k];
+        }
+        ph->e[i] = r[i].e;
+        ph->wt[i] = r[i].wt;
+    }
+    free(r);
+
+    *phsp = ph;
+    return OSH_OK;
+}
+
+int osh_beam_phsp_free(struct beam_phsp *phsp) {
+    int k;
+
+    if (!phsp)
+        return OSH_EINVAL;
+    free(phsp->part);
+    free(phsp->_part);
+    for (k = 0; k < 3; k++) {
+        free(phsp->p[k]);
+        free(phsp->d[k]);
+    }
+    free(phsp->e);
+    free(phsp->wt);
+    free(phsp->fname);
+    free(phsp);
+    return OSH_OK;
+}
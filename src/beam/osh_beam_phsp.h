@@ -0,0 +1,10 @@
+#ifndef _OSH_BEAM_PHSP
+#define _OSH_BEAM_PHSP
+
+#include "osh_beam.h"
+
+/* load a phase-space file written by a PHSP output of detect.dat, see io/osh_phsp.h */
+int osh_beam_phsp_load(struct beam_phsp **phsp, char const *filename);
+int osh_beam_phsp_free(struct beam_phsp *phsp);
+
+#endif /* _OSH_BEAM_PHSP */
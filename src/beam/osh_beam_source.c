@@ -0,0 +1,67 @@
+#include <math.h>
+
+#include "beam/osh_beam.h"
+#include "common/osh_const.h"
+#include "common/osh_rc.h"
+#include "random/osh_rng.h"
+#include "transport/osh_transport.h"
+
+int osh_beam_spot_sample(struct beam_spot const *spot, struct osh_rng *rng, struct position *pos) {
+    double x, y;
+    double r, phi;
+    double tx, ty;
+    double norm;
+    double t;
+    double nucl;
+
+    switch (spot->shape) {
+    case OSH_BEAM_SHAPE_PENCIL:
+        x = 0.0;
+        y = 0.0;
+        break;
+    case OSH_BEAM_SHAPE_GAUSSIAN:
+        x = spot->size[0] * osh_rng_gauss01(rng);
+        y = spot->size[1] * osh_rng_gauss01(rng);
+        break;
+    case OSH_BEAM_SHAPE_SQUARE:
+        x = spot->size[0] * (2.0 * osh_rng_double(rng) - 1.0);
+        y = spot->size[1] * (2.0 * osh_rng_double(rng) - 1.0);
+        break;
+    case OSH_BEAM_SHAPE_CIRCULAR:
+        r = spot->size[0] * sqrt(osh_rng_double(rng));
+        phi = 2.0 * OSH_M_PI * osh_rng_double(rng);
+        x = r * cos(phi);
+        y = r * sin(phi);
+        break;
+    default:
+        return OSH_EINVAL;
+    }
+
+    pos->p[0] = spot->p[0] + x;
+    pos->p[1] = spot->p[1] + y;
+    pos->p[2] = spot->p[2];
+
+    /* small angle divergence: slopes in x and y, then normalise */
+    tx = (spot->div[0] > 0.0) ? tan(spot->div[0] * osh_rng_gauss01(rng)) : 0.0;
+    ty = (spot->div[1] > 0.0) ? tan(spot->div[1] * osh_rng_gauss01(rng)) : 0.0;
+    norm = 1.0 / sqrt(1.0 + tx * tx + ty * ty);
+    pos->v[0] = tx * norm;
+    pos->v[1] = ty * norm;
+    pos->v[2] = norm;
+
+    t = spot->t0;
+    if (spot->tsigma > 0.0) {
+        t += spot->tsigma * osh_rng_gauss01(rng);
+        if (t < 0.0)
+            t = 0.0;
+    }
+    nucl = (spot->part && spot->part->a > 1) ? (double) spot->part->a : 1.0;
+    pos->p[3] = t * nucl;
+
+    pos->rho = 0.0;
+    pos->medium = -1;
+    pos->zone = -1;
+    pos->system = 1;
+
+    return OSH_OK;
+}
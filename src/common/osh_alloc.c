@@ -0,0 +1,32 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#include "common/osh_alloc.h"
+
+void *osh_aligned_alloc(size_t align, size_t size) {
+    void *p;
+
+    if (size == 0)
+        size = align;
+
+#ifdef _WIN32
+    p = _aligned_malloc(size, align);
+#else
+    if (posix_memalign(&p, align, size) != 0)
+        p = NULL;
+#endif
+    return p;
+}
+
+void osh_aligned_free(void *p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
@@ -0,0 +1,34 @@
+#ifndef _OSH_ALLOC_H
+#define _OSH_ALLOC_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Cache line size assumed for padding and alignment of per-thread data. */
+#define OSH_CACHELINE 64
+
+/**
+ * @brief Allocate memory with a given alignment.
+ *
+ * @param[in] align Alignment in bytes, a power of two and a multiple of sizeof(void *).
+ * @param[in] size Number of bytes to allocate.
+ *
+ * @returns Pointer to the allocated memory, or NULL on failure. Must be released with osh_aligned_free().
+ */
+void *osh_aligned_alloc(size_t align, size_t size);
+
+/**
+ * @brief Free memory allocated with osh_aligned_alloc().
+ *
+ * @param[in] p Pointer to free, may be NULL.
+ */
+void osh_aligned_free(void *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OSH_ALLOC_H */
@@ -0,0 +1,124 @@
+#ifndef _OSH_ATOMIC_H
+#define _OSH_ATOMIC_H
+
+/**
+ * @file osh_atomic.h
+ * @brief Minimal atomic operations on 64-bit integers and pointers
+ *
+ * The code base is C99, so <stdatomic.h> is not available. These wrappers map
+ * to the __atomic builtins of GCC and Clang, and to the Interlocked functions
+ * of MSVC.
+ */
+
+#include <stdint.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#include <windows.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+
+static inline int64_t osh_atomic_load(int64_t const volatile *p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline int64_t osh_atomic_load_relaxed(int64_t const volatile *p) {
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+static inline void osh_atomic_store(int64_t volatile *p, int64_t x) {
+    __atomic_store_n(p, x, __ATOMIC_RELEASE);
+}
+
+static inline void osh_atomic_store_relaxed(int64_t volatile *p, int64_t x) {
+    __atomic_store_n(p, x, __ATOMIC_RELAXED);
+}
+
+/* sequentially consistent compare and swap, returns 1 if *p was e and is now x */
+static inline int osh_atomic_cas(int64_t volatile *p, int64_t e, int64_t x) {
+    return __atomic_compare_exchange_n(p, &e, x, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+static inline int64_t osh_atomic_fetch_add(int64_t volatile *p, int64_t x) {
+    return __atomic_fetch_add(p, x, __ATOMIC_ACQ_REL);
+}
+
+static inline void *osh_atomic_load_ptr(void *const volatile *p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void osh_atomic_store_ptr(void *volatile *p, void *x) {
+    __atomic_store_n(p, x, __ATOMIC_RELEASE);
+}
+
+static inline void osh_atomic_fence(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void osh_atomic_fence_release(void) {
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+#elif defined(_MSC_VER)
+
+/* aligned 64-bit loads and stores are atomic on x64 and ARM64, the barriers order them */
+static inline int64_t osh_atomic_load(int64_t const volatile *p) {
+    int64_t x = *p;
+    _ReadWriteBarrier();
+    return x;
+}
+
+static inline int64_t osh_atomic_load_relaxed(int64_t const volatile *p) {
+    return *p;
+}
+
+static inline void osh_atomic_store(int64_t volatile *p, int64_t x) {
+    _ReadWriteBarrier();
+    *p = x;
+}
+
+static inline void osh_atomic_store_relaxed(int64_t volatile *p, int64_t x) {
+    *p = x;
+}
+
+static inline int osh_atomic_cas(int64_t volatile *p, int64_t e, int64_t x) {
+    return _InterlockedCompareExchange64((__int64 volatile *) p, x, e) == e;
+}
+
+static inline int64_t osh_atomic_fetch_add(int64_t volatile *p, int64_t x) {
+    return _InterlockedExchangeAdd64((__int64 volatile *) p, x);
+}
+
+static inline void *osh_atomic_load_ptr(void *const volatile *p) {
+    void *x = *p;
+    _ReadWriteBarrier();
+    return x;
+}
+
+static inline void osh_atomic_store_ptr(void *volatile *p, void *x) {
+    _ReadWriteBarrier();
+    *p = x;
+}
+
+static inline void osh_atomic_fence(void) {
+    MemoryBarrier();
+}
+
+static inline void osh_atomic_fence_release(void) {
+    _ReadWriteBarrier();
+}
+
+#else
+#error "osh_atomic.h: no atomic operations for this compiler"
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OSH_ATOMIC_H */
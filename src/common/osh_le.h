@@ -0,0 +1,63 @@
+#ifndef _OSH_LE_H
+#define _OSH_LE_H
+
+/*
+ * Little-endian encoding and FNV-1a checksums for binary files, independent
+ * of the host byte order. Used by the writers of src/io and by the RNG
+ * checkpoints.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define OSH_FNV1A_INIT 0xcbf29ce484222325ULL
+
+static inline void _put_u32(unsigned char *b, uint32_t x) {
+    b[0] = (unsigned char) x;
+    b[1] = (unsigned char) (x >> 8);
+    b[2] = (unsigned char) (x >> 16);
+    b[3] = (unsigned char) (x >> 24);
+}
+
+static inline void _put_u64(unsigned char *b, uint64_t x) {
+    _put_u32(b, (uint32_t) x);
+    _put_u32(b + 4, (uint32_t) (x >> 32));
+}
+
+static inline void _put_f64(unsigned char *b, double x) {
+    uint64_t u;
+
+    memcpy(&u, &x, sizeof(u));
+    _put_u64(b, u);
+}
+
+static inline uint32_t _get_u32(unsigned char const *b) {
+    return (uint32_t) b[0] | ((uint32_t) b[1] << 8) | ((uint32_t) b[2] << 16) | ((uint32_t) b[3] << 24);
+}
+
+static inline uint64_t _get_u64(unsigned char const *b) {
+    return (uint64_t) _get_u32(b) | ((uint64_t) _get_u32(b + 4) << 32);
+}
+
+static inline double _get_f64(unsigned char const *b) {
+    uint64_t u;
+    double x;
+
+    u = _get_u64(b);
+    memcpy(&x, &u, sizeof(x));
+    return x;
+}
+
+/* continue an FNV-1a (64 bit) hash h over len bytes, start with OSH_FNV1A_INIT */
+static inline uint64_t _fnv1a(uint64_t h, unsigned char const *b, size_t len) {
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        h ^= b[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+#endif /* !_OSH_LE_H */
@@ -1,11 +1,14 @@
 #include "osh_readline.h"
 
 #include <ctype.h>
+#include <errno.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "osh_logger.h"
+#include "osh_rc.h"
 
 static int _is_comment(char c);
 
@@ -147,3 +150,41 @@ static int _is_comment(char c) {
     }
     return 0;
 }
+
+/* log a parse error as "in FILE line N: message", returns OSH_EPARSE */
+int osh_readline_error(struct oshfile const *oshf, int lineno, const char *fmt, ...) {
+    char msg[256];
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    osh_warn("in %s line %i: %s\n", oshf->filename, lineno, msg);
+    return OSH_EPARSE;
+}
+
+/* the whole argument as an int, returns 1 on success */
+int osh_readline_int(const char *args, int *v) {
+    char *end;
+    long l;
+
+    if (!args)
+        return 0;
+    errno = 0;
+    l = strtol(args, &end, 10);
+    if (errno != 0 || end == args || *end != '\0' || l < -2147483647L || l > 2147483647L)
+        return 0;
+    *v = (int) l;
+    return 1;
+}
+
+/* the whole argument as a double, returns 1 on success */
+int osh_readline_double(const char *args, double *v) {
+    char *end;
+
+    if (!args)
+        return 0;
+    errno = 0;
+    *v = strtod(args, &end);
+    return errno == 0 && end != args && *end == '\0';
+}
@@ -37,4 +37,39 @@ int osh_readline(struct oshfile *oshf, char **line, int *lineno);
  */
 int osh_readline_key(struct oshfile *oshf, char **lline, char **kkey, char **aargs, int *lineno);
 
+/**
+ * @brief Logs a parse error with file name and line number.
+ *
+ * @param[in] oshf    File being parsed.
+ * @param[in] lineno  Line of the error.
+ * @param[in] fmt     printf-style message, without trailing newline.
+ *
+ * @return OSH_EPARSE, for parsers to return directly.
+ */
+int osh_readline_error(struct oshfile const *oshf, int lineno, const char *fmt, ...)
+#if defined(__GNUC__) || defined(__clang__)
+    __attribute__((format(printf, 3, 4)))
+#endif
+    ;
+
+/**
+ * @brief Converts a whole argument to an int.
+ *
+ * @param[in]  args  Argument, may be NULL.
+ * @param[out] v     Value, set on success only.
+ *
+ * @return 1 if args is a single integer within the range of int, else 0.
+ */
+int osh_readline_int(const char *args, int *v);
+
+/**
+ * @brief Converts a whole argument to a double.
+ *
+ * @param[in]  args  Argument, may be NULL.
+ * @param[out] v     Value.
+ *
+ * @return 1 if args is a single number, else 0.
+ */
+int osh_readline_double(const char *args, double *v);
+
 #endif /* OSH_READLINE_H */
\ No newline at end of file
@@ -0,0 +1,240 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "common/osh_thread.h"
+
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+int osh_thread_ncpu(void) {
+    long n;
+
+#if defined(OSH_USE_OPENMP)
+    n = omp_get_num_procs();
+#elif defined(_WIN32)
+    SYSTEM_INFO si;
+
+    GetSystemInfo(&si);
+    n = (long) si.dwNumberOfProcessors;
+#else
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return (n > 0) ? (int) n : 1;
+}
+
+/* background threads are native threads, also with OpenMP */
+#if defined(_WIN32)
+static DWORD WINAPI _thread_bg(LPVOID p) {
+    struct osh_thread *t = p;
+
+    t->fn(t->arg);
+    return 0;
+}
+#else
+static void *_thread_bg(void *p) {
+    struct osh_thread *t = p;
+
+    t->fn(t->arg);
+    return NULL;
+}
+#endif
+
+int osh_thread_start(struct osh_thread *t, void (*fn)(void *arg), void *arg) {
+    t->fn = fn;
+    t->arg = arg;
+#if defined(_WIN32)
+    t->h = CreateThread(NULL, 0, _thread_bg, t, 0, NULL);
+    t->started = (t->h != NULL);
+#else
+    t->started = (pthread_create(&t->t, NULL, _thread_bg, t) == 0);
+#endif
+    if (!t->started)
+        fn(arg);
+    return t->started;
+}
+
+void osh_thread_join(struct osh_thread *t) {
+    if (!t->started)
+        return;
+#if defined(_WIN32)
+    WaitForSingleObject(t->h, INFINITE);
+    CloseHandle(t->h);
+#else
+    pthread_join(t->t, NULL);
+#endif
+    t->started = 0;
+}
+
+void osh_thread_yield(void) {
+#if defined(_WIN32)
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+#if defined(OSH_USE_OPENMP)
+
+int osh_thread_run(int n, void (*fn)(void *arg, int id), void *arg) {
+    int started;
+
+    if (n < 1)
+        n = 1;
+
+    started = 0;
+#pragma omp parallel num_threads(n)
+    {
+        int id = omp_get_thread_num();
+        int k;
+
+        if (id == 0)
+            started = omp_get_num_threads();
+        fn(arg, id);
+        /* the runtime may give fewer threads than asked for */
+#pragma omp barrier
+        if (id == 0)
+            for (k = started; k < n; k++)
+                fn(arg, k);
+    }
+
+    return started;
+}
+
+void osh_thread_mutex_init(struct osh_thread_mutex *m) {
+    omp_init_lock(&m->l);
+}
+
+void osh_thread_mutex_lock(struct osh_thread_mutex *m) {
+    omp_set_lock(&m->l);
+}
+
+void osh_thread_mutex_unlock(struct osh_thread_mutex *m) {
+    omp_unset_lock(&m->l);
+}
+
+void osh_thread_mutex_destroy(struct osh_thread_mutex *m) {
+    omp_destroy_lock(&m->l);
+}
+
+#else
+
+struct thread_arg {
+    void (*fn)(void *arg, int id);
+    void *arg;
+    int id;
+};
+
+#if defined(_WIN32)
+static DWORD WINAPI _thread_main(LPVOID p) {
+    struct thread_arg *t = p;
+
+    t->fn(t->arg, t->id);
+    return 0;
+}
+#else
+static void *_thread_main(void *p) {
+    struct thread_arg *t = p;
+
+    t->fn(t->arg, t->id);
+    return NULL;
+}
+#endif
+
+int osh_thread_run(int n, void (*fn)(void *arg, int id), void *arg) {
+    struct thread_arg *t;
+#if defined(_WIN32)
+    HANDLE *th;
+#else
+    pthread_t *th;
+#endif
+    int *ok;
+    int i, started;
+
+    if (n < 1)
+        n = 1;
+
+    t = malloc((size_t) n * sizeof(*t));
+    th = malloc((size_t) n * sizeof(*th));
+    ok = calloc((size_t) n, sizeof(*ok));
+    if (!t || !th || !ok) {
+        free(t);
+        free(th);
+        free(ok);
+        for (i = 0; i < n; i++)
+            fn(arg, i);
+        return 1;
+    }
+
+    started = 1;
+    for (i = 1; i < n; i++) {
+        t[i].fn = fn;
+        t[i].arg = arg;
+        t[i].id = i;
+#if defined(_WIN32)
+        th[i] = CreateThread(NULL, 0, _thread_main, &t[i], 0, NULL);
+        ok[i] = (th[i] != NULL);
+#else
+        ok[i] = (pthread_create(&th[i], NULL, _thread_main, &t[i]) == 0);
+#endif
+        started += ok[i];
+    }
+
+    /* ids whose thread could not be started run on the calling thread */
+    fn(arg, 0);
+    for (i = 1; i < n; i++)
+        if (!ok[i])
+            fn(arg, i);
+
+    for (i = 1; i < n; i++) {
+        if (!ok[i])
+            continue;
+#if defined(_WIN32)
+        WaitForSingleObject(th[i], INFINITE);
+        CloseHandle(th[i]);
+#else
+        pthread_join(th[i], NULL);
+#endif
+    }
+
+    free(t);
+    free(th);
+    free(ok);
+    return started;
+}
+
+void osh_thread_mutex_init(struct osh_thread_mutex *m) {
+#if defined(_WIN32)
+    InitializeCriticalSection(&m->cs);
+#else
+    (void) pthread_mutex_init(&m->m, NULL);
+#endif
+}
+
+void osh_thread_mutex_lock(struct osh_thread_mutex *m) {
+#if defined(_WIN32)
+    EnterCriticalSection(&m->cs);
+#else
+    (void) pthread_mutex_lock(&m->m);
+#endif
+}
+
+void osh_thread_mutex_unlock(struct osh_thread_mutex *m) {
+#if defined(_WIN32)
+    LeaveCriticalSection(&m->cs);
+#else
+    (void) pthread_mutex_unlock(&m->m);
+#endif
+}
+
+void osh_thread_mutex_destroy(struct osh_thread_mutex *m) {
+#if defined(_WIN32)
+    DeleteCriticalSection(&m->cs);
+#else
+    (void) pthread_mutex_destroy(&m->m);
+#endif
+}
+
+#endif /* OSH_USE_OPENMP */
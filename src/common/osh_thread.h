@@ -0,0 +1,116 @@
+#ifndef _OSH_THREAD_H
+#define _OSH_THREAD_H
+
+/**
+ * @file osh_thread.h
+ * @brief Minimal portable worker threads and mutexes
+ *
+ * Threads are POSIX threads, Win32 threads, or an OpenMP parallel region
+ * when built with -DOSH_USE_OPENMP=ON.
+ *
+ * A single background thread, e.g. for writing results while the workers
+ * go on, is started with osh_thread_start(). It is a native thread in all
+ * builds, OpenMP has no threads outside of parallel regions.
+ */
+
+#if defined(OSH_USE_OPENMP)
+#include <omp.h>
+#endif
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct osh_thread_mutex
+ *
+ * @brief Non-recursive mutex.
+ */
+struct osh_thread_mutex {
+#if defined(OSH_USE_OPENMP)
+    omp_lock_t l;
+#elif defined(_WIN32)
+    CRITICAL_SECTION cs;
+#else
+    pthread_mutex_t m;
+#endif
+};
+
+/**
+ * @struct osh_thread
+ *
+ * @brief A background thread.
+ */
+struct osh_thread {
+#if defined(_WIN32)
+    HANDLE h;
+#else
+    pthread_t t;
+#endif
+    void (*fn)(void *arg);
+    void *arg;
+    int started; /* running in its own thread, join with osh_thread_join() */
+};
+
+/**
+ * @brief Number of hardware threads available to this process.
+ *
+ * @returns Number of threads, at least 1.
+ */
+int osh_thread_ncpu(void);
+
+/**
+ * @brief Run fn(arg, id) for id = 0 .. n-1 in n threads and wait for all of them.
+ *
+ * id 0 runs on the calling thread. Every id runs exactly once: if a thread
+ * cannot be started, its id runs on the calling thread after id 0.
+ *
+ * @param[in] n Number of threads, values < 1 are taken as 1.
+ * @param[in] fn Function to run.
+ * @param[in] arg Argument passed to every call of fn.
+ *
+ * @returns Number of threads which actually ran, including the calling thread.
+ */
+int osh_thread_run(int n, void (*fn)(void *arg, int id), void *arg);
+
+/**
+ * @brief Run fn(arg) in a background thread.
+ *
+ * If no thread can be started, fn runs on the calling thread before this
+ * returns. Either way, call osh_thread_join() before starting t again.
+ *
+ * @param[out] t Thread.
+ * @param[in] fn Function to run.
+ * @param[in] arg Argument of fn.
+ *
+ * @returns 1 if fn runs in its own thread, 0 if it already ran.
+ */
+int osh_thread_start(struct osh_thread *t, void (*fn)(void *arg), void *arg);
+
+/**
+ * @brief Wait for a thread of osh_thread_start() to end, no-op if it ran on the calling thread.
+ *
+ * @param[in,out] t Thread.
+ */
+void osh_thread_join(struct osh_thread *t);
+
+/**
+ * @brief Give up the rest of the time slice of the calling thread.
+ */
+void osh_thread_yield(void);
+
+void osh_thread_mutex_init(struct osh_thread_mutex *m);
+void osh_thread_mutex_lock(struct osh_thread_mutex *m);
+void osh_thread_mutex_unlock(struct osh_thread_mutex *m);
+void osh_thread_mutex_destroy(struct osh_thread_mutex *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OSH_THREAD_H */
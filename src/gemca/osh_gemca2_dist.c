@@ -14,7 +14,7 @@
 
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
 
-static inline double _dist_zone(struct cgnode *self, struct ray const *r);
+static inline double _dist_zone(struct cgnode const *self, struct ray const *r, int *inside);
 static inline double _dist_body(struct body const *b, struct ray const *r);
 static inline double _dist_surface(struct surface const *sf, struct ray const *r);
 
@@ -50,6 +50,7 @@ double osh_gemca_get_distance(struct zone *z, struct ray const *r) {
 
     double d, total_distance;
     struct ray rr;
+    int inside;
 
     // printf("osh_gemca_get_distance(): calculating distance to zone boundary for zone '%s'\n", z->name);
 
@@ -58,12 +59,10 @@ double osh_gemca_get_distance(struct zone *z, struct ray const *r) {
 
     osh_vect_norm(rr.cp); /* normalize the direction vector */
 
-    /* per definition, we are always inside this zone *z we begin with */
-    z->node._is_inside = 1; // is this really needed?
-
+    /* the zone tree is only read, so several threads may query the same zone */
     while (1) {
-        d = _dist_zone(&z->node, &rr); /* find shortest distance to closest body */
-        if (!z->node._is_inside) {     /* keep advancing until we left the zone */
+        d = _dist_zone(&z->node, &rr, &inside); /* find shortest distance to closest body */
+        if (!inside) {                          /* keep advancing until we left the zone */
             break;
         }
         // printf("  Currently inside zone '%s', advancing %.9e to next boundary\n", z->name, d);
@@ -81,10 +80,12 @@ double osh_gemca_get_distance(struct zone *z, struct ray const *r) {
     return total_distance;
 }
 
-static inline double _dist_zone(struct cgnode *self, struct ray const *r) {
+static inline double _dist_zone(struct cgnode const *self, struct ray const *r, int *inside) {
     double d;
     double d1;
     double d2;
+    int in1;
+    int in2;
     struct ray tr; /* transformed ray to coordinate system of the body */
 
     if (self->type == _OSH_GEMCA_CGNODE_BODY) {  /* we are in the leaf node */
@@ -96,33 +97,34 @@ static inline double _dist_zone(struct cgnode *self, struct ray const *r) {
 
         d = _dist_body(self->body,
                        &tr); /* Calculate distance to body's surface. It may, or may not be at a zone boudnary. */
-        self->_is_inside = _inside_body(self->body, &tr); /* Check if ray is inside the body */
-        // printf("  is inside body '%s' = %d\n", self->body->name, self->_is_inside);
+        *inside = _inside_body(self->body, &tr) != 0; /* Check if ray is inside the body */
+        // printf("  is inside body '%s' = %d\n", self->body->name, *inside);
         // printf("  Shortest distance to body '%s' is %f\n", self->body->name, d);
         return d;
     } else {
-        d1 = _dist_zone(self->left, r);  // Distance to left child
-        d2 = _dist_zone(self->right, r); // Distance to right child
+        d1 = _dist_zone(self->left, r, &in1);  // Distance to left child
+        d2 = _dist_zone(self->right, r, &in2); // Distance to right child
 
         /* Apply the appropriate operation based on self->op */
         /* This is following table 3 in Scott D. Roth's algorithm from "Ray Casting for Modeling Solids"
            (Computer Graphics, Vol. 18, No. 3, July 1982) */
         switch (self->op) {
         case '|': // Union
-            self->_is_inside = self->left->_is_inside || self->right->_is_inside;
+            *inside = in1 || in2;
             break;
         case '+': // Intersection
-            self->_is_inside = self->left->_is_inside && self->right->_is_inside;
+            *inside = in1 && in2;
             break;
         case '-': // Difference
-            self->_is_inside = self->left->_is_inside && !self->right->_is_inside;
+            *inside = in1 && !in2;
             break;
         default:
+            *inside = 0;
             osh_error(EX_SOFTWARE, "_dist_zone(): unknown operator");
             break;
         }
         /* return smallest possible distance */
-        // printf("Result of operation %c: _is_inside = %d\n", self->op, self->_is_inside);
+        // printf("Result of operation %c: inside = %d\n", self->op, *inside);
 
         return _minpos(d1, d2);
     }
@@ -103,11 +103,21 @@ int osh_gemca_parse_bodies(struct oshfile *shf, struct gemca_workspace *g) {
     size_t ibody = 0;
     size_t _ib;
 
+    int header = 1;
+
     rewind(shf->fp);
 
     /* read line by line and parse the keys and arguments */
     while (osh_readline_key(shf, &line, &key, &args, &lineno) > 0) {
 
+        /* the first line is the title line, as in osh_gemca_parse_count_zones() */
+        if (header) {
+            header = 0;
+            free(line);
+            line = NULL;
+            continue;
+        }
+
         /* END check early so we do not touch parsing state on END lines */
         if ((strcasecmp(key, OSH_GEMCA_KEY_END) == 0) && (nend == 0)) {
             if (current_body == NULL) {
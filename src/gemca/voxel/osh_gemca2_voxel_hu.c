@@ -21,13 +21,14 @@ float osh_gemca_voxel_hu2rho(int16_t hu, char alg) {
         hu = 1600;
     }
 
-    if (hu <= 98) {
+    /* same curve as osh_material_ct_hu2rho(), the skeletal fit starts at 80 HU like the base media */
+    if (hu < -98) {
         ret = 1.03091 + 0.0010297 * hu;
-    } else if (hu <= 14) {
+    } else if (hu < 14) {
         ret = 1.018 + 0.893 * 0.001 * hu;
-    } else if (hu <= 23) {
+    } else if (hu < 23) {
         ret = 1.03;
-    } else if (hu <= 100) {
+    } else if (hu < 80) {
         ret = 1.003 + 1.169 * 0.001 * hu;
     } else {
         ret = 1.017 + 0.592 * 0.001 * hu;
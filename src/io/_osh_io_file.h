@@ -0,0 +1,26 @@
+#ifndef _OSH_IO_FILE
+#define _OSH_IO_FILE
+
+/*
+ * Files written under a temporary name and moved in place when complete,
+ * so a reader never sees half a file, and reads and writes which keep the
+ * running FNV-1a hash of a file's bytes. Internal to src/io.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* open path.tmp for writing, returns OSH_OK, OSH_EIO or OSH_ENOMEM */
+int _osh_io_open_tmp(const char *path, FILE **fp, char **tmp);
+
+/* close the temporary file and move it to path, or remove it if rc is an error; frees tmp, returns rc or OSH_EIO */
+int _osh_io_close_tmp(FILE *fp, char *tmp, const char *path, int rc);
+
+/* write len bytes and continue the hash *h over them, unless *rc holds an error already; sets *rc to OSH_EIO */
+void _osh_io_emit(FILE *fp, uint64_t *h, int *rc, unsigned char const *b, size_t len);
+
+/* read len bytes and continue the hash *h over them, returns OSH_OK, OSH_EIO or OSH_EINCOMPLETE */
+int _osh_io_read(FILE *fp, uint64_t *h, unsigned char *b, size_t len);
+
+#endif /* !_OSH_IO_FILE */
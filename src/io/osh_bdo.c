@@ -0,0 +1,359 @@
+#include "io/osh_bdo.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef OSH_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "common/osh_le.h"
+#include "common/osh_rc.h"
+#include "io/_osh_io_file.h"
+
+#define BDO_MAGIC "OSHBDO\0\0"
+#define BDO_HEADER 16 /* bytes before the first record */
+#define BDO_RECORD 16 /* bytes of a record header */
+#define BDO_ZLEVEL 1  /* zstd level, favour speed, result files are mostly smooth or empty */
+
+static size_t _size(uint32_t type) {
+    return (type == OSH_BDO_TYPE_STR) ? 1 : 8;
+}
+
+/* write the first len bytes of w->raw as one chunk, compressed if that saves space */
+static void _chunk(struct osh_bdo_writer *w, size_t len) {
+    unsigned char b[8];
+    unsigned char const *p;
+    size_t stored;
+
+    p = w->raw;
+    stored = len;
+#ifdef OSH_HAVE_ZSTD
+    if (w->codec == OSH_BDO_CODEC_ZSTD) {
+        size_t zn = ZSTD_compress(w->z, w->zcap, w->raw, len, BDO_ZLEVEL);
+
+        if (!ZSTD_isError(zn) && zn < len) {
+            p = w->z;
+            stored = zn;
+        }
+    }
+#endif
+    _put_u32(b, (uint32_t) len);
+    _put_u32(b + 4, (uint32_t) stored);
+    _osh_io_emit(w->fp, &w->h, &w->rc, b, 8);
+    _osh_io_emit(w->fp, &w->h, &w->rc, p, stored);
+}
+
+static void _record(struct osh_bdo_writer *w, uint32_t tag, uint32_t type, size_t n) {
+    unsigned char b[BDO_RECORD];
+
+    _put_u32(b, tag);
+    _put_u32(b + 4, type);
+    _put_u64(b + 8, (uint64_t) n);
+    _osh_io_emit(w->fp, &w->h, &w->rc, b, BDO_RECORD);
+}
+
+int osh_bdo_open(struct osh_bdo_writer *w, const char *path, int codec) {
+    unsigned char b[BDO_HEADER];
+    int rc;
+
+    memset(w, 0, sizeof(*w));
+    if (codec != OSH_BDO_CODEC_NONE && codec != OSH_BDO_CODEC_ZSTD)
+        return OSH_EINVAL;
+#ifndef OSH_HAVE_ZSTD
+    if (codec == OSH_BDO_CODEC_ZSTD)
+        return OSH_ENOTSUP;
+#else
+    if (codec == OSH_BDO_CODEC_ZSTD) {
+        w->zcap = ZSTD_compressBound(OSH_BDO_CHUNK);
+        w->z = malloc(w->zcap);
+    }
+#endif
+    w->codec = codec;
+    w->raw = malloc(OSH_BDO_CHUNK);
+    w->path = malloc(strlen(path) + 1);
+    if (!w->raw || !w->path || (codec != OSH_BDO_CODEC_NONE && !w->z)) {
+        free(w->raw);
+        free(w->path);
+        free(w->z);
+        return OSH_ENOMEM;
+    }
+    strcpy(w->path, path);
+
+    rc = _osh_io_open_tmp(path, &w->fp, &w->tmp);
+    if (rc != OSH_OK) {
+        free(w->raw);
+        free(w->path);
+        free(w->z);
+        return rc;
+    }
+    w->h = OSH_FNV1A_INIT;
+    w->rc = OSH_OK;
+
+    memcpy(b, BDO_MAGIC, 8);
+    _put_u32(b + 8, OSH_BDO_VERSION);
+    _put_u32(b + 12, (uint32_t) codec);
+    _osh_io_emit(w->fp, &w->h, &w->rc, b, BDO_HEADER);
+    if (w->rc != OSH_OK) {
+        /* nothing is left to close */
+        rc = _osh_io_close_tmp(w->fp, w->tmp, w->path, w->rc);
+        free(w->raw);
+        free(w->path);
+        free(w->z);
+        memset(w, 0, sizeof(*w));
+        return rc;
+    }
+    return OSH_OK;
+}
+
+int osh_bdo_str(struct osh_bdo_writer *w, uint32_t tag, const char *s) {
+    size_t n, m;
+
+    n = strlen(s);
+    _record(w, tag, OSH_BDO_TYPE_STR, n);
+    while (n > 0) {
+        m = (n < OSH_BDO_CHUNK) ? n : OSH_BDO_CHUNK;
+        memcpy(w->raw, s, m);
+        _chunk(w, m);
+        s += m;
+        n -= m;
+    }
+    return w->rc;
+}
+
+int osh_bdo_i64(struct osh_bdo_writer *w, uint32_t tag, int64_t const *x, size_t n) {
+    size_t i, m;
+
+    _record(w, tag, OSH_BDO_TYPE_I64, n);
+    while (n > 0) {
+        m = (n < OSH_BDO_CHUNK / 8) ? n : OSH_BDO_CHUNK / 8;
+        for (i = 0; i < m; i++)
+            _put_u64(w->raw + 8 * i, (uint64_t) x[i]);
+        _chunk(w, 8 * m);
+        x += m;
+        n -= m;
+    }
+    return w->rc;
+}
+
+/* fill of osh_bdo_f64(), copies from an array */
+static void _copy(void *data, size_t first, size_t n, double *x) {
+    memcpy(x, (double const *) data + first, n * sizeof(*x));
+}
+
+int osh_bdo_f64(struct osh_bdo_writer *w, uint32_t tag, double const *x, size_t n) {
+    return osh_bdo_f64_stream(w, tag, n, _copy, (void *) x);
+}
+
+int osh_bdo_f64_stream(struct osh_bdo_writer *w, uint32_t tag, size_t n, osh_bdo_fill_cb fill, void *data) {
+    double *x = (double *) (void *) w->raw; /* raw is malloc()ed, so aligned for doubles */
+    size_t first, i, m;
+
+    _record(w, tag, OSH_BDO_TYPE_F64, n);
+    for (first = 0; first < n && w->rc == OSH_OK; first += m) {
+        m = (n - first < OSH_BDO_CHUNK / 8) ? n - first : OSH_BDO_CHUNK / 8;
+        fill(data, first, m, x);
+        /* to little-endian in place, each double is read before its bytes are overwritten */
+        for (i = 0; i < m; i++)
+            _put_f64(w->raw + 8 * i, x[i]);
+        _chunk(w, 8 * m);
+    }
+    return w->rc;
+}
+
+int osh_bdo_close(struct osh_bdo_writer *w) {
+    unsigned char b[8];
+    int rc;
+
+    _record(w, OSH_BDO_TAG_END, 0, 0);
+    if (w->rc == OSH_OK) {
+        _put_u64(b, w->h);
+        if (fwrite(b, 1, 8, w->fp) != 8)
+            w->rc = OSH_EIO;
+    }
+    rc = _osh_io_close_tmp(w->fp, w->tmp, w->path, w->rc);
+
+    free(w->raw);
+    free(w->z);
+    free(w->path);
+    memset(w, 0, sizeof(*w));
+    return rc;
+}
+
+/* a file with the running hash of all bytes read from it */
+struct bfile {
+    FILE *fp;
+    uint64_t h;
+    int codec;
+    unsigned char *z; /* a compressed chunk */
+};
+
+/* read the chunks of a record of len bytes into p */
+static int _read_chunks(struct bfile *f, unsigned char *p, size_t len) {
+    unsigned char b[8];
+    size_t n, stored;
+    int rc;
+
+    while (len > 0) {
+        rc = _osh_io_read(f->fp, &f->h, b, 8);
+        if (rc != OSH_OK)
+            return rc;
+        n = _get_u32(b);
+        stored = _get_u32(b + 4);
+        if (n == 0 || n > OSH_BDO_CHUNK || n > len || stored > n || stored == 0)
+            return OSH_EPARSE;
+        if (stored == n) {
+            rc = _osh_io_read(f->fp, &f->h, p, n);
+        } else {
+            if (f->codec != OSH_BDO_CODEC_ZSTD)
+                return OSH_EPARSE;
+            rc = _osh_io_read(f->fp, &f->h, f->z, stored);
+#ifdef OSH_HAVE_ZSTD
+            if (rc == OSH_OK && ZSTD_decompress(p, n, f->z, stored) != n)
+                rc = OSH_EPARSE;
+#endif
+        }
+        if (rc != OSH_OK)
+            return rc;
+        p += n;
+        len -= n;
+    }
+    return OSH_OK;
+}
+
+/* read the elements of a record into a new array */
+static int _read_data(struct bfile *f, struct osh_bdo_record *r) {
+    unsigned char *p;
+    int64_t *xi;
+    double *xd;
+    size_t i;
+    int rc;
+
+    p = malloc(r->n * _size(r->type) + 1);
+    if (!p)
+        return OSH_ENOMEM;
+    r->data = p;
+    rc = _read_chunks(f, p, r->n * _size(r->type));
+    if (rc != OSH_OK)
+        return rc;
+
+    /* from little-endian in place */
+    switch (r->type) {
+    case OSH_BDO_TYPE_STR:
+        p[r->n] = '\0';
+        break;
+    case OSH_BDO_TYPE_I64:
+        xi = r->data;
+        for (i = 0; i < r->n; i++)
+            xi[i] = (int64_t) _get_u64(p + 8 * i);
+        break;
+    default:
+        xd = r->data;
+        for (i = 0; i < r->n; i++)
+            xd[i] = _get_f64(p + 8 * i);
+        break;
+    }
+    return OSH_OK;
+}
+
+void osh_bdo_free(struct osh_bdo_record *r, size_t nrec) {
+    size_t i;
+
+    if (!r)
+        return;
+    for (i = 0; i < nrec; i++)
+        free(r[i].data);
+    free(r);
+}
+
+int osh_bdo_read(const char *path, struct osh_bdo_record **r, size_t *nrec) {
+    struct osh_bdo_record *x, *y;
+    struct bfile f;
+    unsigned char b[BDO_HEADER];
+    uint64_t n, h;
+    size_t nx, cap;
+    int rc;
+
+    *r = NULL;
+    *nrec = 0;
+
+    memset(&f, 0, sizeof(f));
+    f.fp = fopen(path, "rb");
+    if (!f.fp)
+        return OSH_EIO;
+    f.h = OSH_FNV1A_INIT;
+
+    x = NULL;
+    nx = cap = 0;
+    rc = _osh_io_read(f.fp, &f.h, b, BDO_HEADER);
+    if (rc == OSH_EINCOMPLETE || (rc == OSH_OK && memcmp(b, BDO_MAGIC, 8) != 0))
+        rc = OSH_EPARSE;
+    if (rc == OSH_OK && _get_u32(b + 8) != OSH_BDO_VERSION)
+        rc = OSH_ENOTSUP;
+    if (rc == OSH_OK) {
+        f.codec = (int) _get_u32(b + 12);
+        if (f.codec == OSH_BDO_CODEC_ZSTD) {
+#ifdef OSH_HAVE_ZSTD
+            f.z = malloc(OSH_BDO_CHUNK);
+            if (!f.z)
+                rc = OSH_ENOMEM;
+#else
+            rc = OSH_ENOTSUP;
+#endif
+        } else if (f.codec != OSH_BDO_CODEC_NONE) {
+            rc = OSH_ENOTSUP;
+        }
+    }
+
+    while (rc == OSH_OK) {
+        rc = _osh_io_read(f.fp, &f.h, b, BDO_RECORD);
+        if (rc != OSH_OK)
+            break;
+        if (_get_u32(b) == OSH_BDO_TAG_END) {
+            if (_get_u64(b + 8) != 0)
+                rc = OSH_EPARSE;
+            break;
+        }
+        if (nx == cap) {
+            cap = cap ? 2 * cap : 16;
+            y = realloc(x, cap * sizeof(*x));
+            if (!y) {
+                rc = OSH_ENOMEM;
+                break;
+            }
+            x = y;
+        }
+        y = &x[nx++];
+        memset(y, 0, sizeof(*y));
+        y->tag = _get_u32(b);
+        y->type = _get_u32(b + 4);
+        n = _get_u64(b + 8);
+        if (y->type < OSH_BDO_TYPE_STR || y->type > OSH_BDO_TYPE_F64 || n > (SIZE_MAX - 1) / 8) {
+            rc = OSH_EPARSE;
+            break;
+        }
+        y->n = (size_t) n;
+        rc = _read_data(&f, y);
+    }
+
+    /* the hash covers everything before it */
+    if (rc == OSH_OK) {
+        h = f.h;
+        if (fread(b, 1, 8, f.fp) != 8)
+            rc = ferror(f.fp) ? OSH_EIO : OSH_EINCOMPLETE;
+        else if (_get_u64(b) != h || fgetc(f.fp) != EOF)
+            rc = OSH_EPARSE;
+    }
+
+    fclose(f.fp);
+    free(f.z);
+    if (rc != OSH_OK) {
+        osh_bdo_free(x, nx);
+        return rc;
+    }
+
+    *r = x;
+    *nrec = nx;
+    return OSH_OK;
+}
@@ -0,0 +1,195 @@
+#ifndef _OSH_BDO_H
+#define _OSH_BDO_H
+
+/**
+ * @file osh_bdo.h
+ * @brief Tagged binary result files (.bdo)
+ *
+ * A .bdo file is a sequence of tagged records. Each record is an array of
+ * characters, 64 bit integers or doubles, and its tag says what it holds.
+ * Readers skip tags they do not know, so records can be added without
+ * breaking older readers; the version only changes when the layout below
+ * does.
+ *
+ * File layout, all integers and doubles little-endian:
+ *
+ *   offset  size  content
+ *        0     8  magic "OSHBDO\0\0"
+ *        8     4  format version (OSH_BDO_VERSION)
+ *       12     4  codec of the chunks (OSH_BDO_CODEC_*)
+ *       16        records, each:
+ *                   u32 tag, u32 type (OSH_BDO_TYPE_*)
+ *                   u64 number of elements n
+ *                   the n elements in chunks of up to OSH_BDO_CHUNK bytes:
+ *                     u32 bytes of the chunk, u32 bytes stored, stored bytes
+ *                   a chunk whose stored size equals its size is not compressed
+ *      end        record OSH_BDO_TAG_END with no elements
+ *                 u64 FNV-1a hash of all preceding bytes
+ *
+ * Records are written chunk by chunk as they are produced, so a large mesh
+ * goes from scorer memory to disk through one chunk sized buffer. With
+ * zstd support built in (-DOSH_WITH_ZSTD=ON) chunks can be compressed, a
+ * chunk which does not shrink is stored as is. Files are written under a
+ * temporary name and renamed when complete.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OSH_BDO_VERSION 1u
+#define OSH_BDO_CHUNK 65536 /* max. bytes of a chunk before compression */
+
+/* element types */
+#define OSH_BDO_TYPE_STR 1 /* bytes of a string, not terminated */
+#define OSH_BDO_TYPE_I64 2 /* signed 64 bit integers */
+#define OSH_BDO_TYPE_F64 3 /* doubles */
+
+/* codecs */
+#define OSH_BDO_CODEC_NONE 0
+#define OSH_BDO_CODEC_ZSTD 1
+
+/* tags */
+#define OSH_BDO_TAG_END 0          /* last record */
+#define OSH_BDO_TAG_VERSION 1      /* str, version of the writing program */
+#define OSH_BDO_TAG_NPRIM 2        /* i64, number of primaries */
+#define OSH_BDO_TAG_GEO_TYPE 10    /* i64, scoring geometry type */
+#define OSH_BDO_TAG_GEO_NAME 11    /* str, name of the geometry */
+#define OSH_BDO_TAG_GEO_N 12       /* i64[3], bins along each axis */
+#define OSH_BDO_TAG_GEO_MIN 13     /* f64[3], lower edge along each axis, angles in degrees */
+#define OSH_BDO_TAG_GEO_MAX 14     /* f64[3], upper edge along each axis, angles in degrees */
+#define OSH_BDO_TAG_GEO_CENTER 15  /* f64[3], center of a cylinder or sphere */
+#define OSH_BDO_TAG_GEO_ZONES 16   /* i64, zone id of each bin */
+#define OSH_BDO_TAG_PAGE 20        /* i64, quantity, starts a page */
+#define OSH_BDO_TAG_PAGE_FILTER 21 /* str, names of the filters of the page */
+#define OSH_BDO_TAG_PAGE_DATA 22   /* f64, mean per primary of each bin, LET averaged over all primaries */
+#define OSH_BDO_TAG_PAGE_ERROR 23  /* f64, standard error of the mean of each bin, not for LET */
+#define OSH_BDO_TAG_PAGE_EAXIS 24  /* f64[3], spectrum: emin, emax [MeV] and number of log energy bins */
+
+/**
+ * @struct osh_bdo_writer
+ *
+ * @brief A .bdo file being written.
+ *
+ * Errors are sticky: after the first failure all calls do nothing and
+ * return it, and osh_bdo_close() removes the file.
+ */
+struct osh_bdo_writer {
+    FILE *fp;
+    char *tmp;          /* temporary name */
+    char *path;         /* final name */
+    uint64_t h;         /* running hash */
+    int codec;          /* OSH_BDO_CODEC_* */
+    unsigned char *raw; /* a chunk, little-endian */
+    unsigned char *z;   /* a compressed chunk, NULL without compression */
+    size_t zcap;        /* bytes of z */
+    int rc;             /* first error */
+};
+
+/**
+ * @typedef osh_bdo_fill_cb
+ * @brief Fill the elements first .. first + n - 1 of a streamed record into x.
+ */
+typedef void (*osh_bdo_fill_cb)(void *data, size_t first, size_t n, double *x);
+
+/**
+ * @struct osh_bdo_record
+ *
+ * @brief A record read back from a file.
+ */
+struct osh_bdo_record {
+    uint32_t tag;
+    uint32_t type; /* OSH_BDO_TYPE_* */
+    size_t n;      /* number of elements */
+    void *data;    /* char[n + 1] NUL terminated, int64_t[n] or double[n] */
+};
+
+/**
+ * @brief Create a .bdo file and write its header.
+ *
+ * @param[out] w Writer.
+ * @param[in] path File name.
+ * @param[in] codec OSH_BDO_CODEC_*.
+ *
+ * @returns OSH_OK, OSH_ENOTSUP for a codec not built in, OSH_EIO or OSH_ENOMEM.
+ *          On error nothing is left to close.
+ */
+int osh_bdo_open(struct osh_bdo_writer *w, const char *path, int codec);
+
+/**
+ * @brief Write a string record.
+ *
+ * @returns OSH_OK or the first error of w.
+ */
+int osh_bdo_str(struct osh_bdo_writer *w, uint32_t tag, const char *s);
+
+/**
+ * @brief Write an integer record.
+ *
+ * @returns OSH_OK or the first error of w.
+ */
+int osh_bdo_i64(struct osh_bdo_writer *w, uint32_t tag, int64_t const *x, size_t n);
+
+/**
+ * @brief Write a double record.
+ *
+ * @returns OSH_OK or the first error of w.
+ */
+int osh_bdo_f64(struct osh_bdo_writer *w, uint32_t tag, double const *x, size_t n);
+
+/**
+ * @brief Write a double record produced chunk by chunk.
+ *
+ * fill is called for consecutive ranges of at most OSH_BDO_CHUNK / 8
+ * elements, so the record is never held in memory as a whole.
+ *
+ * @param[in,out] w Writer.
+ * @param[in] tag Tag.
+ * @param[in] n Number of elements.
+ * @param[in] fill Producer of the elements.
+ * @param[in] data Passed to fill.
+ *
+ * @returns OSH_OK or the first error of w.
+ */
+int osh_bdo_f64_stream(struct osh_bdo_writer *w, uint32_t tag, size_t n, osh_bdo_fill_cb fill, void *data);
+
+/**
+ * @brief Write the end record, close the file and move it in place.
+ *
+ * @param[in] w Writer, released.
+ *
+ * @returns OSH_OK or the first error.
+ */
+int osh_bdo_close(struct osh_bdo_writer *w);
+
+/**
+ * @brief Read all records of a .bdo file.
+ *
+ * @param[in] path File name.
+ * @param[out] r Newly allocated records without the end record, release with osh_bdo_free().
+ * @param[out] nrec Number of records.
+ *
+ * @returns OSH_OK, OSH_EIO, OSH_EPARSE for a file which is not a .bdo file
+ *          or fails the checksum, OSH_EINCOMPLETE for a truncated file,
+ *          OSH_ENOTSUP for an unknown version or a codec not built in, or
+ *          OSH_ENOMEM.
+ */
+int osh_bdo_read(const char *path, struct osh_bdo_record **r, size_t *nrec);
+
+/**
+ * @brief Free records returned by osh_bdo_read().
+ *
+ * @param[in] r Records.
+ * @param[in] nrec Number of records.
+ */
+void osh_bdo_free(struct osh_bdo_record *r, size_t nrec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OSH_BDO_H */
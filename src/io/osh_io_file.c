@@ -0,0 +1,58 @@
+#include "io/_osh_io_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_le.h"
+#include "common/osh_rc.h"
+
+/* open path.tmp for writing */
+int _osh_io_open_tmp(const char *path, FILE **fp, char **tmp) {
+    *fp = NULL;
+    *tmp = malloc(strlen(path) + 5);
+    if (!*tmp)
+        return OSH_ENOMEM;
+    sprintf(*tmp, "%s.tmp", path);
+    *fp = fopen(*tmp, "wb");
+    if (!*fp) {
+        free(*tmp);
+        *tmp = NULL;
+        return OSH_EIO;
+    }
+    return OSH_OK;
+}
+
+/* close the temporary file and move it in place, or remove it on error */
+int _osh_io_close_tmp(FILE *fp, char *tmp, const char *path, int rc) {
+    if (fclose(fp) != 0 && rc == OSH_OK)
+        rc = OSH_EIO;
+    if (rc == OSH_OK) {
+        remove(path); /* rename() does not replace existing files on Windows */
+        if (rename(tmp, path) != 0)
+            rc = OSH_EIO;
+    }
+    if (rc != OSH_OK)
+        remove(tmp);
+    free(tmp);
+    return rc;
+}
+
+/* write and hash, sticky on error */
+void _osh_io_emit(FILE *fp, uint64_t *h, int *rc, unsigned char const *b, size_t len) {
+    if (*rc != OSH_OK)
+        return;
+    if (fwrite(b, 1, len, fp) != len) {
+        *rc = OSH_EIO;
+        return;
+    }
+    *h = _fnv1a(*h, b, len);
+}
+
+/* read and hash */
+int _osh_io_read(FILE *fp, uint64_t *h, unsigned char *b, size_t len) {
+    if (fread(b, 1, len, fp) != len)
+        return ferror(fp) ? OSH_EIO : OSH_EINCOMPLETE;
+    *h = _fnv1a(*h, b, len);
+    return OSH_OK;
+}
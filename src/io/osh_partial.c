@@ -0,0 +1,405 @@
+#include "io/osh_partial.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_le.h"
+#include "common/osh_rc.h"
+#include "io/_osh_io_file.h"
+
+#define PARTIAL_MAGIC "OSHPARTL"
+#define PARTIAL_HEADER 24                        /* bytes before the first block */
+#define PARTIAL_BLOCK (OSH_PARTIAL_NAMELEN + 16) /* bytes of a block header */
+#define PARTIAL_PIECE 8192                       /* doubles per piece when streaming */
+
+/* a file with the running hash of all bytes read from it */
+struct pfile {
+    FILE *fp;
+    uint64_t h;
+};
+
+/* check the trailing hash against everything read so far */
+static int _pcheck(struct pfile *f) {
+    unsigned char b[8];
+
+    if (fread(b, 1, 8, f->fp) != 8)
+        return ferror(f->fp) ? OSH_EIO : OSH_EINCOMPLETE;
+    if (_get_u64(b) != f->h)
+        return OSH_EPARSE;
+    if (fgetc(f->fp) != EOF) /* trailing garbage */
+        return OSH_EPARSE;
+    return OSH_OK;
+}
+
+static int _read_header(struct pfile *f, uint64_t *nprim, uint32_t *nblocks) {
+    unsigned char b[PARTIAL_HEADER];
+    int rc;
+
+    rc = _osh_io_read(f->fp, &f->h, b, PARTIAL_HEADER);
+    if (rc == OSH_EINCOMPLETE)
+        return OSH_EPARSE; /* too short to be a partial result at all */
+    if (rc != OSH_OK)
+        return rc;
+    if (memcmp(b, PARTIAL_MAGIC, 8) != 0)
+        return OSH_EPARSE;
+    if (_get_u32(b + 8) != OSH_PARTIAL_VERSION)
+        return OSH_ENOTSUP;
+    *nblocks = _get_u32(b + 12);
+    *nprim = _get_u64(b + 16);
+    return OSH_OK;
+}
+
+/* block header: name, number of bins and flags */
+static int _read_block(struct pfile *f, char *name, uint64_t *n, uint32_t *flags) {
+    unsigned char b[PARTIAL_BLOCK];
+    int rc;
+
+    rc = _osh_io_read(f->fp, &f->h, b, PARTIAL_BLOCK);
+    if (rc != OSH_OK)
+        return rc;
+    memcpy(name, b, OSH_PARTIAL_NAMELEN);
+    if (name[OSH_PARTIAL_NAMELEN - 1] != '\0')
+        return OSH_EPARSE;
+    *n = _get_u64(b + OSH_PARTIAL_NAMELEN);
+    *flags = _get_u32(b + OSH_PARTIAL_NAMELEN + 8);
+    if (*flags & ~OSH_PARTIAL_SUM2)
+        return OSH_EPARSE;
+    return OSH_OK;
+}
+
+/* read n doubles in pieces; add them to x if add, else store them */
+static int _read_f64(struct pfile *f, unsigned char *raw, double *x, size_t n, int add) {
+    size_t i, m;
+    int rc;
+
+    while (n > 0) {
+        m = (n < PARTIAL_PIECE) ? n : PARTIAL_PIECE;
+        rc = _osh_io_read(f->fp, &f->h, raw, 8 * m);
+        if (rc != OSH_OK)
+            return rc;
+        if (add)
+            for (i = 0; i < m; i++)
+                x[i] += _get_f64(raw + 8 * i);
+        else
+            for (i = 0; i < m; i++)
+                x[i] = _get_f64(raw + 8 * i);
+        x += m;
+        n -= m;
+    }
+    return OSH_OK;
+}
+
+int osh_partial_open(struct osh_partial_writer *w, const char *path, uint64_t nprim, size_t nblocks) {
+    unsigned char b[PARTIAL_HEADER];
+    int rc;
+
+    memset(w, 0, sizeof(*w));
+    if (nblocks > UINT32_MAX)
+        return OSH_EINVAL;
+    w->raw = malloc(8 * PARTIAL_PIECE);
+    w->x = malloc(PARTIAL_PIECE * sizeof(*w->x));
+    w->path = malloc(strlen(path) + 1);
+    if (!w->raw || !w->x || !w->path) {
+        free(w->raw);
+        free(w->x);
+        free(w->path);
+        return OSH_ENOMEM;
+    }
+    strcpy(w->path, path);
+
+    rc = _osh_io_open_tmp(path, &w->fp, &w->tmp);
+    if (rc != OSH_OK) {
+        free(w->raw);
+        free(w->x);
+        free(w->path);
+        return rc;
+    }
+    w->h = OSH_FNV1A_INIT;
+    w->nblocks = nblocks;
+    w->rc = OSH_OK;
+
+    memcpy(b, PARTIAL_MAGIC, 8);
+    _put_u32(b + 8, OSH_PARTIAL_VERSION);
+    _put_u32(b + 12, (uint32_t) nblocks);
+    _put_u64(b + 16, nprim);
+    _osh_io_emit(w->fp, &w->h, &w->rc, b, PARTIAL_HEADER);
+    if (w->rc != OSH_OK) {
+        rc = w->rc;
+        osh_partial_close(w);
+        return rc;
+    }
+    return OSH_OK;
+}
+
+/* n doubles from fill, piece by piece */
+static void _stream_f64(struct osh_partial_writer *w, size_t n, osh_partial_fill_cb fill, void *data) {
+    size_t first, i, m;
+
+    for (first = 0; first < n && w->rc == OSH_OK; first += m) {
+        m = (n - first < PARTIAL_PIECE) ? n - first : PARTIAL_PIECE;
+        fill(data, first, m, w->x);
+        for (i = 0; i < m; i++)
+            _put_f64(w->raw + 8 * i, w->x[i]);
+        _osh_io_emit(w->fp, &w->h, &w->rc, w->raw, 8 * m);
+    }
+}
+
+int osh_partial_block(struct osh_partial_writer *w,
+                      const char *name,
+                      size_t n,
+                      osh_partial_fill_cb sum,
+                      osh_partial_fill_cb sum2,
+                      void *data) {
+    unsigned char b[PARTIAL_BLOCK];
+    size_t len;
+
+    if (w->rc != OSH_OK)
+        return w->rc;
+    len = strlen(name);
+    if (len >= OSH_PARTIAL_NAMELEN || w->nwritten == w->nblocks) {
+        w->rc = OSH_EINVAL;
+        return w->rc;
+    }
+
+    memset(b, 0, sizeof(b));
+    memcpy(b, name, len);
+    _put_u64(b + OSH_PARTIAL_NAMELEN, (uint64_t) n);
+    _put_u32(b + OSH_PARTIAL_NAMELEN + 8, sum2 ? OSH_PARTIAL_SUM2 : 0u);
+    _osh_io_emit(w->fp, &w->h, &w->rc, b, PARTIAL_BLOCK);
+    _stream_f64(w, n, sum, data);
+    if (sum2)
+        _stream_f64(w, n, sum2, data);
+    w->nwritten++;
+    return w->rc;
+}
+
+int osh_partial_close(struct osh_partial_writer *w) {
+    unsigned char b[8];
+    int rc;
+
+    if (w->rc == OSH_OK && w->nwritten != w->nblocks)
+        w->rc = OSH_EINVAL;
+    if (w->rc == OSH_OK) {
+        _put_u64(b, w->h);
+        if (fwrite(b, 1, 8, w->fp) != 8)
+            w->rc = OSH_EIO;
+    }
+    rc = _osh_io_close_tmp(w->fp, w->tmp, w->path, w->rc);
+
+    free(w->raw);
+    free(w->x);
+    free(w->path);
+    memset(w, 0, sizeof(*w));
+    return rc;
+}
+
+/* fills of osh_partial_write(), from the arrays of a block */
+static void _fill_sum(void *data, size_t first, size_t n, double *x) {
+    struct osh_partial_block const *b = data;
+
+    memcpy(x, b->sum + first, n * sizeof(*x));
+}
+
+static void _fill_sum2(void *data, size_t first, size_t n, double *x) {
+    struct osh_partial_block const *b = data;
+
+    memcpy(x, b->sum2 + first, n * sizeof(*x));
+}
+
+int osh_partial_write(const char *path, uint64_t nprim, struct osh_partial_block const *b, size_t nblocks) {
+    struct osh_partial_writer w;
+    size_t i;
+    int rc;
+
+    for (i = 0; i < nblocks; i++)
+        if (memchr(b[i].name, '\0', OSH_PARTIAL_NAMELEN) == NULL)
+            return OSH_EINVAL;
+
+    rc = osh_partial_open(&w, path, nprim, nblocks);
+    if (rc != OSH_OK)
+        return rc;
+    for (i = 0; i < nblocks; i++)
+        osh_partial_block(&w, b[i].name, b[i].n, _fill_sum, b[i].sum2 ? _fill_sum2 : NULL, (void *) &b[i]);
+    return osh_partial_close(&w);
+}
+
+void osh_partial_free(struct osh_partial_block *b, size_t nblocks) {
+    size_t i;
+
+    if (!b)
+        return;
+    for (i = 0; i < nblocks; i++) {
+        free(b[i].sum);
+        free(b[i].sum2);
+    }
+    free(b);
+}
+
+int osh_partial_read(const char *path, uint64_t *nprim, struct osh_partial_block **b, size_t *nblocks) {
+    struct osh_partial_block *x;
+    struct pfile f;
+    unsigned char *raw;
+    uint64_t n;
+    uint32_t nb, flags;
+    size_t i;
+    int rc;
+
+    *b = NULL;
+    *nblocks = 0;
+    nb = 0;
+
+    f.fp = fopen(path, "rb");
+    if (!f.fp)
+        return OSH_EIO;
+    f.h = OSH_FNV1A_INIT;
+
+    x = NULL;
+    raw = malloc(8 * PARTIAL_PIECE);
+    rc = raw ? _read_header(&f, nprim, &nb) : OSH_ENOMEM;
+    if (rc == OSH_OK) {
+        x = calloc(nb ? nb : 1, sizeof(*x));
+        if (!x)
+            rc = OSH_ENOMEM;
+    }
+
+    for (i = 0; rc == OSH_OK && i < nb; i++) {
+        rc = _read_block(&f, x[i].name, &n, &flags);
+        if (rc != OSH_OK)
+            break;
+        if (n > SIZE_MAX / sizeof(double)) {
+            rc = OSH_EPARSE;
+            break;
+        }
+        x[i].n = (size_t) n;
+        x[i].sum = malloc((n ? n : 1) * sizeof(double));
+        if (flags & OSH_PARTIAL_SUM2)
+            x[i].sum2 = malloc((n ? n : 1) * sizeof(double));
+        if (!x[i].sum || ((flags & OSH_PARTIAL_SUM2) && !x[i].sum2)) {
+            rc = OSH_ENOMEM;
+            break;
+        }
+        rc = _read_f64(&f, raw, x[i].sum, x[i].n, 0);
+        if (rc == OSH_OK && x[i].sum2)
+            rc = _read_f64(&f, raw, x[i].sum2, x[i].n, 0);
+    }
+    if (rc == OSH_OK)
+        rc = _pcheck(&f);
+
+    fclose(f.fp);
+    free(raw);
+    if (rc != OSH_OK) {
+        osh_partial_free(x, nb);
+        return rc;
+    }
+
+    *b = x;
+    *nblocks = nb;
+    return OSH_OK;
+}
+
+/* inputs of a merge, read in step with the output */
+struct msrc {
+    struct pfile *f;
+    size_t nin;
+    unsigned char *raw;
+    int rc; /* first error reading the inputs */
+};
+
+/* the next n bins of all inputs, added in the order of the inputs */
+static void _fill_merge(void *data, size_t first, size_t n, double *x) {
+    struct msrc *s = data;
+    size_t i;
+
+    (void) first;
+    memset(x, 0, n * sizeof(*x));
+    for (i = 0; i < s->nin && s->rc == OSH_OK; i++)
+        s->rc = _read_f64(&s->f[i], s->raw, x, n, 1);
+}
+
+int osh_partial_merge(const char *out, const char *const *in, size_t nin) {
+    struct osh_partial_writer w;
+    struct msrc s;
+    struct pfile *f;
+    char name[OSH_PARTIAL_NAMELEN];
+    char name0[OSH_PARTIAL_NAMELEN];
+    uint64_t nprim, np, n, n0;
+    uint32_t nb, nb0, flags, flags0, b;
+    size_t i;
+    int rc;
+
+    if (nin == 0)
+        return OSH_EINVAL;
+
+    f = calloc(nin, sizeof(*f));
+    s.raw = malloc(8 * PARTIAL_PIECE);
+    if (!f || !s.raw) {
+        free(f);
+        free(s.raw);
+        return OSH_ENOMEM;
+    }
+    s.f = f;
+    s.nin = nin;
+    s.rc = OSH_OK;
+
+    /* headers of all inputs */
+    rc = OSH_OK;
+    nprim = 0;
+    nb0 = 0;
+    for (i = 0; i < nin && rc == OSH_OK; i++) {
+        f[i].fp = fopen(in[i], "rb");
+        f[i].h = OSH_FNV1A_INIT;
+        if (!f[i].fp) {
+            rc = OSH_EIO;
+            break;
+        }
+        rc = _read_header(&f[i], &np, &nb);
+        if (rc == OSH_OK && i > 0 && nb != nb0)
+            rc = OSH_EINVAL;
+        nb0 = nb;
+        nprim += np;
+    }
+    if (rc == OSH_OK)
+        rc = osh_partial_open(&w, out, nprim, nb0);
+
+    if (rc == OSH_OK) {
+        /* block by block, piece by piece: every input is read front to back */
+        for (b = 0; b < nb0 && w.rc == OSH_OK; b++) {
+            n0 = 0;
+            flags0 = 0;
+            for (i = 0; i < nin && s.rc == OSH_OK; i++) {
+                s.rc = _read_block(&f[i], i ? name : name0, &n, &flags);
+                if (s.rc != OSH_OK)
+                    break;
+                if (i == 0) {
+                    n0 = n;
+                    flags0 = flags;
+                } else if (n != n0 || flags != flags0 || strcmp(name, name0) != 0) {
+                    s.rc = OSH_EINVAL;
+                }
+            }
+            if (s.rc == OSH_OK && n0 > SIZE_MAX / sizeof(double))
+                s.rc = OSH_EPARSE;
+            if (s.rc == OSH_OK)
+                osh_partial_block(&w,
+                                  name0,
+                                  (size_t) n0,
+                                  _fill_merge,
+                                  (flags0 & OSH_PARTIAL_SUM2) ? _fill_merge : NULL,
+                                  &s);
+            if (s.rc != OSH_OK && w.rc == OSH_OK)
+                w.rc = s.rc; /* the output is dropped on close */
+        }
+
+        for (i = 0; i < nin && w.rc == OSH_OK; i++)
+            w.rc = _pcheck(&f[i]);
+        rc = osh_partial_close(&w);
+    }
+
+    for (i = 0; i < nin; i++)
+        if (f[i].fp)
+            fclose(f[i].fp);
+    free(f);
+    free(s.raw);
+    return rc;
+}
@@ -0,0 +1,187 @@
+#ifndef _OSH_PARTIAL_H
+#define _OSH_PARTIAL_H
+
+/**
+ * @file osh_partial.h
+ * @brief Mergeable partial results of independent jobs
+ *
+ * A job of a distributed run (one process, one slice of the primaries)
+ * writes its scores as a partial result. Each block holds one scored
+ * quantity with, per bin, the sum of the scores of all primaries and
+ * optionally the sum of their squares. Blocks of several jobs are merged by
+ * adding sums, sums of squares and primary counts, which combines the
+ * variances exactly:
+ *
+ *   mean = sum / N,  var(mean) = (sum2 / N - mean^2) / (N - 1)
+ *
+ * with N the merged number of primaries.
+ *
+ * File layout, all integers and doubles little-endian:
+ *
+ *   offset  size  content
+ *        0     8  magic "OSHPARTL"
+ *        8     4  format version (OSH_PARTIAL_VERSION)
+ *       12     4  number of blocks
+ *       16     8  number of primaries
+ *       24        blocks, each:
+ *                   32 bytes name, NUL padded
+ *                   u64 number of bins n
+ *                   u32 flags (OSH_PARTIAL_SUM2), u32 reserved
+ *                   n doubles sum, then n doubles sum2 if flagged
+ *      end     8  FNV-1a hash of all preceding bytes
+ *
+ * Files are written under a temporary name and renamed when complete. A
+ * writer streams the blocks one piece at a time, so a block never has to be
+ * held in memory as a whole.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OSH_PARTIAL_VERSION 1u
+#define OSH_PARTIAL_NAMELEN 32 /* bytes of a block name, including the terminating NUL */
+#define OSH_PARTIAL_SUM2 0x1u  /* block carries sums of squares */
+
+/**
+ * @struct osh_partial_block
+ *
+ * @brief One scored quantity of a partial result.
+ */
+struct osh_partial_block {
+    char name[OSH_PARTIAL_NAMELEN]; /* name of the quantity */
+    size_t n;                       /* number of bins */
+    double *sum;                    /* per bin sum of scores over all primaries */
+    double *sum2;                   /* per bin sum of squared per-primary scores, or NULL */
+};
+
+/**
+ * @struct osh_partial_writer
+ *
+ * @brief A partial result being written.
+ *
+ * Errors are sticky: after the first failure all calls do nothing and
+ * return it, and osh_partial_close() removes the file.
+ */
+struct osh_partial_writer {
+    FILE *fp;
+    char *tmp;          /* temporary name */
+    char *path;         /* final name */
+    uint64_t h;         /* running hash */
+    unsigned char *raw; /* a piece, little-endian */
+    double *x;          /* a piece, as filled in */
+    size_t nblocks;     /* blocks announced in the header */
+    size_t nwritten;    /* blocks written */
+    int rc;             /* first error */
+};
+
+/**
+ * @typedef osh_partial_fill_cb
+ * @brief Fill the bins first .. first + n - 1 of a streamed block into x.
+ */
+typedef void (*osh_partial_fill_cb)(void *data, size_t first, size_t n, double *x);
+
+/**
+ * @brief Create a partial result and write its header.
+ *
+ * @param[out] w Writer.
+ * @param[in] path File name.
+ * @param[in] nprim Number of primaries the sums are over.
+ * @param[in] nblocks Number of blocks which will be written.
+ *
+ * @returns OSH_OK, OSH_EINVAL for too many blocks, OSH_EIO or OSH_ENOMEM.
+ *          On error nothing is left to close.
+ */
+int osh_partial_open(struct osh_partial_writer *w, const char *path, uint64_t nprim, size_t nblocks);
+
+/**
+ * @brief Write a block produced piece by piece.
+ *
+ * sum, then sum2, are called for consecutive ranges of bins.
+ *
+ * @param[in,out] w Writer.
+ * @param[in] name Name of the quantity, shorter than OSH_PARTIAL_NAMELEN.
+ * @param[in] n Number of bins.
+ * @param[in] sum Producer of the sums.
+ * @param[in] sum2 Producer of the sums of squares, NULL for none.
+ * @param[in] data Passed to sum and sum2.
+ *
+ * @returns OSH_OK, or the first error of w, OSH_EINVAL for a name too long
+ *          or more blocks than announced.
+ */
+int osh_partial_block(struct osh_partial_writer *w,
+                      const char *name,
+                      size_t n,
+                      osh_partial_fill_cb sum,
+                      osh_partial_fill_cb sum2,
+                      void *data);
+
+/**
+ * @brief Write the checksum, close the file and move it in place.
+ *
+ * @param[in] w Writer, released.
+ *
+ * @returns OSH_OK, OSH_EINVAL if fewer blocks were written than announced, or the first error.
+ */
+int osh_partial_close(struct osh_partial_writer *w);
+
+/**
+ * @brief Write a partial result.
+ *
+ * @param[in] path File name.
+ * @param[in] nprim Number of primaries the sums are over.
+ * @param[in] b Blocks.
+ * @param[in] nblocks Number of blocks.
+ *
+ * @returns OSH_OK, OSH_EINVAL for an unterminated block name, OSH_EIO or OSH_ENOMEM.
+ */
+int osh_partial_write(const char *path, uint64_t nprim, struct osh_partial_block const *b, size_t nblocks);
+
+/**
+ * @brief Read a whole partial result into memory.
+ *
+ * @param[in] path File name.
+ * @param[out] nprim Number of primaries.
+ * @param[out] b Newly allocated blocks, release with osh_partial_free().
+ * @param[out] nblocks Number of blocks.
+ *
+ * @returns OSH_OK, OSH_EIO, OSH_EPARSE for a file which is not a partial
+ *          result or fails the checksum, OSH_EINCOMPLETE for a truncated
+ *          file, OSH_ENOTSUP for an unknown version, or OSH_ENOMEM.
+ */
+int osh_partial_read(const char *path, uint64_t *nprim, struct osh_partial_block **b, size_t *nblocks);
+
+/**
+ * @brief Free blocks returned by osh_partial_read().
+ *
+ * @param[in] b Blocks.
+ * @param[in] nblocks Number of blocks.
+ */
+void osh_partial_free(struct osh_partial_block *b, size_t nblocks);
+
+/**
+ * @brief Merge partial results into one.
+ *
+ * The inputs are streamed piece by piece, memory use does not depend on
+ * the number of bins. All inputs must have the same blocks, with the same
+ * names, numbers of bins and flags. Sums are added in the order of the
+ * inputs. No output is left behind on failure.
+ *
+ * @param[in] out Output file name, may not be one of the inputs.
+ * @param[in] in Input file names.
+ * @param[in] nin Number of inputs, > 0.
+ *
+ * @returns OSH_OK, OSH_EINVAL for inputs with different blocks, or any
+ *          error of osh_partial_read().
+ */
+int osh_partial_merge(const char *out, const char *const *in, size_t nin);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OSH_PARTIAL_H */
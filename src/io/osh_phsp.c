@@ -0,0 +1,219 @@
+#include "io/osh_phsp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_le.h"
+#include "common/osh_rc.h"
+#include "io/_osh_io_file.h"
+
+#define PHSP_MAGIC "OSHPHSP\0"
+#define PHSP_HEADER 16  /* bytes before the first record */
+#define PHSP_TRAILER 24 /* bytes after the last record */
+
+static void _put_record(unsigned char *b, struct osh_phsp_record const *r) {
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        _put_f64(b + 8 * i, r->p[i]);
+        _put_f64(b + 24 + 8 * i, r->v[i]);
+    }
+    _put_f64(b + 48, r->e);
+    _put_f64(b + 56, r->wt);
+    _put_f64(b + 64, r->amass);
+    _put_f64(b + 72, r->amu);
+    _put_u32(b + 80, (uint32_t) r->id);
+    _put_u32(b + 84, (uint32_t) r->z);
+    _put_u32(b + 88, r->a);
+    _put_u32(b + 92, r->gen);
+    _put_u32(b + 96, (uint32_t) r->pdg);
+    _put_u32(b + 100, 0u);
+}
+
+static void _get_record(unsigned char const *b, struct osh_phsp_record *r) {
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        r->p[i] = _get_f64(b + 8 * i);
+        r->v[i] = _get_f64(b + 24 + 8 * i);
+    }
+    r->e = _get_f64(b + 48);
+    r->wt = _get_f64(b + 56);
+    r->amass = _get_f64(b + 64);
+    r->amu = _get_f64(b + 72);
+    r->id = (int) (int32_t) _get_u32(b + 80);
+    r->z = (int) (int32_t) _get_u32(b + 84);
+    r->a = _get_u32(b + 88);
+    r->gen = _get_u32(b + 92);
+    r->pdg = (int) (int32_t) _get_u32(b + 96);
+}
+
+int osh_phsp_open(struct osh_phsp_writer *w, const char *path) {
+    unsigned char b[PHSP_HEADER];
+    int rc;
+
+    memset(w, 0, sizeof(*w));
+    w->raw = malloc(OSH_PHSP_PIECE * OSH_PHSP_RECORD);
+    w->path = malloc(strlen(path) + 1);
+    if (!w->raw || !w->path) {
+        free(w->raw);
+        free(w->path);
+        memset(w, 0, sizeof(*w));
+        return OSH_ENOMEM;
+    }
+    strcpy(w->path, path);
+
+    rc = _osh_io_open_tmp(path, &w->fp, &w->tmp);
+    if (rc != OSH_OK) {
+        free(w->raw);
+        free(w->path);
+        memset(w, 0, sizeof(*w));
+        return rc;
+    }
+    w->h = OSH_FNV1A_INIT;
+    w->rc = OSH_OK;
+
+    memcpy(b, PHSP_MAGIC, 8);
+    _put_u32(b + 8, OSH_PHSP_VERSION);
+    _put_u32(b + 12, OSH_PHSP_RECORD);
+    _osh_io_emit(w->fp, &w->h, &w->rc, b, PHSP_HEADER);
+    if (w->rc != OSH_OK) {
+        /* nothing is left to close */
+        rc = w->rc;
+        osh_phsp_discard(w);
+        return rc;
+    }
+    return OSH_OK;
+}
+
+int osh_phsp_write(struct osh_phsp_writer *w, struct osh_phsp_record const *r, size_t n) {
+    size_t i, m;
+
+    while (n > 0 && w->rc == OSH_OK) {
+        m = (n < OSH_PHSP_PIECE) ? n : OSH_PHSP_PIECE;
+        for (i = 0; i < m; i++)
+            _put_record(w->raw + OSH_PHSP_RECORD * i, &r[i]);
+        _osh_io_emit(w->fp, &w->h, &w->rc, w->raw, OSH_PHSP_RECORD * m);
+        w->n += m;
+        r += m;
+        n -= m;
+    }
+    return w->rc;
+}
+
+int osh_phsp_close(struct osh_phsp_writer *w, uint64_t nprim) {
+    unsigned char b[PHSP_TRAILER];
+    int rc;
+
+    _put_u64(b, w->n);
+    _put_u64(b + 8, nprim);
+    _osh_io_emit(w->fp, &w->h, &w->rc, b, 16);
+    if (w->rc == OSH_OK) {
+        _put_u64(b + 16, w->h);
+        if (fwrite(b + 16, 1, 8, w->fp) != 8)
+            w->rc = OSH_EIO;
+    }
+    rc = _osh_io_close_tmp(w->fp, w->tmp, w->path, w->rc);
+
+    free(w->raw);
+    free(w->path);
+    memset(w, 0, sizeof(*w));
+    return rc;
+}
+
+void osh_phsp_discard(struct osh_phsp_writer *w) {
+    if (!w->fp)
+        return;
+    _osh_io_close_tmp(w->fp, w->tmp, w->path, OSH_EIO);
+    free(w->raw);
+    free(w->path);
+    memset(w, 0, sizeof(*w));
+}
+
+/* a file with the running hash of all bytes read from it */
+struct rfile {
+    FILE *fp;
+    uint64_t h;
+};
+
+/* number of records from the size of the file, with the header read */
+static int _read_header(struct rfile *f, size_t *n) {
+    unsigned char b[PHSP_HEADER];
+    long size;
+    int rc;
+
+    if (fseek(f->fp, 0, SEEK_END) != 0 || (size = ftell(f->fp)) < 0 || fseek(f->fp, 0, SEEK_SET) != 0)
+        return OSH_EIO;
+    rc = _osh_io_read(f->fp, &f->h, b, PHSP_HEADER);
+    if (rc == OSH_EINCOMPLETE)
+        return OSH_EPARSE; /* too short to be a phase-space file at all */
+    if (rc != OSH_OK)
+        return rc;
+    if (memcmp(b, PHSP_MAGIC, 8) != 0)
+        return OSH_EPARSE;
+    if (_get_u32(b + 8) != OSH_PHSP_VERSION)
+        return OSH_ENOTSUP;
+    if (_get_u32(b + 12) != OSH_PHSP_RECORD)
+        return OSH_EPARSE;
+    if (size < PHSP_HEADER + PHSP_TRAILER || (size - PHSP_HEADER - PHSP_TRAILER) % OSH_PHSP_RECORD != 0)
+        return OSH_EINCOMPLETE;
+    *n = (size_t) ((size - PHSP_HEADER - PHSP_TRAILER) / OSH_PHSP_RECORD);
+    return OSH_OK;
+}
+
+int osh_phsp_read(const char *path, uint64_t *nprim, struct osh_phsp_record **r, size_t *n) {
+    struct osh_phsp_record *x;
+    struct rfile f;
+    unsigned char *raw;
+    unsigned char b[PHSP_TRAILER];
+    size_t nrec, i, k, m;
+    uint64_t h;
+    int rc;
+
+    *r = NULL;
+    *n = 0;
+
+    f.fp = fopen(path, "rb");
+    if (!f.fp)
+        return OSH_EIO;
+    f.h = OSH_FNV1A_INIT;
+
+    x = NULL;
+    nrec = 0;
+    raw = malloc(OSH_PHSP_PIECE * OSH_PHSP_RECORD);
+    rc = raw ? _read_header(&f, &nrec) : OSH_ENOMEM;
+    if (rc == OSH_OK) {
+        x = malloc((nrec ? nrec : 1) * sizeof(*x));
+        if (!x)
+            rc = OSH_ENOMEM;
+    }
+
+    for (k = 0; rc == OSH_OK && k < nrec; k += m) {
+        m = (nrec - k < OSH_PHSP_PIECE) ? nrec - k : OSH_PHSP_PIECE;
+        rc = _osh_io_read(f.fp, &f.h, raw, OSH_PHSP_RECORD * m);
+        for (i = 0; rc == OSH_OK && i < m; i++)
+            _get_record(raw + OSH_PHSP_RECORD * i, &x[k + i]);
+    }
+
+    if (rc == OSH_OK)
+        rc = _osh_io_read(f.fp, &f.h, b, 16);
+    if (rc == OSH_OK) {
+        h = f.h;
+        rc = _osh_io_read(f.fp, &f.h, b + 16, 8);
+        if (rc == OSH_OK && (_get_u64(b) != nrec || _get_u64(b + 16) != h))
+            rc = OSH_EPARSE;
+    }
+
+    fclose(f.fp);
+    free(raw);
+    if (rc != OSH_OK) {
+        free(x);
+        return rc;
+    }
+
+    *nprim = _get_u64(b + 8);
+    *r = x;
+    *n = nrec;
+    return OSH_OK;
+}
@@ -0,0 +1,139 @@
+#ifndef _OSH_PHSP_H
+#define _OSH_PHSP_H
+
+/**
+ * @file osh_phsp.h
+ * @brief Phase-space files of particles crossing a surface
+ *
+ * A phase-space file lists particles with their type, position, direction,
+ * kinetic energy and weight, e.g. all particles leaving a beamline. It is
+ * written by a scorer during one run and read back as the beam of another
+ * (struct beam_phsp), so an expensive beamline is simulated only once.
+ *
+ * File layout, all integers and doubles little-endian:
+ *
+ *   offset  size  content
+ *        0     8  magic "OSHPHSP\0"
+ *        8     4  format version (OSH_PHSP_VERSION)
+ *       12     4  bytes of a record (OSH_PHSP_RECORD)
+ *       16        records, each:
+ *                   f64[3] position [cm]
+ *                   f64[3] unit direction
+ *                   f64 kinetic energy [MeV], f64 weight
+ *                   f64 mass [MeV/c**2], f64 mass [amu]
+ *                   i32 particle id, i32 charge, u32 nucleon number, u32 generation
+ *                   i32 PDG code, u32 reserved
+ *      end    24  u64 number of records, u64 number of primaries of the run
+ *                 u64 FNV-1a hash of all preceding bytes
+ *
+ * Records are only ever appended, the counts follow them, so the file is
+ * written front to back in blocks of OSH_PHSP_PIECE records. Files are
+ * written under a temporary name and renamed when complete.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OSH_PHSP_VERSION 1u
+#define OSH_PHSP_RECORD 104 /* bytes of a record */
+#define OSH_PHSP_PIECE 4096 /* records encoded and written at once */
+
+/**
+ * @struct osh_phsp_record
+ *
+ * @brief One particle of a phase-space file.
+ */
+struct osh_phsp_record {
+    double p[3];      /* position [cm] */
+    double v[3];      /* unit vector of the direction */
+    double e;         /* kinetic energy [MeV] */
+    double wt;        /* statistical weight */
+    double amass;     /* mass [MeV/c**2] */
+    double amu;       /* mass [amu] */
+    int id;           /* particle id, OSH_PART_* */
+    int z;            /* charge */
+    unsigned int a;   /* nucleon number */
+    unsigned int gen; /* generation */
+    int pdg;          /* PDG code */
+};
+
+/**
+ * @struct osh_phsp_writer
+ *
+ * @brief A phase-space file being written.
+ *
+ * Errors are sticky: after the first failure all calls do nothing and
+ * return it, and osh_phsp_close() removes the file.
+ */
+struct osh_phsp_writer {
+    FILE *fp;           /* NULL if not open */
+    char *tmp;          /* temporary name */
+    char *path;         /* final name */
+    unsigned char *raw; /* OSH_PHSP_PIECE records, little-endian */
+    uint64_t n;         /* records written */
+    uint64_t h;         /* running hash */
+    int rc;             /* first error */
+};
+
+/**
+ * @brief Create a phase-space file and write its header.
+ *
+ * @param[out] w Writer.
+ * @param[in] path File name.
+ *
+ * @returns OSH_OK, OSH_EIO or OSH_ENOMEM. On error nothing is left to close.
+ */
+int osh_phsp_open(struct osh_phsp_writer *w, const char *path);
+
+/**
+ * @brief Append records.
+ *
+ * @param[in,out] w Writer.
+ * @param[in] r Records.
+ * @param[in] n Number of records.
+ *
+ * @returns OSH_OK or the first error of w.
+ */
+int osh_phsp_write(struct osh_phsp_writer *w, struct osh_phsp_record const *r, size_t n);
+
+/**
+ * @brief Write the counts, close the file and move it in place.
+ *
+ * @param[in] w Writer, released.
+ * @param[in] nprim Number of primaries of the run.
+ *
+ * @returns OSH_OK or the first error.
+ */
+int osh_phsp_close(struct osh_phsp_writer *w, uint64_t nprim);
+
+/**
+ * @brief Close a file without completing it and remove it.
+ *
+ * @param[in] w Writer, released. Does nothing if not open.
+ */
+void osh_phsp_discard(struct osh_phsp_writer *w);
+
+/**
+ * @brief Read all records of a phase-space file.
+ *
+ * @param[in] path File name.
+ * @param[out] nprim Number of primaries of the run which wrote the file.
+ * @param[out] r Newly allocated records, release with free().
+ * @param[out] n Number of records.
+ *
+ * @returns OSH_OK, OSH_EIO, OSH_EPARSE for a file which is not a
+ *          phase-space file or fails the checksum, OSH_EINCOMPLETE for a
+ *          truncated file, OSH_ENOTSUP for an unknown version, or OSH_ENOMEM.
+ */
+int osh_phsp_read(const char *path, uint64_t *nprim, struct osh_phsp_record **r, size_t *n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OSH_PHSP_H */
@@ -1,7 +1,212 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "beam/osh_beam.h"
+#include "common/osh_logger.h"
+#include "common/osh_rc.h"
+#include "gemca/osh_gemca2.h"
+#include "material/osh_material.h"
+#include "particle/osh_particle.h"
+#include "physics/osh_physics.h"
+#include "scoring/osh_scoring.h"
+#include "transport/osh_transport_run.h"
+
+static void usage(const char *prog) {
+    printf("Usage: %s [OPTIONS] [DIR]\n", prog);
+    printf("OpenShieldHIT - Monte Carlo Particle Transport\n\n");
+    printf("Runs the simulation set up by beam.dat, geo.dat, mat.dat and detect.dat\n");
+    printf("in DIR, the current directory by default, and writes the outputs of\n");
+    printf("detect.dat.\n\n");
+    printf("A run can be spread over NJOBS independent processes, on one machine or\n");
+    printf("many. Job JOB transports its slice of the primaries and writes the partial\n");
+    printf("result jobJOB.partial instead of the outputs, and its phase-space files\n");
+    printf("with _JOB added to their names. All jobs keep the seed of beam.dat, so\n");
+    printf("together they transport the same histories as a single run. The outputs\n");
+    printf("are then written by\n\n");
+    printf("  osh-merge -d DIR/detect.dat -o all.partial job*.partial\n\n");
+    printf("OPTIONS:\n");
+    printf("  -N JOB            Job of a distributed run, 0 .. NJOBS - 1 (default 0)\n");
+    printf("  -J NJOBS          Number of jobs the primaries are split into (default 1)\n");
+    printf("  -t THREADS        Worker threads, 0 for one per CPU (default 0)\n");
+    printf("  --version, -v     Print version information\n");
+    printf("  --help, -h        Show this help message\n");
+}
+
+/* a non-negative integer option */
+static int _count(const char *prog, const char *opt, const char *arg, size_t *x) {
+    char *end;
+    long v;
+
+    v = strtol(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0' || v < 0) {
+        fprintf(stderr, "%s: option %s needs a number >= 0, not '%s'\n", prog, opt, arg);
+        return OSH_EINVAL;
+    }
+    *x = (size_t) v;
+    return OSH_OK;
+}
+
+/* dir/name, NULL if out of memory */
+static char *_path(const char *dir, const char *name) {
+    char *s;
+
+    s = malloc(strlen(dir) + strlen(name) + 2);
+    if (s)
+        sprintf(s, "%s/%s", dir, name);
+    return s;
+}
+
+/* add _job to the phase-space file names, before the extension, so jobs sharing a directory do not collide */
+static int _job_filenames(struct scoring_workspace *sw, size_t job) {
+    struct scoring_output *o;
+    char *s, *dot;
+    size_t i, n;
+
+    for (i = 0; i < sw->nphsp; i++) {
+        o = &sw->outputs[sw->pages[sw->phsp[i].page].output];
+        n = strlen(o->filename) + 24;
+        s = malloc(n);
+        if (!s)
+            return OSH_ENOMEM;
+        dot = strrchr(o->filename, '.');
+        if (dot && !strchr(dot, '/'))
+            snprintf(s, n, "%.*s_%lu%s", (int) (dot - o->filename), o->filename, (unsigned long) job, dot);
+        else
+            snprintf(s, n, "%s_%lu", o->filename, (unsigned long) job);
+        free(o->filename);
+        o->filename = s;
+    }
+    return OSH_OK;
+}
+
+/* highest charge of the primaries, the physics tables are built up to it */
+static int _zmax(struct beam_workspace const *wb) {
+    size_t i;
+    int z = 1;
+
+    for (i = 0; i < wb->nspots; i++)
+        if (wb->spots[i].part && wb->spots[i].part->z > z)
+            z = wb->spots[i].part->z;
+    return z;
+}
+
+static int _run(const char *prog, const char *dir, size_t job, size_t njobs, size_t nthreads) {
+    struct beam_workspace *wb = NULL;
+    struct gemca_workspace *g = NULL;
+    struct material_workspace mw;
+    struct physics_workspace pw;
+    struct scoring_workspace sw;
+    struct transport_physics ph;
+    struct transport_tally t;
+    struct transport_run run;
+    char *fbeam, *fgeo, *fmat, *fdetect;
+    char partial[64];
+    int have_mw = 0, have_pw = 0, have_sw = 0;
+    int rc;
+
+    fbeam = _path(dir, "beam.dat");
+    fgeo = _path(dir, "geo.dat");
+    fmat = _path(dir, "mat.dat");
+    fdetect = _path(dir, "detect.dat");
+    rc = (fbeam && fgeo && fmat && fdetect) ? OSH_OK : OSH_ENOMEM;
+
+    if (rc == OSH_OK) {
+        rc = osh_beam_setup(fbeam, dir, &wb);
+        if (rc != OSH_OK)
+            fprintf(stderr, "%s: %s: %s\n", prog, fbeam, osh_strerr(rc));
+        else if (wb->nspots == 0) {
+            fprintf(stderr, "%s: %s: only beams of spots can be run\n", prog, fbeam);
+            rc = OSH_EINVAL;
+        }
+    }
+    if (rc == OSH_OK) {
+        osh_gemca_workspace_init(&g);
+        osh_gemca_load(fgeo, g);
+        rc = osh_material_load(fmat, &mw);
+        if (rc == OSH_OK) {
+            have_mw = 1;
+            rc = osh_material_check(&mw, g);
+        }
+        if (rc != OSH_OK)
+            fprintf(stderr, "%s: %s: %s\n", prog, fmat, osh_strerr(rc));
+    }
+    if (rc == OSH_OK) {
+        rc = osh_physics_init(&pw, &mw, _zmax(wb), wb->straggl, wb->scatter);
+        if (rc == OSH_OK) {
+            have_pw = 1;
+            osh_physics_hooks(&pw, &ph);
+        } else {
+            fprintf(stderr, "%s: physics tables: %s\n", prog, osh_strerr(rc));
+        }
+    }
+    if (rc == OSH_OK) {
+        rc = osh_scoring_load(fdetect, &sw);
+        if (rc == OSH_OK) {
+            have_sw = 1;
+            osh_scoring_tally(&sw, &t);
+            if (njobs > 1)
+                rc = _job_filenames(&sw, job);
+        }
+        if (rc != OSH_OK)
+            fprintf(stderr, "%s: %s: %s\n", prog, fdetect, osh_strerr(rc));
+    }
+
+    if (rc == OSH_OK) {
+        rc = osh_transport_run_init(&run, g, wb, &ph, &t);
+        if (rc == OSH_OK && njobs > 1) {
+            rc = osh_transport_run_slice(&run, job, njobs);
+            run.nsave = 0; /* a job has no result of its own to save */
+        }
+        if (rc == OSH_OK) {
+            run.nthreads = (int) nthreads;
+            rc = osh_transport_run(&run);
+        }
+        if (rc == OSH_OK && sw.rc != OSH_OK)
+            rc = sw.rc;
+        if (rc != OSH_OK)
+            fprintf(stderr, "%s: transport: %s\n", prog, osh_strerr(rc));
+        else
+            osh_info("%lu primaries, %lu histories, %lu steps on %d threads\n",
+                     (unsigned long) run.nstat,
+                     (unsigned long) run.nhist,
+                     (unsigned long) run.nsteps,
+                     run.nthreads_used);
+    }
+
+    if (rc == OSH_OK) {
+        if (njobs > 1) {
+            snprintf(partial, sizeof(partial), "job%lu.partial", (unsigned long) job);
+            rc = osh_scoring_write_partial(&sw, partial);
+        } else {
+            rc = osh_scoring_write(&sw);
+        }
+        if (rc != OSH_OK)
+            fprintf(stderr, "%s: writing the results: %s\n", prog, osh_strerr(rc));
+    }
+
+    if (have_sw)
+        osh_scoring_free(&sw);
+    if (have_pw)
+        osh_physics_free(&pw);
+    if (have_mw)
+        osh_material_free(&mw);
+    if (g)
+        osh_gemca_workspace_free(g);
+    osh_beam_workspace_free(wb);
+    free(fbeam);
+    free(fgeo);
+    free(fmat);
+    free(fdetect);
+    return rc;
+}
+
 int main(int argc, char *argv[]) {
+    const char *dir = ".";
+    size_t job = 0, njobs = 1, nthreads = 0;
+    size_t *x;
+    int i;
+
     /* Handle --version flag */
     if (argc > 1 && (strcmp(argv[1], "--version") == 0 || strcmp(argv[1], "-v") == 0)) {
         printf("OpenShieldHIT version %s\n", OSH_VERSION);
@@ -10,14 +215,42 @@ int main(int argc, char *argv[]) {
 
     /* Handle --help flag */
     if (argc > 1 && (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0)) {
-        printf("Usage: %s [OPTIONS]\n", argv[0]);
-        printf("OpenShieldHIT - Monte Carlo Particle Transport\n\n");
-        printf("OPTIONS:\n");
-        printf("  --version, -v     Print version information\n");
-        printf("  --help, -h        Show this help message\n");
+        usage(argv[0]);
         return 0;
     }
 
-    printf("Hello, World!\n");
-    return 0;
-}
\ No newline at end of file
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-N") == 0 || strcmp(argv[i], "-J") == 0 || strcmp(argv[i], "-t") == 0) {
+            if (i + 1 == argc) {
+                fprintf(stderr, "%s: option %s needs a number\n", argv[0], argv[i]);
+                usage(argv[0]);
+                return 1;
+            }
+            if (argv[i][1] == 'N')
+                x = &job;
+            else if (argv[i][1] == 'J')
+                x = &njobs;
+            else
+                x = &nthreads;
+            if (_count(argv[0], argv[i], argv[i + 1], x) != OSH_OK)
+                return 1;
+            i++;
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "%s: unknown option %s\n", argv[0], argv[i]);
+            usage(argv[0]);
+            return 1;
+        } else {
+            dir = argv[i];
+        }
+    }
+    if (njobs == 0 || job >= njobs) {
+        fprintf(stderr,
+                "%s: job %lu of %lu jobs does not exist\n",
+                argv[0],
+                (unsigned long) job,
+                (unsigned long) njobs);
+        return 1;
+    }
+
+    return (_run(argv[0], dir, job, njobs, nthreads) == OSH_OK) ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+#include "material/_osh_material_db.h"
+
+#include <strings.h>
+
+#include "particle/_osh_partdb.h"
+
+/* ICRU 37 / ICRU 49, index is Z, 0 is unused */
+// clang-format off
+const double _osh_matdb_ival[_OSH_MATDB_NELEM + 1] = {
+       0.0,
+      19.2,  41.8,  40.0,  63.7,  76.0,  78.0,  82.0,  95.0, 115.0, 137.0, /*  1 - 10 */
+     149.0, 156.0, 166.0, 173.0, 173.0, 180.0, 174.0, 188.0, 190.0, 191.0, /* 11 - 20 */
+     216.0, 233.0, 245.0, 257.0, 272.0, 286.0, 297.0, 311.0, 322.0, 330.0, /* 21 - 30 */
+     334.0, 350.0, 347.0, 348.0, 343.0, 352.0, 363.0, 366.0, 379.0, 393.0, /* 31 - 40 */
+     417.0, 424.0, 428.0, 441.0, 449.0, 470.0, 470.0, 469.0, 488.0, 488.0, /* 41 - 50 */
+     487.0, 485.0, 491.0, 482.0, 488.0, 491.0, 501.0, 523.0, 535.0, 546.0, /* 51 - 60 */
+     560.0, 574.0, 580.0, 591.0, 614.0, 628.0, 650.0, 658.0, 674.0, 684.0, /* 61 - 70 */
+     694.0, 705.0, 718.0, 727.0, 736.0, 746.0, 757.0, 790.0, 790.0, 800.0, /* 71 - 80 */
+     810.0, 823.0, 823.0, 830.0, 825.0, 794.0, 827.0, 826.0, 841.0, 847.0, /* 81 - 90 */
+     878.0, 890.0, 902.0, 921.0, 934.0, 939.0, 952.0, 966.0                /* 91 - 98 */
+};
+
+/* ESTAR / PSTAR material numbers, compositions and I-values; elements 1 .. 98 are handled separately */
+const struct icru_material _osh_matdb_icru[] = {
+    {  99, "A-150 tissue-equivalent plastic", 1.127, 65.1, OSH_MATERIAL_STATE_CONDENSED, 6,
+       { 1, 6, 7, 8, 9, 20 },
+       { 0.101330, 0.775498, 0.035057, 0.052315, 0.017423, 0.018377 } },
+    { 103, "Adipose tissue (ICRP)", 0.92, 63.2, OSH_MATERIAL_STATE_CONDENSED, 13,
+       { 1, 6, 7, 8, 11, 12, 15, 16, 17, 19, 20, 26, 30 },
+       { 0.119477, 0.637240, 0.007970, 0.232333, 0.000500, 0.000020, 0.000160, 0.000730, 0.001190, 0.000320,
+         0.000020, 0.000020, 0.000020 } },
+    { 104, "Air, dry (near sea level)", 1.20479e-3, 85.7, OSH_MATERIAL_STATE_GAS, 4,
+       { 6, 7, 8, 18 },
+       { 0.000124, 0.755268, 0.231781, 0.012827 } },
+    { 119, "Bone, compact (ICRU)", 1.85, 91.9, OSH_MATERIAL_STATE_CONDENSED, 8,
+       { 1, 6, 7, 8, 12, 15, 16, 20 },
+       { 0.063984, 0.278000, 0.027000, 0.410016, 0.002000, 0.070000, 0.002000, 0.147000 } },
+    { 120, "Bone, cortical (ICRP)", 1.85, 106.4, OSH_MATERIAL_STATE_CONDENSED, 9,
+       { 1, 6, 7, 8, 12, 15, 16, 20, 30 },
+       { 0.047234, 0.144330, 0.041990, 0.446096, 0.002200, 0.104970, 0.003150, 0.209930, 0.000100 } },
+    { 201, "Muscle, skeletal (ICRP)", 1.04, 75.3, OSH_MATERIAL_STATE_CONDENSED, 13,
+       { 1, 6, 7, 8, 11, 12, 15, 16, 17, 19, 20, 26, 30 },
+       { 0.100637, 0.107830, 0.027680, 0.754773, 0.000750, 0.000190, 0.001800, 0.002410, 0.000790, 0.003020,
+         0.000030, 0.000040, 0.000050 } },
+    { 202, "Muscle, striated (ICRU)", 1.04, 74.7, OSH_MATERIAL_STATE_CONDENSED, 9,
+       { 1, 6, 7, 8, 11, 12, 15, 16, 19 },
+       { 0.101997, 0.123000, 0.035000, 0.729003, 0.000800, 0.000200, 0.002000, 0.005000, 0.003000 } },
+    { 221, "Polyethylene", 0.94, 57.4, OSH_MATERIAL_STATE_CONDENSED, 2,
+       { 1, 6 },
+       { 0.143711, 0.856289 } },
+    { 222, "Polymethyl methacrylate (PMMA)", 1.19, 74.0, OSH_MATERIAL_STATE_CONDENSED, 3,
+       { 1, 6, 8 },
+       { 0.080538, 0.599848, 0.319614 } },
+    { 226, "Polystyrene", 1.06, 68.7, OSH_MATERIAL_STATE_CONDENSED, 2,
+       { 1, 6 },
+       { 0.077418, 0.922582 } },
+    { 276, "Water, liquid", 1.0, 75.0, OSH_MATERIAL_STATE_CONDENSED, 2,
+       { 1, 8 },
+       { 0.111894, 0.888106 } },
+    { 277, "Water vapor", 7.56182e-4, 71.6, OSH_MATERIAL_STATE_GAS, 2,
+       { 1, 8 },
+       { 0.111894, 0.888106 } },
+};
+// clang-format on
+
+const size_t _osh_matdb_nicru = sizeof(_osh_matdb_icru) / sizeof(_osh_matdb_icru[0]);
+
+unsigned int _osh_matdb_z(const char *symb) {
+    unsigned int z;
+
+    for (z = 1; z < _OSH_ISODB_NELEM; z++)
+        if (strcasecmp(symb, _isotopes[_isotopes_idx_default[z]].symb) == 0)
+            return z;
+    return 0;
+}
+
+double _osh_matdb_amass(unsigned int z) {
+    struct isotope const *iso;
+    double m, w;
+    unsigned int i;
+
+    if (z == 0 || z >= _OSH_ISODB_NELEM)
+        return 0.0;
+
+    m = 0.0;
+    w = 0.0;
+    for (i = 0; i < _isotopes_len[z]; i++) {
+        iso = &_isotopes[_isotopes_idx[z] + i];
+        m += iso->abund * iso->amass;
+        w += iso->abund;
+    }
+    if (w > 0.0)
+        return m / w;
+    return _isotopes[_isotopes_idx_default[z]].amass; /* no stable isotope */
+}
+
+struct icru_material const *_osh_matdb_find(int id) {
+    size_t i;
+
+    for (i = 0; i < _osh_matdb_nicru; i++)
+        if (_osh_matdb_icru[i].id == id)
+            return &_osh_matdb_icru[i];
+    return NULL;
+}
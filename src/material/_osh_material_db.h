@@ -0,0 +1,39 @@
+#ifndef _OSH_MATERIAL_DB
+#define _OSH_MATERIAL_DB
+
+/*
+ * Tabulated material data, internal to src/material.
+ */
+
+#include <stddef.h>
+
+#include "material/osh_material.h"
+
+#define _OSH_MATDB_NELEM 98 /* elements with a mean excitation energy, Z = 1 .. 98 */
+
+/* predefined ICRU material, composition by mass fraction */
+struct icru_material {
+    int id;                               /* ICRU material number */
+    const char *name;                     /* name */
+    double rho;                           /* density [g/cm3] */
+    double ival;                          /* mean excitation energy [eV] */
+    int state;                            /* OSH_MATERIAL_STATE_* */
+    size_t nelem;                         /* number of elements */
+    unsigned int z[OSH_MATERIAL_MAXELEM]; /* atomic numbers */
+    double w[OSH_MATERIAL_MAXELEM];       /* mass fractions */
+};
+
+extern const double _osh_matdb_ival[];               /* elemental mean excitation energy [eV] by Z, ICRU 37 */
+extern const struct icru_material _osh_matdb_icru[]; /* predefined compounds */
+extern const size_t _osh_matdb_nicru;                /* number of predefined compounds */
+
+/* atomic number of an element symbol, case insensitive, 0 if unknown */
+unsigned int _osh_matdb_z(const char *symb);
+
+/* standard atomic weight [u] of element z, from the isotope database */
+double _osh_matdb_amass(unsigned int z);
+
+/* predefined compound by ICRU material number, NULL if unknown */
+struct icru_material const *_osh_matdb_find(int id);
+
+#endif /* !_OSH_MATERIAL_DB */
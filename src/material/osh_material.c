@@ -0,0 +1,195 @@
+#include "material/osh_material.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_const.h"
+#include "common/osh_logger.h"
+#include "common/osh_rc.h"
+#include "gemca/osh_gemca2.h"
+#include "material/_osh_material_db.h"
+#include "physics/osh_stopping.h"
+
+#define MEDIUM_VACUUM 1000
+
+/* mean excitation energy [eV] of element z bound in a condensed compound, ICRU 37 */
+static double _ival_bound(unsigned int z) {
+    switch (z) {
+    case 1:
+        return 19.2;
+    case 6:
+        return 81.0;
+    case 7:
+        return 82.0;
+    case 8:
+        return 106.0;
+    case 9:
+        return 112.0;
+    case 17:
+        return 180.0;
+    default:
+        return 1.13 * _osh_matdb_ival[z];
+    }
+}
+
+/* radiation length [g/cm2] of element z, Dahl */
+static double _x0(unsigned int z, double a) {
+    double zz = (double) z;
+
+    return 716.4 * a / (zz * (zz + 1.0) * log(287.0 / sqrt(zz)));
+}
+
+int osh_material_compile(struct medium *m) {
+    struct icru_material const *icru;
+    struct medium_element *e;
+    double wsum, zw, z2w, lni, x0inv;
+    size_t i;
+
+    if (m->id < 1 || m->id > OSH_MATERIAL_MAXMEDIUM)
+        return OSH_EINVAL;
+
+    /* predefined materials fill in what is not given */
+    if (m->icru > 0) {
+        if (m->nelem > 0)
+            return OSH_EINVAL;
+        if (m->icru <= _OSH_MATDB_NELEM) {
+            m->nelem = 1;
+            m->elem[0].z = (unsigned int) m->icru;
+            m->elem[0].w = 1.0;
+        } else {
+            icru = _osh_matdb_find(m->icru);
+            if (!icru)
+                return OSH_EINVAL;
+            m->nelem = icru->nelem;
+            for (i = 0; i < icru->nelem; i++) {
+                m->elem[i].z = icru->z[i];
+                m->elem[i].w = icru->w[i];
+            }
+            if (m->rho <= 0.0)
+                m->rho = icru->rho;
+            if (m->ival <= 0.0)
+                m->ival = icru->ival;
+            if (m->state < 0)
+                m->state = icru->state;
+        }
+    }
+    if (m->state < 0)
+        m->state = OSH_MATERIAL_STATE_CONDENSED;
+
+    if (!(m->rho > 0.0) || m->nelem == 0 || m->nelem > OSH_MATERIAL_MAXELEM ||
+        (m->state != OSH_MATERIAL_STATE_CONDENSED && m->state != OSH_MATERIAL_STATE_GAS))
+        return OSH_EINVAL;
+
+    wsum = 0.0;
+    for (i = 0; i < m->nelem; i++) {
+        e = &m->elem[i];
+        if (e->z < 1 || e->z > _OSH_MATDB_NELEM || !(e->w > 0.0))
+            return OSH_EINVAL;
+        e->amass = _osh_matdb_amass(e->z);
+        wsum += e->w;
+    }
+
+    zw = 0.0;
+    z2w = 0.0;
+    lni = 0.0;
+    x0inv = 0.0;
+    for (i = 0; i < m->nelem; i++) {
+        e = &m->elem[i];
+        e->w /= wsum;
+        e->natoms = m->rho * OSH_NAVOGADRO * e->w / e->amass;
+        zw += e->w * e->z / e->amass;
+        z2w += e->w * e->z * e->z / e->amass;
+        if (m->nelem == 1 || m->state == OSH_MATERIAL_STATE_GAS)
+            lni += e->w * e->z / e->amass * log(_osh_matdb_ival[e->z]);
+        else
+            lni += e->w * e->z / e->amass * log(_ival_bound(e->z));
+        x0inv += e->w / _x0(e->z, e->amass);
+    }
+
+    m->zovera = zw;
+    m->zmean = z2w / zw;
+    m->ne = m->rho * OSH_NAVOGADRO * zw;
+    m->x0 = 1.0 / x0inv;
+    if (m->ival <= 0.0)
+        m->ival = exp(lni / zw); /* Bragg additivity */
+
+    return OSH_OK;
+}
+
+void osh_material_free(struct material_workspace *mw) {
+    free(mw->media);
+    free(mw->row);
+    free(mw->filename);
+    memset(mw, 0, sizeof(*mw));
+}
+
+int osh_material_init(struct material_workspace *mw, struct medium const *media, size_t nmedia) {
+    size_t i;
+    int rc;
+
+    if (!mw || (!media && nmedia > 0))
+        return OSH_EINVAL;
+
+    memset(mw, 0, sizeof(*mw));
+    mw->row = malloc((OSH_MATERIAL_MAXMEDIUM + 1) * sizeof(*mw->row));
+    mw->media = malloc((nmedia + 1) * sizeof(*mw->media));
+    if (!mw->row || !mw->media) {
+        osh_material_free(mw);
+        return OSH_ENOMEM;
+    }
+    for (i = 0; i <= OSH_MATERIAL_MAXMEDIUM; i++)
+        mw->row[i] = -1;
+
+    for (i = 0; i < nmedia; i++) {
+        mw->media[i] = media[i];
+        rc = osh_material_compile(&mw->media[i]);
+        if (rc == OSH_OK && mw->row[media[i].id] >= 0)
+            rc = OSH_EINVAL;
+        if (rc != OSH_OK) {
+            osh_material_free(mw);
+            return rc;
+        }
+        mw->row[media[i].id] = (int) i;
+        mw->nmedia++;
+    }
+
+    return OSH_OK;
+}
+
+double osh_material_density(void *data, int medium) {
+    struct medium const *m = osh_material_medium(data, medium);
+
+    return m ? m->rho : 0.0;
+}
+
+void osh_material_stopping(struct material_workspace const *mw, struct stopping_medium *sm) {
+    size_t i;
+
+    for (i = 0; i < mw->nmedia; i++) {
+        sm[i].medium = mw->media[i].id;
+        sm[i].rho = mw->media[i].rho;
+        sm[i].zovera = mw->media[i].zovera;
+        sm[i].z = mw->media[i].zmean;
+        sm[i].ival = mw->media[i].ival;
+    }
+}
+
+int osh_material_check(struct material_workspace const *mw, struct gemca_workspace const *g) {
+    size_t i, medium;
+    int rc = OSH_OK;
+
+    for (i = 0; i < g->nzones; i++) {
+        medium = g->zones[i]->medium;
+        if (medium == 0 || medium == MEDIUM_VACUUM)
+            continue;
+        if (medium > OSH_MATERIAL_MAXMEDIUM || mw->row[medium] < 0) {
+            osh_warn("zone %lu '%s' uses undefined medium %lu\n",
+                     (unsigned long) g->zones[i]->id,
+                     g->zones[i]->name ? g->zones[i]->name : "",
+                     (unsigned long) medium);
+            rc = OSH_EINVAL;
+        }
+    }
+    return rc;
+}
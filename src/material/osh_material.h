@@ -0,0 +1,184 @@
+#ifndef _OSH_MATERIAL_H
+#define _OSH_MATERIAL_H
+
+/**
+ * @file osh_material.h
+ * @brief Media of mat.dat, compiled into a table of derived properties
+ *
+ * mat.dat holds one block per medium:
+ *
+ *   MEDIUM 2          ! medium number, 1 .. 999, as used in geo.dat
+ *   ICRU 222          ! predefined ICRU material, or
+ *   NUCLID H 8        ! elements by symbol or Z, with atoms per molecule,
+ *   NUCLID 6 5        ! or with a negative mass fraction
+ *   NUCLID O 2
+ *   RHO 1.19          ! density [g/cm3], optional for ICRU compounds
+ *   IVALUE 74.0       ! mean excitation energy [eV], optional
+ *   STATE 0           ! 0 condensed, 1 gas, optional
+ *   END
+ *
+ * Everything transport needs from a medium is derived once when the file is
+ * loaded: mass fractions and atom densities of the elements, with atomic
+ * weights from the isotope database, <Z/A>, electron density, the mean
+ * excitation energy from Bragg additivity if not given, and the radiation
+ * length. Media are looked up by number in O(1).
+ *
+ * Elemental mean excitation energies are those of ICRU 37. In condensed
+ * compounds, the ICRU 37 values for bound H, C, N, O, F and Cl are used, and
+ * 1.13 times the elemental value for all other elements. Radiation lengths
+ * follow the Dahl parametrisation, X0 = 716.4 A / (Z (Z + 1) ln(287 / sqrt(Z))),
+ * added as 1 / X0 = sum w_i / X0_i for compounds.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OSH_MATERIAL_MAXELEM 16    /* max. number of elements of a medium */
+#define OSH_MATERIAL_MAXMEDIUM 999 /* highest medium number, 1000 is vacuum */
+
+#define OSH_MATERIAL_STATE_CONDENSED 0
+#define OSH_MATERIAL_STATE_GAS 1
+
+/* forward declarations */
+struct gemca_workspace;
+struct stopping_medium;
+
+/**
+ * @struct medium_element
+ *
+ * @brief One element of a medium.
+ */
+struct medium_element {
+    unsigned int z; /* atomic number */
+    double amass;   /* atomic weight [u] */
+    double w;       /* mass fraction */
+    double natoms;  /* atoms per cm3 at the nominal density */
+};
+
+/**
+ * @struct medium
+ *
+ * @brief A medium with all derived properties.
+ */
+struct medium {
+    int id;        /* medium number */
+    int icru;      /* ICRU material number, 0 if composed by NUCLID */
+    int state;     /* OSH_MATERIAL_STATE_* */
+    double rho;    /* nominal density [g/cm3] */
+    double ival;   /* mean excitation energy [eV] */
+    double zovera; /* <Z/A> [mol/g] */
+    double zmean;  /* electron weighted mean atomic number */
+    double ne;     /* electron density at the nominal density [1/cm3] */
+    double x0;     /* radiation length [g/cm2] */
+
+    size_t nelem;                                     /* number of elements */
+    struct medium_element elem[OSH_MATERIAL_MAXELEM]; /* composition */
+};
+
+/**
+ * @struct material_workspace
+ *
+ * @brief All media of a run.
+ */
+struct material_workspace {
+    struct medium *media; /* media in the order of definition */
+    size_t nmedia;        /* number of media */
+    int *row;             /* index into media of each medium number 0 .. OSH_MATERIAL_MAXMEDIUM, -1 if undefined */
+    char *filename;       /* path to the mat.dat file, NULL if not loaded from a file */
+};
+
+/**
+ * @brief Load and compile all media of a mat.dat file.
+ *
+ * Problems are logged with file name and line number.
+ *
+ * @param[in] filename Path to mat.dat.
+ * @param[out] mw Workspace to initialise, release with osh_material_free().
+ *
+ * @returns OSH_OK, OSH_EPARSE for a malformed or inconsistent file, or OSH_ENOMEM.
+ */
+int osh_material_load(const char *filename, struct material_workspace *mw);
+
+/**
+ * @brief Set up a workspace from media defined in code.
+ *
+ * Each medium needs id, rho, and either icru or a composition given as
+ * elem[].z with elem[].w holding the mass fractions; state and ival are
+ * optional. All other fields are derived.
+ *
+ * @param[out] mw Workspace to initialise, release with osh_material_free().
+ * @param[in] media Media.
+ * @param[in] nmedia Number of media.
+ *
+ * @returns OSH_OK, OSH_EINVAL for an invalid or duplicate medium, or OSH_ENOMEM.
+ */
+int osh_material_init(struct material_workspace *mw, struct medium const *media, size_t nmedia);
+
+/**
+ * @brief Free a workspace.
+ *
+ * @param[in] mw Workspace.
+ */
+void osh_material_free(struct material_workspace *mw);
+
+/**
+ * @brief Derive all properties of a medium from its definition, see osh_material_init().
+ *
+ * @param[in,out] m Medium.
+ *
+ * @returns OSH_OK or OSH_EINVAL.
+ */
+int osh_material_compile(struct medium *m);
+
+/**
+ * @brief Medium by number.
+ *
+ * @param[in] mw Workspace.
+ * @param[in] id Medium number.
+ *
+ * @returns The medium, or NULL if it is not defined.
+ */
+static inline struct medium const *osh_material_medium(struct material_workspace const *mw, int id) {
+    if (id < 0 || id > OSH_MATERIAL_MAXMEDIUM || mw->row[id] < 0)
+        return NULL;
+    return &mw->media[mw->row[id]];
+}
+
+/**
+ * @brief Nominal density, density hook of struct transport_physics.
+ *
+ * @param[in] data struct material_workspace.
+ * @param[in] medium Medium number.
+ *
+ * @returns Density [g/cm3], 0 for undefined media.
+ */
+double osh_material_density(void *data, int medium);
+
+/**
+ * @brief Stopping power parameters of all media, for osh_stopping_init().
+ *
+ * @param[in] mw Workspace.
+ * @param[out] sm Array of mw->nmedia entries.
+ */
+void osh_material_stopping(struct material_workspace const *mw, struct stopping_medium *sm);
+
+/**
+ * @brief Check that every zone of a geometry has a defined medium.
+ *
+ * Black hole (0) and vacuum (1000) need no definition. Undefined media are logged.
+ *
+ * @param[in] mw Workspace.
+ * @param[in] g Loaded geometry.
+ *
+ * @returns OSH_OK, or OSH_EINVAL if a zone refers to an undefined medium.
+ */
+int osh_material_check(struct material_workspace const *mw, struct gemca_workspace const *g);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OSH_MATERIAL_H */
@@ -0,0 +1,83 @@
+#include "material/osh_material_ct.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_rc.h"
+#include "gemca/voxel/osh_voxel_mat_schneider2000.h"
+
+double osh_material_ct_hu2rho(int hu) {
+    double h;
+
+    if (hu < OSH_MATERIAL_CT_HUMIN)
+        hu = OSH_MATERIAL_CT_HUMIN;
+    if (hu > OSH_MATERIAL_CT_HUMAX)
+        hu = OSH_MATERIAL_CT_HUMAX;
+    h = (double) hu;
+
+    if (hu < -98)
+        return 1.03091 + 1.0297e-3 * h;
+    if (hu < 14)
+        return 1.018 + 0.893e-3 * h;
+    if (hu < 23)
+        return 1.03;
+    if (hu < 80)
+        return 1.003 + 1.169e-3 * h;
+    return 1.017 + 0.592e-3 * h;
+}
+
+void osh_material_ct_free(struct material_ct *ct) {
+    osh_material_free(&ct->mw);
+    free(ct->idx);
+    free(ct->rho);
+    memset(ct, 0, sizeof(*ct));
+}
+
+int osh_material_ct_init(struct material_ct *ct, int first) {
+    struct medium media[OSH_MATERIAL_CT_NMEDIA];
+    struct medium *m;
+    int i, k, hu;
+    int rc;
+
+    if (!ct || first < 1 || first + OSH_MATERIAL_CT_NMEDIA - 1 > OSH_MATERIAL_MAXMEDIUM)
+        return OSH_EINVAL;
+
+    memset(ct, 0, sizeof(*ct));
+    memset(media, 0, sizeof(media));
+    for (i = 0; i < OSH_MATERIAL_CT_NMEDIA; i++) {
+        m = &media[i];
+        m->id = first + i;
+        m->rho = _ct_hu_rho[i];
+        m->state = (i == 0) ? OSH_MATERIAL_STATE_GAS : OSH_MATERIAL_STATE_CONDENSED;
+        for (k = 0; k < _nelm; k++) {
+            if (_ct_relm[i][k] <= 0.0f)
+                continue;
+            m->elem[m->nelem].z = (unsigned int) _ct_elmz[k];
+            m->elem[m->nelem].w = _ct_relm[i][k]; /* percent, normalised when compiled */
+            m->nelem++;
+        }
+    }
+
+    rc = osh_material_init(&ct->mw, media, OSH_MATERIAL_CT_NMEDIA);
+    if (rc != OSH_OK)
+        return rc;
+
+    ct->first = first;
+    ct->idx = malloc(OSH_MATERIAL_CT_NHU * sizeof(*ct->idx));
+    ct->rho = malloc(OSH_MATERIAL_CT_NHU * sizeof(*ct->rho));
+    if (!ct->idx || !ct->rho) {
+        osh_material_ct_free(ct);
+        return OSH_ENOMEM;
+    }
+
+    /* base medium i covers [_ct_hu[i], _ct_hu[i + 1]), the last one includes the upper limit */
+    i = 0;
+    for (hu = OSH_MATERIAL_CT_HUMIN; hu <= OSH_MATERIAL_CT_HUMAX; hu++) {
+        while (i < OSH_MATERIAL_CT_NMEDIA - 1 && hu >= _ct_hu[i + 1])
+            i++;
+        ct->idx[hu - OSH_MATERIAL_CT_HUMIN] = (unsigned char) i;
+        ct->rho[hu - OSH_MATERIAL_CT_HUMIN] = (float) osh_material_ct_hu2rho(hu);
+    }
+
+    return OSH_OK;
+}
@@ -0,0 +1,115 @@
+#ifndef _OSH_MATERIAL_CT_H
+#define _OSH_MATERIAL_CT_H
+
+/**
+ * @file osh_material_ct.h
+ * @brief CT numbers to base media and densities, Schneider et al. 2000
+ *
+ * A CT is not turned into one medium per Hounsfield unit. The tissue
+ * segmentation of Schneider et al., Phys. Med. Biol. 45 (2000) 459, defines
+ * 24 base media by HU interval; each is compiled once, so physics tables such
+ * as the stopping powers exist 24 times regardless of the size of the CT.
+ * A voxel keeps only its HU value. Looking it up gives the base medium and
+ * the CT-corrected density of the voxel, which is what struct position and
+ * struct step carry as medium and rho.
+ *
+ * The transport loop scales mass stopping powers and ranges of the medium by
+ * the density at the step, so a base medium table serves all voxels of its
+ * HU interval. The density effect is that of the nominal density of the base
+ * medium.
+ *
+ * Densities follow the piecewise linear calibration of Schneider et al.:
+ *
+ *   HU < -98        rho = 1.03091 + 1.0297e-3 HU
+ *   -98 .. 14       rho = 1.018 + 0.893e-3 HU
+ *   14 .. 23        rho = 1.03
+ *   23 .. 80        rho = 1.003 + 1.169e-3 HU
+ *   HU >= 80        rho = 1.017 + 0.592e-3 HU
+ *
+ * The skeletal fit starts at 80 HU, where the base media switch from soft
+ * tissue to skeletal tissue (_ct_hu_rho in
+ * gemca/voxel/osh_voxel_mat_schneider2000.h, media 9 and up follow eq. 19),
+ * so a voxel's density and base medium always come from the same tissue
+ * class. osh_gemca_voxel_hu2rho() of the voxel geometry uses the same curve.
+ *
+ * HU values outside [-1000, 1600] are clamped to this interval. The
+ * lookup is a table of OSH_MATERIAL_CT_NHU entries, small enough to stay in
+ * cache while a large CT is traversed.
+ */
+
+#include <stdint.h>
+
+#include "material/osh_material.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OSH_MATERIAL_CT_NMEDIA 24                                            /* number of base media */
+#define OSH_MATERIAL_CT_HUMIN -1000                                          /* lowest HU */
+#define OSH_MATERIAL_CT_HUMAX 1600                                           /* highest HU */
+#define OSH_MATERIAL_CT_NHU (OSH_MATERIAL_CT_HUMAX - OSH_MATERIAL_CT_HUMIN + 1) /* entries of the lookup */
+
+/**
+ * @struct material_ct
+ *
+ * @brief Base media and the HU lookup of a CT.
+ */
+struct material_ct {
+    struct material_workspace mw; /* the base media, medium numbers first .. first + 23 */
+    int first;                    /* medium number of the first base medium */
+    unsigned char *idx;           /* base medium 0 .. 23 of each HU, HU - OSH_MATERIAL_CT_HUMIN */
+    float *rho;                   /* density of each HU [g/cm3] */
+};
+
+/**
+ * @brief Compile the base media and the HU lookup.
+ *
+ * @param[out] ct CT materials, release with osh_material_ct_free().
+ * @param[in] first Medium number of the first base medium, first + 23 must not exceed OSH_MATERIAL_MAXMEDIUM.
+ *
+ * @returns OSH_OK, OSH_EINVAL for an invalid first medium number, or OSH_ENOMEM.
+ */
+int osh_material_ct_init(struct material_ct *ct, int first);
+
+/**
+ * @brief Free the CT materials.
+ *
+ * @param[in] ct CT materials.
+ */
+void osh_material_ct_free(struct material_ct *ct);
+
+/**
+ * @brief Density of a CT number, Schneider et al. calibration.
+ *
+ * @param[in] hu Hounsfield units, clamped to [-1000, 1600].
+ *
+ * @returns Density [g/cm3].
+ */
+double osh_material_ct_hu2rho(int hu);
+
+/**
+ * @brief Base medium and density of a voxel.
+ *
+ * @param[in] ct CT materials.
+ * @param[in] hu Hounsfield units of the voxel, clamped to [-1000, 1600].
+ * @param[out] medium Medium number of the base medium.
+ * @param[out] rho Density of the voxel [g/cm3].
+ */
+static inline void osh_material_ct_lookup(struct material_ct const *ct, int16_t hu, int *medium, double *rho) {
+    int i = (int) hu;
+
+    if (i < OSH_MATERIAL_CT_HUMIN)
+        i = OSH_MATERIAL_CT_HUMIN;
+    if (i > OSH_MATERIAL_CT_HUMAX)
+        i = OSH_MATERIAL_CT_HUMAX;
+    i -= OSH_MATERIAL_CT_HUMIN;
+    *medium = ct->first + (int) ct->idx[i];
+    *rho = (double) ct->rho[i];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OSH_MATERIAL_CT_H */
@@ -0,0 +1,192 @@
+#include "material/osh_material.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "common/osh_file.h"
+#include "common/osh_logger.h"
+#include "common/osh_rc.h"
+#include "common/osh_readline.h"
+#include "material/_osh_material_db.h"
+#include "material/osh_material_parse_keys.h"
+
+/* state of the parser */
+struct mparse {
+    struct oshfile *oshf;
+    struct material_workspace *mw;
+    size_t cap;        /* allocated media */
+    struct medium *m;  /* medium being defined, NULL outside MEDIUM ... END */
+    int lineno;        /* line of the current key */
+    int mline;         /* line of the MEDIUM key of m */
+    int nfrac;         /* NUCLID amounts of m given as mass fractions */
+    int ncount;        /* NUCLID amounts of m given as atoms per molecule */
+};
+
+static int _medium(struct mparse *p, const char *args) {
+    struct medium *m;
+    int id;
+
+    if (p->m)
+        return osh_readline_error(p->oshf, p->lineno, "MEDIUM %d is not closed by END", p->m->id);
+    if (!osh_readline_int(args, &id) || id < 1 || id > OSH_MATERIAL_MAXMEDIUM)
+        return osh_readline_error(p->oshf, p->lineno, "medium number must be 1 .. %d", OSH_MATERIAL_MAXMEDIUM);
+    if (p->mw->row[id] >= 0)
+        return osh_readline_error(p->oshf, p->lineno, "medium %d is defined twice", id);
+
+    if (p->mw->nmedia == p->cap) {
+        p->cap = p->cap ? 2 * p->cap : 8;
+        m = realloc(p->mw->media, p->cap * sizeof(*m));
+        if (!m)
+            return OSH_ENOMEM;
+        p->mw->media = m;
+    }
+
+    m = &p->mw->media[p->mw->nmedia];
+    memset(m, 0, sizeof(*m));
+    m->id = id;
+    m->state = -1;
+    p->m = m;
+    p->mline = p->lineno;
+    p->nfrac = 0;
+    p->ncount = 0;
+    return OSH_OK;
+}
+
+static int _nuclid(struct mparse *p, char *args) {
+    struct medium *m = p->m;
+    char *sym, *amount;
+    double x;
+    int z;
+
+    sym = args ? strtok(args, " \t") : NULL;
+    amount = sym ? strtok(NULL, " \t") : NULL;
+    if (!amount || strtok(NULL, " \t"))
+        return osh_readline_error(p->oshf, p->lineno, "NUCLID needs an element and an amount");
+
+    if (!osh_readline_int(sym, &z))
+        z = (int) _osh_matdb_z(sym);
+    if (z < 1 || z > _OSH_MATDB_NELEM)
+        return osh_readline_error(p->oshf, p->lineno, "unknown or unsupported element '%s'", sym);
+    if (!osh_readline_double(amount, &x) || x == 0.0)
+        return osh_readline_error(p->oshf, p->lineno, "invalid amount '%s'", amount);
+    if (m->nelem == OSH_MATERIAL_MAXELEM)
+        return osh_readline_error(p->oshf, p->lineno, "more than %d elements", OSH_MATERIAL_MAXELEM);
+
+    if (x > 0.0) {
+        p->ncount++;
+        x *= _osh_matdb_amass((unsigned int) z); /* atoms per molecule to mass */
+    } else {
+        p->nfrac++;
+        x = -x;
+    }
+    if (p->ncount > 0 && p->nfrac > 0)
+        return osh_readline_error(p->oshf, p->lineno, "atoms per molecule and mass fractions may not be mixed");
+
+    m->elem[m->nelem].z = (unsigned int) z;
+    m->elem[m->nelem].w = x;
+    m->nelem++;
+    return OSH_OK;
+}
+
+static int _end(struct mparse *p) {
+    struct medium *m = p->m;
+
+    if (m->icru > 0 && m->nelem > 0)
+        return osh_readline_error(p->oshf, p->mline, "medium %d: ICRU and NUCLID are exclusive", m->id);
+    if (m->icru == 0 && m->nelem == 0)
+        return osh_readline_error(p->oshf, p->mline, "medium %d: needs ICRU or NUCLID", m->id);
+    if (m->icru > _OSH_MATDB_NELEM && !_osh_matdb_find(m->icru))
+        return osh_readline_error(p->oshf, p->mline, "medium %d: unknown ICRU material %d", m->id, m->icru);
+    if (m->rho <= 0.0 && (m->icru == 0 || m->icru <= _OSH_MATDB_NELEM))
+        return osh_readline_error(p->oshf, p->mline, "medium %d: needs RHO", m->id);
+    if (osh_material_compile(m) != OSH_OK)
+        return osh_readline_error(p->oshf, p->mline, "medium %d: invalid definition", m->id);
+
+    p->mw->row[m->id] = (int) p->mw->nmedia;
+    p->mw->nmedia++;
+    p->m = NULL;
+    return OSH_OK;
+}
+
+/* handle one key */
+static int _key(struct mparse *p, const char *key, char *args) {
+    struct medium *m = p->m;
+    int i;
+
+    if (strcasecmp(OSH_MATERIAL_KEY_MEDIUM, key) == 0)
+        return _medium(p, args);
+
+    if (!m)
+        return osh_readline_error(p->oshf, p->lineno, "'%s' outside of a MEDIUM ... END block", key);
+
+    if (strcasecmp(OSH_MATERIAL_KEY_END, key) == 0)
+        return _end(p);
+
+    if (strcasecmp(OSH_MATERIAL_KEY_ICRU, key) == 0) {
+        if (!osh_readline_int(args, &m->icru) || m->icru < 1)
+            return osh_readline_error(p->oshf, p->lineno, "invalid ICRU material number");
+    } else if (strcasecmp(OSH_MATERIAL_KEY_NUCLID, key) == 0) {
+        return _nuclid(p, args);
+    } else if (strcasecmp(OSH_MATERIAL_KEY_RHO, key) == 0) {
+        if (!osh_readline_double(args, &m->rho) || !(m->rho > 0.0))
+            return osh_readline_error(p->oshf, p->lineno, "RHO must be > 0");
+    } else if (strcasecmp(OSH_MATERIAL_KEY_IVALUE, key) == 0) {
+        if (!osh_readline_double(args, &m->ival) || !(m->ival > 0.0))
+            return osh_readline_error(p->oshf, p->lineno, "IVALUE must be > 0");
+    } else if (strcasecmp(OSH_MATERIAL_KEY_STATE, key) == 0) {
+        if (!osh_readline_int(args, &i) || (i != OSH_MATERIAL_STATE_CONDENSED && i != OSH_MATERIAL_STATE_GAS))
+            return osh_readline_error(p->oshf,
+                                      p->lineno,
+                                      "STATE must be %d or %d",
+                                      OSH_MATERIAL_STATE_CONDENSED,
+                                      OSH_MATERIAL_STATE_GAS);
+        m->state = i;
+    } else {
+        osh_warn("in %s line %i: unknown key '%s' ignored\n", p->oshf->filename, p->lineno, key);
+    }
+    return OSH_OK;
+}
+
+int osh_material_load(const char *filename, struct material_workspace *mw) {
+    struct mparse p;
+    char *line = NULL;
+    char *key = NULL;
+    char *args = NULL;
+    int lineno;
+    int rc;
+    int i;
+
+    if (!filename || !mw)
+        return OSH_EINVAL;
+
+    memset(mw, 0, sizeof(*mw));
+    mw->row = malloc((OSH_MATERIAL_MAXMEDIUM + 1) * sizeof(*mw->row));
+    mw->filename = malloc(strlen(filename) + 1);
+    if (!mw->row || !mw->filename) {
+        osh_material_free(mw);
+        return OSH_ENOMEM;
+    }
+    for (i = 0; i <= OSH_MATERIAL_MAXMEDIUM; i++)
+        mw->row[i] = -1;
+    strcpy(mw->filename, filename);
+
+    memset(&p, 0, sizeof(p));
+    p.mw = mw;
+    p.oshf = osh_fopen(filename);
+
+    rc = OSH_OK;
+    while (rc == OSH_OK && osh_readline_key(p.oshf, &line, &key, &args, &lineno) > 0) {
+        p.lineno = lineno;
+        rc = _key(&p, key, args);
+        free(line);
+    }
+    if (rc == OSH_OK && p.m)
+        rc = osh_readline_error(p.oshf, p.mline, "MEDIUM %d is not closed by END", p.m->id);
+
+    osh_fclose(p.oshf);
+    if (rc != OSH_OK)
+        osh_material_free(mw);
+    return rc;
+}
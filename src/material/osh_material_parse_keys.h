@@ -0,0 +1,15 @@
+#ifndef _OSH_MATERIAL_PARSE_KEYS
+#define _OSH_MATERIAL_PARSE_KEYS
+
+/* list of keys used in mat.dat */
+// clang-format off
+#define OSH_MATERIAL_KEY_MEDIUM  "medium"
+#define OSH_MATERIAL_KEY_ICRU    "icru"
+#define OSH_MATERIAL_KEY_NUCLID  "nuclid"
+#define OSH_MATERIAL_KEY_RHO     "rho"
+#define OSH_MATERIAL_KEY_IVALUE  "ivalue"
+#define OSH_MATERIAL_KEY_STATE   "state"
+#define OSH_MATERIAL_KEY_END     "end"
+// clang-format on
+
+#endif /* !_OSH_MATERIAL_PARSE_KEYS */
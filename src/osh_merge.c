@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "common/osh_rc.h"
+#include "io/osh_partial.h"
+#include "scoring/osh_scoring.h"
+
+static void usage(const char *prog) {
+    printf("Usage: %s [-d DETECT] -o OUTPUT INPUT...\n", prog);
+    printf("Merge partial results of independent OpenShieldHIT jobs.\n\n");
+    printf("Sums, sums of squares and primary counts of all INPUT files are added\n");
+    printf("and written to OUTPUT. Inputs are streamed, not loaded into memory.\n");
+    printf("With -d, the outputs of DETECT are then written with the merged result.\n\n");
+    printf("OPTIONS:\n");
+    printf("  -o OUTPUT         Merged partial result, may not be one of the inputs\n");
+    printf("  -d DETECT         detect.dat the jobs ran with\n");
+    printf("  --version, -v     Print version information\n");
+    printf("  --help, -h        Show this help message\n");
+}
+
+/* write the outputs of detect.dat with the merged result */
+static int _write_outputs(const char *detect, const char *merged) {
+    struct scoring_workspace sw;
+    int rc;
+
+    rc = osh_scoring_load(detect, &sw);
+    if (rc != OSH_OK)
+        return rc;
+    rc = osh_scoring_read_partial(&sw, merged);
+    if (rc == OSH_OK)
+        rc = osh_scoring_write(&sw);
+    osh_scoring_free(&sw);
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
+    const char *out = NULL;
+    const char *detect = NULL;
+    const char **in;
+    int nin = 0;
+    int rc;
+    int i;
+
+    if (argc > 1 && (strcmp(argv[1], "--version") == 0 || strcmp(argv[1], "-v") == 0)) {
+        printf("osh-merge (OpenShieldHIT) version %s\n", OSH_VERSION);
+        return 0;
+    }
+
+    if (argc < 2 || strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0) {
+        usage(argv[0]);
+        return (argc < 2) ? 1 : 0;
+    }
+
+    /* inputs are collected in place, behind the arguments still to be read */
+    in = (const char **) (argv + 1);
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "-d") == 0) {
+            if (i + 1 == argc) {
+                fprintf(stderr, "%s: option %s needs a file\n", argv[0], argv[i]);
+                usage(argv[0]);
+                return 1;
+            }
+            if (argv[i][1] == 'o')
+                out = argv[++i];
+            else
+                detect = argv[++i];
+        } else {
+            in[nin++] = argv[i];
+        }
+    }
+
+    if (!out || nin == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    for (i = 0; i < nin; i++) {
+        if (strcmp(in[i], out) == 0) {
+            fprintf(stderr, "%s: output %s is also an input\n", argv[0], out);
+            return 1;
+        }
+    }
+
+    rc = osh_partial_merge(out, in, (size_t) nin);
+    if (rc != OSH_OK) {
+        fprintf(stderr, "%s: merging into %s failed: %s\n", argv[0], out, osh_strerr(rc));
+        return 1;
+    }
+
+    if (detect) {
+        rc = _write_outputs(detect, out);
+        if (rc != OSH_OK) {
+            fprintf(stderr, "%s: writing the outputs of %s failed: %s\n", argv[0], detect, osh_strerr(rc));
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -1,6 +1,8 @@
 #ifndef OSH_PARTICLE_H
 #define OSH_PARTICLE_H
 
+#include <stdint.h>
+
 #include "_osh_partdb.h" /* autogenerated DB */
 
 /* list of particle IDs. */
@@ -79,6 +81,8 @@ struct particle {
     unsigned int gen;   /* generation, 0 for primary particles, 1 for 1st generation etc... */
     unsigned int nprim; /* originated from this primary particle number (NCUR in shield.f) */
     int pdg;            /* particle PDG code */
+    uint64_t smask;     /* scoring filters whose static predicates accept the particle */
+    void const *sft;    /* scoring filter table smask was computed for, NULL if not computed */
 };
 
 void osh_particle_print(struct particle part);
@@ -0,0 +1,150 @@
+#include "physics/osh_physics.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_rc.h"
+#include "material/osh_material.h"
+#include "particle/osh_particle.h"
+#include "transport/osh_transport.h"
+#include "transport/osh_transport_engine.h"
+
+void osh_physics_free(struct physics_workspace *pw) {
+    osh_stopping_free(&pw->stopping);
+    osh_straggling_free(&pw->vavilov);
+    osh_scattering_free(&pw->moliere);
+    free(pw->msc);
+    memset(pw, 0, sizeof(*pw));
+}
+
+int osh_physics_init(struct physics_workspace *pw,
+                     struct material_workspace const *mw,
+                     int zmax,
+                     int stragg,
+                     int mscat) {
+    struct stopping_medium *sm;
+    size_t i;
+    int rc;
+
+    if (!pw || !mw)
+        return OSH_EINVAL;
+    if (stragg != OSH_STRAGGLING_OFF && stragg != OSH_STRAGGLING_GAUSS && stragg != OSH_STRAGGLING_VAVILOV)
+        return OSH_EINVAL;
+    if (mscat != OSH_SCATTERING_OFF && mscat != OSH_SCATTERING_GAUSS && mscat != OSH_SCATTERING_MOLIERE)
+        return OSH_EINVAL;
+
+    memset(pw, 0, sizeof(*pw));
+    pw->stragg = stragg;
+    pw->mscat = mscat;
+
+    sm = malloc((mw->nmedia + 1) * sizeof(*sm));
+    if (!sm)
+        return OSH_ENOMEM;
+    osh_material_stopping(mw, sm);
+    rc = osh_stopping_init(&pw->stopping, sm, mw->nmedia, zmax);
+    free(sm);
+    if (rc != OSH_OK)
+        return rc;
+
+    if (stragg == OSH_STRAGGLING_VAVILOV) {
+        rc = osh_straggling_init(&pw->vavilov);
+        if (rc != OSH_OK) {
+            osh_physics_free(pw);
+            return rc;
+        }
+    }
+
+    pw->msc = malloc((mw->nmedia + 1) * sizeof(*pw->msc));
+    if (!pw->msc) {
+        osh_physics_free(pw);
+        return OSH_ENOMEM;
+    }
+    for (i = 0; i < mw->nmedia; i++)
+        osh_scattering_medium(&mw->media[i], &pw->msc[i]);
+
+    if (mscat == OSH_SCATTERING_MOLIERE) {
+        rc = osh_scattering_init(&pw->moliere);
+        if (rc != OSH_OK) {
+            osh_physics_free(pw);
+            return rc;
+        }
+    }
+
+    return OSH_OK;
+}
+
+void osh_physics_hooks(struct physics_workspace *pw, struct transport_physics *ph) {
+    memset(ph, 0, sizeof(*ph));
+    ph->density = osh_physics_density;
+    ph->dedx = osh_physics_dedx;
+    ph->range = osh_physics_range;
+    ph->erange = osh_physics_erange;
+    if (pw->stragg != OSH_STRAGGLING_OFF)
+        ph->eloss = osh_physics_eloss;
+    if (pw->mscat != OSH_SCATTERING_OFF)
+        ph->scatter = osh_physics_scatter;
+    ph->data = pw;
+}
+
+/* tabulated medium, NULL if there is none */
+static struct stopping_medium const *_medium(struct physics_workspace const *pw, int medium) {
+    struct stopping_workspace const *sw = &pw->stopping;
+
+    if (medium < 0 || medium > sw->maxmedium || sw->row[medium] < 0)
+        return NULL;
+    return &sw->media[sw->row[medium]];
+}
+
+double osh_physics_density(void *data, int medium) {
+    struct stopping_medium const *m = _medium(data, medium);
+
+    return m ? m->rho : 0.0;
+}
+
+double osh_physics_dedx(void *data, struct particle const *part, int medium, double e) {
+    return osh_stopping_dedx(&((struct physics_workspace *) data)->stopping, part, medium, e);
+}
+
+double osh_physics_range(void *data, struct particle const *part, int medium, double e) {
+    return osh_stopping_range(&((struct physics_workspace *) data)->stopping, part, medium, e);
+}
+
+double osh_physics_erange(void *data, struct particle const *part, int medium, double r) {
+    return osh_stopping_erange(&((struct physics_workspace *) data)->stopping, part, medium, r);
+}
+
+double osh_physics_eloss(void *data, struct particle const *part, struct step const *st, struct osh_rng *rng) {
+    struct physics_workspace const *pw = data;
+    struct stopping_medium const *m;
+    double e, xi, tmax, beta2;
+
+    m = _medium(pw, st->medium);
+    e = st->p[3] - 0.5 * st->de;
+    if (!m || part->z == 0 || !(part->amu > 0.0) || e <= 0.0 || st->ds <= 0.0)
+        return st->de;
+
+    osh_straggling_params(part->z, part->amu, e, m->zovera, st->rho * st->ds, &xi, &tmax, &beta2);
+    if (pw->stragg == OSH_STRAGGLING_GAUSS)
+        return st->de + osh_straggling_gauss(xi, tmax, beta2, rng);
+    return st->de + osh_straggling_vavilov(&pw->vavilov, xi, tmax, beta2, rng);
+}
+
+void osh_physics_scatter(void *data, struct particle const *part, struct step const *st, double v[3], struct osh_rng *rng) {
+    struct physics_workspace const *pw = data;
+    struct stopping_workspace const *sw = &pw->stopping;
+    struct scattering_medium const *sm;
+    double e, t;
+
+    if (st->medium < 0 || st->medium > sw->maxmedium || sw->row[st->medium] < 0)
+        return;
+    sm = &pw->msc[sw->row[st->medium]];
+    e = st->p[3] - 0.5 * st->de;
+    t = st->rho * st->ds;
+    if (part->z == 0 || !(part->amu > 0.0) || e <= 0.0 || t <= 0.0)
+        return;
+
+    if (pw->mscat == OSH_SCATTERING_GAUSS)
+        osh_scattering_gauss(osh_scattering_highland(sm, part->z, part->amu, e, t), v, rng);
+    else
+        osh_scattering_moliere(&pw->moliere, sm, part->z, part->amu, e, t, v, rng);
+}
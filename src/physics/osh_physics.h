@@ -0,0 +1,123 @@
+#ifndef _OSH_PHYSICS_H
+#define _OSH_PHYSICS_H
+
+/**
+ * @file osh_physics.h
+ * @brief Physics of the media of a run, behind the hooks of struct transport_physics
+ *
+ * The hooks of struct transport_physics share a single data pointer. A
+ * struct physics_workspace holds everything they need: the stopping power
+ * and range tables of all media, the tables of the selected straggling
+ * model and the multiple scattering properties of all media. It is built
+ * once from the compiled media of mat.dat, and osh_physics_hooks() wires it
+ * into the transport.
+ *
+ * The straggling model is selected by the STRAGG switch of beam.dat,
+ * OSH_STRAGGLING_* has the same values as OSH_BEAM_STRAGG_*, the scattering
+ * model by MSCAT, with OSH_SCATTERING_*. The energy loss distribution and
+ * the scattering angle of a step are taken at its mid-step energy.
+ */
+
+#include "physics/osh_stopping.h"
+#include "physics/osh_scattering.h"
+#include "physics/osh_straggling.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* forward declarations */
+struct material_workspace;
+struct transport_physics;
+struct particle;
+struct step;
+struct osh_rng;
+
+/**
+ * @struct physics_workspace
+ *
+ * @brief Physics tables of all media.
+ */
+struct physics_workspace {
+    struct stopping_workspace stopping; /* stopping power and range tables */
+    struct straggling_table vavilov;    /* Vavilov tables, only built for OSH_STRAGGLING_VAVILOV */
+    struct scattering_table moliere;    /* Moliere tables, only built for OSH_SCATTERING_MOLIERE */
+    struct scattering_medium *msc;      /* scattering properties, same rows as stopping.media */
+    int stragg;                         /* straggling model, OSH_STRAGGLING_* */
+    int mscat;                          /* scattering model, OSH_SCATTERING_* */
+};
+
+/**
+ * @brief Build the physics tables of all media.
+ *
+ * @param[out] pw Workspace to initialise, release with osh_physics_free().
+ * @param[in] mw Compiled media.
+ * @param[in] zmax Highest charge to tabulate, >= 1.
+ * @param[in] stragg Straggling model, OSH_STRAGGLING_*.
+ * @param[in] mscat Multiple scattering model, OSH_SCATTERING_*.
+ *
+ * @returns OSH_OK, OSH_EINVAL for invalid arguments, or OSH_ENOMEM.
+ */
+int osh_physics_init(struct physics_workspace *pw,
+                     struct material_workspace const *mw,
+                     int zmax,
+                     int stragg,
+                     int mscat);
+
+/**
+ * @brief Free the physics tables.
+ *
+ * @param[in] pw Workspace.
+ */
+void osh_physics_free(struct physics_workspace *pw);
+
+/**
+ * @brief Set all hooks of the transport to this workspace.
+ *
+ * The eloss hook is NULL if straggling is off, scatter is NULL if scattering is off.
+ *
+ * @param[in] pw Workspace.
+ * @param[out] ph Hooks.
+ */
+void osh_physics_hooks(struct physics_workspace *pw, struct transport_physics *ph);
+
+/** @brief Nominal density of a medium [g/cm3], density hook. */
+double osh_physics_density(void *data, int medium);
+
+/** @brief Mass stopping power [MeV cm2/g], dedx hook, see osh_stopping_dedx(). */
+double osh_physics_dedx(void *data, struct particle const *part, int medium, double e);
+
+/** @brief CSDA range [g/cm2], range hook, see osh_stopping_range(). */
+double osh_physics_range(void *data, struct particle const *part, int medium, double e);
+
+/** @brief Inverse CSDA range [MeV], erange hook, see osh_stopping_erange(). */
+double osh_physics_erange(void *data, struct particle const *part, int medium, double r);
+
+/**
+ * @brief Energy loss of a step with straggling [MeV], eloss hook.
+ *
+ * @param[in] data struct physics_workspace.
+ * @param[in] part Particle.
+ * @param[in] st Step, st->de holds the mean energy loss.
+ * @param[in] rng Random number generator.
+ *
+ * @returns Energy loss, st->de for neutral particles and media without tables.
+ */
+double osh_physics_eloss(void *data, struct particle const *part, struct step const *st, struct osh_rng *rng);
+
+/**
+ * @brief Multiple scattering of a step, scatter hook.
+ *
+ * @param[in] data struct physics_workspace.
+ * @param[in] part Particle.
+ * @param[in] st Step.
+ * @param[in,out] v Unit direction.
+ * @param[in] rng Random number generator.
+ */
+void osh_physics_scatter(void *data, struct particle const *part, struct step const *st, double v[3], struct osh_rng *rng);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OSH_PHYSICS_H */
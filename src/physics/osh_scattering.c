@@ -0,0 +1,327 @@
+/*
+ * Multiple Coulomb scattering
+ *
+ * Based on:
+ *   G. Moliere, "Theorie der Streuung schneller geladener Teilchen II",
+ *   Z. Naturforsch. 3a, 1948.
+ *   H.A. Bethe, "Moliere's theory of multiple scattering", Phys. Rev. 89, 1953.
+ *   V.L. Highland, "Some practical remarks on multiple scattering",
+ *   Nucl. Instr. Meth. 129, 1975, as given by the Particle Data Group.
+ *   B. Gottschalk et al., "Multiple Coulomb scattering of 160 MeV protons",
+ *   Nucl. Instr. Meth. B 74, 1993.
+ */
+
+#include "physics/osh_scattering.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_const.h"
+#include "common/osh_rc.h"
+#include "common/osh_vect.h"
+#include "material/osh_material.h"
+#include "random/osh_rng.h"
+
+#define ALPHA (1.0 / 137.035999) /* fine structure constant */
+#define CHIC 0.157               /* chi_c^2 (p beta c)^2 A / (z^2 Z (Z + 1) t) [MeV^2 cm2/g] */
+#define CHI0 1.7754e-5           /* (hbar c / (0.885 a_0))^2 [MeV^2] */
+#define NBB 256                  /* points of the B(b) table */
+#define NR 1024                  /* points of the density when building a table */
+#define NQ 2000                  /* Simpson intervals of the Bessel transforms */
+#define UMAX 14.0                /* upper limit of the Bessel transforms */
+
+/* Bessel function J0, rational approximations of Numerical Recipes */
+static double _j0(double x) {
+    double ax, z, y, xx, a1, a2;
+
+    ax = fabs(x);
+    if (ax < 8.0) {
+        y = x * x;
+        a1 = 57568490574.0 +
+             y * (-13362590354.0 + y * (651619640.7 + y * (-11214424.18 + y * (77392.33017 + y * (-184.9052456)))));
+        a2 = 57568490411.0 + y * (1029532985.0 + y * (9494680.718 + y * (59272.64853 + y * (267.8532712 + y))));
+        return a1 / a2;
+    }
+    z = 8.0 / ax;
+    y = z * z;
+    xx = ax - 0.785398164;
+    a1 = 1.0 + y * (-0.1098628627e-2 + y * (0.2734510407e-4 + y * (-0.2073370639e-5 + y * 0.2093887211e-6)));
+    a2 = -0.1562499995e-1 + y * (0.1430488765e-3 + y * (-0.6911147651e-5 + y * (0.7621095161e-6 - y * 0.934935152e-7)));
+    return sqrt(0.636619772 / ax) * (cos(xx) * a1 - z * sin(xx) * a2);
+}
+
+void osh_scattering_moliere_f(double x, double *f1, double *f2) {
+    double du, u, y, g, w, s1, s2;
+    int i;
+
+    /* f_n(x) = 1/n! int_0^inf u J0(x u) exp(-u^2/4) (u^2/4 ln(u^2/4))^n du, Simpson's rule */
+    du = UMAX / NQ;
+    s1 = 0.0;
+    s2 = 0.0;
+    for (i = 1; i < NQ; i++) {
+        u = (double) i * du;
+        y = 0.25 * u * u;
+        g = u * _j0(x * u) * exp(-y) * y * log(y);
+        w = (i % 2) ? 4.0 : 2.0;
+        s1 += w * g;
+        s2 += w * g * y * log(y);
+    }
+    *f1 = s1 * du / 3.0;
+    *f2 = 0.5 * s2 * du / 3.0;
+}
+
+void osh_scattering_medium(struct medium const *m, struct scattering_medium *sm) {
+    double w, z;
+    size_t i;
+
+    memset(sm, 0, sizeof(*sm));
+    sm->x0 = m->x0;
+    for (i = 0; i < m->nelem; i++) {
+        z = (double) m->elem[i].z;
+        w = m->elem[i].w * z * (z + 1.0) / m->elem[i].amass;
+        sm->zz1a += w;
+        sm->lnz23 += w * log(z) * 2.0 / 3.0;
+        sm->zeff2 += w * z * z;
+    }
+    if (sm->zz1a > 0.0) {
+        sm->lnz23 /= sm->zz1a;
+        sm->zeff2 /= sm->zz1a;
+    }
+}
+
+/* inverse cumulative distribution of the reduced angle for B, q[0 .. OSH_SCATTERING_NU] */
+static void _table(float *q, double b, double const *f1, double const *f2, double *c, double *m) {
+    double dr, r, f, g, gl, sum, mean, u, s;
+    size_t j, k;
+
+    dr = OSH_SCATTERING_RMAX / (NR - 1);
+    sum = 0.0;
+    mean = 0.0;
+    gl = 0.0;
+    c[0] = 0.0;
+    m[0] = 0.0;
+    for (j = 1; j < NR; j++) {
+        r = (double) j * dr;
+        f = 2.0 * exp(-r * r) + f1[j] / b + f2[j] / (b * b);
+        g = (f > 0.0) ? r * f : 0.0;
+        sum += 0.5 * (gl + g) * dr;
+        mean += 0.5 * ((r - dr) * gl + r * g) * dr;
+        gl = g;
+        c[j] = sum;
+        m[j] = mean;
+    }
+
+    q[0] = 0.0;
+    j = 0;
+    for (k = 1; k < OSH_SCATTERING_NU; k++) {
+        u = sum * (double) k / OSH_SCATTERING_NU;
+        while (j < NR - 2 && c[j + 1] < u)
+            j++;
+        s = (c[j + 1] > c[j]) ? (u - c[j]) / (c[j + 1] - c[j]) : 0.0;
+        q[k] = (float) (((double) j + s) * dr);
+        if (k == OSH_SCATTERING_NU - 1) /* last interval with the mean of the tail */
+            q[k + 1] = (float) (2.0 * (mean - m[j] - s * (m[j + 1] - m[j])) / (sum - u) - q[k]);
+    }
+}
+
+void osh_scattering_free(struct scattering_table *t) {
+    free(t->q);
+    free(t->bb);
+    memset(t, 0, sizeof(*t));
+}
+
+int osh_scattering_init(struct scattering_table *t) {
+    double *f1, *f2;
+    double b, bb, bmax, dib;
+    size_t i;
+    int k;
+
+    memset(t, 0, sizeof(*t));
+    t->nbb = NBB;
+    t->q = malloc((size_t) OSH_SCATTERING_NB * (OSH_SCATTERING_NU + 1) * sizeof(*t->q));
+    t->bb = malloc(NBB * sizeof(*t->bb));
+    f1 = malloc(4 * NR * sizeof(*f1));
+    if (!t->q || !t->bb || !f1) {
+        free(f1);
+        osh_scattering_free(t);
+        return OSH_ENOMEM;
+    }
+    f2 = f1 + NR;
+
+    /* B of b = B - ln B */
+    t->bmin = OSH_SCATTERING_BMIN - log(OSH_SCATTERING_BMIN);
+    bmax = OSH_SCATTERING_BMAX - log(OSH_SCATTERING_BMAX);
+    t->inv_db = (NBB - 1) / (bmax - t->bmin);
+    bb = OSH_SCATTERING_BMIN;
+    for (i = 0; i < NBB; i++) {
+        b = t->bmin + (double) i / t->inv_db;
+        for (k = 0; k < 50; k++)
+            bb -= (bb - log(bb) - b) / (1.0 - 1.0 / bb);
+        t->bb[i] = bb;
+    }
+
+    for (i = 0; i < NR; i++)
+        osh_scattering_moliere_f((double) i * OSH_SCATTERING_RMAX / (NR - 1), &f1[i], &f2[i]);
+
+    /* uniform in 1/B */
+    dib = (1.0 / OSH_SCATTERING_BMIN - 1.0 / OSH_SCATTERING_BMAX) / (OSH_SCATTERING_NB - 1);
+    t->inv_dib = 1.0 / dib;
+    for (i = 0; i < OSH_SCATTERING_NB; i++)
+        _table(t->q + i * (OSH_SCATTERING_NU + 1), 1.0 / (1.0 / OSH_SCATTERING_BMAX + (double) i * dib), f1, f2,
+               f1 + 2 * NR, f1 + 3 * NR);
+
+    free(f1);
+    return OSH_OK;
+}
+
+/* linear interpolation of the quantile at u = (k + fu) / OSH_SCATTERING_NU */
+static double _quantile(struct scattering_table const *t, double b, size_t k, double fu) {
+    float const *q0, *q1;
+    double x, fb, a0, a1;
+    size_t i;
+
+    x = (1.0 / b - 1.0 / OSH_SCATTERING_BMAX) * t->inv_dib;
+    if (x < 0.0)
+        x = 0.0;
+    if (x > OSH_SCATTERING_NB - 1)
+        x = OSH_SCATTERING_NB - 1;
+    i = (size_t) x;
+    if (i > OSH_SCATTERING_NB - 2)
+        i = OSH_SCATTERING_NB - 2;
+    fb = x - (double) i;
+
+    q0 = t->q + i * (OSH_SCATTERING_NU + 1) + k;
+    q1 = q0 + (OSH_SCATTERING_NU + 1);
+    a0 = q0[0] + fu * (q0[1] - q0[0]);
+    a1 = q1[0] + fu * (q1[1] - q1[0]);
+    return a0 + fb * (a1 - a0);
+}
+
+double osh_scattering_quantile(struct scattering_table const *t, double b, double u) {
+    double x;
+    size_t k;
+
+    if (u < 0.0)
+        u = 0.0;
+    if (u > 1.0)
+        u = 1.0;
+    x = u * OSH_SCATTERING_NU;
+    k = (size_t) x;
+    if (k > OSH_SCATTERING_NU - 1)
+        k = OSH_SCATTERING_NU - 1;
+    return _quantile(t, b, k, x - (double) k);
+}
+
+double osh_scattering_highland(struct scattering_medium const *sm, int z, double amu, double e, double t) {
+    double m, pbeta, beta2, x;
+
+    if (!(t > 0.0) || !(sm->x0 > 0.0))
+        return 0.0;
+    m = amu * OSH_AMU;
+    pbeta = e * (e + 2.0 * m) / (e + m);
+    beta2 = pbeta / (e + m);
+    x = t / sm->x0;
+    return 13.6 / pbeta * fabs((double) z) * sqrt(x) * (1.0 + 0.038 * log(x * (double) (z * z) / beta2));
+}
+
+/* two unit vectors completing the unit direction v to an orthonormal basis */
+static void _basis(double const v[3], double u[3], double w[3]) {
+    double n;
+    int i;
+
+    osh_vect_orthogonal_basis(v, u, w);
+    n = 1.0 / sqrt(osh_vect_len2(u)); /* |u| = |w| = sin of the angle between v and the z axis */
+    for (i = 0; i < 3; i++) {
+        u[i] *= n;
+        w[i] *= n;
+    }
+}
+
+void osh_scattering_gauss(double theta0, double v[3], struct osh_rng *rng) {
+    double u[3], w[3];
+    double a, b, n;
+    int i;
+
+    if (!(theta0 > 0.0))
+        return;
+    _basis(v, u, w);
+    a = theta0 * osh_rng_gauss01(rng);
+    b = theta0 * osh_rng_gauss01(rng);
+
+    /* projected angles as slopes in the plane normal to v */
+    for (i = 0; i < 3; i++)
+        v[i] += a * u[i] + b * w[i];
+    n = 1.0 / sqrt(1.0 + a * a + b * b);
+    for (i = 0; i < 3; i++)
+        v[i] *= n;
+}
+
+void osh_scattering_moliere(struct scattering_table const *t,
+                            struct scattering_medium const *sm,
+                            int z,
+                            double amu,
+                            double e,
+                            double th,
+                            double v[3],
+                            struct osh_rng *rng) {
+    double u[3], w[3];
+    double m, pbeta, beta2, z2, chic2, b, bb, x, f, theta, s, c, a1, a2, r2, cphi, sphi;
+    size_t k;
+    int i;
+
+    if (!(th > 0.0) || !(sm->zz1a > 0.0))
+        return;
+    m = amu * OSH_AMU;
+    pbeta = e * (e + 2.0 * m) / (e + m);
+    beta2 = pbeta / (e + m);
+    z2 = (double) (z * z);
+    chic2 = CHIC * sm->zz1a * z2 * th / (pbeta * pbeta);
+
+    /* b = ln(chi_c^2 / (1.167 chi_a^2)), the momentum cancels */
+    b = log(CHIC * sm->zz1a * z2 * th /
+            (beta2 * 1.167 * CHI0 * (1.13 + 3.76 * ALPHA * ALPHA * z2 * sm->zeff2 / beta2))) -
+        sm->lnz23;
+    if (b < t->bmin) {
+        osh_scattering_gauss(osh_scattering_highland(sm, z, amu, e, th), v, rng);
+        return;
+    }
+    x = (b - t->bmin) * t->inv_db;
+    if (x < (double) (t->nbb - 1)) {
+        k = (size_t) x;
+        bb = t->bb[k] + (x - (double) k) * (t->bb[k + 1] - t->bb[k]);
+    } else {
+        bb = b + log(b);
+        bb -= (bb - log(bb) - b) / (1.0 - 1.0 / bb);
+    }
+
+    x = osh_rng_double(rng) * OSH_SCATTERING_NU;
+    k = (size_t) x;
+    if (k > OSH_SCATTERING_NU - 1)
+        k = OSH_SCATTERING_NU - 1;
+    theta = _quantile(t, bb, k, x - (double) k) * sqrt(chic2 * bb);
+
+    if (theta < 0.5) {
+        f = theta * theta;
+        s = theta * (1.0 - f / 6.0 * (1.0 - f / 20.0 * (1.0 - f / 42.0)));
+        c = sqrt((1.0 - s) * (1.0 + s));
+    } else {
+        if (theta > OSH_M_PI)
+            theta = OSH_M_PI;
+        s = sin(theta);
+        c = cos(theta);
+    }
+
+    /* azimuth from a point in the unit disk */
+    do {
+        a1 = 2.0 * osh_rng_double(rng) - 1.0;
+        a2 = 2.0 * osh_rng_double(rng) - 1.0;
+        r2 = a1 * a1 + a2 * a2;
+    } while (r2 >= 1.0 || r2 == 0.0);
+    cphi = (a1 * a1 - a2 * a2) / r2;
+    sphi = 2.0 * a1 * a2 / r2;
+
+    _basis(v, u, w);
+    for (i = 0; i < 3; i++)
+        v[i] = c * v[i] + s * (cphi * u[i] + sphi * w[i]);
+}
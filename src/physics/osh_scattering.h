@@ -0,0 +1,178 @@
+#ifndef _OSH_SCATTERING_H
+#define _OSH_SCATTERING_H
+
+/**
+ * @file osh_scattering.h
+ * @brief Multiple Coulomb scattering of heavy charged particles, Highland and Moliere
+ *
+ * Gaussian model: the two projected angles of a step of areal thickness t
+ * are normal with the width of Highland (PDG):
+ *
+ *   theta0 = 13.6 MeV / (beta c p) z sqrt(t / X0) (1 + 0.038 ln(t z^2 / (X0 beta^2)))
+ *
+ * Moliere model, with Bethe's form of the theory: the polar angle is
+ * theta = theta' chi_c sqrt(B), where the reduced angle theta' follows
+ *
+ *   f(theta') = f0(theta') + f1(theta') / B + f2(theta') / B^2,  f0 = 2 exp(-theta'^2),
+ *
+ * chi_c^2 = 0.157 MeV^2 cm2/g sum_i w_i Z_i (Z_i + 1) / A_i z^2 t / (p beta c)^2, and
+ * B - ln B = ln(chi_c^2 / (1.167 chi_a^2)), with the screening angle chi_a of
+ * Moliere combined over the elements of a compound by Bethe's rule and
+ * the Coulomb correction taken with an effective Z of the medium. The
+ * momentum cancels in B, which needs one logarithm per step.
+ *
+ * The inverse cumulative distributions of theta' are computed once by
+ * osh_scattering_init() from the Bessel transforms defining f1 and f2, for
+ * OSH_SCATTERING_NB values of B, uniform in 1/B from OSH_SCATTERING_BMIN to
+ * OSH_SCATTERING_BMAX, and truncated at theta' = OSH_SCATTERING_RMAX. B is
+ * interpolated from a table too. A step costs one uniform for theta', a
+ * lookup and a bilinear interpolation. Steps too thin for Moliere
+ * theory, B < OSH_SCATTERING_BMIN, are scattered by the Gaussian model.
+ *
+ * Directions are turned without trigonometric functions: the Gaussian
+ * model adds the projected angles along two unit vectors normal to the
+ * direction and normalises, the Moliere model takes the azimuth from a
+ * point in the unit disk.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* models, same values as OSH_BEAM_MSCAT_* of beam.dat */
+#define OSH_SCATTERING_OFF 0
+#define OSH_SCATTERING_GAUSS 1
+#define OSH_SCATTERING_MOLIERE 2
+
+#define OSH_SCATTERING_BMIN 4.5  /* lowest B of the Moliere tables */
+#define OSH_SCATTERING_BMAX 30.0 /* highest B of the Moliere tables */
+#define OSH_SCATTERING_NB 24     /* tabulated values of B */
+#define OSH_SCATTERING_NU 256    /* quantile intervals per table */
+#define OSH_SCATTERING_RMAX 10.0 /* largest reduced angle */
+
+/* forward declarations */
+struct medium;
+struct osh_rng;
+
+/**
+ * @struct scattering_medium
+ *
+ * @brief Properties of a medium entering multiple scattering.
+ */
+struct scattering_medium {
+    double x0;    /* radiation length [g/cm2] */
+    double zz1a;  /* sum_i w_i Z_i (Z_i + 1) / A_i [mol/g] */
+    double lnz23; /* mean ln(Z^2/3), weighted by w_i Z_i (Z_i + 1) / A_i */
+    double zeff2; /* mean Z^2, weighted the same way */
+};
+
+/**
+ * @struct scattering_table
+ *
+ * @brief Inverse cumulative Moliere distributions.
+ *
+ * The table of B index i starts at element i * (OSH_SCATTERING_NU + 1) of q.
+ */
+struct scattering_table {
+    float *q;       /* quantiles of the reduced angle */
+    double *bb;     /* B as a function of b = B - ln B */
+    size_t nbb;     /* points of bb */
+    double bmin;    /* b at OSH_SCATTERING_BMIN */
+    double inv_db;  /* 1 / grid spacing of bb */
+    double inv_dib; /* 1 / grid spacing of 1/B of q */
+};
+
+/**
+ * @brief Compute the Moliere tables.
+ *
+ * @param[out] t Tables to initialise.
+ *
+ * @returns OSH_OK or OSH_ENOMEM.
+ */
+int osh_scattering_init(struct scattering_table *t);
+
+/**
+ * @brief Free the Moliere tables.
+ *
+ * @param[in] t Tables.
+ */
+void osh_scattering_free(struct scattering_table *t);
+
+/**
+ * @brief Scattering properties of a compiled medium.
+ *
+ * @param[in] m Medium.
+ * @param[out] sm Scattering properties.
+ */
+void osh_scattering_medium(struct medium const *m, struct scattering_medium *sm);
+
+/**
+ * @brief Moliere functions f1 and f2 of the reduced angle, Bethe 1953.
+ *
+ * @param[in] x Reduced angle.
+ * @param[out] f1 f1(x).
+ * @param[out] f2 f2(x).
+ */
+void osh_scattering_moliere_f(double x, double *f1, double *f2);
+
+/**
+ * @brief Highland width of the projected angle.
+ *
+ * @param[in] sm Medium.
+ * @param[in] z Charge of the particle.
+ * @param[in] amu Mass of the particle [u].
+ * @param[in] e Kinetic energy [MeV].
+ * @param[in] t Areal thickness of the step [g/cm2].
+ *
+ * @returns theta0 [rad].
+ */
+double osh_scattering_highland(struct scattering_medium const *sm, int z, double amu, double e, double t);
+
+/**
+ * @brief Deflect a direction by the Gaussian model.
+ *
+ * @param[in] theta0 Width of the projected angle [rad].
+ * @param[in,out] v Unit direction.
+ * @param[in] rng Random number generator.
+ */
+void osh_scattering_gauss(double theta0, double v[3], struct osh_rng *rng);
+
+/**
+ * @brief Deflect a direction by the Moliere model.
+ *
+ * @param[in] t Moliere tables.
+ * @param[in] sm Medium.
+ * @param[in] z Charge of the particle.
+ * @param[in] amu Mass of the particle [u].
+ * @param[in] e Kinetic energy [MeV].
+ * @param[in] th Areal thickness of the step [g/cm2].
+ * @param[in,out] v Unit direction.
+ * @param[in] rng Random number generator.
+ */
+void osh_scattering_moliere(struct scattering_table const *t,
+                            struct scattering_medium const *sm,
+                            int z,
+                            double amu,
+                            double e,
+                            double th,
+                            double v[3],
+                            struct osh_rng *rng);
+
+/**
+ * @brief Quantile of the tabulated reduced angle distribution.
+ *
+ * @param[in] t Moliere tables.
+ * @param[in] b B, clamped to [OSH_SCATTERING_BMIN, OSH_SCATTERING_BMAX].
+ * @param[in] u Probability in [0, 1].
+ *
+ * @returns Reduced angle theta' at probability u.
+ */
+double osh_scattering_quantile(struct scattering_table const *t, double b, double u);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OSH_SCATTERING_H */
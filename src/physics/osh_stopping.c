@@ -0,0 +1,266 @@
+#include "physics/osh_stopping.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_alloc.h"
+#include "common/osh_const.h"
+#include "common/osh_rc.h"
+#include "particle/osh_particle.h"
+
+#define ME 0.51099895       /* electron mass [MeV/c**2] */
+#define KBETHE 0.307075     /* 4 pi N_A r_e^2 m_e c^2 [MeV cm2/mol] */
+#define HWP 28.816e-6       /* plasma energy of a medium of rho <Z/A> = 1 [MeV] */
+#define ETA_SHELL 0.13      /* lower validity limit of the shell correction, beta*gamma */
+#define MAXMEDIUM 999       /* highest medium number, 1000 is vacuum */
+
+/* shell correction C/Z of ICRU 49, ival in eV */
+static double _shell(double ival, double z, double bg2) {
+    double e2, e4, e6;
+
+    if (bg2 < ETA_SHELL * ETA_SHELL)
+        bg2 = ETA_SHELL * ETA_SHELL;
+    e2 = 1.0 / bg2;
+    e4 = e2 * e2;
+    e6 = e4 * e2;
+    return ((0.422377 * e2 + 0.0304043 * e4 - 0.00038106 * e6) * 1e-6 * ival * ival +
+            (3.858019 * e2 - 0.1667989 * e4 + 0.00157955 * e6) * 1e-9 * ival * ival * ival) /
+           z;
+}
+
+/* energy per mass [MeV/u] below which the stopping power is velocity proportional */
+static double _tlow(struct stopping_medium const *m) {
+    double b2;
+
+    b2 = 8.0 * m->ival * 1e-6 / ME; /* 2 m_e c^2 beta^2 = 16 I */
+    return OSH_AMU * (1.0 / sqrt(1.0 - b2) - 1.0);
+}
+
+double osh_stopping_bethe(struct stopping_medium const *m, int z, double tau) {
+    double g, b2, bg2, tmax, ival, zeff, l, d, t0;
+
+    t0 = _tlow(m);
+    if (tau < t0)
+        return osh_stopping_bethe(m, z, t0) * sqrt(tau / t0);
+
+    ival = m->ival * 1e-6;
+    g = 1.0 + tau / OSH_AMU;
+    b2 = 1.0 - 1.0 / (g * g);
+    bg2 = b2 * g * g;
+
+    /* max. energy transfer to an electron, for a mass of 1 u per unit of tau */
+    tmax = 2.0 * ME * bg2 / (1.0 + 2.0 * g * ME / OSH_AMU + (ME / OSH_AMU) * (ME / OSH_AMU));
+
+    l = 0.5 * log(2.0 * ME * bg2 * tmax / (ival * ival)) - b2;
+    l -= _shell(m->ival, m->z, bg2);
+
+    /* density effect, high energy limit */
+    d = log(HWP * sqrt(m->rho * m->zovera) / ival) + 0.5 * log(bg2) - 0.5;
+    if (d > 0.0)
+        l -= d;
+
+    zeff = (double) z;
+    if (z > 1)
+        zeff *= 1.0 - exp(-125.0 * sqrt(b2) * pow((double) z, -2.0 / 3.0));
+
+    return KBETHE * m->zovera * zeff * zeff / b2 * l;
+}
+
+/* fill table t of medium m for charge z */
+static void _table(struct stopping_workspace *sw, size_t t, struct stopping_medium const *m, int z) {
+    double *dedx = sw->dedx + t * sw->stride;
+    double *lnr = sw->lnr + t * sw->stride;
+    unsigned int *rbin = sw->rbin + t * sw->stride;
+    double ta, tb, r, x, dlr;
+    size_t i, k;
+
+    for (i = 0; i < sw->n; i++)
+        dedx[i] = osh_stopping_bethe(m, z, exp(sw->lnemin + (double) i * sw->dl));
+
+    /* below the grid S ~ sqrt(tau), which integrates to 2 tau / S */
+    r = 2.0 * OSH_STOPPING_TMIN / dedx[0];
+    lnr[0] = log(r);
+    for (i = 1; i < sw->n; i++) {
+        ta = exp(sw->lnemin + (double) (i - 1) * sw->dl);
+        tb = exp(sw->lnemin + (double) i * sw->dl);
+        r += (tb - ta) / 6.0 *
+             (1.0 / dedx[i - 1] + 4.0 / osh_stopping_bethe(m, z, 0.5 * (ta + tb)) + 1.0 / dedx[i]);
+        lnr[i] = log(r);
+    }
+
+    /* uniform ln(range) grid, each point remembers the energy bin it falls into */
+    dlr = (lnr[sw->n - 1] - lnr[0]) / (double) (sw->n - 1);
+    sw->inv_dlr[t] = 1.0 / dlr;
+    i = 0;
+    for (k = 0; k < sw->n; k++) {
+        x = lnr[0] + (double) k * dlr;
+        while (i < sw->n - 2 && lnr[i + 1] <= x)
+            i++;
+        rbin[k] = (unsigned int) i;
+    }
+}
+
+void osh_stopping_free(struct stopping_workspace *sw) {
+    free(sw->row);
+    free(sw->media);
+    osh_aligned_free(sw->dedx);
+    osh_aligned_free(sw->lnr);
+    osh_aligned_free(sw->rbin);
+    free(sw->inv_dlr);
+    memset(sw, 0, sizeof(*sw));
+}
+
+int osh_stopping_init(struct stopping_workspace *sw, struct stopping_medium const *media, size_t nmedia, int zmax) {
+    struct stopping_medium const *m;
+    size_t i, ntab, per;
+    int z;
+
+    if (!sw || (!media && nmedia > 0) || zmax < 1)
+        return OSH_EINVAL;
+
+    memset(sw, 0, sizeof(*sw));
+    for (i = 0; i < nmedia; i++) {
+        m = &media[i];
+        if (m->medium < 1 || m->medium > MAXMEDIUM || !(m->rho > 0.0) || !(m->zovera > 0.0) || !(m->z > 0.0) ||
+            !(m->ival > 0.0))
+            return OSH_EINVAL;
+        if (m->medium > sw->maxmedium)
+            sw->maxmedium = m->medium;
+    }
+
+    sw->lnemin = log(OSH_STOPPING_TMIN);
+    sw->dl = log(10.0) / OSH_STOPPING_NDEC;
+    sw->inv_dl = 1.0 / sw->dl;
+    sw->n = (size_t) floor(log10(OSH_STOPPING_TMAX / OSH_STOPPING_TMIN) * OSH_STOPPING_NDEC + 0.5) + 1;
+    per = OSH_CACHELINE / sizeof(double);
+    sw->stride = (sw->n + per - 1) / per * per;
+    sw->zmax = zmax;
+    sw->nz = (size_t) (zmax - OSH_STOPPING_ZMIN + 1);
+    sw->nmedia = nmedia;
+    ntab = nmedia * sw->nz;
+
+    sw->row = malloc((size_t) (sw->maxmedium + 1) * sizeof(*sw->row));
+    sw->media = malloc((nmedia + 1) * sizeof(*sw->media));
+    sw->dedx = osh_aligned_alloc(OSH_CACHELINE, (ntab * sw->stride + 1) * sizeof(*sw->dedx));
+    sw->lnr = osh_aligned_alloc(OSH_CACHELINE, (ntab * sw->stride + 1) * sizeof(*sw->lnr));
+    sw->rbin = osh_aligned_alloc(OSH_CACHELINE, (ntab * sw->stride + 1) * sizeof(*sw->rbin));
+    sw->inv_dlr = calloc(ntab + 1, sizeof(*sw->inv_dlr));
+    if (!sw->row || !sw->media || !sw->dedx || !sw->lnr || !sw->rbin || !sw->inv_dlr) {
+        osh_stopping_free(sw);
+        return OSH_ENOMEM;
+    }
+
+    for (i = 0; i <= (size_t) sw->maxmedium; i++)
+        sw->row[i] = -1;
+    for (i = 0; i < nmedia; i++) {
+        if (sw->row[media[i].medium] >= 0) {
+            osh_stopping_free(sw);
+            return OSH_EINVAL;
+        }
+        sw->row[media[i].medium] = (int) i;
+        sw->media[i] = media[i];
+    }
+
+    for (i = 0; i < nmedia; i++)
+        for (z = OSH_STOPPING_ZMIN; z <= zmax; z++)
+            if (z != 0)
+                _table(sw, i * sw->nz + (size_t) (z - OSH_STOPPING_ZMIN), &sw->media[i], z);
+
+    return OSH_OK;
+}
+
+/* table of a particle in a medium, -1 if there is none */
+static long _find(struct stopping_workspace const *sw, struct particle const *part, int medium) {
+    if (part->z == 0 || part->z < OSH_STOPPING_ZMIN || part->z > sw->zmax || !(part->amu > 0.0))
+        return -1;
+    if (medium < 0 || medium > sw->maxmedium || sw->row[medium] < 0)
+        return -1;
+    return (long) ((size_t) sw->row[medium] * sw->nz + (size_t) (part->z - OSH_STOPPING_ZMIN));
+}
+
+double osh_stopping_dedx(void *data, struct particle const *part, int medium, double e) {
+    struct stopping_workspace const *sw = data;
+    double const *dedx;
+    double tau, x, f;
+    long t;
+    size_t i;
+
+    t = _find(sw, part, medium);
+    if (t < 0)
+        return 0.0;
+    dedx = sw->dedx + (size_t) t * sw->stride;
+
+    tau = e / part->amu;
+    if (tau <= OSH_STOPPING_TMIN)
+        return dedx[0] * sqrt(tau / OSH_STOPPING_TMIN);
+    x = (log(tau) - sw->lnemin) * sw->inv_dl;
+    if (x >= (double) (sw->n - 1))
+        return dedx[sw->n - 1];
+
+    i = (size_t) x;
+    f = x - (double) i;
+    return dedx[i] + f * (dedx[i + 1] - dedx[i]);
+}
+
+double osh_stopping_range(void *data, struct particle const *part, int medium, double e) {
+    struct stopping_workspace const *sw = data;
+    double const *dedx;
+    double const *lnr;
+    double tau, x, f;
+    long t;
+    size_t i, n;
+
+    t = _find(sw, part, medium);
+    if (t < 0)
+        return HUGE_VAL;
+    dedx = sw->dedx + (size_t) t * sw->stride;
+    lnr = sw->lnr + (size_t) t * sw->stride;
+    n = sw->n;
+
+    tau = e / part->amu;
+    if (tau <= 0.0)
+        return 0.0;
+    if (tau <= OSH_STOPPING_TMIN)
+        return part->amu * 2.0 * sqrt(tau * OSH_STOPPING_TMIN) / dedx[0];
+    x = (log(tau) - sw->lnemin) * sw->inv_dl;
+    if (x >= (double) (n - 1))
+        return part->amu * (exp(lnr[n - 1]) + (tau - OSH_STOPPING_TMAX) / dedx[n - 1]);
+
+    i = (size_t) x;
+    f = x - (double) i;
+    return part->amu * exp(lnr[i] + f * (lnr[i + 1] - lnr[i]));
+}
+
+double osh_stopping_erange(void *data, struct particle const *part, int medium, double r) {
+    struct stopping_workspace const *sw = data;
+    double const *dedx;
+    double const *lnr;
+    double rho, x, f;
+    long t;
+    size_t i, k, n;
+
+    t = _find(sw, part, medium);
+    if (t < 0 || r <= 0.0)
+        return 0.0;
+    dedx = sw->dedx + (size_t) t * sw->stride;
+    lnr = sw->lnr + (size_t) t * sw->stride;
+    n = sw->n;
+
+    rho = r / part->amu;
+    x = log(rho);
+    if (x <= lnr[0])
+        return part->amu * rho * rho * dedx[0] * dedx[0] / (4.0 * OSH_STOPPING_TMIN);
+    if (x >= lnr[n - 1])
+        return part->amu * (OSH_STOPPING_TMAX + (rho - exp(lnr[n - 1])) * dedx[n - 1]);
+
+    k = (size_t) ((x - lnr[0]) * sw->inv_dlr[t]);
+    if (k > n - 1)
+        k = n - 1;
+    i = sw->rbin[(size_t) t * sw->stride + k];
+    while (i < n - 2 && lnr[i + 1] <= x)
+        i++;
+
+    f = (x - lnr[i]) / (lnr[i + 1] - lnr[i]);
+    return part->amu * exp(sw->lnemin + ((double) i + f) * sw->dl);
+}
@@ -0,0 +1,166 @@
+#ifndef _OSH_STOPPING_H
+#define _OSH_STOPPING_H
+
+/**
+ * @file osh_stopping.h
+ * @brief Stopping power, CSDA range and inverse range tables of heavy charged particles
+ *
+ * For every medium and every charge z = -1, 1 .. zmax, the electronic mass
+ * stopping power is tabulated once at startup on a logarithmic grid of the
+ * kinetic energy per mass, tau = E / amu [MeV/u]. Particles of the same
+ * charge and velocity share a table: the stopping power depends on tau
+ * only, and the range of a particle of mass amu is amu times the tabulated
+ * range per unit mass. The tables thus cover protons, ions, pions, muons
+ * and their antiparticles; electrons and positrons are not supported.
+ *
+ * The stopping power is the Bethe formula with
+ * - the ICRU 49 shell correction, frozen below beta*gamma = 0.13,
+ * - the high energy limit of the density effect,
+ * - the Barkas effective charge z (1 - exp(-125 beta z^-2/3)) for z > 1,
+ * - a velocity proportional stopping power, S ~ sqrt(tau), below the
+ *   energy where 2 m_e c^2 beta^2 = 16 I, where the Bethe formula fails.
+ *
+ * The CSDA range is integrated from the model with Simpson's rule and
+ * stored as ln(range), interpolated linearly in ln(tau). The inverse range
+ * inverts this interpolation exactly, so osh_stopping_erange() undoes
+ * osh_stopping_range() to rounding, and the energy after a path of areal
+ * thickness t is erange(range(E) - t) with no step size error.
+ *
+ * Lookups compute the grid index from ln(tau) in O(1). The inverse range
+ * keeps, per table, a uniform grid in ln(range) pointing into the energy
+ * grid, so it is O(1) too. All tables of a quantity are stored in one
+ * cache line aligned array, one table after the other, each padded to a
+ * whole number of cache lines.
+ *
+ * osh_stopping_dedx(), osh_stopping_range() and osh_stopping_erange() match
+ * the dedx, range and erange hooks of struct transport_physics, with the
+ * struct stopping_workspace as hook data.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OSH_STOPPING_TMIN 1.0e-3 /* lower end of the energy grid [MeV/u] */
+#define OSH_STOPPING_TMAX 1.0e4  /* upper end of the energy grid [MeV/u] */
+#define OSH_STOPPING_NDEC 64     /* grid points per decade */
+#define OSH_STOPPING_ZMIN -1     /* lowest tabulated charge */
+
+/* forward declarations */
+struct particle;
+
+/**
+ * @struct stopping_medium
+ *
+ * @brief Properties of a medium entering the stopping power.
+ */
+struct stopping_medium {
+    int medium;    /* medium number, 1 .. 999 */
+    double rho;    /* nominal density [g/cm3], for the density effect */
+    double zovera; /* mean ratio of atomic number to mass <Z/A> [mol/g] */
+    double z;      /* mean atomic number, for the shell correction */
+    double ival;   /* mean excitation energy I [eV] */
+};
+
+/**
+ * @struct stopping_workspace
+ *
+ * @brief Stopping power and range tables of all media and charges.
+ *
+ * Table t = row * nz + (z - OSH_STOPPING_ZMIN) of the medium in row `row`
+ * starts at element t * stride of dedx, lnr and rbin.
+ */
+struct stopping_workspace {
+    size_t n;                      /* grid points per table */
+    size_t stride;                 /* distance between two tables, n rounded up to a cache line */
+    double lnemin;                 /* ln(OSH_STOPPING_TMIN) */
+    double dl;                     /* ln(tau) grid spacing */
+    double inv_dl;                 /* 1 / dl */
+    int zmax;                      /* highest tabulated charge */
+    size_t nz;                     /* tables per medium, zmax - OSH_STOPPING_ZMIN + 1 */
+    size_t nmedia;                 /* number of media */
+    int maxmedium;                 /* highest medium number */
+    int *row;                      /* row of each medium number 0 .. maxmedium, -1 if not tabulated */
+    struct stopping_medium *media; /* the media, by row */
+
+    double *dedx;       /* mass stopping power at the grid energies [MeV cm2/g] */
+    double *lnr;        /* ln of the CSDA range per unit mass [g/cm2/u] at the grid energies */
+    unsigned int *rbin; /* energy bin at each point of the uniform ln(range) grid */
+    double *inv_dlr;    /* 1 / spacing of the uniform ln(range) grid, per table */
+};
+
+/**
+ * @brief Build the tables.
+ *
+ * @param[out] sw Workspace to initialise.
+ * @param[in] media Media.
+ * @param[in] nmedia Number of media.
+ * @param[in] zmax Highest charge to tabulate, >= 1.
+ *
+ * @returns OSH_OK, OSH_EINVAL for invalid or duplicate media, or OSH_ENOMEM.
+ */
+int osh_stopping_init(struct stopping_workspace *sw, struct stopping_medium const *media, size_t nmedia, int zmax);
+
+/**
+ * @brief Free the tables.
+ *
+ * @param[in] sw Workspace.
+ */
+void osh_stopping_free(struct stopping_workspace *sw);
+
+/**
+ * @brief Mass stopping power of the model, without tables.
+ *
+ * @param[in] m Medium.
+ * @param[in] z Charge of the particle.
+ * @param[in] tau Kinetic energy per mass [MeV/u].
+ *
+ * @returns Mass stopping power [MeV cm2/g].
+ */
+double osh_stopping_bethe(struct stopping_medium const *m, int z, double tau);
+
+/**
+ * @brief Mass stopping power, dedx hook of struct transport_physics.
+ *
+ * @param[in] data struct stopping_workspace.
+ * @param[in] part Particle.
+ * @param[in] medium Medium number.
+ * @param[in] e Kinetic energy [MeV].
+ *
+ * @returns Mass stopping power [MeV cm2/g], 0 for neutral particles, charges
+ *          beyond the tables and media without tables.
+ */
+double osh_stopping_dedx(void *data, struct particle const *part, int medium, double e);
+
+/**
+ * @brief CSDA range, range hook of struct transport_physics.
+ *
+ * @param[in] data struct stopping_workspace.
+ * @param[in] part Particle.
+ * @param[in] medium Medium number.
+ * @param[in] e Kinetic energy [MeV].
+ *
+ * @returns Range [g/cm2], HUGE_VAL where osh_stopping_dedx() is 0.
+ */
+double osh_stopping_range(void *data, struct particle const *part, int medium, double e);
+
+/**
+ * @brief Inverse of osh_stopping_range(), erange hook of struct transport_physics.
+ *
+ * @param[in] data struct stopping_workspace.
+ * @param[in] part Particle.
+ * @param[in] medium Medium number.
+ * @param[in] r Range [g/cm2].
+ *
+ * @returns Kinetic energy [MeV] of a particle with range r, 0 for r <= 0 and
+ *          where osh_stopping_dedx() is 0.
+ */
+double osh_stopping_erange(void *data, struct particle const *part, int medium, double r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OSH_STOPPING_H */
@@ -0,0 +1,312 @@
+/*
+ * Energy loss straggling
+ *
+ * Based on:
+ *   P.V. Vavilov, "Ionization losses of high-energy heavy particles",
+ *   Sov. Phys. JETP 5, 1957.
+ *   B. Schorr, "Programs for the Landau and the Vavilov distributions and
+ *   the corresponding random numbers", Comp. Phys. Comm. 7, 1974.
+ *   W.H. Press et al., Numerical Recipes, 2nd ed., sect. 6.9 (sine and
+ *   cosine integrals).
+ */
+
+#include "physics/osh_straggling.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_const.h"
+#include "common/osh_rc.h"
+#include "random/osh_rng.h"
+#include "random/osh_rng_dist.h"
+
+#define ME 0.51099895          /* electron mass [MeV/c**2] */
+#define KBETHE 0.307075        /* 4 pi N_A r_e^2 m_e c^2 [MeV cm2/mol] */
+#define EULER 0.57721566490153 /* Euler constant */
+#define NY 1024                /* points of the density when building a table */
+#define YMIN -7.0              /* lower end of the density [sigma] */
+#define PHIMIN 1e-12           /* characteristic function below which the Fourier integral ends */
+#define KMAXT 100000           /* max. points of the Fourier integral */
+
+/* sine integral si and Cin(x) = int_0^x (1 - cos t) / t dt, x > 0 */
+static void _sicin(double x, double *si, double *cin) {
+    double t, sum_s, sum_c, sign_s, sign_c;
+    double br, bi, cr, ci, dr, di, hr, hi, ar, qr, qi, den, delr, deli, tr;
+    int n;
+
+    if (x <= 2.0) {
+        t = 1.0;
+        sum_s = 0.0;
+        sum_c = 0.0;
+        sign_s = 1.0;
+        sign_c = 1.0;
+        for (n = 1; n < 100; n++) {
+            t *= x / n;
+            if (n % 2) {
+                sum_s += sign_s * t / n;
+                sign_s = -sign_s;
+            } else {
+                sum_c += sign_c * t / n;
+                sign_c = -sign_c;
+            }
+            if (t / n < 1e-17)
+                break;
+        }
+        *si = sum_s;
+        *cin = sum_c;
+        return;
+    }
+
+    /* continued fraction of E1(ix), Lentz's method */
+    br = 1.0;
+    bi = x;
+    cr = 1e30;
+    ci = 0.0;
+    den = br * br + bi * bi;
+    dr = br / den;
+    di = -bi / den;
+    hr = dr;
+    hi = di;
+    for (n = 2; n < 1000; n++) {
+        ar = -(double) ((n - 1) * (n - 1));
+        br += 2.0;
+        /* d = 1 / (a d + b) */
+        qr = ar * dr + br;
+        qi = ar * di + bi;
+        den = qr * qr + qi * qi;
+        dr = qr / den;
+        di = -qi / den;
+        /* c = b + a / c */
+        den = cr * cr + ci * ci;
+        tr = br + ar * cr / den;
+        ci = bi - ar * ci / den;
+        cr = tr;
+        /* h *= c d */
+        delr = cr * dr - ci * di;
+        deli = cr * di + ci * dr;
+        tr = hr * delr - hi * deli;
+        hi = hr * deli + hi * delr;
+        hr = tr;
+        if (fabs(delr - 1.0) + fabs(deli) < 1e-15)
+            break;
+    }
+    /* h *= exp(-ix) */
+    tr = hr * cos(x) + hi * sin(x);
+    hi = hi * cos(x) - hr * sin(x);
+    hr = tr;
+    *si = 0.5 * OSH_M_PI + hi;
+    *cin = EULER + log(x) + hr; /* Ci = -Re h */
+}
+
+/* ln of the characteristic function of (D - <D>) / Tmax at s */
+static void _lnphi(double kappa, double beta2, double s, double *re, double *im) {
+    double si, cin;
+
+    if (s <= 0.0) {
+        *re = 0.0;
+        *im = 0.0;
+        return;
+    }
+    _sicin(s, &si, &cin);
+    *re = kappa * (1.0 - cos(s) - s * si + beta2 * cin);
+    *im = kappa * (s - sin(s) - s * cin - beta2 * (si - s));
+}
+
+/* inverse cumulative distribution of (D - <D>) / sigma, q[0 .. OSH_STRAGGLING_NU] */
+static void _table(float *q, double kappa, double beta2, double *f, double *m) {
+    double sig, ymax, dy, dt, t, s, re, im, a, zr, zi, rr, ri, tr, y, u, sum, mean;
+    size_t j, k;
+
+    sig = sqrt(kappa * (1.0 - 0.5 * beta2)); /* sigma in units of Tmax */
+    ymax = 1.0 / sig + 6.0;                  /* one collision reaches Tmax, two are rare */
+    dy = (ymax - YMIN) / (double) (NY - 1);
+    dt = 2.0 * OSH_M_PI / (3.0 * (ymax - YMIN));
+
+    /* density f(y) = 1/pi int_0^inf Re(phi(t) exp(-ity)) dt, trapezoidal in t */
+    memset(f, 0, NY * sizeof(*f));
+    for (k = 0; k < KMAXT; k++) {
+        t = (double) k * dt;
+        _lnphi(kappa, beta2, t / sig, &re, &im);
+        a = exp(re);
+        if (a < PHIMIN)
+            break;
+        if (k == 0)
+            a *= 0.5;
+        zr = a * cos(im - t * YMIN);
+        zi = a * sin(im - t * YMIN);
+        rr = cos(t * dy);
+        ri = -sin(t * dy);
+        for (j = 0; j < NY; j++) {
+            f[j] += zr;
+            tr = zr * rr - zi * ri;
+            zi = zr * ri + zi * rr;
+            zr = tr;
+        }
+    }
+
+    /* cumulative distribution and first moment, in place */
+    sum = 0.0;
+    mean = 0.0;
+    y = f[0] > 0.0 ? f[0] : 0.0;
+    f[0] = 0.0;
+    m[0] = 0.0;
+    for (j = 1; j < NY; j++) {
+        s = f[j] > 0.0 ? f[j] : 0.0;
+        sum += 0.5 * (y + s);
+        mean += 0.5 * (y * (YMIN + (double) (j - 1) * dy) + s * (YMIN + (double) j * dy));
+        y = s;
+        f[j] = sum;
+        m[j] = mean;
+    }
+
+    /* invert, the outermost quantiles are placed so that the first and last interval have the mean of their tail */
+    j = 0;
+    for (k = 1; k < OSH_STRAGGLING_NU; k++) {
+        u = sum * (double) k / OSH_STRAGGLING_NU;
+        while (j < NY - 2 && f[j + 1] < u)
+            j++;
+        s = (f[j + 1] > f[j]) ? (u - f[j]) / (f[j + 1] - f[j]) : 0.0;
+        q[k] = (float) (YMIN + ((double) j + s) * dy);
+        if (k == 1)
+            q[0] = (float) (2.0 * (m[j] + s * (m[j + 1] - m[j])) / u - q[1]);
+        if (k == OSH_STRAGGLING_NU - 1)
+            q[k + 1] = (float) (2.0 * (mean - m[j] - s * (m[j + 1] - m[j])) / (sum - u) - q[k]);
+    }
+
+    /* the mean of the piecewise linear quantile function is exactly 0 */
+    mean = 0.0;
+    for (k = 0; k < OSH_STRAGGLING_NU; k++)
+        mean += 0.5 * ((double) q[k] + (double) q[k + 1]);
+    mean /= OSH_STRAGGLING_NU;
+    for (k = 0; k <= OSH_STRAGGLING_NU; k++)
+        q[k] = (float) ((double) q[k] - mean);
+}
+
+void osh_straggling_free(struct straggling_table *t) {
+    free(t->q);
+    memset(t, 0, sizeof(*t));
+}
+
+int osh_straggling_init(struct straggling_table *t) {
+    double dlnk, kappa, beta2;
+    double *f;
+    size_t i, j;
+
+    memset(t, 0, sizeof(*t));
+    dlnk = log(OSH_STRAGGLING_KMAX / OSH_STRAGGLING_KMIN) / (OSH_STRAGGLING_NKAPPA - 1);
+    t->lnkmin = log(OSH_STRAGGLING_KMIN);
+    t->inv_dlnk = 1.0 / dlnk;
+    t->inv_dbeta2 = OSH_STRAGGLING_NBETA2 - 1;
+
+    t->q = malloc((size_t) OSH_STRAGGLING_NKAPPA * OSH_STRAGGLING_NBETA2 * (OSH_STRAGGLING_NU + 1) * sizeof(*t->q));
+    f = malloc(2 * NY * sizeof(*f));
+    if (!t->q || !f) {
+        free(f);
+        osh_straggling_free(t);
+        return OSH_ENOMEM;
+    }
+
+    for (i = 0; i < OSH_STRAGGLING_NKAPPA; i++) {
+        kappa = exp(t->lnkmin + (double) i * dlnk);
+        for (j = 0; j < OSH_STRAGGLING_NBETA2; j++) {
+            beta2 = (double) j / t->inv_dbeta2;
+            _table(t->q + (i * OSH_STRAGGLING_NBETA2 + j) * (OSH_STRAGGLING_NU + 1), kappa, beta2, f, f + NY);
+        }
+    }
+
+    free(f);
+    return OSH_OK;
+}
+
+void osh_straggling_params(int z, double amu, double e, double zovera, double t, double *xi, double *tmax, double *beta2) {
+    double g, b2, r;
+
+    g = 1.0 + e / (amu * OSH_AMU);
+    b2 = 1.0 - 1.0 / (g * g);
+    r = ME / (amu * OSH_AMU);
+    *beta2 = b2;
+    *tmax = 2.0 * ME * b2 * g * g / (1.0 + 2.0 * g * r + r * r);
+    *xi = 0.5 * KBETHE * zovera * (double) (z * z) * t / b2;
+}
+
+double osh_straggling_gauss(double xi, double tmax, double beta2, struct osh_rng *rng) {
+    return sqrt(xi * tmax * (1.0 - 0.5 * beta2)) * osh_rng_gauss01(rng);
+}
+
+/* bilinear interpolation of the quantile of the tables at u = (k + fu) / OSH_STRAGGLING_NU */
+static double _quantile(struct straggling_table const *t, double kappa, double beta2, size_t k, double fu) {
+    float const *q00, *q01, *q10, *q11;
+    double x, y, fk, fb, a00, a01, a10, a11;
+    size_t i, j;
+
+    x = (log(kappa) - t->lnkmin) * t->inv_dlnk;
+    if (x < 0.0)
+        x = 0.0;
+    if (x > OSH_STRAGGLING_NKAPPA - 1)
+        x = OSH_STRAGGLING_NKAPPA - 1;
+    i = (size_t) x;
+    if (i > OSH_STRAGGLING_NKAPPA - 2)
+        i = OSH_STRAGGLING_NKAPPA - 2;
+    fk = x - (double) i;
+
+    y = beta2 * t->inv_dbeta2;
+    if (y < 0.0)
+        y = 0.0;
+    if (y > OSH_STRAGGLING_NBETA2 - 1)
+        y = OSH_STRAGGLING_NBETA2 - 1;
+    j = (size_t) y;
+    if (j > OSH_STRAGGLING_NBETA2 - 2)
+        j = OSH_STRAGGLING_NBETA2 - 2;
+    fb = y - (double) j;
+
+    q00 = t->q + (i * OSH_STRAGGLING_NBETA2 + j) * (OSH_STRAGGLING_NU + 1) + k;
+    q01 = q00 + (OSH_STRAGGLING_NU + 1);
+    q10 = q00 + OSH_STRAGGLING_NBETA2 * (OSH_STRAGGLING_NU + 1);
+    q11 = q10 + (OSH_STRAGGLING_NU + 1);
+
+    a00 = q00[0] + fu * (q00[1] - q00[0]);
+    a01 = q01[0] + fu * (q01[1] - q01[0]);
+    a10 = q10[0] + fu * (q10[1] - q10[0]);
+    a11 = q11[0] + fu * (q11[1] - q11[0]);
+    return (1.0 - fk) * ((1.0 - fb) * a00 + fb * a01) + fk * ((1.0 - fb) * a10 + fb * a11);
+}
+
+double osh_straggling_quantile(struct straggling_table const *t, double kappa, double beta2, double u) {
+    double x;
+    size_t k;
+
+    if (u < 0.0)
+        u = 0.0;
+    if (u > 1.0)
+        u = 1.0;
+    x = u * OSH_STRAGGLING_NU;
+    k = (size_t) x;
+    if (k > OSH_STRAGGLING_NU - 1)
+        k = OSH_STRAGGLING_NU - 1;
+    return _quantile(t, kappa, beta2, k, x - (double) k);
+}
+
+double osh_straggling_vavilov(struct straggling_table const *t, double xi, double tmax, double beta2, struct osh_rng *rng) {
+    double kappa, x, c, lambda, lmax;
+    size_t k;
+
+    kappa = xi / tmax;
+    if (kappa >= OSH_STRAGGLING_KMAX)
+        return osh_straggling_gauss(xi, tmax, beta2, rng);
+
+    if (kappa < OSH_STRAGGLING_KMIN) {
+        c = 1.0 - EULER + beta2 + log(kappa);
+        lmax = 1.0 / kappa - c;
+        do {
+            lambda = osh_rng_landau(rng);
+        } while (lambda > lmax);
+        return xi * (lambda + c);
+    }
+
+    x = osh_rng_double(rng) * OSH_STRAGGLING_NU;
+    k = (size_t) x;
+    if (k > OSH_STRAGGLING_NU - 1)
+        k = OSH_STRAGGLING_NU - 1;
+    return sqrt(xi * tmax * (1.0 - 0.5 * beta2)) * _quantile(t, kappa, beta2, k, x - (double) k);
+}
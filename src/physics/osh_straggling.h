@@ -0,0 +1,148 @@
+#ifndef _OSH_STRAGGLING_H
+#define _OSH_STRAGGLING_H
+
+/**
+ * @file osh_straggling.h
+ * @brief Energy loss straggling of heavy charged particles, Gauss and Vavilov
+ *
+ * The energy loss of a step of areal thickness t fluctuates around its mean
+ * <D>. The fluctuations are set by
+ *
+ *   xi    = K/2 <Z/A> z^2 t / beta^2                  [MeV]
+ *   Tmax  = 2 m_e c^2 beta^2 gamma^2 / (1 + 2 gamma m_e/M + (m_e/M)^2)
+ *   kappa = xi / Tmax
+ *
+ * and the variance is sigma^2 = xi Tmax (1 - beta^2 / 2) (Bohr).
+ *
+ * The Gaussian model samples D = <D> + sigma g.
+ *
+ * The Vavilov model samples the Vavilov distribution, whose shape depends
+ * on kappa and beta^2 only:
+ * - kappa >= OSH_STRAGGLING_KMAX: Gaussian, the Vavilov limit of thick layers,
+ * - kappa < OSH_STRAGGLING_KMIN: Landau, D = <D> + xi (lambda + 1 - C + beta^2 + ln kappa),
+ *   with C the Euler constant and lambda truncated where the loss exceeds
+ *   <D> + Tmax, beyond which the Landau tail is unphysical,
+ * - in between: inverse cumulative distribution tables.
+ *
+ * The tables are computed once by osh_straggling_init(): the Vavilov density
+ * is obtained by Fourier inversion of its characteristic function,
+ *
+ *   ln phi(s) = kappa int_0^1 (exp(i s u) - 1 - i s u) (1/u^2 - beta^2/u) du,
+ *
+ * which has a closed form in the sine and cosine integrals, and is
+ * integrated to the cumulative distribution and inverted. The tables hold
+ * the loss in units of sigma, mean 0, at OSH_STRAGGLING_NU + 1 quantiles
+ * for OSH_STRAGGLING_NKAPPA values of kappa, logarithmically spaced, and
+ * OSH_STRAGGLING_NBETA2 values of beta^2. A sample is one uniform and a
+ * bilinear interpolation in (ln kappa, beta^2) of two neighbouring
+ * quantiles, no series is evaluated per call. All tables fit in
+ * 16 * 11 * 257 floats, about 181 kB.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* models, same values as OSH_BEAM_STRAGG_* of beam.dat */
+#define OSH_STRAGGLING_OFF 0
+#define OSH_STRAGGLING_GAUSS 1
+#define OSH_STRAGGLING_VAVILOV 2
+
+#define OSH_STRAGGLING_KMIN 0.01 /* lowest tabulated kappa, Landau below */
+#define OSH_STRAGGLING_KMAX 10.0 /* highest tabulated kappa, Gaussian above */
+#define OSH_STRAGGLING_NKAPPA 16 /* tabulated kappa values, 5 per decade */
+#define OSH_STRAGGLING_NBETA2 11 /* tabulated beta^2 values, 0 .. 1 */
+#define OSH_STRAGGLING_NU 256    /* quantile intervals per table */
+
+/* forward declarations */
+struct osh_rng;
+
+/**
+ * @struct straggling_table
+ *
+ * @brief Inverse cumulative Vavilov distributions.
+ *
+ * The table of kappa index i and beta^2 index j starts at element
+ * (i * OSH_STRAGGLING_NBETA2 + j) * (OSH_STRAGGLING_NU + 1) of q.
+ */
+struct straggling_table {
+    float *q;          /* quantiles of (D - <D>) / sigma */
+    double lnkmin;     /* ln(OSH_STRAGGLING_KMIN) */
+    double inv_dlnk;   /* 1 / ln(kappa) grid spacing */
+    double inv_dbeta2; /* 1 / beta^2 grid spacing */
+};
+
+/**
+ * @brief Compute the Vavilov tables.
+ *
+ * @param[out] t Tables to initialise.
+ *
+ * @returns OSH_OK or OSH_ENOMEM.
+ */
+int osh_straggling_init(struct straggling_table *t);
+
+/**
+ * @brief Free the Vavilov tables.
+ *
+ * @param[in] t Tables.
+ */
+void osh_straggling_free(struct straggling_table *t);
+
+/**
+ * @brief Parameters of the energy loss distribution of a step.
+ *
+ * @param[in] z Charge of the particle.
+ * @param[in] amu Mass of the particle [u].
+ * @param[in] e Kinetic energy [MeV].
+ * @param[in] zovera <Z/A> of the medium [mol/g].
+ * @param[in] t Areal thickness of the step [g/cm2].
+ * @param[out] xi Scale xi [MeV].
+ * @param[out] tmax Max. energy transfer to an electron [MeV].
+ * @param[out] beta2 beta^2.
+ */
+void osh_straggling_params(int z, double amu, double e, double zovera, double t, double *xi, double *tmax, double *beta2);
+
+/**
+ * @brief Fluctuation D - <D> of the Gaussian model.
+ *
+ * @param[in] xi Scale xi [MeV].
+ * @param[in] tmax Max. energy transfer to an electron [MeV].
+ * @param[in] beta2 beta^2.
+ * @param[in] rng Random number generator.
+ *
+ * @returns Deviation from the mean energy loss [MeV].
+ */
+double osh_straggling_gauss(double xi, double tmax, double beta2, struct osh_rng *rng);
+
+/**
+ * @brief Fluctuation D - <D> of the Vavilov model.
+ *
+ * @param[in] t Vavilov tables.
+ * @param[in] xi Scale xi [MeV].
+ * @param[in] tmax Max. energy transfer to an electron [MeV].
+ * @param[in] beta2 beta^2.
+ * @param[in] rng Random number generator.
+ *
+ * @returns Deviation from the mean energy loss [MeV].
+ */
+double osh_straggling_vavilov(struct straggling_table const *t, double xi, double tmax, double beta2, struct osh_rng *rng);
+
+/**
+ * @brief Quantile of the tabulated Vavilov distribution, in units of sigma.
+ *
+ * @param[in] t Vavilov tables.
+ * @param[in] kappa kappa, clamped to [OSH_STRAGGLING_KMIN, OSH_STRAGGLING_KMAX].
+ * @param[in] beta2 beta^2, clamped to [0, 1].
+ * @param[in] u Probability in [0, 1].
+ *
+ * @returns (D - <D>) / sigma at probability u.
+ */
+double osh_straggling_quantile(struct straggling_table const *t, double kappa, double beta2, double u);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OSH_STRAGGLING_H */
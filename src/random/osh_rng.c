@@ -5,6 +5,7 @@
 void osh_rng_init(struct osh_rng *rng, enum osh_rng_type type, uint64_t seed, uint64_t stream) {
     rng->type = type;
     rng->gauss_has_spare = 0;
+    rng->gauss_type = OSH_RNG_GAUSS_POLAR;
 
     switch (type) {
     case OSH_RNG_TYPE_PCG32:
@@ -22,6 +23,19 @@ void osh_rng_init(struct osh_rng *rng, enum osh_rng_type type, uint64_t seed, ui
     }
 }
 
+void osh_rng_set_gauss(struct osh_rng *rng, enum osh_rng_gauss_type type) {
+    switch (type) {
+    case OSH_RNG_GAUSS_ZIGGURAT:
+        rng->gauss_type = OSH_RNG_GAUSS_ZIGGURAT;
+        break;
+
+    default:
+        rng->gauss_type = OSH_RNG_GAUSS_POLAR;
+        break;
+    }
+    rng->gauss_has_spare = 0;
+}
+
 uint32_t osh_rng_u32(struct osh_rng *rng) {
     switch (rng->type) {
     case OSH_RNG_TYPE_PCG32:
@@ -76,6 +90,16 @@ double osh_rng_double(struct osh_rng *rng) {
 }
 
 double osh_rng_gauss01(struct osh_rng *rng) {
+    switch (rng->gauss_type) {
+    case OSH_RNG_GAUSS_ZIGGURAT:
+        return osh_rng_gauss01_ziggurat(rng);
+
+    default:
+        return osh_rng_gauss01_polar(rng);
+    }
+}
+
+double osh_rng_gauss01_polar(struct osh_rng *rng) {
     double u;
     double v;
     double s;
@@ -142,6 +166,11 @@ void osh_rng_float_vec(struct osh_rng *rng, float *restrict x, int n) {
 void osh_rng_gauss01_vec(struct osh_rng *rng, double *restrict x, int n) {
     int i = 0;
 
+    if (rng->gauss_type == OSH_RNG_GAUSS_ZIGGURAT) {
+        osh_rng_gauss01_ziggurat_vec(rng, x, n);
+        return;
+    }
+
     while (i + 3 < n) {
         x[i + 0] = osh_rng_gauss01(rng);
         x[i + 1] = osh_rng_gauss01(rng);
@@ -158,6 +187,14 @@ void osh_rng_gauss01_vec(struct osh_rng *rng, double *restrict x, int n) {
 void osh_rng_gauss_vec(struct osh_rng *rng, double mu, double sigma, double *restrict x, int n) {
     int i = 0;
 
+    if (rng->gauss_type == OSH_RNG_GAUSS_ZIGGURAT) {
+        osh_rng_gauss01_ziggurat_vec(rng, x, n);
+        for (i = 0; i < n; i++) {
+            x[i] = mu + sigma * x[i];
+        }
+        return;
+    }
+
     while (i + 3 < n) {
         x[i + 0] = mu + sigma * osh_rng_gauss01(rng);
         x[i + 1] = mu + sigma * osh_rng_gauss01(rng);
@@ -185,4 +222,32 @@ void osh_rng_u32_vec(struct osh_rng *rng, uint32_t *restrict x, int n) {
         x[i] = osh_rng_u32(rng);
         i++;
     }
-}
\ No newline at end of file
+}
+
+void osh_rng_u64_vec(struct osh_rng *rng, uint64_t *restrict x, int n) {
+    int i = 0;
+
+    switch (rng->type) {
+    case OSH_RNG_TYPE_PCG32:
+        while (i < n) {
+            x[i] = (uint64_t) osh_rng_pcg32_u32(rng) << 32;
+            x[i] |= (uint64_t) osh_rng_pcg32_u32(rng);
+            i++;
+        }
+        break;
+
+    case OSH_RNG_TYPE_XOSHIRO256SS:
+        while (i < n) {
+            x[i] = osh_rng_xoshiro256ss_u64(rng);
+            i++;
+        }
+        break;
+
+    default:
+        while (i < n) {
+            x[i] = osh_rng_u64(rng);
+            i++;
+        }
+        break;
+    }
+}
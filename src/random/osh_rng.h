@@ -9,7 +9,27 @@
  * - Stack-only state (no heap allocation, no pointers required)
  * - Runtime engine selection (switch-based dispatch in implementation)
  * - Fast uniform draws (u32/u64/f32/f64)
- * - Fast Gaussian sampling (Box-Muller with cached spare)
+ * - Fast Gaussian sampling, selectable per state:
+ *   - Marsaglia polar method (Box-Muller variant with cached spare), default
+ *   - Ziggurat method (table based, Doornik's ZIGNOR variant with 128 layers)
+ *
+ * Gaussian cost in ns per N(0,1) draw, gcc 12 -O3, virtualised x86-64 host
+ * where one xoshiro256** u64 costs ~4.8 ns (scalar) / ~4.0 ns (_vec):
+ *
+ *   method      engine          scalar   _vec
+ *   polar       pcg32            27.0    25.4
+ *   polar       xoshiro256**     23.7    22.5
+ *   ziggurat    pcg32            14.4    13.6
+ *   ziggurat    xoshiro256**     11.9    11.0
+ *
+ * The single precision osh_rng_gauss01f_vec() (Box-Muller with polynomial
+ * log/sincos) costs 5.9 ns with SSE2 and 2.8 ns with AVX-512F per draw on the
+ * same host (xoshiro256**), see bench/bench_osh_rng.c.
+ *
+ * The polar method rejects ~21% of its uniform pairs and pays a log() and a
+ * sqrt() per accepted pair. The ziggurat accepts ~98.8% of draws with one
+ * 64-bit uniform, one table lookup and one multiply; log()/exp() are only
+ * evaluated in the wedges and in the tail.
  *
  * Notes:
  * - "seed" selects the run; "stream" (a.k.a. sequence id) selects an
@@ -44,6 +64,14 @@ void osh_rng_pcg32_init(struct osh_rng *rng, uint64_t seed, uint64_t stream);
  */
 uint32_t osh_rng_pcg32_u32(struct osh_rng *rng);
 
+/**
+ * @brief Advance PCG32 by delta steps, as if delta numbers were drawn.
+ *
+ * @param rng Pointer to the RNG state.
+ * @param delta Number of steps.
+ */
+void osh_rng_pcg32_advance(struct osh_rng *rng, uint64_t delta);
+
 /**
  * @brief Initialize xoshiro256** engine.
  *
@@ -62,6 +90,70 @@ void osh_rng_xoshiro256ss_init(struct osh_rng *rng, uint64_t seed, uint64_t stre
  */
 uint64_t osh_rng_xoshiro256ss_u64(struct osh_rng *rng);
 
+/**
+ * @brief Advance xoshiro256** by 2^128 steps.
+ *
+ * Calling this k times on copies of one state gives k non-overlapping
+ * subsequences of length 2^128.
+ *
+ * @param rng Pointer to the RNG state.
+ */
+void osh_rng_xoshiro256ss_jump(struct osh_rng *rng);
+
+/**
+ * @brief Advance xoshiro256** by 2^192 steps.
+ *
+ * @param rng Pointer to the RNG state.
+ */
+void osh_rng_xoshiro256ss_long_jump(struct osh_rng *rng);
+
+/** @} */
+
+/**
+ * @name Gaussian samplers
+ * @{
+ */
+
+/**
+ * @brief Standard normal variate using the Marsaglia polar method.
+ *
+ * Returns two variates per accepted pair; the second one is cached in the
+ * RNG state and returned on the next call.
+ *
+ * @param rng Pointer to the RNG state.
+ *
+ * @return Standard normal random variable.
+ */
+double osh_rng_gauss01_polar(struct osh_rng *rng);
+
+/**
+ * @brief Standard normal variate using the ziggurat method.
+ *
+ * Consumes one 64-bit uniform per attempt: the low 7 bits select the layer,
+ * the top 53 bits give the signed abscissa. Does not use the spare cache.
+ *
+ * @param rng Pointer to the RNG state.
+ *
+ * @return Standard normal random variable.
+ */
+double osh_rng_gauss01_ziggurat(struct osh_rng *rng);
+
+/**
+ * @brief Generate an array of standard normal variates using the ziggurat method.
+ *
+ * Uniforms are drawn in blocks, the fast path (layer lookup, compare,
+ * multiply) runs branch-free over the block, and only the ~1.2% rejected
+ * lanes go through the scalar wedge/tail code.
+ *
+ * The stream is consumed in a different order than repeated calls to
+ * osh_rng_gauss01_ziggurat(), so the two do not produce the same sequence.
+ *
+ * @param rng Pointer to the RNG state.
+ * @param x Pointer to the output array.
+ * @param n Number of elements to generate.
+ */
+void osh_rng_gauss01_ziggurat_vec(struct osh_rng *rng, double *restrict x, int n);
+
 /** @} */
 
 /**
@@ -74,6 +166,16 @@ enum osh_rng_type {
     OSH_RNG_TYPE_XOSHIRO256SS = 2, /**< xoshiro256** engine */
 };
 
+/**
+ * @enum osh_rng_gauss_type
+ *
+ * @brief Enumeration of normal variate generators used by osh_rng_gauss*().
+ */
+enum osh_rng_gauss_type {
+    OSH_RNG_GAUSS_POLAR = 0,    /**< Marsaglia polar method (default) */
+    OSH_RNG_GAUSS_ZIGGURAT = 1, /**< Ziggurat method */
+};
+
 /**
  * @struct osh_rng
  *
@@ -81,8 +183,9 @@ enum osh_rng_type {
  *
  * Keep this on the stack or embed in other state objects.
  *
- * The "gauss_has_spare" / "gauss_spare" cache is used by osh_rng_gauss*()
- * to return two normal variates per underlying transform.
+ * The "gauss_has_spare" / "gauss_spare" cache is used by the polar method
+ * to return two normal variates per underlying transform. "gauss_type"
+ * selects which normal generator osh_rng_gauss*() dispatches to.
  */
 struct osh_rng {
     enum osh_rng_type type; /**< RNG engine type */
@@ -100,6 +203,7 @@ struct osh_rng {
 
     double gauss_spare;  /**< Cached spare value for Gaussian sampling */
     int gauss_has_spare; /**< Flag indicating if spare value is available */
+    enum osh_rng_gauss_type gauss_type; /**< Normal generator used by osh_rng_gauss*() */
 };
 
 /**
@@ -112,6 +216,17 @@ struct osh_rng {
  */
 void osh_rng_init(struct osh_rng *rng, enum osh_rng_type type, uint64_t seed, uint64_t stream);
 
+/**
+ * @brief Select the normal variate generator used by osh_rng_gauss*().
+ *
+ * osh_rng_init() selects OSH_RNG_GAUSS_POLAR. Switching discards any cached
+ * spare value, so the engine stream continues unchanged.
+ *
+ * @param rng Pointer to the RNG state.
+ * @param type Gaussian method.
+ */
+void osh_rng_set_gauss(struct osh_rng *rng, enum osh_rng_gauss_type type);
+
 /**
  * @brief Generate a 32-bit unsigned integer.
  *
@@ -151,6 +266,8 @@ double osh_rng_double(struct osh_rng *rng);
 /**
  * @brief Generate a standard normal random variable (N(0,1)).
  *
+ * Uses the method selected with osh_rng_set_gauss().
+ *
  * @param rng Pointer to the RNG state.
  *
  * @return Standard normal random variable.
@@ -195,6 +312,17 @@ void osh_rng_float_vec(struct osh_rng *rng, float *restrict x, int n);
  */
 void osh_rng_u32_vec(struct osh_rng *rng, uint32_t *restrict x, int n);
 
+/**
+ * @brief Generate an array of 64-bit unsigned integers.
+ *
+ * The engine dispatch is done once per call, not once per element.
+ *
+ * @param rng Pointer to the RNG state.
+ * @param x Pointer to the output array.
+ * @param n Number of elements to generate.
+ */
+void osh_rng_u64_vec(struct osh_rng *rng, uint64_t *restrict x, int n);
+
 /**
  * @brief Generate an array of standard normal random variables (N(0,1)).
  *
@@ -204,6 +332,34 @@ void osh_rng_u32_vec(struct osh_rng *rng, uint32_t *restrict x, int n);
  */
 void osh_rng_gauss01_vec(struct osh_rng *rng, double *restrict x, int n);
 
+/**
+ * @brief Generate a single precision standard normal random variable.
+ *
+ * Rounds the output of osh_rng_gauss01(), so it follows the method selected
+ * with osh_rng_set_gauss(). The single precision speed-up is in
+ * osh_rng_gauss01f_vec().
+ *
+ * @param rng Pointer to the RNG state.
+ *
+ * @return Standard normal random variable.
+ */
+float osh_rng_gauss01f(struct osh_rng *rng);
+
+/**
+ * @brief Generate an array of single precision standard normal random variables.
+ *
+ * Box-Muller transform in float with polynomial log and sincos, two normals
+ * per 64-bit draw, 16 lanes per instruction with AVX-512F. The 24-bit
+ * uniforms truncate the distribution at |x| = sqrt(-2 ln 2^-24) = 5.77,
+ * i.e. a probability of 8e-9 is missing from the tails. Independent of
+ * osh_rng_set_gauss().
+ *
+ * @param rng Pointer to the RNG state.
+ * @param x Pointer to the output array.
+ * @param n Number of elements to generate.
+ */
+void osh_rng_gauss01f_vec(struct osh_rng *rng, float *restrict x, int n);
+
 /**
  * @brief Generate an array of normal random variables (N(mu, sigma)).
  *
@@ -0,0 +1,423 @@
+/*
+ * Distribution sampling on top of struct osh_rng
+ *
+ * Based on:
+ *   G. Marsaglia, "Choosing a Point from the Surface of a Sphere",
+ *   Ann. Math. Stat. 43(2), 1972.
+ *   J.M. Chambers, C.L. Mallows, B.W. Stuck, "A Method for Simulating Stable
+ *   Random Variables", J. Am. Stat. Assoc. 71(354), 1976.
+ *   G. Marsaglia, W.W. Tsang, "A Simple Method for Generating Gamma
+ *   Variables", ACM TOMS 26(3), 2000.
+ *   W. Hoermann, "The transformed rejection method for generating Poisson
+ *   random variables", Insur. Math. Econ. 12(1), 1993.
+ *   M.D. Vose, "A linear algorithm for generating random numbers with a
+ *   given distribution", IEEE TSE 17(9), 1991.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "common/osh_rc.h"
+#include "random/osh_rng_dist.h"
+
+#define DIST_BLOCK 64                   /* uniforms drawn per block in the _vec versions */
+#define DIST_PI 3.14159265358979323846  /* pi */
+#define DIST_INV32 (1.0 / 4294967296.0) /* 2^-32 */
+#define DIST_POISSON_PTRS 10.0          /* mean from which PTRS is used */
+
+/* mean dependent constants of the PTRS Poisson sampler */
+struct ptrs {
+    double mean;
+    double loglam;
+    double b;
+    double a;
+    double lninvalpha;
+    double vr;
+};
+
+static void ptrs_setup(struct ptrs *p, double mean);
+static unsigned int ptrs_sample(struct osh_rng *rng, struct ptrs const *p);
+static unsigned int poisson_knuth(struct osh_rng *rng, double expmean);
+
+/* isotropic directions */
+
+void osh_rng_iso(struct osh_rng *rng, double u[3]) {
+    double a;
+    double b;
+    double s;
+    double k;
+
+    do {
+        a = 2.0 * osh_rng_double(rng) - 1.0;
+        b = 2.0 * osh_rng_double(rng) - 1.0;
+        s = a * a + b * b;
+    } while (s >= 1.0 || s == 0.0);
+
+    k = 2.0 * sqrt(1.0 - s);
+    u[0] = a * k;
+    u[1] = b * k;
+    u[2] = 1.0 - 2.0 * s;
+}
+
+void osh_rng_iso_vec(struct osh_rng *rng, double *restrict ux, double *restrict uy, double *restrict uz, int n) {
+    double r[2 * DIST_BLOCK];
+    double a;
+    double b;
+    double s;
+    double k;
+    int i;
+    int j;
+    int m;
+
+    /* Marsaglia's rejection over blocks of uniform pairs, ~27% are rejected */
+    i = 0;
+    while (i < n) {
+        m = n - i;
+        if (m > DIST_BLOCK)
+            m = DIST_BLOCK;
+
+        osh_rng_double_vec(rng, r, 2 * m);
+
+        for (j = 0; j < m; j++) {
+            a = 2.0 * r[2 * j] - 1.0;
+            b = 2.0 * r[2 * j + 1] - 1.0;
+            s = a * a + b * b;
+            if (s >= 1.0 || s == 0.0)
+                continue;
+
+            k = 2.0 * sqrt(1.0 - s);
+            ux[i] = a * k;
+            uy[i] = b * k;
+            uz[i] = 1.0 - 2.0 * s;
+            i++;
+        }
+    }
+}
+
+/* exponential */
+
+double osh_rng_exp(struct osh_rng *rng, double mean) {
+    return -mean * log(1.0 - osh_rng_double(rng)); /* 1 - u in (0, 1] */
+}
+
+void osh_rng_exp_vec(struct osh_rng *rng, double mean, double *restrict x, int n) {
+    int i;
+
+    osh_rng_double_vec(rng, x, n);
+    for (i = 0; i < n; i++) {
+        x[i] = -mean * log(1.0 - x[i]);
+    }
+}
+
+/* Landau */
+
+double osh_rng_landau(struct osh_rng *rng) {
+    double w;
+    double e;
+    double h;
+
+    /* w in (-pi/2, pi/2): u = 0 is mapped to the open end by the (0.5 + ...) shift */
+    w = DIST_PI * ((double) (osh_rng_u64(rng) >> 11) + 0.5) / 9007199254740992.0 - 0.5 * DIST_PI;
+    e = -log(1.0 - osh_rng_double(rng));
+    h = 0.5 * DIST_PI + w;
+
+    return h * tan(w) - log(e * cos(w) / h);
+}
+
+void osh_rng_landau_vec(struct osh_rng *rng, double *restrict x, int n) {
+    double r[2 * DIST_BLOCK];
+    double w;
+    double e;
+    double h;
+    int i;
+    int j;
+    int m;
+
+    i = 0;
+    while (i < n) {
+        m = n - i;
+        if (m > DIST_BLOCK)
+            m = DIST_BLOCK;
+
+        osh_rng_double_vec(rng, r, 2 * m);
+
+        for (j = 0; j < m; j++) {
+            /* r has 53 bit resolution, so adding half an ulp keeps w off -pi/2 */
+            w = DIST_PI * (r[j] + 0.5 / 9007199254740992.0) - 0.5 * DIST_PI;
+            e = -log(1.0 - r[m + j]);
+            h = 0.5 * DIST_PI + w;
+            x[i + j] = h * tan(w) - log(e * cos(w) / h);
+        }
+        i += m;
+    }
+}
+
+/* gamma */
+
+double osh_rng_gamma(struct osh_rng *rng, double k, double theta) {
+    double d;
+    double c;
+    double x;
+    double v;
+    double u;
+    double boost;
+
+    if (!(k > 0.0))
+        return 0.0;
+
+    boost = 1.0;
+    if (k < 1.0) {
+        /* gamma(k) = gamma(k + 1) * u^(1/k), u in (0, 1] */
+        boost = pow(1.0 - osh_rng_double(rng), 1.0 / k);
+        k += 1.0;
+    }
+
+    d = k - 1.0 / 3.0;
+    c = 1.0 / sqrt(9.0 * d);
+
+    for (;;) {
+        do {
+            x = osh_rng_gauss01(rng);
+            v = 1.0 + c * x;
+        } while (v <= 0.0);
+
+        v = v * v * v;
+        u = 1.0 - osh_rng_double(rng); /* (0, 1] */
+
+        if (u < 1.0 - 0.0331 * (x * x) * (x * x))
+            break;
+        if (log(u) < 0.5 * x * x + d * (1.0 - v + log(v)))
+            break;
+    }
+
+    return theta * boost * d * v;
+}
+
+void osh_rng_gamma_vec(struct osh_rng *rng, double k, double theta, double *restrict x, int n) {
+    int i;
+
+    for (i = 0; i < n; i++) {
+        x[i] = osh_rng_gamma(rng, k, theta);
+    }
+}
+
+/* Poisson */
+
+unsigned int osh_rng_poisson(struct osh_rng *rng, double mean) {
+    struct ptrs p;
+
+    if (!(mean > 0.0))
+        return 0;
+
+    if (mean < DIST_POISSON_PTRS)
+        return poisson_knuth(rng, exp(-mean));
+
+    ptrs_setup(&p, mean);
+    return ptrs_sample(rng, &p);
+}
+
+void osh_rng_poisson_vec(struct osh_rng *rng, double mean, unsigned int *restrict x, int n) {
+    struct ptrs p;
+    double expmean;
+    int i;
+
+    if (!(mean > 0.0)) {
+        for (i = 0; i < n; i++)
+            x[i] = 0;
+        return;
+    }
+
+    if (mean < DIST_POISSON_PTRS) {
+        expmean = exp(-mean);
+        for (i = 0; i < n; i++)
+            x[i] = poisson_knuth(rng, expmean);
+        return;
+    }
+
+    ptrs_setup(&p, mean);
+    for (i = 0; i < n; i++)
+        x[i] = ptrs_sample(rng, &p);
+}
+
+/*
+ * Multiplication method: count uniforms until their product drops below
+ * exp(-mean). Needs mean + 1 uniforms on average.
+ */
+static unsigned int poisson_knuth(struct osh_rng *rng, double expmean) {
+    unsigned int k;
+    double prod;
+
+    k = 0;
+    prod = 1.0 - osh_rng_double(rng);
+    while (prod > expmean) {
+        k++;
+        prod *= 1.0 - osh_rng_double(rng);
+    }
+    return k;
+}
+
+static void ptrs_setup(struct ptrs *p, double mean) {
+    double slam;
+
+    slam = sqrt(mean);
+    p->mean = mean;
+    p->loglam = log(mean);
+    p->b = 0.931 + 2.53 * slam;
+    p->a = -0.059 + 0.02483 * p->b;
+    p->lninvalpha = log(1.1239 + 1.1328 / (p->b - 3.4));
+    p->vr = 0.9277 - 3.6224 / (p->b - 2.0);
+}
+
+static unsigned int ptrs_sample(struct osh_rng *rng, struct ptrs const *p) {
+    double u;
+    double v;
+    double us;
+    double k;
+
+    for (;;) {
+        u = osh_rng_double(rng) - 0.5;
+        v = 1.0 - osh_rng_double(rng); /* (0, 1] */
+        us = 0.5 - fabs(u);
+        k = floor((2.0 * p->a / us + p->b) * u + p->mean + 0.43);
+
+        if (us >= 0.07 && v <= p->vr)
+            return (unsigned int) k;
+
+        if (k < 0.0 || (us < 0.013 && v > us))
+            continue;
+
+        if (log(v) + p->lninvalpha - log(p->a / (us * us) + p->b) <= -p->mean + k * p->loglam - lgamma(k + 1.0))
+            return (unsigned int) k;
+    }
+}
+
+/* alias tables */
+
+int osh_rng_alias_init(struct osh_rng_alias *t, double const *w, uint32_t n) {
+    uint32_t *small;
+    uint32_t *large;
+    double *q;
+    double sum;
+    uint32_t ns;
+    uint32_t nl;
+    uint32_t s;
+    uint32_t l;
+    uint32_t i;
+
+    t->bin = NULL;
+    t->n = 0;
+
+    if (n == 0)
+        return OSH_EINVAL;
+
+    sum = 0.0;
+    for (i = 0; i < n; i++) {
+        if (!(w[i] >= 0.0) || isinf(w[i]))
+            return OSH_EINVAL;
+        sum += w[i];
+    }
+    if (!(sum > 0.0) || isinf(sum))
+        return OSH_EINVAL;
+
+    t->bin = malloc(n * sizeof(*t->bin));
+    q = malloc(n * sizeof(*q));
+    small = malloc(n * sizeof(*small));
+    large = malloc(n * sizeof(*large));
+    if (!t->bin || !q || !small || !large) {
+        free(t->bin);
+        free(q);
+        free(small);
+        free(large);
+        t->bin = NULL;
+        return OSH_ENOMEM;
+    }
+
+    /* scale so that the mean bin content is 1 and split into worklists */
+    ns = 0;
+    nl = 0;
+    l = 0;
+    for (i = 0; i < n; i++) {
+        if (w[i] > 0.0)
+            l = i; /* fallback alias for zero weight leftovers */
+        q[i] = w[i] * n / sum;
+        if (q[i] < 1.0)
+            small[ns++] = i;
+        else
+            large[nl++] = i;
+    }
+
+    while (ns > 0 && nl > 0) {
+        s = small[--ns];
+        l = large[--nl];
+
+        t->bin[s].prob = q[s];
+        t->bin[s].alias = l;
+
+        q[l] = (q[l] + q[s]) - 1.0;
+        if (q[l] < 1.0)
+            small[ns++] = l;
+        else
+            large[nl++] = l;
+    }
+
+    /* leftovers are 1 up to rounding */
+    while (nl > 0) {
+        l = large[--nl];
+        t->bin[l].prob = 1.0;
+        t->bin[l].alias = l;
+    }
+    while (ns > 0) {
+        s = small[--ns];
+        t->bin[s].prob = (w[s] > 0.0) ? 1.0 : 0.0;
+        t->bin[s].alias = l;
+    }
+
+    t->n = n;
+
+    free(q);
+    free(small);
+    free(large);
+
+    return OSH_OK;
+}
+
+void osh_rng_alias_free(struct osh_rng_alias *t) {
+    free(t->bin);
+    t->bin = NULL;
+    t->n = 0;
+}
+
+/* bin from the upper 32 bits by multiply-shift, uniform in [0, 1) from the lower 32 bits */
+static inline uint32_t _alias_pick(struct osh_rng_alias const *t, uint64_t r) {
+    uint32_t i;
+    double u;
+
+    i = (uint32_t) (((r >> 32) * (uint64_t) t->n) >> 32);
+    u = (double) (uint32_t) r * DIST_INV32;
+
+    return (u < t->bin[i].prob) ? i : t->bin[i].alias;
+}
+
+uint32_t osh_rng_alias_sample(struct osh_rng_alias const *t, struct osh_rng *rng) {
+    return _alias_pick(t, osh_rng_u64(rng));
+}
+
+void osh_rng_alias_vec(struct osh_rng_alias const *t, struct osh_rng *rng, uint32_t *restrict x, int n) {
+    uint64_t r[DIST_BLOCK];
+    int i;
+    int j;
+    int m;
+
+    i = 0;
+    while (i < n) {
+        m = n - i;
+        if (m > DIST_BLOCK)
+            m = DIST_BLOCK;
+
+        osh_rng_u64_vec(rng, r, m);
+        for (j = 0; j < m; j++) {
+            x[i + j] = _alias_pick(t, r[j]);
+        }
+        i += m;
+    }
+}
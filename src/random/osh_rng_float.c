@@ -0,0 +1,354 @@
+/*
+ * Single precision samplers
+ *
+ * The _vec() variants draw 64-bit uniforms in blocks and split each into
+ * two 24-bit float uniforms, then transform them with branch-free
+ * polynomial logf() and sincos(2 pi u) kernels. The generic kernels are
+ * plain loops over arrays which the compiler vectorises for whatever ISA
+ * is enabled; with AVX-512F enabled at compile time (e.g. OSH_NATIVE_ARCH)
+ * explicit 16-lane kernels are used instead.
+ *
+ * Polynomials are those of the Cephes library (S.L. Moshier), accurate to
+ * a few ulp in float, which is well below the 2^-24 resolution of the
+ * uniforms they are applied to.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __AVX512F__
+#include <immintrin.h>
+#endif
+
+#include "random/osh_rng.h"
+#include "random/osh_rng_dist.h"
+
+#define FLT_BLOCK 64                   /* 64-bit uniforms drawn per block, a multiple of 16 */
+#define FLT_INV24 (1.0f / 16777216.0f) /* 2^-24 */
+#define FLT_2PI 6.28318530717958647692f
+#define FLT_SQRTHF 0.707106781186547524f /* sqrt(1/2) */
+#define FLT_SQRTHF_BITS 0x3f3504f3u      /* bit pattern of FLT_SQRTHF */
+
+/* natural logarithm of x > 0, x normal */
+static inline float _logf_poly(float x) {
+    uint32_t b;
+    uint32_t m;
+    float e;
+    float z;
+    float y;
+    int lo;
+
+    /*
+     * x = m 2^e with m in [sqrt(1/2), sqrt(2)). Done in integer arithmetic
+     * only: float compares and selects are not if-converted under the
+     * default -ftrapping-math, which would keep the calling loops scalar.
+     */
+    memcpy(&b, &x, sizeof(b));
+    m = (b & 0x807fffffu) | 0x3f000000u; /* [0.5, 1) */
+    lo = (int) (m < FLT_SQRTHF_BITS);    /* then use 2m and e - 1 */
+    m += (uint32_t) lo << 23;
+    e = (float) ((int) (b >> 23) - 126 - lo);
+    memcpy(&x, &m, sizeof(x));
+    x -= 1.0f;
+
+    z = x * x;
+    y = 7.0376836292e-2f;
+    y = y * x - 1.1514610310e-1f;
+    y = y * x + 1.1676998740e-1f;
+    y = y * x - 1.2420140846e-1f;
+    y = y * x + 1.4249322787e-1f;
+    y = y * x - 1.6668057665e-1f;
+    y = y * x + 2.0000714765e-1f;
+    y = y * x - 2.4999993993e-1f;
+    y = y * x + 3.3333331174e-1f;
+    y = y * x * z;
+    y += -2.12194440e-4f * e;
+    y += -0.5f * z;
+
+    return x + y + 0.693359375f * e;
+}
+
+/*
+ * sin and cos of 2 pi u for u in [0, 1). The quadrant k = round(4u) is
+ * split off exactly, leaving |alpha| <= pi/4 for the polynomials.
+ */
+static inline void _sincos2pi_poly(float u, float *s, float *c) {
+    float k;
+    float a;
+    float z;
+    float sa;
+    float ca;
+    int q;
+
+    q = (int) (4.0f * u + 0.5f); /* truncation is rounding here, and unlike floorf() it vectorises on plain SSE2 */
+    k = (float) q;
+    a = FLT_2PI * (u - 0.25f * k);
+    q &= 3;
+    z = a * a;
+
+    sa = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * a + a;
+    ca = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z - 0.5f * z + 1.0f;
+
+    /* rotate by q quarter turns */
+    *s = (q == 0) ? sa : (q == 1) ? ca : (q == 2) ? -sa : -ca;
+    *c = (q == 0) ? ca : (q == 1) ? -sa : (q == 2) ? -ca : sa;
+}
+
+/* upper and lower 24-bit float uniforms from a 64-bit draw; hi in (0, 1], lo in [0, 1) */
+static inline float _u_hi(uint64_t r) {
+    return (float) ((uint32_t) (r >> 40) + 1u) * FLT_INV24;
+}
+
+static inline float _u_lo(uint64_t r) {
+    return (float) (((uint32_t) r) >> 8) * FLT_INV24;
+}
+
+#ifdef __AVX512F__
+static inline __m512 _mm512_logf_poly(__m512 x) {
+    __m512 e;
+    __m512 m;
+    __m512 z;
+    __m512 y;
+    __mmask16 lo;
+
+    /* getexp/getmant give x = m 2^e with m in [1, 2) */
+    e = _mm512_getexp_ps(x);
+    m = _mm512_getmant_ps(x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src);
+    lo = _mm512_cmp_ps_mask(m, _mm512_set1_ps(2.0f * FLT_SQRTHF), _CMP_LT_OQ);
+    /* m < sqrt(2): x - 1 = m - 1 with exponent e, otherwise m/2 - 1 with e + 1 */
+    m = _mm512_mask_mul_ps(m, ~lo, m, _mm512_set1_ps(0.5f));
+    e = _mm512_mask_add_ps(e, ~lo, e, _mm512_set1_ps(1.0f));
+    x = _mm512_sub_ps(m, _mm512_set1_ps(1.0f));
+
+    z = _mm512_mul_ps(x, x);
+    y = _mm512_set1_ps(7.0376836292e-2f);
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(-1.1514610310e-1f));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.1676998740e-1f));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(-1.2420140846e-1f));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.4249322787e-1f));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(-1.6668057665e-1f));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(2.0000714765e-1f));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(-2.4999993993e-1f));
+    y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(3.3333331174e-1f));
+    y = _mm512_mul_ps(_mm512_mul_ps(y, x), z);
+    y = _mm512_fmadd_ps(e, _mm512_set1_ps(-2.12194440e-4f), y);
+    y = _mm512_fmadd_ps(z, _mm512_set1_ps(-0.5f), y);
+
+    return _mm512_fmadd_ps(e, _mm512_set1_ps(0.693359375f), _mm512_add_ps(x, y));
+}
+
+static inline void _mm512_sincos2pi_poly(__m512 u, __m512 *s, __m512 *c) {
+    __m512 k;
+    __m512 a;
+    __m512 z;
+    __m512 sa;
+    __m512 ca;
+    __m512i q;
+    __mmask16 swap;
+    __mmask16 negs;
+    __mmask16 negc;
+
+    k = _mm512_roundscale_ps(_mm512_fmadd_ps(u, _mm512_set1_ps(4.0f), _mm512_set1_ps(0.5f)),
+                             _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    a = _mm512_mul_ps(_mm512_set1_ps(FLT_2PI), _mm512_fnmadd_ps(k, _mm512_set1_ps(0.25f), u));
+    q = _mm512_and_si512(_mm512_cvttps_epi32(k), _mm512_set1_epi32(3));
+    z = _mm512_mul_ps(a, a);
+
+    sa = _mm512_fmadd_ps(_mm512_set1_ps(-1.9515295891e-4f), z, _mm512_set1_ps(8.3321608736e-3f));
+    sa = _mm512_fmadd_ps(sa, z, _mm512_set1_ps(-1.6666654611e-1f));
+    sa = _mm512_fmadd_ps(_mm512_mul_ps(sa, z), a, a);
+
+    ca = _mm512_fmadd_ps(_mm512_set1_ps(2.443315711809948e-5f), z, _mm512_set1_ps(-1.388731625493765e-3f));
+    ca = _mm512_fmadd_ps(ca, z, _mm512_set1_ps(4.166664568298827e-2f));
+    ca = _mm512_fmadd_ps(_mm512_mul_ps(ca, z), z, _mm512_fnmadd_ps(_mm512_set1_ps(0.5f), z, _mm512_set1_ps(1.0f)));
+
+    /* q odd swaps sin and cos; sin is negated for q = 2, 3 and cos for q = 1, 2 */
+    swap = _mm512_test_epi32_mask(q, _mm512_set1_epi32(1));
+    negs = _mm512_test_epi32_mask(q, _mm512_set1_epi32(2));
+    negc = _mm512_cmpeq_epi32_mask(q, _mm512_set1_epi32(1)) | _mm512_cmpeq_epi32_mask(q, _mm512_set1_epi32(2));
+
+    *s = _mm512_mask_blend_ps(swap, sa, ca);
+    *c = _mm512_mask_blend_ps(swap, ca, sa);
+    *s = _mm512_mask_sub_ps(*s, negs, _mm512_setzero_ps(), *s);
+    *c = _mm512_mask_sub_ps(*c, negc, _mm512_setzero_ps(), *c);
+}
+
+/* 16 uniforms from the upper (hi = 1, in (0, 1]) or lower (hi = 0, in [0, 1)) halves of 16 draws */
+static inline __m512 _mm512_u24(uint64_t const *r, int hi) {
+    __m512i a;
+    __m512i b;
+    __m256i lo8;
+    __m256i hi8;
+    __m512i v;
+
+    a = _mm512_loadu_si512((void const *) r);
+    b = _mm512_loadu_si512((void const *) (r + 8));
+    if (hi) {
+        lo8 = _mm512_cvtepi64_epi32(_mm512_srli_epi64(a, 40));
+        hi8 = _mm512_cvtepi64_epi32(_mm512_srli_epi64(b, 40));
+    } else {
+        lo8 = _mm512_cvtepi64_epi32(_mm512_srli_epi64(_mm512_and_si512(a, _mm512_set1_epi64(0xffffffff)), 8));
+        hi8 = _mm512_cvtepi64_epi32(_mm512_srli_epi64(_mm512_and_si512(b, _mm512_set1_epi64(0xffffffff)), 8));
+    }
+    v = _mm512_inserti64x4(_mm512_castsi256_si512(lo8), hi8, 1);
+    if (hi)
+        v = _mm512_add_epi32(v, _mm512_set1_epi32(1));
+
+    return _mm512_mul_ps(_mm512_cvtepi32_ps(v), _mm512_set1_ps(FLT_INV24));
+}
+#endif /* __AVX512F__ */
+
+/*
+ * Box-Muller transform of m 64-bit draws into 2m normals, x[0..m) from the
+ * cosine branch and x[m..2m) from the sine branch.
+ */
+static void gauss_block(uint64_t const *restrict r, float *restrict x, int m) {
+    float rad;
+    float s;
+    float c;
+    int j;
+
+    j = 0;
+#ifdef __AVX512F__
+    for (; j + 16 <= m; j += 16) {
+        __m512 vr;
+        __m512 vs;
+        __m512 vc;
+
+        vr = _mm512_sqrt_ps(_mm512_mul_ps(_mm512_set1_ps(-2.0f), _mm512_logf_poly(_mm512_u24(r + j, 1))));
+        _mm512_sincos2pi_poly(_mm512_u24(r + j, 0), &vs, &vc);
+        _mm512_storeu_ps(x + j, _mm512_mul_ps(vr, vc));
+        _mm512_storeu_ps(x + m + j, _mm512_mul_ps(vr, vs));
+    }
+#endif
+    for (; j < m; j++) {
+        rad = sqrtf(-2.0f * _logf_poly(_u_hi(r[j])));
+        _sincos2pi_poly(_u_lo(r[j]), &s, &c);
+        x[j] = rad * c;
+        x[m + j] = rad * s;
+    }
+}
+
+float osh_rng_gauss01f(struct osh_rng *rng) {
+    return (float) osh_rng_gauss01(rng);
+}
+
+void osh_rng_gauss01f_vec(struct osh_rng *rng, float *restrict x, int n) {
+    uint64_t r[FLT_BLOCK];
+    float t[2];
+    int i;
+    int m;
+
+    i = 0;
+    while (n - i >= 2) {
+        m = (n - i) / 2;
+        if (m > FLT_BLOCK)
+            m = FLT_BLOCK;
+
+        osh_rng_u64_vec(rng, r, m);
+        gauss_block(r, x + i, m);
+        i += 2 * m;
+    }
+    if (i < n) {
+        osh_rng_u64_vec(rng, r, 1);
+        gauss_block(r, t, 1);
+        x[i] = t[0];
+    }
+}
+
+void osh_rng_isof(struct osh_rng *rng, float u[3]) {
+    float a;
+    float b;
+    float s;
+    float k;
+
+    do {
+        a = 2.0f * osh_rng_float(rng) - 1.0f;
+        b = 2.0f * osh_rng_float(rng) - 1.0f;
+        s = a * a + b * b;
+    } while (s >= 1.0f || s == 0.0f);
+
+    k = 2.0f * sqrtf(1.0f - s);
+    u[0] = a * k;
+    u[1] = b * k;
+    u[2] = 1.0f - 2.0f * s;
+}
+
+void osh_rng_isof_vec(struct osh_rng *rng, float *restrict ux, float *restrict uy, float *restrict uz, int n) {
+    uint64_t r[FLT_BLOCK];
+    float w;
+    float sn;
+    float s;
+    float c;
+    int i;
+    int j;
+    int m;
+
+    i = 0;
+    while (i < n) {
+        m = n - i;
+        if (m > FLT_BLOCK)
+            m = FLT_BLOCK;
+
+        osh_rng_u64_vec(rng, r, m);
+
+        j = 0;
+#ifdef __AVX512F__
+        for (; j + 16 <= m; j += 16) {
+            __m512 vw;
+            __m512 vsn;
+            __m512 vs;
+            __m512 vc;
+
+            /* cos(theta) = 1 - 2w and sin(theta) = 2 sqrt(w (1 - w)), w in [0, 1) */
+            vw = _mm512_sub_ps(_mm512_set1_ps(1.0f), _mm512_u24(r + j, 1));
+            vsn = _mm512_mul_ps(_mm512_set1_ps(2.0f),
+                                _mm512_sqrt_ps(_mm512_mul_ps(vw, _mm512_sub_ps(_mm512_set1_ps(1.0f), vw))));
+            _mm512_sincos2pi_poly(_mm512_u24(r + j, 0), &vs, &vc);
+            _mm512_storeu_ps(ux + i + j, _mm512_mul_ps(vsn, vc));
+            _mm512_storeu_ps(uy + i + j, _mm512_mul_ps(vsn, vs));
+            _mm512_storeu_ps(uz + i + j, _mm512_fnmadd_ps(_mm512_set1_ps(2.0f), vw, _mm512_set1_ps(1.0f)));
+        }
+#endif
+        for (; j < m; j++) {
+            w = 1.0f - _u_hi(r[j]);
+            sn = 2.0f * sqrtf(w * (1.0f - w));
+            _sincos2pi_poly(_u_lo(r[j]), &s, &c);
+            ux[i + j] = sn * c;
+            uy[i + j] = sn * s;
+            uz[i + j] = 1.0f - 2.0f * w;
+        }
+        i += m;
+    }
+}
+
+float osh_rng_expf(struct osh_rng *rng, float mean) {
+    return -mean * _logf_poly(1.0f - osh_rng_float(rng)); /* 1 - u in (0, 1] */
+}
+
+void osh_rng_expf_vec(struct osh_rng *rng, float mean, float *restrict x, int n) {
+    uint64_t r[FLT_BLOCK];
+    int i;
+    int j;
+    int m;
+    int m2;
+
+    i = 0;
+    while (i < n) {
+        m = (n - i + 1) / 2;
+        if (m > FLT_BLOCK)
+            m = FLT_BLOCK;
+        m2 = (2 * m > n - i) ? m - 1 : m; /* an odd tail drops the last lower half */
+
+        osh_rng_u64_vec(rng, r, m);
+
+        for (j = 0; j < m; j++) {
+            x[i + j] = -mean * _logf_poly(_u_hi(r[j]));
+        }
+        for (j = 0; j < m2; j++) {
+            x[i + m + j] = -mean * _logf_poly(1.0f - _u_lo(r[j]));
+        }
+        i += m + m2;
+    }
+}
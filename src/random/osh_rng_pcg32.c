@@ -45,3 +45,29 @@ uint32_t osh_rng_pcg32_u32(struct osh_rng *rng) {
 
     return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
 }
+
+/*
+ * Jump ahead by delta steps in O(log delta) (Brown 1994, "Random Number
+ * Generation with Arbitrary Strides").
+ */
+void osh_rng_pcg32_advance(struct osh_rng *rng, uint64_t delta) {
+    uint64_t cur_mult, cur_plus;
+    uint64_t acc_mult, acc_plus;
+
+    cur_mult = 6364136223846793005ULL;
+    cur_plus = rng->u.pcg32.inc | 1ULL;
+    acc_mult = 1u;
+    acc_plus = 0u;
+
+    while (delta > 0) {
+        if (delta & 1u) {
+            acc_mult *= cur_mult;
+            acc_plus = acc_plus * cur_mult + cur_plus;
+        }
+        cur_plus = (cur_mult + 1u) * cur_plus;
+        cur_mult *= cur_mult;
+        delta >>= 1u;
+    }
+
+    rng->u.pcg32.state = acc_mult * rng->u.pcg32.state + acc_plus;
+}
@@ -0,0 +1,294 @@
+/*
+ * Per-worker RNG states with cache line padding and checkpointing
+ *
+ * Checkpoint file layout, all integers little-endian:
+ *
+ *   offset  size  content
+ *        0     8  magic "OSHRNGPL"
+ *        8     4  format version (POOL_VERSION)
+ *       12     4  engine type (enum osh_rng_type)
+ *       16     4  number of states n
+ *       20     4  reserved, 0
+ *       24     8  run seed
+ *       32     8  job offset
+ *       40  48 n  states, each:
+ *                   4 x u64 engine words (pcg32: state, inc, 0, 0)
+ *                   u64 bit pattern of the Gaussian spare
+ *                   u32 spare flag, u32 Gaussian method
+ *  40+48 n     8  FNV-1a hash of all preceding bytes
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_alloc.h"
+#include "common/osh_le.h"
+#include "common/osh_rc.h"
+#include "random/osh_rng_pool.h"
+
+#define POOL_MAGIC "OSHRNGPL"
+#define POOL_VERSION 1u
+#define POOL_HEADER 40       /* bytes before the first state */
+#define POOL_STATE 48        /* bytes per state */
+#define POOL_TRAILER 8       /* checksum */
+#define POOL_STREAM_SHIFT 32 /* pcg32 stream = (offset << 32) | worker */
+#define POOL_HISTORY_STREAM 0xffffffffULL /* pcg32 stream of history mode = (offset << 32) | this */
+#define POOL_HISTORY_STRIDE 32              /* log2 of the pcg32 steps reserved per history */
+#define POOL_HISTORY_SHIFT 40               /* xoshiro256** stream = (offset << 40) | history */
+
+static int pool_alloc(struct osh_rng_pool *pool, uint32_t n) {
+    pool->slot = osh_aligned_alloc(OSH_CACHELINE, (size_t) n * sizeof(union osh_rng_slot));
+    if (!pool->slot) {
+        pool->n = 0;
+        return OSH_ENOMEM;
+    }
+    memset(pool->slot, 0, (size_t) n * sizeof(union osh_rng_slot));
+    pool->n = n;
+    return OSH_OK;
+}
+
+int osh_rng_pool_init(struct osh_rng_pool *pool, enum osh_rng_type type, uint64_t seed, uint64_t offset, uint32_t n) {
+    struct osh_rng base;
+    uint64_t k;
+    uint32_t i;
+
+    pool->slot = NULL;
+    pool->n = 0;
+
+    if (n == 0)
+        return OSH_EINVAL;
+
+    if (pool_alloc(pool, n) != OSH_OK)
+        return OSH_ENOMEM;
+
+    pool->seed = seed;
+    pool->offset = offset;
+
+    switch (type) {
+    case OSH_RNG_TYPE_XOSHIRO256SS:
+        pool->type = OSH_RNG_TYPE_XOSHIRO256SS;
+        osh_rng_init(&base, type, seed, 0);
+        for (k = 0; k < offset; k++)
+            osh_rng_xoshiro256ss_long_jump(&base);
+        for (i = 0; i < n; i++) {
+            pool->slot[i].rng = base;
+            osh_rng_xoshiro256ss_jump(&base);
+        }
+        break;
+
+    default:
+        pool->type = OSH_RNG_TYPE_PCG32;
+        for (i = 0; i < n; i++) {
+            osh_rng_init(&pool->slot[i].rng, OSH_RNG_TYPE_PCG32, seed, (offset << POOL_STREAM_SHIFT) | i);
+        }
+        break;
+    }
+
+    return OSH_OK;
+}
+
+struct osh_rng *osh_rng_pool_history(struct osh_rng_pool *pool, uint32_t i, uint64_t history) {
+    struct osh_rng *rng;
+    enum osh_rng_gauss_type gauss;
+
+    rng = &pool->slot[i].rng;
+    gauss = rng->gauss_type;
+    if (pool->type == OSH_RNG_TYPE_XOSHIRO256SS) {
+        osh_rng_init(rng, OSH_RNG_TYPE_XOSHIRO256SS, pool->seed, (pool->offset << POOL_HISTORY_SHIFT) | history);
+    } else {
+        osh_rng_init(rng, OSH_RNG_TYPE_PCG32, pool->seed, (pool->offset << POOL_STREAM_SHIFT) | POOL_HISTORY_STREAM);
+        osh_rng_pcg32_advance(rng, history << POOL_HISTORY_STRIDE);
+    }
+    osh_rng_set_gauss(rng, gauss); /* keep the Gaussian method chosen for this slot */
+    return rng;
+}
+
+void osh_rng_pool_free(struct osh_rng_pool *pool) {
+    osh_aligned_free(pool->slot);
+    pool->slot = NULL;
+    pool->n = 0;
+}
+
+int osh_rng_pool_save(struct osh_rng_pool const *pool, const char *path) {
+    struct osh_rng const *r;
+    unsigned char *buf;
+    unsigned char *b;
+    char *tmp;
+    uint64_t spare;
+    size_t len;
+    uint32_t i;
+    FILE *fp;
+    int rc;
+
+    len = POOL_HEADER + (size_t) pool->n * POOL_STATE + POOL_TRAILER;
+    buf = malloc(len);
+    tmp = malloc(strlen(path) + 5);
+    if (!buf || !tmp) {
+        free(buf);
+        free(tmp);
+        return OSH_ENOMEM;
+    }
+
+    memcpy(buf, POOL_MAGIC, 8);
+    _put_u32(buf + 8, POOL_VERSION);
+    _put_u32(buf + 12, (uint32_t) pool->type);
+    _put_u32(buf + 16, pool->n);
+    _put_u32(buf + 20, 0);
+    _put_u64(buf + 24, pool->seed);
+    _put_u64(buf + 32, pool->offset);
+
+    for (i = 0; i < pool->n; i++) {
+        r = &pool->slot[i].rng;
+        b = buf + POOL_HEADER + (size_t) i * POOL_STATE;
+        switch (pool->type) {
+        case OSH_RNG_TYPE_XOSHIRO256SS:
+            _put_u64(b, r->u.xoshiro256ss.s[0]);
+            _put_u64(b + 8, r->u.xoshiro256ss.s[1]);
+            _put_u64(b + 16, r->u.xoshiro256ss.s[2]);
+            _put_u64(b + 24, r->u.xoshiro256ss.s[3]);
+            break;
+        default:
+            _put_u64(b, r->u.pcg32.state);
+            _put_u64(b + 8, r->u.pcg32.inc);
+            _put_u64(b + 16, 0);
+            _put_u64(b + 24, 0);
+            break;
+        }
+        memcpy(&spare, &r->gauss_spare, sizeof(spare));
+        _put_u64(b + 32, spare);
+        _put_u32(b + 40, (uint32_t) r->gauss_has_spare);
+        _put_u32(b + 44, (uint32_t) r->gauss_type);
+    }
+    _put_u64(buf + len - POOL_TRAILER, _fnv1a(OSH_FNV1A_INIT, buf, len - POOL_TRAILER));
+
+    sprintf(tmp, "%s.tmp", path);
+    rc = OSH_EIO;
+    fp = fopen(tmp, "wb");
+    if (fp) {
+        if (fwrite(buf, 1, len, fp) == len)
+            rc = OSH_OK;
+        if (fclose(fp) != 0)
+            rc = OSH_EIO;
+    }
+
+    if (rc == OSH_OK) {
+#ifdef _WIN32
+        remove(path); /* rename() does not replace existing files on Windows */
+#endif
+        if (rename(tmp, path) != 0)
+            rc = OSH_EIO;
+    }
+    if (rc != OSH_OK)
+        remove(tmp);
+
+    free(buf);
+    free(tmp);
+
+    return rc;
+}
+
+int osh_rng_pool_load(struct osh_rng_pool *pool, const char *path) {
+    unsigned char head[POOL_HEADER];
+    unsigned char *buf;
+    unsigned char const *b;
+    struct osh_rng *r;
+    enum osh_rng_type type;
+    uint64_t spare;
+    size_t len;
+    uint32_t n;
+    uint32_t i;
+    FILE *fp;
+
+    pool->slot = NULL;
+    pool->n = 0;
+
+    fp = fopen(path, "rb");
+    if (!fp)
+        return OSH_EIO;
+
+    if (fread(head, 1, POOL_HEADER, fp) != POOL_HEADER) {
+        fclose(fp);
+        return OSH_EPARSE;
+    }
+    if (memcmp(head, POOL_MAGIC, 8) != 0) {
+        fclose(fp);
+        return OSH_EPARSE;
+    }
+    if (_get_u32(head + 8) != POOL_VERSION) {
+        fclose(fp);
+        return OSH_ENOTSUP;
+    }
+
+    switch (_get_u32(head + 12)) {
+    case OSH_RNG_TYPE_PCG32:
+        type = OSH_RNG_TYPE_PCG32;
+        break;
+    case OSH_RNG_TYPE_XOSHIRO256SS:
+        type = OSH_RNG_TYPE_XOSHIRO256SS;
+        break;
+    default:
+        fclose(fp);
+        return OSH_ENOTSUP;
+    }
+
+    n = _get_u32(head + 16);
+    if (n == 0) {
+        fclose(fp);
+        return OSH_EPARSE;
+    }
+
+    len = POOL_HEADER + (size_t) n * POOL_STATE + POOL_TRAILER;
+    buf = malloc(len);
+    if (!buf) {
+        fclose(fp);
+        return OSH_ENOMEM;
+    }
+    memcpy(buf, head, POOL_HEADER);
+    if (fread(buf + POOL_HEADER, 1, len - POOL_HEADER, fp) != len - POOL_HEADER) {
+        free(buf);
+        fclose(fp);
+        return OSH_EPARSE;
+    }
+    fclose(fp);
+
+    if (_get_u64(buf + len - POOL_TRAILER) != _fnv1a(OSH_FNV1A_INIT, buf, len - POOL_TRAILER)) {
+        free(buf);
+        return OSH_EPARSE;
+    }
+
+    if (pool_alloc(pool, n) != OSH_OK) {
+        free(buf);
+        return OSH_ENOMEM;
+    }
+
+    pool->type = type;
+    pool->seed = _get_u64(buf + 24);
+    pool->offset = _get_u64(buf + 32);
+
+    for (i = 0; i < n; i++) {
+        r = &pool->slot[i].rng;
+        b = buf + POOL_HEADER + (size_t) i * POOL_STATE;
+        r->type = type;
+        switch (type) {
+        case OSH_RNG_TYPE_XOSHIRO256SS:
+            r->u.xoshiro256ss.s[0] = _get_u64(b);
+            r->u.xoshiro256ss.s[1] = _get_u64(b + 8);
+            r->u.xoshiro256ss.s[2] = _get_u64(b + 16);
+            r->u.xoshiro256ss.s[3] = _get_u64(b + 24);
+            break;
+        default:
+            r->u.pcg32.state = _get_u64(b);
+            r->u.pcg32.inc = _get_u64(b + 8);
+            break;
+        }
+        osh_rng_set_gauss(r, (enum osh_rng_gauss_type) _get_u32(b + 44)); /* drops the spare, so first */
+        spare = _get_u64(b + 32);
+        memcpy(&r->gauss_spare, &spare, sizeof(spare));
+        r->gauss_has_spare = (int) _get_u32(b + 40);
+    }
+
+    free(buf);
+
+    return OSH_OK;
+}
@@ -0,0 +1,138 @@
+#ifndef OSH_RNG_POOL_H
+#define OSH_RNG_POOL_H
+
+/**
+ * @file osh_rng_pool.h
+ * @brief Per-worker RNG states with cache line padding and checkpointing
+ *
+ * One struct osh_rng per worker thread, each in its own cache line(s), so
+ * that workers drawing random numbers concurrently do not false-share.
+ *
+ * All states derive from a run seed and an offset:
+ * - seed: the random number seed of the run, beam_workspace::rndseed.
+ * - offset: the index of this job among independent jobs of the same run,
+ *   beam_workspace::rndoffset (the -N option).
+ *
+ * Streams are disjoint across workers and offsets:
+ * - PCG32: worker w of offset k uses the stream (k << 32) | w, i.e. its own
+ *   LCG increment. Offsets must be below 2^31.
+ * - xoshiro256**: the state seeded from seed is advanced by k long jumps
+ *   (2^192 steps) and then by w jumps (2^128 steps), so subsequences do not
+ *   overlap before 2^128 draws.
+ *
+ * The whole pool can be saved to disk and restored, which resumes every
+ * stream bit-identically, including a cached Gaussian spare.
+ *
+ * Alternatively a slot can be reset to the stream of one primary history
+ * with osh_rng_pool_history(). The numbers a history draws then depend only
+ * on seed, offset and history number, not on which worker runs it, which
+ * makes a run reproducible for any number of threads:
+ * - PCG32: stream (k << 32) | 0xffffffff, advanced by history * 2^32 steps.
+ *   Histories must stay below 2^32 and draw fewer than 2^32 numbers each.
+ * - xoshiro256**: seeded with the stream number (k << 40) | history, for
+ *   histories below 2^40.
+ */
+
+#include <stdint.h>
+
+#include "common/osh_alloc.h"
+#include "random/osh_rng.h"
+
+/** Size of one pool slot, sizeof(struct osh_rng) rounded up to whole cache lines. */
+#define OSH_RNG_SLOT_SIZE ((sizeof(struct osh_rng) + OSH_CACHELINE - 1) / OSH_CACHELINE * OSH_CACHELINE)
+
+/**
+ * @union osh_rng_slot
+ *
+ * @brief RNG state padded to whole cache lines.
+ */
+union osh_rng_slot {
+    struct osh_rng rng;                   /**< RNG state */
+    unsigned char pad[OSH_RNG_SLOT_SIZE]; /**< Padding up to the cache line boundary */
+};
+
+/**
+ * @struct osh_rng_pool
+ *
+ * @brief Pool of per-worker RNG states.
+ */
+struct osh_rng_pool {
+    union osh_rng_slot *slot; /**< n slots, cache line aligned */
+    uint64_t seed;            /**< Run seed */
+    uint64_t offset;          /**< Job offset */
+    enum osh_rng_type type;   /**< RNG engine type of all states */
+    uint32_t n;               /**< Number of workers */
+};
+
+/**
+ * @brief Allocate and seed one RNG state per worker.
+ *
+ * @param pool Pointer to the pool to initialise.
+ * @param type RNG engine type.
+ * @param seed Run seed, e.g. beam_workspace::rndseed.
+ * @param offset Job offset, e.g. beam_workspace::rndoffset.
+ * @param n Number of workers, > 0.
+ *
+ * @return OSH_OK, OSH_EINVAL for n == 0 or OSH_ENOMEM.
+ */
+int osh_rng_pool_init(struct osh_rng_pool *pool, enum osh_rng_type type, uint64_t seed, uint64_t offset, uint32_t n);
+
+/**
+ * @brief Free the RNG states of a pool.
+ *
+ * @param pool Pointer to the pool.
+ */
+void osh_rng_pool_free(struct osh_rng_pool *pool);
+
+/**
+ * @brief Write all RNG states of a pool to a file.
+ *
+ * The file is written under a temporary name and renamed when complete,
+ * so an interrupted write never replaces a previous checkpoint. The format
+ * is little-endian on all hosts and carries a checksum.
+ *
+ * @param pool Pointer to the pool.
+ * @param path File name.
+ *
+ * @return OSH_OK, OSH_EIO or OSH_ENOMEM.
+ */
+int osh_rng_pool_save(struct osh_rng_pool const *pool, const char *path);
+
+/**
+ * @brief Initialise a pool from a file written by osh_rng_pool_save().
+ *
+ * The pool must not be initialised; on failure it is left empty.
+ *
+ * @param pool Pointer to the pool to initialise.
+ * @param path File name.
+ *
+ * @return OSH_OK, OSH_EIO on read errors, OSH_EPARSE for a file which is not
+ *         a pool checkpoint or fails the checksum, OSH_ENOTSUP for an
+ *         unknown format version or engine, or OSH_ENOMEM.
+ */
+int osh_rng_pool_load(struct osh_rng_pool *pool, const char *path);
+
+/**
+ * @brief Get the RNG state of a worker.
+ *
+ * @param pool Pointer to the pool.
+ * @param i Worker index, < pool->n.
+ *
+ * @return Pointer to the RNG state.
+ */
+static inline struct osh_rng *osh_rng_pool_get(struct osh_rng_pool *pool, uint32_t i) {
+    return &pool->slot[i].rng;
+}
+
+/**
+ * @brief Reset the RNG state of a worker to the stream of a primary history.
+ *
+ * @param pool Pointer to the pool.
+ * @param i Worker index, < pool->n.
+ * @param history Primary history number within this job.
+ *
+ * @return Pointer to the RNG state.
+ */
+struct osh_rng *osh_rng_pool_history(struct osh_rng_pool *pool, uint32_t i, uint64_t history);
+
+#endif /* OSH_RNG_POOL_H */
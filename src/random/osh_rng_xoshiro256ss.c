@@ -70,3 +70,58 @@ uint64_t osh_rng_xoshiro256ss_u64(struct osh_rng *rng) {
 
     return result;
 }
+
+/*
+ * Apply the jump polynomial j: replace the state by sum_i j_i T^i s,
+ * where T is one step of the generator.
+ */
+static void _xoshiro256_jump_poly(struct osh_rng *rng, uint64_t const j[4]) {
+    uint64_t *s;
+    uint64_t s0;
+    uint64_t s1;
+    uint64_t s2;
+    uint64_t s3;
+    int i;
+    int b;
+
+    s = rng->u.xoshiro256ss.s;
+    s0 = 0;
+    s1 = 0;
+    s2 = 0;
+    s3 = 0;
+    for (i = 0; i < 4; i++) {
+        for (b = 0; b < 64; b++) {
+            if (j[i] & (1ULL << b)) {
+                s0 ^= s[0];
+                s1 ^= s[1];
+                s2 ^= s[2];
+                s3 ^= s[3];
+            }
+            osh_rng_xoshiro256ss_u64(rng);
+        }
+    }
+    s[0] = s0;
+    s[1] = s1;
+    s[2] = s2;
+    s[3] = s3;
+}
+
+/*
+ * Advance by 2^128 steps.
+ */
+void osh_rng_xoshiro256ss_jump(struct osh_rng *rng) {
+    static const uint64_t j[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL,
+                                  0x39abdc4529b1661cULL};
+
+    _xoshiro256_jump_poly(rng, j);
+}
+
+/*
+ * Advance by 2^192 steps.
+ */
+void osh_rng_xoshiro256ss_long_jump(struct osh_rng *rng) {
+    static const uint64_t j[4] = {0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL,
+                                  0x39109bb02acbe635ULL};
+
+    _xoshiro256_jump_poly(rng, j);
+}
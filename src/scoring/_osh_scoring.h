@@ -0,0 +1,140 @@
+#ifndef _OSH_SCORING_INTERNAL
+#define _OSH_SCORING_INTERNAL
+
+/*
+ * Per step scoring shared by the geometry traversals, internal to src/scoring.
+ *
+ * A traversal cuts a step into the parts inside each bin it crosses and
+ * hands every part to _osh_scoring_add(). The energy lost in the step is
+ * shared out in proportion to track length.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common/osh_rc.h"
+#include "scoring/osh_scoring.h"
+#include "transport/osh_transport.h"
+
+/* what all geometries need to know about a step */
+struct scoring_step {
+    struct step const *st;
+    uint64_t mask;  /* filters accepting the particle */
+    double dosefac; /* dose per energy and bin volume [Gy cm3/MeV], 0 in vacuum */
+    double let;     /* energy loss per track length [keV/um], < 0 for steps of zero length, which have none */
+    double loge;    /* log of the mean kinetic energy [MeV], if the workspace has a spectrum */
+};
+
+/* allocate block b of a buffer if needed and list it as touched, returns OSH_OK or OSH_ENOMEM */
+int _osh_scoring_touch(struct scoring_buffer *buf, size_t b);
+
+/* score of the current history in a bin to add to, NULL if its block could not be allocated */
+static inline double *_osh_scoring_bin(struct scoring_buffer *buf, size_t bin) {
+    size_t b = bin >> OSH_SCORING_BLOCK_SHIFT;
+    struct scoring_bin *x;
+
+    if (!buf->dirty[b] && _osh_scoring_touch(buf, b) != OSH_OK)
+        return NULL;
+    x = &buf->blk[b][bin & (OSH_SCORING_BLOCK - 1)];
+    if (x->last != buf->hist) {
+        /* first score of this history here, the previous one is finished */
+        x->sum += x->cur;
+        x->sum2 += x->cur * x->cur;
+        x->cur = 0.0;
+        x->last = buf->hist;
+    }
+    return &x->cur;
+}
+
+/* add a part of length l [cm] with energy loss de [MeV] in bin of a geometry, inv_vol is 1 / bin volume [1/cm3] */
+static inline void _osh_scoring_add(struct scoring_buffer *buf,
+                                    struct scoring_geo const *g,
+                                    struct scoring_step const *s,
+                                    size_t bin,
+                                    double l,
+                                    double de,
+                                    double inv_vol) {
+    struct scoring_page const *pg;
+    double *x, *w, u;
+    size_t k;
+
+    for (k = 0; k < g->npages; k++) {
+        pg = &buf->sw->pages[g->pages[k]];
+        if (pg->fmask & ~s->mask)
+            continue;
+        if (pg->quantity == OSH_SCORING_QTY_SPECTRUM) {
+            u = (s->loge - pg->loge0) * pg->inv_dloge;
+            if (!(u >= 0.0 && u < (double) pg->ne))
+                continue;
+            x = _osh_scoring_bin(buf, pg->offset + bin * pg->ne + (size_t) u);
+            if (x)
+                *x += l * inv_vol;
+            continue;
+        }
+        x = _osh_scoring_bin(buf, pg->offset + bin);
+        if (!x)
+            continue;
+        switch (pg->quantity) {
+        case OSH_SCORING_QTY_ENERGY:
+            *x += de;
+            break;
+        case OSH_SCORING_QTY_FLUENCE:
+            *x += l * inv_vol;
+            break;
+        case OSH_SCORING_QTY_DOSE:
+            *x += de * s->dosefac * inv_vol;
+            break;
+        case OSH_SCORING_QTY_LETT:
+        case OSH_SCORING_QTY_LETD:
+            /* the residual energy of a stopping particle has no LET, and would only dilute LETd */
+            if (s->let < 0.0)
+                break;
+            /* the weight is in the second half of the page */
+            w = _osh_scoring_bin(buf, pg->offset + g->nbins + bin);
+            if (!w)
+                break;
+            u = (pg->quantity == OSH_SCORING_QTY_LETT) ? l : de;
+            *x += u * s->let;
+            *w += u;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/* merged sum or sum2 of a bin, blk in blocks as in struct scoring_workspace */
+static inline double _osh_scoring_get(double *const *blk, size_t bin) {
+    double const *b = blk[bin >> OSH_SCORING_BLOCK_SHIFT];
+
+    return b ? b[bin & (OSH_SCORING_BLOCK - 1)] : 0.0;
+}
+
+/* standard errors of the mean per primary of the n bins from first */
+void _osh_scoring_stderr(double *const *sum, double *const *sum2, uint64_t nprim, size_t first, size_t n, double *err);
+
+/* join a background snapshot and release its copy */
+void _osh_scoring_snapshot_free(struct scoring_snapshot *s);
+
+/* score a step on a Cartesian mesh */
+void _osh_scoring_mesh(struct scoring_buffer *buf, struct scoring_geo const *g, struct scoring_step const *s);
+
+/* score a step on a cylindrical or spherical mesh */
+void _osh_scoring_radial(struct scoring_buffer *buf, struct scoring_geo const *g, struct scoring_step const *s);
+
+/* record a step crossing the surface of a phase-space output */
+void _osh_scoring_phsp(struct scoring_buffer *buf, struct particle const *part, struct scoring_step const *s);
+
+/* zone bitmaps and the writer queue of the phase-space outputs, returns OSH_OK or OSH_ENOMEM */
+int _osh_scoring_phsp_init(struct scoring_workspace *sw);
+
+/* queue the records of a buffer for the writer thread and start it if needed */
+void _osh_scoring_phsp_merge(struct scoring_workspace *sw, struct scoring_buffer *buf);
+
+/* write what is queued, complete and close the phase-space files, returns the first error */
+int _osh_scoring_phsp_close(struct scoring_workspace *sw);
+
+/* remove unfinished phase-space files and release the outputs */
+void _osh_scoring_phsp_free(struct scoring_workspace *sw);
+
+#endif /* !_OSH_SCORING_INTERNAL */
@@ -0,0 +1,581 @@
+#include "scoring/osh_scoring.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "common/osh_const.h"
+#include "common/osh_logger.h"
+#include "common/osh_rc.h"
+#include "particle/osh_particle.h"
+#include "scoring/_osh_scoring.h"
+#include "transport/osh_transport.h"
+#include "transport/osh_transport_run.h"
+
+/* free the merged result */
+static void _result_free(struct scoring_workspace *sw) {
+    size_t b;
+
+    if (sw->sum)
+        for (b = 0; b < sw->nblk; b++) {
+            free(sw->sum[b]);
+            free(sw->sum2[b]);
+        }
+    free(sw->sum);
+    free(sw->sum2);
+    sw->sum = sw->sum2 = NULL;
+}
+
+void osh_scoring_free(struct scoring_workspace *sw) {
+    size_t i;
+
+    _osh_scoring_snapshot_free(&sw->snap);
+    _osh_scoring_phsp_free(sw);
+    _result_free(sw);
+    if (sw->geos)
+        for (i = 0; i < sw->ngeos; i++) {
+            free(sw->geos[i].pages);
+            free(sw->geos[i].mesh.ivol);
+            free(sw->geos[i].zone.ids);
+            free(sw->geos[i].zone.inv_vol);
+        }
+    if (sw->outputs)
+        for (i = 0; i < sw->noutputs; i++)
+            free(sw->outputs[i].filename);
+    free(sw->filters);
+    free(sw->geos);
+    free(sw->pages);
+    free(sw->outputs);
+    free(sw->zbins);
+    free(sw->zstart);
+    free(sw->filename);
+    memset(sw, 0, sizeof(*sw));
+}
+
+int osh_scoring_filter_find(struct scoring_workspace const *sw, const char *name) {
+    size_t i;
+
+    for (i = 0; i < sw->nfilters; i++)
+        if (strcasecmp(sw->filters[i].name, name) == 0)
+            return (int) i;
+    return -1;
+}
+
+int osh_scoring_geo_find(struct scoring_workspace const *sw, const char *name) {
+    size_t i;
+
+    for (i = 0; i < sw->ngeos; i++)
+        if (strcasecmp(sw->geos[i].name, name) == 0)
+            return (int) i;
+    return -1;
+}
+
+/* derived fields and number of bins of a mesh, returns OSH_OK, OSH_EINVAL or OSH_ENOMEM */
+static int _mesh(struct scoring_geo *g) {
+    struct scoring_mesh *m = &g->mesh;
+    int type = g->type;
+    double r0, r1, d, th, dc;
+    size_t i, j;
+
+    m->vol = 1.0;
+    for (i = 0; i < 3; i++) {
+        if (m->n[i] == 0 || !(m->x1[i] > m->x0[i]))
+            return OSH_EINVAL;
+        m->inv_d[i] = (double) m->n[i] / (m->x1[i] - m->x0[i]);
+        m->vol /= m->inv_d[i];
+    }
+    m->inv_vol = 1.0 / m->vol;
+    free(m->ivol);
+    m->ivol = NULL;
+    g->nbins = m->n[0] * m->n[1] * m->n[2];
+    if (type == OSH_SCORING_GEO_MESH)
+        return OSH_OK;
+
+    /* radius from 0, polar angle in [0, pi], azimuth in [0, 2 pi] */
+    if (m->x0[0] < 0.0 || m->x0[1] < 0.0)
+        return OSH_EINVAL;
+    if (type == OSH_SCORING_GEO_CYL && m->x1[1] > 2.0 * OSH_M_PI * (1.0 + 1e-12))
+        return OSH_EINVAL;
+    if (type == OSH_SCORING_GEO_SPH &&
+        (m->x1[1] > OSH_M_PI * (1.0 + 1e-12) || m->x0[2] < 0.0 || m->x1[2] > 2.0 * OSH_M_PI * (1.0 + 1e-12)))
+        return OSH_EINVAL;
+
+    d = 1.0 / m->inv_d[0];
+    if (type == OSH_SCORING_GEO_CYL) {
+        m->ivol = malloc(m->n[0] * sizeof(*m->ivol));
+        if (!m->ivol)
+            return OSH_ENOMEM;
+        for (i = 0; i < m->n[0]; i++) {
+            r0 = m->x0[0] + (double) i * d;
+            r1 = r0 + d;
+            m->ivol[i] = 2.0 * m->inv_d[1] * m->inv_d[2] / (r1 * r1 - r0 * r0);
+        }
+    } else {
+        m->ivol = malloc(m->n[0] * m->n[1] * sizeof(*m->ivol));
+        if (!m->ivol)
+            return OSH_ENOMEM;
+        for (j = 0; j < m->n[1]; j++) {
+            th = m->x0[1] + (double) j / m->inv_d[1];
+            dc = cos(th) - cos(th + 1.0 / m->inv_d[1]);
+            for (i = 0; i < m->n[0]; i++) {
+                r0 = m->x0[0] + (double) i * d;
+                r1 = r0 + d;
+                m->ivol[i + m->n[0] * j] = 3.0 * m->inv_d[2] / ((r1 * r1 * r1 - r0 * r0 * r0) * dc);
+            }
+        }
+    }
+    return OSH_OK;
+}
+
+/* number of bins of a zone geometry, returns OSH_OK or OSH_EINVAL */
+static int _zone(struct scoring_geo *g) {
+    struct scoring_zone const *z = &g->zone;
+    size_t i;
+
+    if (z->n == 0 || !z->ids)
+        return OSH_EINVAL;
+    for (i = 0; i < z->n; i++)
+        if (z->ids[i] == 0 || (z->inv_vol && !(z->inv_vol[i] > 0.0)))
+            return OSH_EINVAL;
+    g->nbins = z->n;
+    return OSH_OK;
+}
+
+/* unit normal and offset of a plane, returns OSH_OK or OSH_EINVAL */
+static int _plane(struct scoring_geo *g) {
+    struct scoring_plane *pl = &g->plane;
+    double l;
+    int i;
+
+    l = sqrt(pl->n[0] * pl->n[0] + pl->n[1] * pl->n[1] + pl->n[2] * pl->n[2]);
+    if (!(l > 0.0) || !isfinite(l))
+        return OSH_EINVAL;
+    pl->d = 0.0;
+    for (i = 0; i < 3; i++) {
+        pl->n[i] /= l;
+        pl->d += pl->n[i] * pl->c[i];
+    }
+    g->nbins = 0;
+    return OSH_OK;
+}
+
+/* table of the bins each zone scores into, returns OSH_OK, OSH_EINVAL for a zone twice in a geometry, or OSH_ENOMEM */
+static int _zone_table(struct scoring_workspace *sw) {
+    struct scoring_geo const *g;
+    struct scoring_zbin *e;
+    size_t *fill;
+    size_t i, k, z, n;
+
+    free(sw->zbins);
+    free(sw->zstart);
+    sw->zbins = NULL;
+    sw->zstart = NULL;
+    sw->nzt = 0;
+
+    /* count the entries of each zone, zstart[z + 1] first holds the count of zone z */
+    n = 0;
+    for (i = 0; i < sw->ngeos; i++) {
+        g = &sw->geos[i];
+        if (g->type != OSH_SCORING_GEO_ZONE || g->npages == 0)
+            continue;
+        for (k = 0; k < g->zone.n; k++)
+            if (g->zone.ids[k] + 1 > sw->nzt)
+                sw->nzt = g->zone.ids[k] + 1;
+        n += g->zone.n;
+    }
+    if (n == 0)
+        return OSH_OK;
+    sw->zstart = calloc(sw->nzt + 1, sizeof(*sw->zstart));
+    sw->zbins = malloc(n * sizeof(*sw->zbins));
+    fill = calloc(sw->nzt, sizeof(*fill));
+    if (!sw->zstart || !sw->zbins || !fill) {
+        free(fill);
+        return OSH_ENOMEM;
+    }
+    for (i = 0; i < sw->ngeos; i++) {
+        g = &sw->geos[i];
+        if (g->type == OSH_SCORING_GEO_ZONE && g->npages > 0)
+            for (k = 0; k < g->zone.n; k++)
+                sw->zstart[g->zone.ids[k] + 1]++;
+    }
+    for (z = 0; z < sw->nzt; z++)
+        sw->zstart[z + 1] += sw->zstart[z];
+
+    for (i = 0; i < sw->ngeos; i++) {
+        g = &sw->geos[i];
+        if (g->type != OSH_SCORING_GEO_ZONE || g->npages == 0)
+            continue;
+        for (k = 0; k < g->zone.n; k++) {
+            z = g->zone.ids[k];
+            e = &sw->zbins[sw->zstart[z] + fill[z]];
+            /* entries of one geometry are adjacent */
+            if (fill[z] > 0 && e[-1].geo == i) {
+                free(fill);
+                return OSH_EINVAL;
+            }
+            e->geo = i;
+            e->bin = k;
+            e->inv_vol = g->zone.inv_vol ? g->zone.inv_vol[k] : 1.0;
+            fill[z]++;
+        }
+    }
+    free(fill);
+    return OSH_OK;
+}
+
+int osh_scoring_compile(struct scoring_workspace *sw) {
+    struct scoring_geo *g;
+    struct scoring_page *pg;
+    struct scoring_output const *o;
+    size_t i, k, nphsp;
+    int type;
+    int rc;
+
+    if (osh_scoring_filter_compile(&sw->ft, sw->filters, sw->nfilters) != OSH_OK)
+        return OSH_EINVAL;
+
+    for (i = 0; i < sw->ngeos; i++) {
+        g = &sw->geos[i];
+        free(g->pages);
+        g->pages = NULL;
+        g->npages = 0;
+        if (g->type < OSH_SCORING_GEO_MESH || g->type > OSH_SCORING_GEO_PLANE)
+            return OSH_EINVAL;
+        if (g->type == OSH_SCORING_GEO_ZONE)
+            rc = _zone(g);
+        else if (g->type == OSH_SCORING_GEO_PLANE)
+            rc = _plane(g);
+        else
+            rc = _mesh(g);
+        if (rc != OSH_OK)
+            return rc;
+    }
+
+    nphsp = 0;
+    for (i = 0; i < sw->noutputs; i++) {
+        o = &sw->outputs[i];
+        if (o->geo >= sw->ngeos || o->npages == 0 || o->page + o->npages > sw->npages)
+            return OSH_EINVAL;
+        for (k = o->page; k < o->page + o->npages; k++)
+            if (sw->pages[k].output != i || sw->pages[k].geo != o->geo)
+                return OSH_EINVAL;
+        /* a phase-space output is one PHSP page on a plane or zones, a plane has nothing else */
+        type = sw->geos[o->geo].type;
+        if (sw->pages[o->page].quantity == OSH_SCORING_QTY_PHSP) {
+            if (o->npages != 1 || (type != OSH_SCORING_GEO_PLANE && type != OSH_SCORING_GEO_ZONE))
+                return OSH_EINVAL;
+            nphsp++;
+        } else if (type == OSH_SCORING_GEO_PLANE) {
+            return OSH_EINVAL;
+        }
+    }
+
+    _osh_scoring_phsp_free(sw);
+    if (nphsp > 0) {
+        sw->phsp = calloc(nphsp, sizeof(*sw->phsp));
+        if (!sw->phsp)
+            return OSH_ENOMEM;
+    }
+
+    sw->nbins = 0;
+    sw->spectrum = 0;
+    for (i = 0; i < sw->npages; i++) {
+        pg = &sw->pages[i];
+        if (pg->geo >= sw->ngeos || pg->output >= sw->noutputs || (pg->fmask & ~sw->ft.all))
+            return OSH_EINVAL;
+        if (pg->quantity < OSH_SCORING_QTY_ENERGY || pg->quantity > OSH_SCORING_QTY_PHSP)
+            return OSH_EINVAL;
+        if (pg->quantity == OSH_SCORING_QTY_PHSP) {
+            if (sw->outputs[pg->output].page != i)
+                return OSH_EINVAL;
+            /* recorded, not scored into bins */
+            pg->nbins = 0;
+            pg->offset = sw->nbins;
+            sw->phsp[sw->nphsp++].page = i;
+            continue;
+        }
+        pg->nbins = sw->geos[pg->geo].nbins;
+        if (pg->quantity == OSH_SCORING_QTY_LETT || pg->quantity == OSH_SCORING_QTY_LETD)
+            pg->nbins *= 2;
+        if (pg->quantity == OSH_SCORING_QTY_SPECTRUM) {
+            if (!(pg->emin > 0.0 && pg->emax > pg->emin) || pg->ne == 0)
+                return OSH_EINVAL;
+            pg->loge0 = log(pg->emin);
+            pg->inv_dloge = (double) pg->ne / (log(pg->emax) - pg->loge0);
+            pg->nbins *= pg->ne;
+            sw->spectrum = 1;
+        }
+        pg->offset = sw->nbins;
+        sw->nbins += pg->nbins;
+        sw->geos[pg->geo].npages++;
+    }
+
+    for (i = 0; i < sw->ngeos; i++) {
+        g = &sw->geos[i];
+        if (g->npages == 0)
+            continue;
+        g->pages = malloc(g->npages * sizeof(*g->pages));
+        if (!g->pages)
+            return OSH_ENOMEM;
+        g->npages = 0;
+    }
+    for (i = 0; i < sw->npages; i++) {
+        if (sw->pages[i].quantity == OSH_SCORING_QTY_PHSP)
+            continue;
+        g = &sw->geos[sw->pages[i].geo];
+        g->pages[g->npages++] = i;
+    }
+    rc = _zone_table(sw);
+    if (rc != OSH_OK)
+        return rc;
+    rc = _osh_scoring_phsp_init(sw);
+    if (rc != OSH_OK)
+        return rc;
+
+    _osh_scoring_snapshot_free(&sw->snap);
+    _result_free(sw);
+    sw->rc = OSH_OK;
+    sw->nprim = 0;
+    sw->nblk = (sw->nbins + OSH_SCORING_BLOCK - 1) >> OSH_SCORING_BLOCK_SHIFT;
+    sw->sum = calloc(sw->nblk + 1, sizeof(*sw->sum));
+    sw->sum2 = calloc(sw->nblk + 1, sizeof(*sw->sum2));
+    if (!sw->sum || !sw->sum2)
+        return OSH_ENOMEM;
+
+    return OSH_OK;
+}
+
+struct scoring_buffer *osh_scoring_buffer_alloc(struct scoring_workspace const *sw) {
+    struct scoring_buffer *buf;
+    size_t i;
+
+    buf = calloc(1, sizeof(*buf));
+    if (!buf)
+        return NULL;
+    buf->sw = sw;
+    buf->nblk = (sw->nbins + OSH_SCORING_BLOCK - 1) >> OSH_SCORING_BLOCK_SHIFT;
+    buf->blk = calloc(buf->nblk + 1, sizeof(*buf->blk));
+    buf->dirty = calloc(buf->nblk + 1, sizeof(*buf->dirty));
+    buf->touched = malloc((buf->nblk + 1) * sizeof(*buf->touched));
+    buf->ph = calloc(sw->nphsp + 1, sizeof(*buf->ph));
+    if (!buf->blk || !buf->dirty || !buf->touched || !buf->ph) {
+        osh_scoring_buffer_free(buf);
+        return NULL;
+    }
+
+    if (sw->nbins <= OSH_SCORING_DENSE) {
+        buf->slab = calloc(buf->nblk * OSH_SCORING_BLOCK + 1, sizeof(*buf->slab));
+        if (!buf->slab) {
+            osh_scoring_buffer_free(buf);
+            return NULL;
+        }
+        for (i = 0; i < buf->nblk; i++)
+            buf->blk[i] = buf->slab + i * OSH_SCORING_BLOCK;
+        buf->nalloc = buf->nblk;
+    }
+    return buf;
+}
+
+void osh_scoring_buffer_free(struct scoring_buffer *buf) {
+    size_t i;
+
+    if (!buf)
+        return;
+    if (!buf->slab && buf->blk)
+        for (i = 0; i < buf->nblk; i++)
+            free(buf->blk[i]);
+    if (buf->ph)
+        for (i = 0; i < buf->sw->nphsp; i++)
+            free(buf->ph[i].rec);
+    free(buf->slab);
+    free(buf->blk);
+    free(buf->dirty);
+    free(buf->touched);
+    free(buf->ph);
+    free(buf);
+}
+
+int _osh_scoring_touch(struct scoring_buffer *buf, size_t b) {
+    if (!buf->blk[b]) {
+        buf->blk[b] = calloc(OSH_SCORING_BLOCK, sizeof(**buf->blk));
+        if (!buf->blk[b]) {
+            buf->rc = OSH_ENOMEM;
+            return OSH_ENOMEM;
+        }
+        buf->nalloc++;
+    }
+    buf->dirty[b] = 1;
+    buf->touched[buf->ntouched++] = b;
+    return OSH_OK;
+}
+
+void osh_scoring_buffer_clear(struct scoring_buffer *buf) {
+    size_t i, b;
+
+    for (i = 0; i < buf->ntouched; i++) {
+        b = buf->touched[i];
+        memset(buf->blk[b], 0, OSH_SCORING_BLOCK * sizeof(**buf->blk));
+        buf->dirty[b] = 0;
+    }
+    for (i = 0; i < buf->sw->nphsp; i++)
+        buf->ph[i].n = 0;
+    buf->ntouched = 0;
+    buf->hist = 0;
+    buf->rc = OSH_OK;
+}
+
+void osh_scoring_history(void *data) {
+    struct scoring_buffer *buf = data;
+
+    buf->hist++;
+}
+
+void osh_scoring_particle(void *data, struct particle *part) {
+    struct scoring_buffer const *buf = data;
+
+    part->smask = osh_scoring_filter_static(&buf->sw->ft, part);
+    part->sft = &buf->sw->ft;
+}
+
+void osh_scoring_score(void *data, struct particle const *part, struct step const *st) {
+    struct scoring_buffer *buf = data;
+    struct scoring_workspace const *sw = buf->sw;
+    struct scoring_geo const *g;
+    struct scoring_zbin const *e;
+    struct scoring_step s;
+    uint64_t smask;
+    size_t i;
+
+    /* the static predicates were applied when the particle started, unless it bypassed osh_scoring_particle() */
+    smask = (part->sft == &sw->ft) ? part->smask : osh_scoring_filter_static(&sw->ft, part);
+
+    s.st = st;
+    s.mask = osh_scoring_filter_energy(&sw->ft, part, smask, st->p[3]);
+    s.dosefac = (st->rho > 0.0) ? OSH_MEVG2GY / st->rho : 0.0;
+    s.let = (st->ds > 0.0) ? 0.1 * st->de / st->ds : -1.0; /* 1 MeV/cm is 0.1 keV/um */
+    s.loge = sw->spectrum ? log(0.5 * (st->p[3] + st->q[3])) : 0.0;
+
+    for (i = 0; i < sw->ngeos; i++) {
+        g = &sw->geos[i];
+        if (g->npages == 0)
+            continue;
+        switch (g->type) {
+        case OSH_SCORING_GEO_MESH:
+            _osh_scoring_mesh(buf, g, &s);
+            break;
+        case OSH_SCORING_GEO_CYL:
+        case OSH_SCORING_GEO_SPH:
+            _osh_scoring_radial(buf, g, &s);
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (st->zone >= 0 && (size_t) st->zone < sw->nzt)
+        for (i = sw->zstart[st->zone]; i < sw->zstart[st->zone + 1]; i++) {
+            e = &sw->zbins[i];
+            _osh_scoring_add(buf, &sw->geos[e->geo], &s, e->bin, st->ds, st->de, e->inv_vol);
+        }
+
+    if (sw->nphsp > 0)
+        _osh_scoring_phsp(buf, part, &s);
+}
+
+void osh_scoring_merge(struct scoring_workspace *sw, struct scoring_buffer *buf) {
+    struct scoring_bin const *d;
+    double *r, *r2;
+    size_t i, k, b, n;
+
+    for (i = 0; i < buf->ntouched; i++) {
+        b = buf->touched[i];
+        d = buf->blk[b];
+        if (!sw->sum[b]) {
+            sw->sum[b] = calloc(OSH_SCORING_BLOCK, sizeof(**sw->sum));
+            sw->sum2[b] = calloc(OSH_SCORING_BLOCK, sizeof(**sw->sum2));
+            if (!sw->sum[b] || !sw->sum2[b]) {
+                free(sw->sum[b]);
+                free(sw->sum2[b]);
+                sw->sum[b] = sw->sum2[b] = NULL;
+                sw->rc = OSH_ENOMEM;
+                continue;
+            }
+        }
+        r = sw->sum[b];
+        r2 = sw->sum2[b];
+        n = sw->nbins - (b << OSH_SCORING_BLOCK_SHIFT);
+        if (n > OSH_SCORING_BLOCK)
+            n = OSH_SCORING_BLOCK;
+        /* the last history of each bin is finished here */
+        for (k = 0; k < n; k++) {
+            r[k] += d[k].sum + d[k].cur;
+            r2[k] += d[k].sum2 + d[k].cur * d[k].cur;
+        }
+    }
+    if (sw->nphsp > 0)
+        _osh_scoring_phsp_merge(sw, buf);
+    sw->nprim += buf->hist;
+    if (buf->rc != OSH_OK)
+        sw->rc = buf->rc;
+    osh_scoring_buffer_clear(buf);
+}
+
+void _osh_scoring_stderr(double *const *sum, double *const *sum2, uint64_t nprim, size_t first, size_t n, double *err) {
+    double np, m, v;
+    size_t i;
+
+    if (nprim < 2) {
+        memset(err, 0, n * sizeof(*err));
+        return;
+    }
+    np = (double) nprim;
+    for (i = 0; i < n; i++) {
+        m = _osh_scoring_get(sum, first + i) / np;
+        v = (_osh_scoring_get(sum2, first + i) / np - m * m) / (np - 1.0);
+        err[i] = (v > 0.0) ? sqrt(v) : 0.0; /* rounding can leave a tiny negative variance */
+    }
+}
+
+void osh_scoring_stderr(struct scoring_workspace const *sw, size_t page, double *err) {
+    struct scoring_page const *pg = &sw->pages[page];
+
+    _osh_scoring_stderr(sw->sum, sw->sum2, sw->nprim, pg->offset, pg->nbins, err);
+}
+
+static void *_tally_alloc(void *ctx) {
+    return osh_scoring_buffer_alloc(ctx);
+}
+
+static void _tally_merge(void *ctx, void *buf) {
+    osh_scoring_merge(ctx, buf);
+}
+
+static void _tally_free(void *ctx, void *buf) {
+    (void) ctx;
+    osh_scoring_buffer_free(buf);
+}
+
+/* a skipped snapshot is counted in snap.nskip, a failed one is logged and kept in snap.rc */
+static void _tally_save(void *ctx) {
+    struct scoring_workspace *sw = ctx;
+    int rc;
+
+    rc = osh_scoring_snapshot(sw);
+    if (rc != OSH_OK && rc != OSH_ESTATE) {
+        osh_warn("snapshot of %llu primaries not taken: %s\n", (unsigned long long) sw->nprim, osh_strerr(rc));
+        if (sw->snap.rc == OSH_OK)
+            sw->snap.rc = rc;
+    }
+}
+
+void osh_scoring_tally(struct scoring_workspace *sw, struct transport_tally *t) {
+    t->alloc = _tally_alloc;
+    t->score = osh_scoring_score;
+    t->merge = _tally_merge;
+    t->free = _tally_free;
+    t->ctx = sw;
+    t->history = osh_scoring_history;
+    t->save = _tally_save;
+    t->particle = osh_scoring_particle;
+}
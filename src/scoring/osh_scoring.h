@@ -0,0 +1,659 @@
+#ifndef _OSH_SCORING_H
+#define _OSH_SCORING_H
+
+/**
+ * @file osh_scoring.h
+ * @brief Scoring of the steps of a run as defined in detect.dat
+ *
+ * detect.dat holds three kinds of blocks, each running up to the next:
+ *
+ *   Filter                        ! see osh_scoring_filter.h
+ *       Name MyFilter
+ *       Z = 6
+ *
+ *   Geometry Mesh                 ! Cartesian mesh
+ *       Name MyMesh
+ *       X -0.5  0.5    1          ! min. [cm], max. [cm], number of bins
+ *       Y -0.5  0.5    1
+ *       Z  0.0  40.0   10
+ *
+ *   Geometry Cyl                  ! cylinder along z
+ *       Name MyCyl
+ *       R    0.0  5.0  50         ! radius [cm]
+ *       Phi  0.0  360.0 1         ! azimuth [deg], optional, default one bin of 360
+ *       Z    0.0  40.0 400
+ *       Center 0.0 0.0 0.0        ! origin of r, phi and z [cm], optional
+ *
+ *   Geometry Sph                  ! spherical shells
+ *       Name MySph
+ *       R     0.0  5.0  50        ! radius [cm]
+ *       Theta 0.0  180.0 1        ! polar angle to +z [deg], optional
+ *       Phi   0.0  360.0 1        ! azimuth [deg], optional
+ *       Center 0.0 0.0 20.0       ! optional
+ *
+ *   Geometry Zone                 ! zones of geo.dat, one bin each
+ *       Name MyZones
+ *       Zone 2 3 5                ! zone ids, may be repeated to add more
+ *       Volume 10.0 12.5 4.0      ! [cm3], optional, FLUENCE and DOSE per cm3 without
+ *
+ *   Geometry Plane                ! a plane, for phase-space outputs only
+ *       Name MyPlane
+ *       Point  0.0 0.0 20.0       ! a point of the plane [cm], optional, default the origin
+ *       Normal 0.0 0.0 1.0        ! particles crossing along the normal are recorded
+ *
+ *   Output
+ *       Filename NB_msh.bdo
+ *       Geo MyMesh
+ *       Quantity ENERGY           ! one page per quantity,
+ *       Quantity FLUENCE MyFilter ! scoring only particles accepted by all listed filters
+ *       Quantity LETd             ! dose averaged LET, LETt for track averaged
+ *       Quantity SPECTRUM 0.1 250.0 100 MyFilter ! fluence in 100 log energy bins from 0.1 to 250 MeV
+ *
+ *   Output
+ *       Filename beamline.phsp
+ *       Geo MyPlane               ! a Plane, or Zone for particles leaving the zones
+ *       Quantity PHSP MyFilter    ! phase-space file (io/osh_phsp.h), the only page of its output
+ *
+ * Filters and geometries must be defined before the outputs using them.
+ *
+ * Everything is compiled when the file is loaded: filters into the bitmask
+ * tables of struct scoring_filter_table, each page into the filter mask it
+ * requires, and the pages of all outputs are laid out in one array of bins.
+ * Each geometry knows the pages scored on it. Scoring a step computes the
+ * filter mask of the particle once, traverses each geometry once, and adds
+ * to every page of the geometry whose filters are all in the mask: a few
+ * compares and loads per page, no name or list lookups.
+ *
+ * A step is cut into its parts in every bin it crosses. Fluence is the
+ * track length in a bin per bin volume; the energy lost in the step is
+ * shared out in proportion to track length, so energy and dose are exact
+ * for a constant stopping power along the step. Steps of zero length, the
+ * residual energy of a stopping particle, deposit at their start point.
+ *
+ * Meshes are traversed by a 3D digital differential analyser: the step is
+ * clipped to the mesh, and then walks from bin to bin crossing the nearest
+ * of the three next bin planes, one compare and one add per crossing. A
+ * step with both ends in the same bin, the common case, is scored without
+ * any division.
+ *
+ * Cylinders and spheres are cut at their boundaries too, but the crossings
+ * are solved analytically: along a straight step the squared distance to
+ * the axis or center is a quadratic in the step parameter, the polar angle
+ * boundaries are cones, also quadratics, and the azimuth boundaries are
+ * half planes. Only boundaries within the range an axis sweeps along the
+ * step are tried, the crossings are sorted, and each part between two of
+ * them is scored in the bin of its midpoint.
+ *
+ * LET pages hold two bins per geometry bin, the numerator of the average,
+ * the LET weighted by track length or energy loss, in the first half and
+ * its weight in the second; the written LET is their ratio. The LET of a
+ * step is its energy loss per track length; steps of zero length, such as
+ * the residual energy of a stopping particle, are left out. Spectrum pages hold the
+ * energy bins of each geometry bin together, bin i * ne + j, and the
+ * energy bin of a step, at its mean energy, is one subtraction and one
+ * multiplication from its log(E), taken once per step. Buffers and the
+ * merged result only allocate the blocks of bins which are scored, so a
+ * fine mesh times many energy bins costs memory where particles went.
+ *
+ * Zones are not traversed, the transport already knows the zone of a step.
+ * Compiling builds a table indexed by zone id listing every zone geometry
+ * and bin the zone scores into, so a step in a zone looks up its entries
+ * directly and a zone scored by no geometry costs one compare.
+ *
+ * Phase-space outputs have no bins. A step crossing a plane along its
+ * normal, or ending on the boundary of a listed zone, appends a record of
+ * the particle at the crossing to the buffer. Merging only moves the
+ * records of a buffer to a queue; a writer thread, started when records
+ * are waiting, appends them to the files in queue order, so the merge lock
+ * is never held for disk I/O. Buffers are merged in chunk order, so the
+ * file does not depend on the number of threads. Zone exits are checked
+ * against a bitmap of the zones of the output, indexed by zone id. The
+ * file is completed by osh_scoring_write().
+ *
+ * Every bin also carries the statistical uncertainty of its score, by the
+ * history-by-history method: the score of each primary history, with all
+ * its secondaries, is one sample, and the bin sums both the samples and
+ * their squares. A bin remembers the last history which scored into it and
+ * that history's score. Only when a different history first scores into
+ * the bin is the finished sample squared and added, so the cost per
+ * primary is set by the bins it touches, never by the size of the mesh.
+ * With N primaries the standard error of the mean score per primary is
+ *
+ *   sqrt((sum2 / N - (sum / N)^2) / (N - 1))
+ *
+ * Each output is written as a .bdo file (io/osh_bdo.h): the geometry, then
+ * per page the mean score per primary and its standard error, computed
+ * chunk by chunk on the way to the file. During a run the result can be
+ * saved every beam_workspace::nsave primaries: the sums are copied while
+ * the workers wait for the merge lock, and written by a background thread
+ * while transport goes on.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common/osh_thread.h"
+#include "io/osh_phsp.h"
+#include "scoring/osh_scoring_filter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* geometry types */
+#define OSH_SCORING_GEO_MESH 1  /* Cartesian mesh */
+#define OSH_SCORING_GEO_CYL 2   /* cylindrical mesh */
+#define OSH_SCORING_GEO_SPH 3   /* spherical mesh */
+#define OSH_SCORING_GEO_ZONE 4  /* gemca zones */
+#define OSH_SCORING_GEO_PLANE 5 /* a plane, phase space only */
+
+/* buffers */
+#define OSH_SCORING_BLOCK_SHIFT 9                                 /* log2 of the bins of a buffer block */
+#define OSH_SCORING_BLOCK ((size_t) 1 << OSH_SCORING_BLOCK_SHIFT) /* bins of a buffer block */
+#define OSH_SCORING_DENSE ((size_t) 1 << 14)                      /* buffers up to this many bins are dense */
+
+/* scored quantities */
+#define OSH_SCORING_QTY_ENERGY 1   /* deposited energy [MeV] */
+#define OSH_SCORING_QTY_FLUENCE 2  /* track length fluence [1/cm2] */
+#define OSH_SCORING_QTY_DOSE 3     /* dose [Gy] */
+#define OSH_SCORING_QTY_LETT 4     /* track averaged LET [keV/um] */
+#define OSH_SCORING_QTY_LETD 5     /* dose averaged LET [keV/um] */
+#define OSH_SCORING_QTY_SPECTRUM 6 /* track length fluence in log energy bins [1/cm2] */
+#define OSH_SCORING_QTY_PHSP 7     /* phase space of the crossing particles, no bins */
+
+/* forward declarations */
+struct particle;
+struct step;
+struct transport_tally;
+
+/**
+ * @struct scoring_mesh
+ *
+ * @brief Mesh with three axes, bin (i, j, k) is number i + n[0] * (j + n[1] * k).
+ *
+ * The axes are x, y, z for a Cartesian mesh, r, phi, z for a cylinder
+ * and r, theta, phi for a sphere. Angles are in radians.
+ */
+struct scoring_mesh {
+    double x0[3];    /* lower edges [cm or rad] */
+    double x1[3];    /* upper edges [cm or rad] */
+    double inv_d[3]; /* 1 / bin width [1/cm or 1/rad] */
+    size_t n[3];     /* bins along each axis */
+    double c[3];     /* cylinder and sphere: center [cm] */
+    double vol;      /* Cartesian: volume of a bin [cm3] */
+    double inv_vol;  /* Cartesian: 1 / vol [1/cm3] */
+    double *ivol;    /* cylinder: 1 / volume by r bin, sphere: by r and theta bin, i + n[0] * j [1/cm3] */
+};
+
+/**
+ * @struct scoring_zone
+ *
+ * @brief Zones of the transport geometry, bin i is zone ids[i].
+ *
+ * Zone volumes are not known to scoring, FLUENCE and DOSE are per volume
+ * given in detect.dat, or per cm3 without one.
+ */
+struct scoring_zone {
+    size_t *ids;     /* zone ids, from 1 */
+    double *inv_vol; /* 1 / volume of each zone [1/cm3], NULL for 1 */
+    size_t n;        /* number of zones */
+};
+
+/**
+ * @struct scoring_plane
+ *
+ * @brief A plane, the points x with n . x = d.
+ */
+struct scoring_plane {
+    double c[3]; /* a point of the plane [cm] */
+    double n[3]; /* unit normal, particles crossing along it are recorded */
+    double d;    /* n . c [cm] */
+};
+
+/**
+ * @struct scoring_zbin
+ *
+ * @brief Where a step in a zone scores, an entry of the zone table.
+ */
+struct scoring_zbin {
+    size_t geo;     /* index of the geometry */
+    size_t bin;     /* bin within the geometry */
+    double inv_vol; /* 1 / volume of the zone [1/cm3] */
+};
+
+/**
+ * @struct scoring_geo
+ *
+ * @brief A scoring geometry.
+ */
+struct scoring_geo {
+    char name[OSH_SCORING_NAMELEN]; /* name, unique within detect.dat */
+    int type;                       /* OSH_SCORING_GEO_* */
+    size_t nbins;                   /* number of bins */
+    struct scoring_mesh mesh;       /* OSH_SCORING_GEO_MESH, _CYL and _SPH */
+    struct scoring_zone zone;       /* OSH_SCORING_GEO_ZONE */
+    struct scoring_plane plane;     /* OSH_SCORING_GEO_PLANE */
+    size_t *pages;                  /* pages scored on this geometry, without PHSP pages */
+    size_t npages;                  /* number of pages */
+};
+
+/**
+ * @struct scoring_page
+ *
+ * @brief One scored quantity of an output.
+ */
+struct scoring_page {
+    int quantity;     /* OSH_SCORING_QTY_* */
+    size_t geo;       /* index of the geometry */
+    size_t output;    /* index of the output */
+    uint64_t fmask;   /* filters which must all accept a particle, 0 for all particles */
+    double emin;      /* spectrum: lower edge of the energy axis [MeV] */
+    double emax;      /* spectrum: upper edge of the energy axis [MeV] */
+    size_t ne;        /* spectrum: number of energy bins */
+    double loge0;     /* spectrum: log(emin) */
+    double inv_dloge; /* spectrum: 1 / width of an energy bin in log(E) */
+    size_t nbins;     /* number of bins */
+    size_t offset;    /* first bin of the page in a buffer */
+};
+
+/**
+ * @struct scoring_output
+ *
+ * @brief One output file, a geometry with one or more pages.
+ */
+struct scoring_output {
+    char *filename; /* file to write */
+    size_t geo;     /* index of the geometry */
+    size_t page;    /* index of the first page, pages of an output are consecutive */
+    size_t npages;  /* number of pages */
+};
+
+/**
+ * @struct scoring_phsp
+ *
+ * @brief A phase-space output and its file.
+ */
+struct scoring_phsp {
+    size_t page;              /* the PHSP page */
+    struct osh_phsp_writer w; /* file being written, w.fp NULL until the first records are written */
+    uint64_t *zbits;          /* zones recorded, bit z % 64 of word z / 64, NULL for a plane */
+    size_t nzt;               /* zone ids below nzt have a bit */
+};
+
+/**
+ * @struct scoring_phsp_item
+ *
+ * @brief Records of a phase-space output from one merged buffer.
+ */
+struct scoring_phsp_item {
+    size_t k;                    /* index of the phase-space output */
+    struct osh_phsp_record *rec; /* records, released once written */
+    size_t n;                    /* number of records */
+};
+
+/**
+ * @struct scoring_phsp_queue
+ *
+ * @brief Records handed from merging to the writer thread.
+ */
+struct scoring_phsp_queue {
+    struct osh_thread_mutex lock;   /* guards all but th */
+    struct scoring_phsp_item *item; /* waiting to be written, in merge order */
+    size_t n;                       /* number of items */
+    size_t cap;                     /* allocated items */
+    struct osh_thread th;           /* writer, started by merging */
+    int busy;                       /* the writer runs and will take new items */
+    int rc;                         /* first error of queueing, opening or writing */
+};
+
+/**
+ * @struct scoring_phsp_buf
+ *
+ * @brief Records of a phase-space output collected by a buffer.
+ */
+struct scoring_phsp_buf {
+    struct osh_phsp_record *rec; /* records since the last merge */
+    size_t n;                    /* number of records */
+    size_t cap;                  /* allocated records */
+};
+
+/**
+ * @struct scoring_snapshot
+ *
+ * @brief A copy of the result written by a background thread.
+ */
+struct scoring_snapshot {
+    struct scoring_workspace const *sw; /* layout */
+    double **sum;                       /* copy of the blocks of sw->sum */
+    double **sum2;                      /* copy of the blocks of sw->sum2 */
+    size_t nblk;                        /* number of blocks */
+    uint64_t nprim;                     /* copy of sw->nprim */
+    struct osh_thread th;               /* writer */
+    int64_t volatile busy;              /* the copy is being written */
+    int rc;                             /* first error of a snapshot, OSH_OK if none */
+    size_t nskip;                       /* snapshots skipped while the previous one was written */
+};
+
+/**
+ * @struct scoring_workspace
+ *
+ * @brief All scorers of a run and their merged result.
+ */
+struct scoring_workspace {
+    struct scoring_filter *filters; /* filters, in the order of definition */
+    size_t nfilters;
+    struct scoring_filter_table ft; /* compiled filters */
+    struct scoring_geo *geos;       /* geometries */
+    size_t ngeos;
+    struct scoring_page *pages; /* pages of all outputs */
+    size_t npages;
+    struct scoring_output *outputs; /* outputs */
+    size_t noutputs;
+    struct scoring_zbin *zbins; /* zone table, the bins of zone z are zbins[zstart[z] .. zstart[z + 1] - 1] */
+    size_t *zstart;             /* nzt + 1 entries */
+    size_t nzt;                 /* zones in the table, 1 + the largest zone id scored */
+    struct scoring_phsp *phsp;  /* phase-space outputs */
+    size_t nphsp;
+    struct scoring_phsp_queue *phq; /* records waiting for the writer, NULL without phase-space outputs */
+    size_t nbins;   /* bins of all pages */
+    double **sum;   /* merged result, in blocks of OSH_SCORING_BLOCK bins, NULL for blocks never scored */
+    double **sum2;  /* merged sums of squared per history scores, in the same blocks */
+    size_t nblk;    /* number of blocks */
+    int spectrum;   /* some page is a spectrum */
+    uint64_t nprim; /* number of primary histories merged */
+    int rc;         /* OSH_ENOMEM if a buffer lost scores, else OSH_OK */
+    int codec;      /* OSH_BDO_CODEC_* of the written files */
+    char *filename; /* path to detect.dat, NULL if not loaded from a file */
+    struct scoring_snapshot snap; /* background saving */
+};
+
+/**
+ * @struct scoring_bin
+ *
+ * @brief A bin of a buffer, all a step touches in one cache line.
+ */
+struct scoring_bin {
+    double cur;    /* score of history last */
+    uint64_t last; /* last history of the buffer which scored here */
+    double sum;    /* scores of the histories before last */
+    double sum2;   /* squared scores of the histories before last */
+};
+
+/**
+ * @struct scoring_buffer
+ *
+ * @brief Scores of one thread or chunk of primaries.
+ *
+ * The bins of all pages are cut into blocks of OSH_SCORING_BLOCK. Small
+ * layouts, up to OSH_SCORING_DENSE bins, get all blocks in one allocation
+ * up front. For larger ones a block is only allocated when a step first
+ * scores into it, so a pencil beam in a large dose grid costs memory for
+ * the bins it reaches, not for the grid. Blocks touched since the last
+ * merge are listed, merging and clearing walk only those.
+ *
+ * Histories are numbered from 1 within a buffer by osh_scoring_history().
+ * Steps scored without a history being started count as history 0.
+ */
+struct scoring_buffer {
+    struct scoring_workspace const *sw; /* layout of the scores */
+    struct scoring_bin **blk;           /* block i holds bins i * OSH_SCORING_BLOCK .., NULL if not allocated */
+    unsigned char *dirty;               /* block touched since the last merge */
+    size_t *touched;                    /* indices of the touched blocks */
+    size_t ntouched;                    /* number of touched blocks */
+    size_t nblk;                        /* number of blocks */
+    size_t nalloc;                      /* number of allocated blocks */
+    struct scoring_bin *slab;           /* all blocks of a dense buffer, else NULL */
+    uint64_t hist;                      /* number of histories started since the last merge */
+    struct scoring_phsp_buf *ph;        /* records of each phase-space output */
+    int rc;                             /* OSH_ENOMEM if a block could not be allocated and scores were lost */
+};
+
+/**
+ * @brief Load and compile a detect.dat file.
+ *
+ * Problems are logged with file name and line number.
+ *
+ * @param[in] filename Path to detect.dat.
+ * @param[out] sw Workspace to initialise, release with osh_scoring_free().
+ *
+ * @returns OSH_OK, OSH_EPARSE for a malformed or inconsistent file, or OSH_ENOMEM.
+ */
+int osh_scoring_load(const char *filename, struct scoring_workspace *sw);
+
+/**
+ * @brief Compile filters, geometries and pages filled in by the caller.
+ *
+ * filters, geos with their type, name and defining parameters, pages with
+ * quantity, geo, output and fmask, and outputs must be set. Derived fields
+ * and the result are set up here.
+ *
+ * @param[in,out] sw Workspace.
+ *
+ * @returns OSH_OK, OSH_EINVAL for an inconsistent definition, or OSH_ENOMEM.
+ */
+int osh_scoring_compile(struct scoring_workspace *sw);
+
+/**
+ * @brief Free a workspace.
+ *
+ * @param[in] sw Workspace.
+ */
+void osh_scoring_free(struct scoring_workspace *sw);
+
+/**
+ * @brief Find a filter by name.
+ *
+ * @param[in] sw Workspace.
+ * @param[in] name Name, case insensitive.
+ *
+ * @returns Index of the filter, or -1.
+ */
+int osh_scoring_filter_find(struct scoring_workspace const *sw, const char *name);
+
+/**
+ * @brief Find a geometry by name.
+ *
+ * @param[in] sw Workspace.
+ * @param[in] name Name, case insensitive.
+ *
+ * @returns Index of the geometry, or -1.
+ */
+int osh_scoring_geo_find(struct scoring_workspace const *sw, const char *name);
+
+/**
+ * @brief Allocate an empty buffer.
+ *
+ * @param[in] sw Compiled workspace.
+ *
+ * @returns Buffer, NULL if out of memory.
+ */
+struct scoring_buffer *osh_scoring_buffer_alloc(struct scoring_workspace const *sw);
+
+/**
+ * @brief Free a buffer.
+ *
+ * @param[in] buf Buffer, may be NULL.
+ */
+void osh_scoring_buffer_free(struct scoring_buffer *buf);
+
+/**
+ * @brief Zero a buffer, keeping its blocks allocated.
+ *
+ * @param[in,out] buf Buffer.
+ */
+void osh_scoring_buffer_clear(struct scoring_buffer *buf);
+
+/**
+ * @brief Score of a bin in a buffer.
+ *
+ * @param[in] buf Buffer.
+ * @param[in] bin Bin, page offset plus bin of the page.
+ *
+ * @returns Score, 0 for bins of blocks not allocated.
+ */
+static inline double osh_scoring_buffer_value(struct scoring_buffer const *buf, size_t bin) {
+    struct scoring_bin const *b = buf->blk[bin >> OSH_SCORING_BLOCK_SHIFT];
+
+    if (!b)
+        return 0.0;
+    b += bin & (OSH_SCORING_BLOCK - 1);
+    return b->sum + b->cur;
+}
+
+/**
+ * @brief Merged sum of the scores of all histories in a bin.
+ *
+ * @param[in] sw Workspace.
+ * @param[in] bin Bin, page offset plus bin of the page.
+ *
+ * @returns Sum, 0 for bins never scored.
+ */
+static inline double osh_scoring_sum(struct scoring_workspace const *sw, size_t bin) {
+    double const *b = sw->sum[bin >> OSH_SCORING_BLOCK_SHIFT];
+
+    return b ? b[bin & (OSH_SCORING_BLOCK - 1)] : 0.0;
+}
+
+/**
+ * @brief Merged sum of the squared scores per history in a bin.
+ *
+ * @param[in] sw Workspace.
+ * @param[in] bin Bin, page offset plus bin of the page.
+ *
+ * @returns Sum, 0 for bins never scored.
+ */
+static inline double osh_scoring_sum2(struct scoring_workspace const *sw, size_t bin) {
+    double const *b = sw->sum2[bin >> OSH_SCORING_BLOCK_SHIFT];
+
+    return b ? b[bin & (OSH_SCORING_BLOCK - 1)] : 0.0;
+}
+
+/**
+ * @brief Start the next primary history in a buffer, history hook of the transport.
+ *
+ * @param[in] buf struct scoring_buffer.
+ */
+void osh_scoring_history(void *buf);
+
+/**
+ * @brief Cache the static filter mask of a particle, particle hook of the transport.
+ *
+ * Z, A, GEN and ID predicates are evaluated once here, so a step only
+ * checks the energy predicates. Particles not passed through this hook are
+ * filtered in full at every step.
+ *
+ * @param[in] buf struct scoring_buffer.
+ * @param[in,out] part Particle starting its transport.
+ */
+void osh_scoring_particle(void *buf, struct particle *part);
+
+/**
+ * @brief Score a step, scorer hook of the transport.
+ *
+ * @param[in] buf struct scoring_buffer.
+ * @param[in] part Particle.
+ * @param[in] st Step.
+ */
+void osh_scoring_score(void *buf, struct particle const *part, struct step const *st);
+
+/**
+ * @brief Add a buffer to the result and zero it.
+ *
+ * Only the blocks touched since the last merge are visited, and the result
+ * gets a block when a buffer first brings one. The histories of the buffer
+ * are finished and counted in sw->nprim. A lost score of the buffer, or a
+ * result block which could not be allocated, is recorded in sw->rc.
+ * Phase-space records are queued for the writer thread, which is started
+ * if it does not run; errors of the files are returned by
+ * osh_scoring_write().
+ *
+ * @param[in,out] sw Workspace.
+ * @param[in,out] buf Buffer of sw.
+ */
+void osh_scoring_merge(struct scoring_workspace *sw, struct scoring_buffer *buf);
+
+/**
+ * @brief Standard error of the mean score per primary of the bins of a page.
+ *
+ * @param[in] sw Workspace with merged results.
+ * @param[in] page Index of the page.
+ * @param[out] err Standard errors, one per bin of the page, 0 for fewer than two primaries.
+ *                 For LET pages these are of the numerators and denominators.
+ */
+void osh_scoring_stderr(struct scoring_workspace const *sw, size_t page, double *err);
+
+/**
+ * @brief Write all outputs with the merged result.
+ *
+ * Waits for a background snapshot to finish first, so the files are left
+ * with the final result, and logs snapshots which failed or were skipped.
+ * Phase-space files are completed with the number of primaries and closed.
+ *
+ * @param[in] sw Workspace.
+ *
+ * @returns OSH_OK, or the first error of osh_bdo_open(), osh_phsp_open() and the writing.
+ */
+int osh_scoring_write(struct scoring_workspace *sw);
+
+/**
+ * @brief Write the merged sums as a partial result, for a job of a distributed run.
+ *
+ * Instead of the outputs, a job writes one block per page, in page order
+ * and without phase-space pages, with the sums and sums of squares of all
+ * bins (io/osh_partial.h). The partial results of all jobs are added by
+ * osh-merge. Like osh_scoring_write(), this waits for a background
+ * snapshot and completes the phase-space files.
+ *
+ * @param[in] sw Workspace.
+ * @param[in] path File name.
+ *
+ * @returns OSH_OK, or the first error of osh_partial_open(), osh_phsp_open() and the writing.
+ */
+int osh_scoring_write_partial(struct scoring_workspace *sw, const char *path);
+
+/**
+ * @brief Replace the merged result by a partial result.
+ *
+ * Used to write the outputs of a distributed run with osh_scoring_write()
+ * once the partial results of its jobs are merged. The workspace must be
+ * loaded from the detect.dat the jobs ran with. The file is read into
+ * memory as a whole; blocks of bins which are all zero are not allocated.
+ * Phase-space outputs are dropped, their files are written by the jobs.
+ *
+ * @param[in,out] sw Compiled workspace.
+ * @param[in] path File name.
+ *
+ * @returns OSH_OK, OSH_EINVAL if the blocks do not match the pages of sw,
+ *          any error of osh_partial_read(), or OSH_ENOMEM.
+ */
+int osh_scoring_read_partial(struct scoring_workspace *sw, const char *path);
+
+/**
+ * @brief Copy the merged result and write it in a background thread.
+ *
+ * Must not run concurrently with merging, e.g. call it from the save hook
+ * of a run. A snapshot is skipped rather than waited for while the
+ * previous one is still being written. Phase-space outputs are left to
+ * osh_scoring_write().
+ *
+ * @param[in] sw Workspace.
+ *
+ * @returns OSH_OK, OSH_ESTATE if skipped, or OSH_ENOMEM.
+ */
+int osh_scoring_snapshot(struct scoring_workspace *sw);
+
+/**
+ * @brief Set up a tally of a multithreaded run scoring into sw.
+ *
+ * The save hook of the tally writes snapshots with osh_scoring_snapshot().
+ *
+ * @param[in] sw Compiled workspace, the result is merged into sw->sum.
+ * @param[out] t Tally.
+ */
+void osh_scoring_tally(struct scoring_workspace *sw, struct transport_tally *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OSH_SCORING_H */
@@ -0,0 +1,149 @@
+#include "scoring/osh_scoring_filter.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "common/osh_rc.h"
+
+/* does value x satisfy x op c */
+static int _test(int op, double x, double c) {
+    switch (op) {
+    case OSH_SCORING_OP_EQ:
+        return x == c;
+    case OSH_SCORING_OP_NE:
+        return x != c;
+    case OSH_SCORING_OP_LT:
+        return x < c;
+    case OSH_SCORING_OP_LE:
+        return x <= c;
+    case OSH_SCORING_OP_GT:
+        return x > c;
+    case OSH_SCORING_OP_GE:
+        return x >= c;
+    default:
+        return 0;
+    }
+}
+
+int osh_scoring_pred_valid(struct scoring_pred const *p) {
+    double lo, hi;
+
+    if (p->op < OSH_SCORING_OP_EQ || p->op > OSH_SCORING_OP_GE || !isfinite(p->value))
+        return 0;
+
+    switch (p->var) {
+    case OSH_SCORING_VAR_Z:
+        lo = OSH_SCORING_ZMIN + 1;
+        hi = OSH_SCORING_ZMAX - 1;
+        break;
+    case OSH_SCORING_VAR_A:
+        lo = 0;
+        hi = OSH_SCORING_AMAX - 1;
+        break;
+    case OSH_SCORING_VAR_GEN:
+        lo = 0;
+        hi = OSH_SCORING_GENMAX - 1;
+        break;
+    case OSH_SCORING_VAR_ID:
+        lo = 0;
+        hi = OSH_SCORING_IDMAX - 1;
+        break;
+    case OSH_SCORING_VAR_E:
+    case OSH_SCORING_VAR_ENUC:
+        return p->op != OSH_SCORING_OP_NE; /* not an interval */
+    default:
+        return 0;
+    }
+
+    /* interior of the table, so clamped values compare like the true ones */
+    return p->value == floor(p->value) && p->value >= lo && p->value <= hi;
+}
+
+/* intersect [*lo, *hi] with the values x satisfying x op c */
+static void _interval(int op, double c, double *lo, double *hi) {
+    double l = -HUGE_VAL;
+    double h = HUGE_VAL;
+
+    switch (op) {
+    case OSH_SCORING_OP_EQ:
+        l = c;
+        h = c;
+        break;
+    case OSH_SCORING_OP_LT:
+        h = nextafter(c, -HUGE_VAL);
+        break;
+    case OSH_SCORING_OP_LE:
+        h = c;
+        break;
+    case OSH_SCORING_OP_GT:
+        l = nextafter(c, HUGE_VAL);
+        break;
+    case OSH_SCORING_OP_GE:
+        l = c;
+        break;
+    default:
+        break;
+    }
+    if (l > *lo)
+        *lo = l;
+    if (h < *hi)
+        *hi = h;
+}
+
+/* set bit of filter f in the entries of table t whose value, offset + i, satisfies all predicates on var */
+static void _table(uint64_t *t, size_t n, int offset, int var, struct scoring_filter const *f, uint64_t bit) {
+    size_t i, k;
+    int ok;
+
+    for (i = 0; i < n; i++) {
+        ok = 1;
+        for (k = 0; k < f->npred && ok; k++)
+            if (f->pred[k].var == var)
+                ok = _test(f->pred[k].op, (double) offset + (double) i, f->pred[k].value);
+        if (ok)
+            t[i] |= bit;
+    }
+}
+
+int osh_scoring_filter_compile(struct scoring_filter_table *ft, struct scoring_filter const *f, size_t n) {
+    struct scoring_pred const *p;
+    uint64_t bit;
+    size_t i, k;
+
+    if (n > OSH_SCORING_MAXFILTER)
+        return OSH_EINVAL;
+
+    memset(ft, 0, sizeof(*ft));
+    ft->nfilters = n;
+    for (i = 0; i < n; i++) {
+        if (f[i].npred > OSH_SCORING_MAXPRED)
+            return OSH_EINVAL;
+
+        bit = (uint64_t) 1 << i;
+        ft->all |= bit;
+        ft->elo[i] = -HUGE_VAL;
+        ft->ehi[i] = HUGE_VAL;
+        ft->nlo[i] = -HUGE_VAL;
+        ft->nhi[i] = HUGE_VAL;
+
+        for (k = 0; k < f[i].npred; k++) {
+            p = &f[i].pred[k];
+            if (!osh_scoring_pred_valid(p))
+                return OSH_EINVAL;
+            if (p->var == OSH_SCORING_VAR_E) {
+                _interval(p->op, p->value, &ft->elo[i], &ft->ehi[i]);
+                ft->dyn |= bit;
+            } else if (p->var == OSH_SCORING_VAR_ENUC) {
+                _interval(p->op, p->value, &ft->nlo[i], &ft->nhi[i]);
+                ft->dyn |= bit;
+            }
+        }
+
+        _table(ft->z, OSH_SCORING_ZMAX - OSH_SCORING_ZMIN + 1, OSH_SCORING_ZMIN, OSH_SCORING_VAR_Z, &f[i], bit);
+        _table(ft->a, OSH_SCORING_AMAX + 1, 0, OSH_SCORING_VAR_A, &f[i], bit);
+        _table(ft->gen, OSH_SCORING_GENMAX + 1, 0, OSH_SCORING_VAR_GEN, &f[i], bit);
+        _table(ft->id, OSH_SCORING_IDMAX + 1, 0, OSH_SCORING_VAR_ID, &f[i], bit);
+    }
+
+    return OSH_OK;
+}
@@ -0,0 +1,221 @@
+#ifndef _OSH_SCORING_FILTER_H
+#define _OSH_SCORING_FILTER_H
+
+/**
+ * @file osh_scoring_filter.h
+ * @brief Particle filters of detect.dat, compiled into bitmasks
+ *
+ * A filter is a conjunction of predicates on a particle:
+ *
+ *   Filter
+ *       Name MyFilter
+ *       Z = 6          ! charge
+ *       A = 12         ! nucleon number
+ *       GEN = 0        ! generation, 0 for primaries
+ *       ID = 1         ! particle id, OSH_PART_*
+ *       E > 0.1        ! kinetic energy [MeV]
+ *       ENUC < 200     ! kinetic energy per nucleon [MeV/nucleon]
+ *
+ * with the operators =, !=, <, <=, > and >=. Up to OSH_SCORING_MAXFILTER
+ * filters are held in a table, filter i owning bit i of a uint64_t mask.
+ *
+ * Z, A, GEN and ID do not change along a track. For each of them the table
+ * holds, per possible value, the mask of the filters whose predicates on
+ * that variable accept it, so the static part of all filters is four loads
+ * and three ANDs. Values beyond the tabulated ranges are clamped; the
+ * constants of predicates are restricted to the interior of the ranges,
+ * which keeps the clamping exact. The energy predicates of a filter are
+ * intersected into one closed interval for E and one for ENUC, checked
+ * only for the filters which have them and passed the static part.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "particle/osh_particle.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OSH_SCORING_MAXFILTER 64 /* bits of a filter mask */
+#define OSH_SCORING_MAXPRED 8    /* max. predicates of a filter */
+#define OSH_SCORING_NAMELEN 32   /* bytes of a name, including the terminating NUL */
+
+/* variables of predicates */
+#define OSH_SCORING_VAR_Z 0    /* charge */
+#define OSH_SCORING_VAR_A 1    /* nucleon number */
+#define OSH_SCORING_VAR_GEN 2  /* generation */
+#define OSH_SCORING_VAR_ID 3   /* particle id */
+#define OSH_SCORING_VAR_E 4    /* kinetic energy [MeV] */
+#define OSH_SCORING_VAR_ENUC 5 /* kinetic energy per nucleon [MeV/nucleon] */
+
+/* comparison operators */
+#define OSH_SCORING_OP_EQ 0
+#define OSH_SCORING_OP_NE 1
+#define OSH_SCORING_OP_LT 2
+#define OSH_SCORING_OP_LE 3
+#define OSH_SCORING_OP_GT 4
+#define OSH_SCORING_OP_GE 5
+
+/* tabulated ranges of the static variables */
+#define OSH_SCORING_ZMIN -2
+#define OSH_SCORING_ZMAX 127
+#define OSH_SCORING_AMAX 511
+#define OSH_SCORING_GENMAX 255
+#define OSH_SCORING_IDMAX 63
+
+/**
+ * @struct scoring_pred
+ *
+ * @brief One predicate, variable op value.
+ */
+struct scoring_pred {
+    int var;      /* OSH_SCORING_VAR_* */
+    int op;       /* OSH_SCORING_OP_* */
+    double value; /* constant, integral for Z, A, GEN and ID */
+};
+
+/**
+ * @struct scoring_filter
+ *
+ * @brief A filter as defined in detect.dat.
+ */
+struct scoring_filter {
+    char name[OSH_SCORING_NAMELEN];               /* name, unique within detect.dat */
+    struct scoring_pred pred[OSH_SCORING_MAXPRED]; /* predicates, all must hold */
+    size_t npred;                                  /* number of predicates */
+};
+
+/**
+ * @struct scoring_filter_table
+ *
+ * @brief Compiled filters.
+ */
+struct scoring_filter_table {
+    uint64_t z[OSH_SCORING_ZMAX - OSH_SCORING_ZMIN + 1]; /* filters accepting charge OSH_SCORING_ZMIN + i */
+    uint64_t a[OSH_SCORING_AMAX + 1];                    /* filters accepting nucleon number i */
+    uint64_t gen[OSH_SCORING_GENMAX + 1];                /* filters accepting generation i */
+    uint64_t id[OSH_SCORING_IDMAX + 1];                  /* filters accepting particle id i */
+    uint64_t all;                                        /* bits of all filters */
+    uint64_t dyn;                                        /* filters with energy predicates */
+    double elo[OSH_SCORING_MAXFILTER];                   /* accepted kinetic energies [MeV] */
+    double ehi[OSH_SCORING_MAXFILTER];
+    double nlo[OSH_SCORING_MAXFILTER]; /* accepted kinetic energies per nucleon [MeV/nucleon] */
+    double nhi[OSH_SCORING_MAXFILTER];
+    size_t nfilters; /* number of filters */
+};
+
+/**
+ * @brief Compile filters into a table.
+ *
+ * @param[out] ft Table, filter i of f is bit i.
+ * @param[in] f Filters.
+ * @param[in] n Number of filters, at most OSH_SCORING_MAXFILTER.
+ *
+ * @returns OSH_OK, or OSH_EINVAL for too many filters or an invalid predicate.
+ */
+int osh_scoring_filter_compile(struct scoring_filter_table *ft, struct scoring_filter const *f, size_t n);
+
+/**
+ * @brief Check a predicate for a valid variable, operator and value.
+ *
+ * @param[in] p Predicate.
+ *
+ * @returns 1 if valid, else 0.
+ */
+int osh_scoring_pred_valid(struct scoring_pred const *p);
+
+/* index of the lowest set bit of m != 0 */
+static inline int osh_scoring_ctz64(uint64_t m) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(m);
+#else
+    int i = 0;
+
+    while (!(m & 1u)) {
+        m >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+/**
+ * @brief Mask of the filters whose static predicates accept a particle.
+ *
+ * @param[in] ft Filter table.
+ * @param[in] part Particle.
+ *
+ * @returns Filter mask.
+ */
+static inline uint64_t osh_scoring_filter_static(struct scoring_filter_table const *ft, struct particle const *part) {
+    int z = part->z;
+    unsigned int a = part->a;
+    unsigned int gen = part->gen;
+    int id = part->id;
+
+    if (z < OSH_SCORING_ZMIN)
+        z = OSH_SCORING_ZMIN;
+    if (z > OSH_SCORING_ZMAX)
+        z = OSH_SCORING_ZMAX;
+    if (a > OSH_SCORING_AMAX)
+        a = OSH_SCORING_AMAX;
+    if (gen > OSH_SCORING_GENMAX)
+        gen = OSH_SCORING_GENMAX;
+    if (id < 0 || id > OSH_SCORING_IDMAX)
+        id = OSH_SCORING_IDMAX;
+
+    return ft->z[z - OSH_SCORING_ZMIN] & ft->a[a] & ft->gen[gen] & ft->id[id];
+}
+
+/**
+ * @brief Apply the energy predicates to a static filter mask.
+ *
+ * @param[in] ft Filter table.
+ * @param[in] part Particle.
+ * @param[in] smask Mask of osh_scoring_filter_static().
+ * @param[in] e Kinetic energy [MeV].
+ *
+ * @returns Mask of the filters accepting the particle at energy e.
+ */
+static inline uint64_t osh_scoring_filter_energy(struct scoring_filter_table const *ft,
+                                                 struct particle const *part,
+                                                 uint64_t smask,
+                                                 double e) {
+    uint64_t d = smask & ft->dyn;
+    double en;
+    int i;
+
+    if (!d)
+        return smask;
+    en = (part->a > 1) ? e / (double) part->a : e;
+    while (d) {
+        i = osh_scoring_ctz64(d);
+        if (e < ft->elo[i] || e > ft->ehi[i] || en < ft->nlo[i] || en > ft->nhi[i])
+            smask &= ~((uint64_t) 1 << i);
+        d &= d - 1;
+    }
+    return smask;
+}
+
+/**
+ * @brief Mask of the filters accepting a particle at a kinetic energy.
+ *
+ * @param[in] ft Filter table.
+ * @param[in] part Particle.
+ * @param[in] e Kinetic energy [MeV].
+ *
+ * @returns Filter mask.
+ */
+static inline uint64_t osh_scoring_filter_mask(struct scoring_filter_table const *ft,
+                                               struct particle const *part,
+                                               double e) {
+    return osh_scoring_filter_energy(ft, part, osh_scoring_filter_static(ft, part), e);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OSH_SCORING_FILTER_H */
@@ -0,0 +1,108 @@
+#include <math.h>
+
+#include "scoring/_osh_scoring.h"
+#include "scoring/osh_scoring.h"
+#include "transport/osh_transport.h"
+
+void _osh_scoring_mesh(struct scoring_buffer *buf, struct scoring_geo const *g, struct scoring_step const *s) {
+    struct scoring_mesh const *m = &g->mesh;
+    struct step const *st = s->st;
+    double u0[3], u1[3], du[3], tnext[3], tdelta[3];
+    double t, t0, t1, ta, tb, tn, x;
+    size_t i[3], stride[3], bin;
+    int inc[3];
+    int a, in0, in1;
+
+    /* ends of the step in units of bins */
+    in0 = 1;
+    in1 = 1;
+    for (a = 0; a < 3; a++) {
+        u0[a] = (st->p[a] - m->x0[a]) * m->inv_d[a];
+        u1[a] = (st->q[a] - m->x0[a]) * m->inv_d[a];
+        in0 = in0 && u0[a] >= 0.0 && u0[a] < (double) m->n[a];
+        in1 = in1 && u1[a] >= 0.0 && u1[a] < (double) m->n[a];
+    }
+
+    /* both ends in the same bin, this includes steps of zero length */
+    if (in0 && (st->ds <= 0.0 || (in1 && (size_t) u0[0] == (size_t) u1[0] && (size_t) u0[1] == (size_t) u1[1] &&
+                                  (size_t) u0[2] == (size_t) u1[2]))) {
+        bin = (size_t) u0[0] + m->n[0] * ((size_t) u0[1] + m->n[1] * (size_t) u0[2]);
+        _osh_scoring_add(buf, g, s, bin, st->ds, st->de, m->inv_vol);
+        return;
+    }
+    if (st->ds <= 0.0)
+        return;
+
+    /* clip to the mesh, t in [0, 1] from p to q */
+    t0 = 0.0;
+    t1 = 1.0;
+    for (a = 0; a < 3; a++) {
+        du[a] = u1[a] - u0[a];
+        if (du[a] == 0.0) {
+            if (!(u0[a] >= 0.0 && u0[a] < (double) m->n[a]))
+                return;
+            continue;
+        }
+        ta = -u0[a] / du[a];
+        tb = ((double) m->n[a] - u0[a]) / du[a];
+        if (ta > tb) {
+            t = ta;
+            ta = tb;
+            tb = t;
+        }
+        if (ta > t0)
+            t0 = ta;
+        if (tb < t1)
+            t1 = tb;
+    }
+    if (!(t0 < t1))
+        return;
+
+    /* first bin, and where the step crosses the next bin plane along each axis */
+    for (a = 0; a < 3; a++) {
+        x = floor(u0[a] + t0 * du[a]);
+        if (x < 0.0)
+            x = 0.0;
+        if (x > (double) (m->n[a] - 1))
+            x = (double) (m->n[a] - 1);
+        i[a] = (size_t) x;
+        if (du[a] > 0.0) {
+            inc[a] = 1;
+            tdelta[a] = 1.0 / du[a];
+            tnext[a] = (x + 1.0 - u0[a]) * tdelta[a];
+        } else if (du[a] < 0.0) {
+            inc[a] = -1;
+            tdelta[a] = -1.0 / du[a];
+            tnext[a] = (u0[a] - x) * tdelta[a];
+        } else {
+            inc[a] = 0;
+            tdelta[a] = HUGE_VAL;
+            tnext[a] = HUGE_VAL;
+        }
+    }
+    stride[0] = 1;
+    stride[1] = m->n[0];
+    stride[2] = m->n[0] * m->n[1];
+    bin = i[0] + stride[1] * i[1] + stride[2] * i[2];
+
+    for (t = t0;;) {
+        a = (tnext[0] < tnext[1]) ? ((tnext[0] < tnext[2]) ? 0 : 2) : ((tnext[1] < tnext[2]) ? 1 : 2);
+        tn = (tnext[a] < t1) ? tnext[a] : t1;
+        if (tn > t)
+            _osh_scoring_add(buf, g, s, bin, (tn - t) * st->ds, (tn - t) * st->de, m->inv_vol);
+        if (tn >= t1)
+            break;
+        t = tn;
+        if (inc[a] > 0) {
+            if (++i[a] >= m->n[a])
+                break;
+            bin += stride[a];
+        } else {
+            if (i[a] == 0)
+                break;
+            i[a]--;
+            bin -= stride[a];
+        }
+        tnext[a] += tdelta[a];
+    }
+}
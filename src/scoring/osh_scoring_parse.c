@@ -0,0 +1,584 @@
+#include "scoring/osh_scoring.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "common/osh_const.h"
+#include "common/osh_file.h"
+#include "common/osh_logger.h"
+#include "common/osh_rc.h"
+#include "common/osh_readline.h"
+#include "scoring/osh_scoring_parse_keys.h"
+
+/* blocks of detect.dat */
+#define BLOCK_NONE 0
+#define BLOCK_FILTER 1
+#define BLOCK_GEOMETRY 2
+#define BLOCK_OUTPUT 3
+
+/* state of the parser */
+struct sparse {
+    struct oshfile *oshf;
+    struct scoring_workspace *sw;
+    size_t capf, capg, capp, capo; /* allocated filters, geometries, pages and outputs */
+    int block;                     /* block being defined, BLOCK_* */
+    int lineno;                    /* line of the current key */
+    int bline;                     /* line of the key opening the block */
+    unsigned int axes;             /* mesh axes given, bit i for axis i */
+    size_t nvol;                   /* zone volumes given */
+    int geo;                       /* geometry of the output, -1 if not given */
+};
+
+/* make room for one more element of size bytes in *a holding n of *cap */
+static int _grow(void **a, size_t *cap, size_t n, size_t size) {
+    void *t;
+
+    if (n < *cap)
+        return OSH_OK;
+    t = realloc(*a, (*cap ? 2 * *cap : 8) * size);
+    if (!t)
+        return OSH_ENOMEM;
+    *a = t;
+    *cap = *cap ? 2 * *cap : 8;
+    return OSH_OK;
+}
+
+/* copy a single word into a name */
+static int _name(struct sparse const *p, char *args, char *name) {
+    char *w;
+
+    w = args ? strtok(args, " \t") : NULL;
+    if (!w || strtok(NULL, " \t"))
+        return osh_readline_error(p->oshf, p->lineno, "Name needs a single word");
+    if (strlen(w) >= OSH_SCORING_NAMELEN)
+        return osh_readline_error(
+            p->oshf, p->lineno, "name '%s' is longer than %d characters", w, OSH_SCORING_NAMELEN - 1);
+    strcpy(name, w);
+    return OSH_OK;
+}
+
+static int _filter(struct sparse *p) {
+    struct scoring_workspace *sw = p->sw;
+
+    if (sw->nfilters == OSH_SCORING_MAXFILTER)
+        return osh_readline_error(p->oshf, p->lineno, "more than %d filters", OSH_SCORING_MAXFILTER);
+    if (_grow((void **) &sw->filters, &p->capf, sw->nfilters, sizeof(*sw->filters)) != OSH_OK)
+        return OSH_ENOMEM;
+    memset(&sw->filters[sw->nfilters], 0, sizeof(*sw->filters));
+    sw->nfilters++;
+    return OSH_OK;
+}
+
+static int _geometry(struct sparse *p, char *args) {
+    struct scoring_workspace *sw = p->sw;
+    struct scoring_geo *g;
+    struct scoring_mesh *m;
+    int type;
+
+    if (args && strcasecmp(args, OSH_SCORING_KEY_MESH) == 0)
+        type = OSH_SCORING_GEO_MESH;
+    else if (args && strcasecmp(args, OSH_SCORING_KEY_CYL) == 0)
+        type = OSH_SCORING_GEO_CYL;
+    else if (args && strcasecmp(args, OSH_SCORING_KEY_SPH) == 0)
+        type = OSH_SCORING_GEO_SPH;
+    else if (args && strcasecmp(args, OSH_SCORING_KEY_ZONE) == 0)
+        type = OSH_SCORING_GEO_ZONE;
+    else if (args && strcasecmp(args, OSH_SCORING_KEY_PLANE) == 0)
+        type = OSH_SCORING_GEO_PLANE;
+    else
+        return osh_readline_error(p->oshf, p->lineno, "unknown geometry type '%s'", args ? args : "");
+
+    if (_grow((void **) &sw->geos, &p->capg, sw->ngeos, sizeof(*sw->geos)) != OSH_OK)
+        return OSH_ENOMEM;
+    g = &sw->geos[sw->ngeos];
+    memset(g, 0, sizeof(*g));
+    g->type = type;
+    sw->ngeos++;
+    p->axes = 0;
+    p->nvol = 0;
+
+    /* angles default to one bin all around */
+    m = &g->mesh;
+    if (type == OSH_SCORING_GEO_CYL) {
+        m->x1[1] = 2.0 * OSH_M_PI;
+        m->n[1] = 1;
+    } else if (type == OSH_SCORING_GEO_SPH) {
+        m->x1[1] = OSH_M_PI;
+        m->x1[2] = 2.0 * OSH_M_PI;
+        m->n[1] = m->n[2] = 1;
+    }
+    return OSH_OK;
+}
+
+static int _output(struct sparse *p) {
+    struct scoring_workspace *sw = p->sw;
+    struct scoring_output *o;
+
+    if (_grow((void **) &sw->outputs, &p->capo, sw->noutputs, sizeof(*sw->outputs)) != OSH_OK)
+        return OSH_ENOMEM;
+    o = &sw->outputs[sw->noutputs];
+    memset(o, 0, sizeof(*o));
+    o->page = sw->npages;
+    sw->noutputs++;
+    p->geo = -1;
+    return OSH_OK;
+}
+
+/* zone i listed before */
+static int _zone_twice(struct scoring_zone const *z, size_t i) {
+    size_t k;
+
+    for (k = 0; k < i; k++)
+        if (z->ids[k] == z->ids[i])
+            return 1;
+    return 0;
+}
+
+/* finish the block being defined */
+static int _close(struct sparse *p) {
+    struct scoring_workspace *sw = p->sw;
+    struct scoring_output *o;
+    char const *name;
+    double const *n;
+    size_t i;
+    int type;
+
+    switch (p->block) {
+    case BLOCK_FILTER:
+        name = sw->filters[sw->nfilters - 1].name;
+        if (name[0] == '\0')
+            return osh_readline_error(p->oshf, p->bline, "Filter needs a Name");
+        if (osh_scoring_filter_find(sw, name) != (int) sw->nfilters - 1)
+            return osh_readline_error(p->oshf, p->bline, "filter '%s' is defined twice", name);
+        break;
+    case BLOCK_GEOMETRY:
+        name = sw->geos[sw->ngeos - 1].name;
+        if (name[0] == '\0')
+            return osh_readline_error(p->oshf, p->bline, "Geometry needs a Name");
+        if (osh_scoring_geo_find(sw, name) != (int) sw->ngeos - 1)
+            return osh_readline_error(p->oshf, p->bline, "geometry '%s' is defined twice", name);
+        switch (sw->geos[sw->ngeos - 1].type) {
+        case OSH_SCORING_GEO_CYL:
+            if ((p->axes & 5u) != 5u)
+                return osh_readline_error(p->oshf, p->bline, "cylinder '%s' needs R and Z", name);
+            break;
+        case OSH_SCORING_GEO_SPH:
+            if (!(p->axes & 1u))
+                return osh_readline_error(p->oshf, p->bline, "sphere '%s' needs R", name);
+            break;
+        case OSH_SCORING_GEO_ZONE:
+            if (sw->geos[sw->ngeos - 1].zone.n == 0)
+                return osh_readline_error(p->oshf, p->bline, "zones '%s' need a Zone", name);
+            if (p->nvol > 0 && p->nvol != sw->geos[sw->ngeos - 1].zone.n)
+                return osh_readline_error(p->oshf, p->bline, "zones '%s' need one Volume per zone", name);
+            for (i = 1; i < sw->geos[sw->ngeos - 1].zone.n; i++)
+                if (_zone_twice(&sw->geos[sw->ngeos - 1].zone, i))
+                    return osh_readline_error(p->oshf,
+                                              p->bline,
+                                              "zone %lu is listed twice in '%s'",
+                                              (unsigned long) sw->geos[sw->ngeos - 1].zone.ids[i],
+                                              name);
+            break;
+        case OSH_SCORING_GEO_PLANE:
+            n = sw->geos[sw->ngeos - 1].plane.n;
+            if (!(p->axes & 1u) || (n[0] == 0.0 && n[1] == 0.0 && n[2] == 0.0))
+                return osh_readline_error(p->oshf, p->bline, "plane '%s' needs a nonzero Normal", name);
+            break;
+        default:
+            if (p->axes != 7u)
+                return osh_readline_error(p->oshf, p->bline, "mesh '%s' needs X, Y and Z", name);
+            break;
+        }
+        break;
+    case BLOCK_OUTPUT:
+        o = &sw->outputs[sw->noutputs - 1];
+        if (!o->filename)
+            return osh_readline_error(p->oshf, p->bline, "Output needs a Filename");
+        if (p->geo < 0)
+            return osh_readline_error(p->oshf, p->bline, "Output needs a Geo");
+        if (o->npages == 0)
+            return osh_readline_error(p->oshf, p->bline, "Output needs a Quantity");
+        type = sw->geos[p->geo].type;
+        for (i = o->page; i < o->page + o->npages; i++) {
+            if (sw->pages[i].quantity == OSH_SCORING_QTY_PHSP) {
+                if (o->npages != 1)
+                    return osh_readline_error(p->oshf, p->bline, "PHSP must be the only Quantity of its Output");
+                if (type != OSH_SCORING_GEO_PLANE && type != OSH_SCORING_GEO_ZONE)
+                    return osh_readline_error(p->oshf, p->bline, "PHSP needs a Plane or Zone geometry");
+            } else if (type == OSH_SCORING_GEO_PLANE) {
+                return osh_readline_error(p->oshf, p->bline, "plane '%s' only records PHSP", sw->geos[p->geo].name);
+            }
+        }
+        o->geo = (size_t) p->geo;
+        for (i = o->page; i < o->page + o->npages; i++)
+            sw->pages[i].geo = o->geo;
+        break;
+    default:
+        break;
+    }
+    p->block = BLOCK_NONE;
+    return OSH_OK;
+}
+
+/* predicate "op value" of a filter */
+static int _pred(struct sparse *p, int var, char const *key, char *args) {
+    struct scoring_filter *f = &p->sw->filters[p->sw->nfilters - 1];
+    struct scoring_pred *pr;
+    char op[3];
+    size_t n;
+
+    if (f->npred == OSH_SCORING_MAXPRED)
+        return osh_readline_error(p->oshf, p->lineno, "more than %d conditions in filter", OSH_SCORING_MAXPRED);
+
+    n = args ? strspn(args, "=!<>") : 0;
+    if (n == 0 || n > 2)
+        return osh_readline_error(p->oshf, p->lineno, "%s needs an operator =, !=, <, <=, > or >=", key);
+    memcpy(op, args, n);
+    op[n] = '\0';
+    args += n;
+    args += strspn(args, " \t");
+
+    pr = &f->pred[f->npred];
+    pr->var = var;
+    if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0)
+        pr->op = OSH_SCORING_OP_EQ;
+    else if (strcmp(op, "!=") == 0)
+        pr->op = OSH_SCORING_OP_NE;
+    else if (strcmp(op, "<") == 0)
+        pr->op = OSH_SCORING_OP_LT;
+    else if (strcmp(op, "<=") == 0)
+        pr->op = OSH_SCORING_OP_LE;
+    else if (strcmp(op, ">") == 0)
+        pr->op = OSH_SCORING_OP_GT;
+    else if (strcmp(op, ">=") == 0)
+        pr->op = OSH_SCORING_OP_GE;
+    else
+        return osh_readline_error(p->oshf, p->lineno, "unknown operator '%s'", op);
+
+    if (!osh_readline_double(args, &pr->value) || !osh_scoring_pred_valid(pr))
+        return osh_readline_error(p->oshf, p->lineno, "invalid condition on %s", key);
+    f->npred++;
+    return OSH_OK;
+}
+
+/* mesh axis "min max nbins", kept in units of scale, and min and max within [lo, hi] */
+static int _axis(struct sparse *p, int axis, char *args, double scale, double lo, double hi) {
+    struct scoring_mesh *m = &p->sw->geos[p->sw->ngeos - 1].mesh;
+    double x0, x1;
+    char *s[4];
+    int i, n;
+
+    s[0] = args ? strtok(args, " \t") : NULL;
+    for (i = 1; i < 4; i++)
+        s[i] = s[i - 1] ? strtok(NULL, " \t") : NULL;
+    if (!s[2] || s[3])
+        return osh_readline_error(p->oshf, p->lineno, "mesh axis needs min, max and number of bins");
+    if (!osh_readline_double(s[0], &x0) || !osh_readline_double(s[1], &x1) || !(x1 > x0))
+        return osh_readline_error(p->oshf, p->lineno, "mesh axis needs min < max");
+    if (x0 < lo || x1 > hi)
+        return osh_readline_error(p->oshf, p->lineno, "mesh axis must be within %g and %g", lo, hi);
+    if (!osh_readline_int(s[2], &n) || n < 1)
+        return osh_readline_error(p->oshf, p->lineno, "mesh axis needs at least one bin");
+    m->x0[axis] = x0 * scale;
+    m->x1[axis] = x1 * scale;
+    m->n[axis] = (size_t) n;
+    p->axes |= 1u << axis;
+    return OSH_OK;
+}
+
+/* "Center x y z" of a cylinder or sphere, "Point x y z" and "Normal x y z" of a plane */
+static int _xyz(struct sparse *p, const char *name, char *args, double *v) {
+    char *s[4];
+    int i;
+
+    s[0] = args ? strtok(args, " \t") : NULL;
+    for (i = 1; i < 4; i++)
+        s[i] = s[i - 1] ? strtok(NULL, " \t") : NULL;
+    if (!s[2] || s[3] || !osh_readline_double(s[0], &v[0]) || !osh_readline_double(s[1], &v[1]) ||
+        !osh_readline_double(s[2], &v[2]))
+        return osh_readline_error(p->oshf, p->lineno, "%s needs x, y and z", name);
+    return OSH_OK;
+}
+
+/* "Zone id ..." adds zones */
+static int _zones(struct sparse *p, char *args) {
+    struct scoring_zone *z = &p->sw->geos[p->sw->ngeos - 1].zone;
+    size_t *t;
+    char *w;
+    int id;
+
+    w = args ? strtok(args, " \t") : NULL;
+    if (!w)
+        return osh_readline_error(p->oshf, p->lineno, "Zone needs zone ids");
+    for (; w; w = strtok(NULL, " \t")) {
+        if (!osh_readline_int(w, &id) || id < 1)
+            return osh_readline_error(p->oshf, p->lineno, "invalid zone id '%s'", w);
+        t = realloc(z->ids, (z->n + 1) * sizeof(*z->ids));
+        if (!t)
+            return OSH_ENOMEM;
+        z->ids = t;
+        z->ids[z->n++] = (size_t) id;
+    }
+    return OSH_OK;
+}
+
+/* "Volume v ..." adds volumes of the zones in the order of their ids */
+static int _volumes(struct sparse *p, char *args) {
+    struct scoring_zone *z = &p->sw->geos[p->sw->ngeos - 1].zone;
+    double *t;
+    double v;
+    char *w;
+
+    w = args ? strtok(args, " \t") : NULL;
+    if (!w)
+        return osh_readline_error(p->oshf, p->lineno, "Volume needs volumes");
+    for (; w; w = strtok(NULL, " \t")) {
+        if (!osh_readline_double(w, &v) || !(v > 0.0))
+            return osh_readline_error(p->oshf, p->lineno, "invalid zone volume '%s'", w);
+        t = realloc(z->inv_vol, (p->nvol + 1) * sizeof(*z->inv_vol));
+        if (!t)
+            return OSH_ENOMEM;
+        z->inv_vol = t;
+        z->inv_vol[p->nvol++] = 1.0 / v;
+    }
+    return OSH_OK;
+}
+
+/* "Quantity NAME [filter ...]", "Quantity SPECTRUM emin emax nbins [filter ...]", "Quantity PHSP [filter ...]" */
+static int _quantity(struct sparse *p, char *args) {
+    struct scoring_workspace *sw = p->sw;
+    struct scoring_page *pg;
+    char *w, *s[3];
+    int q, f, i, n;
+
+    w = args ? strtok(args, " \t") : NULL;
+    if (!w)
+        return osh_readline_error(p->oshf, p->lineno, "Quantity needs a name");
+    if (strcasecmp(w, OSH_SCORING_KEY_ENERGY) == 0)
+        q = OSH_SCORING_QTY_ENERGY;
+    else if (strcasecmp(w, OSH_SCORING_KEY_FLUENCE) == 0)
+        q = OSH_SCORING_QTY_FLUENCE;
+    else if (strcasecmp(w, OSH_SCORING_KEY_DOSE) == 0)
+        q = OSH_SCORING_QTY_DOSE;
+    else if (strcasecmp(w, OSH_SCORING_KEY_LETT) == 0)
+        q = OSH_SCORING_QTY_LETT;
+    else if (strcasecmp(w, OSH_SCORING_KEY_LETD) == 0)
+        q = OSH_SCORING_QTY_LETD;
+    else if (strcasecmp(w, OSH_SCORING_KEY_SPECTRUM) == 0)
+        q = OSH_SCORING_QTY_SPECTRUM;
+    else if (strcasecmp(w, OSH_SCORING_KEY_PHSP) == 0)
+        q = OSH_SCORING_QTY_PHSP;
+    else
+        return osh_readline_error(p->oshf, p->lineno, "unknown quantity '%s'", w);
+
+    if (_grow((void **) &sw->pages, &p->capp, sw->npages, sizeof(*sw->pages)) != OSH_OK)
+        return OSH_ENOMEM;
+    pg = &sw->pages[sw->npages];
+    memset(pg, 0, sizeof(*pg));
+    pg->quantity = q;
+    pg->output = sw->noutputs - 1;
+
+    if (q == OSH_SCORING_QTY_SPECTRUM) {
+        for (i = 0; i < 3; i++)
+            s[i] = strtok(NULL, " \t");
+        if (!osh_readline_double(s[0], &pg->emin) || !osh_readline_double(s[1], &pg->emax) ||
+            !(pg->emin > 0.0 && pg->emax > pg->emin))
+            return osh_readline_error(p->oshf, p->lineno, "SPECTRUM needs 0 < emin < emax");
+        if (!osh_readline_int(s[2], &n) || n < 1)
+            return osh_readline_error(p->oshf, p->lineno, "SPECTRUM needs at least one energy bin");
+        pg->ne = (size_t) n;
+    }
+
+    while ((w = strtok(NULL, " \t")) != NULL) {
+        f = osh_scoring_filter_find(sw, w);
+        if (f < 0)
+            return osh_readline_error(p->oshf, p->lineno, "unknown filter '%s'", w);
+        pg->fmask |= (uint64_t) 1 << f;
+    }
+
+    sw->npages++;
+    sw->outputs[sw->noutputs - 1].npages++;
+    return OSH_OK;
+}
+
+static int _filter_key(struct sparse *p, const char *key, char *args) {
+    if (strcasecmp(OSH_SCORING_KEY_NAME, key) == 0)
+        return _name(p, args, p->sw->filters[p->sw->nfilters - 1].name);
+    if (strcasecmp(OSH_SCORING_KEY_Z, key) == 0)
+        return _pred(p, OSH_SCORING_VAR_Z, key, args);
+    if (strcasecmp(OSH_SCORING_KEY_A, key) == 0)
+        return _pred(p, OSH_SCORING_VAR_A, key, args);
+    if (strcasecmp(OSH_SCORING_KEY_GEN, key) == 0)
+        return _pred(p, OSH_SCORING_VAR_GEN, key, args);
+    if (strcasecmp(OSH_SCORING_KEY_ID, key) == 0)
+        return _pred(p, OSH_SCORING_VAR_ID, key, args);
+    if (strcasecmp(OSH_SCORING_KEY_E, key) == 0)
+        return _pred(p, OSH_SCORING_VAR_E, key, args);
+    if (strcasecmp(OSH_SCORING_KEY_ENUC, key) == 0)
+        return _pred(p, OSH_SCORING_VAR_ENUC, key, args);
+
+    osh_warn("in %s line %i: unknown key '%s' ignored\n", p->oshf->filename, p->lineno, key);
+    return OSH_OK;
+}
+
+static int _geometry_key(struct sparse *p, const char *key, char *args) {
+    struct scoring_geo *g = &p->sw->geos[p->sw->ngeos - 1];
+
+    if (strcasecmp(OSH_SCORING_KEY_NAME, key) == 0)
+        return _name(p, args, g->name);
+
+    switch (g->type) {
+    case OSH_SCORING_GEO_MESH:
+        if (strcasecmp(OSH_SCORING_KEY_X, key) == 0)
+            return _axis(p, 0, args, 1.0, -HUGE_VAL, HUGE_VAL);
+        if (strcasecmp(OSH_SCORING_KEY_Y, key) == 0)
+            return _axis(p, 1, args, 1.0, -HUGE_VAL, HUGE_VAL);
+        if (strcasecmp(OSH_SCORING_KEY_Z, key) == 0)
+            return _axis(p, 2, args, 1.0, -HUGE_VAL, HUGE_VAL);
+        break;
+    case OSH_SCORING_GEO_CYL:
+        if (strcasecmp(OSH_SCORING_KEY_R, key) == 0)
+            return _axis(p, 0, args, 1.0, 0.0, HUGE_VAL);
+        if (strcasecmp(OSH_SCORING_KEY_PHI, key) == 0)
+            return _axis(p, 1, args, OSH_M_PI_180, 0.0, 360.0);
+        if (strcasecmp(OSH_SCORING_KEY_Z, key) == 0)
+            return _axis(p, 2, args, 1.0, -HUGE_VAL, HUGE_VAL);
+        if (strcasecmp(OSH_SCORING_KEY_CENTER, key) == 0)
+            return _xyz(p, "Center", args, g->mesh.c);
+        break;
+    case OSH_SCORING_GEO_SPH:
+        if (strcasecmp(OSH_SCORING_KEY_R, key) == 0)
+            return _axis(p, 0, args, 1.0, 0.0, HUGE_VAL);
+        if (strcasecmp(OSH_SCORING_KEY_THETA, key) == 0)
+            return _axis(p, 1, args, OSH_M_PI_180, 0.0, 180.0);
+        if (strcasecmp(OSH_SCORING_KEY_PHI, key) == 0)
+            return _axis(p, 2, args, OSH_M_PI_180, 0.0, 360.0);
+        if (strcasecmp(OSH_SCORING_KEY_CENTER, key) == 0)
+            return _xyz(p, "Center", args, g->mesh.c);
+        break;
+    case OSH_SCORING_GEO_ZONE:
+        if (strcasecmp(OSH_SCORING_KEY_ZONE, key) == 0)
+            return _zones(p, args);
+        if (strcasecmp(OSH_SCORING_KEY_VOLUME, key) == 0)
+            return _volumes(p, args);
+        break;
+    case OSH_SCORING_GEO_PLANE:
+        if (strcasecmp(OSH_SCORING_KEY_POINT, key) == 0)
+            return _xyz(p, "Point", args, g->plane.c);
+        if (strcasecmp(OSH_SCORING_KEY_NORMAL, key) == 0) {
+            p->axes |= 1u;
+            return _xyz(p, "Normal", args, g->plane.n);
+        }
+        break;
+    default:
+        break;
+    }
+
+    osh_warn("in %s line %i: unknown key '%s' ignored\n", p->oshf->filename, p->lineno, key);
+    return OSH_OK;
+}
+
+static int _output_key(struct sparse *p, const char *key, char *args) {
+    struct scoring_output *o = &p->sw->outputs[p->sw->noutputs - 1];
+
+    if (strcasecmp(OSH_SCORING_KEY_FILENAME, key) == 0) {
+        if (!args || strpbrk(args, " \t"))
+            return osh_readline_error(p->oshf, p->lineno, "Filename needs a single file name");
+        free(o->filename);
+        o->filename = malloc(strlen(args) + 1);
+        if (!o->filename)
+            return OSH_ENOMEM;
+        strcpy(o->filename, args);
+        return OSH_OK;
+    }
+    if (strcasecmp(OSH_SCORING_KEY_GEO, key) == 0) {
+        p->geo = args ? osh_scoring_geo_find(p->sw, args) : -1;
+        if (p->geo < 0)
+            return osh_readline_error(p->oshf, p->lineno, "unknown geometry '%s'", args ? args : "");
+        return OSH_OK;
+    }
+    if (strcasecmp(OSH_SCORING_KEY_QUANTITY, key) == 0)
+        return _quantity(p, args);
+
+    osh_warn("in %s line %i: unknown key '%s' ignored\n", p->oshf->filename, p->lineno, key);
+    return OSH_OK;
+}
+
+/* handle one key */
+static int _key(struct sparse *p, const char *key, char *args) {
+    int rc;
+
+    if (strcasecmp(OSH_SCORING_KEY_FILTER, key) == 0 || strcasecmp(OSH_SCORING_KEY_GEOMETRY, key) == 0 ||
+        strcasecmp(OSH_SCORING_KEY_OUTPUT, key) == 0) {
+        rc = _close(p);
+        if (rc != OSH_OK)
+            return rc;
+        p->bline = p->lineno;
+        if (strcasecmp(OSH_SCORING_KEY_FILTER, key) == 0) {
+            p->block = BLOCK_FILTER;
+            return _filter(p);
+        }
+        if (strcasecmp(OSH_SCORING_KEY_GEOMETRY, key) == 0) {
+            p->block = BLOCK_GEOMETRY;
+            return _geometry(p, args);
+        }
+        p->block = BLOCK_OUTPUT;
+        return _output(p);
+    }
+
+    switch (p->block) {
+    case BLOCK_FILTER:
+        return _filter_key(p, key, args);
+    case BLOCK_GEOMETRY:
+        return _geometry_key(p, key, args);
+    case BLOCK_OUTPUT:
+        return _output_key(p, key, args);
+    default:
+        return osh_readline_error(p->oshf, p->lineno, "'%s' outside of a Filter, Geometry or Output block", key);
+    }
+}
+
+int osh_scoring_load(const char *filename, struct scoring_workspace *sw) {
+    struct sparse p;
+    char *line = NULL;
+    char *key = NULL;
+    char *args = NULL;
+    int lineno;
+    int rc;
+
+    if (!filename || !sw)
+        return OSH_EINVAL;
+
+    memset(sw, 0, sizeof(*sw));
+    sw->filename = malloc(strlen(filename) + 1);
+    if (!sw->filename)
+        return OSH_ENOMEM;
+    strcpy(sw->filename, filename);
+
+    memset(&p, 0, sizeof(p));
+    p.sw = sw;
+    p.geo = -1;
+    p.oshf = osh_fopen(filename);
+
+    rc = OSH_OK;
+    while (rc == OSH_OK && osh_readline_key(p.oshf, &line, &key, &args, &lineno) > 0) {
+        p.lineno = lineno;
+        rc = _key(&p, key, args);
+        free(line);
+    }
+    if (rc == OSH_OK)
+        rc = _close(&p);
+    if (rc == OSH_OK) {
+        rc = osh_scoring_compile(sw);
+        if (rc == OSH_EINVAL)
+            rc = osh_readline_error(p.oshf, p.lineno, "inconsistent scoring definition");
+    }
+
+    osh_fclose(p.oshf);
+    if (rc != OSH_OK)
+        osh_scoring_free(sw);
+    return rc;
+}
@@ -0,0 +1,50 @@
+#ifndef _OSH_SCORING_PARSE_KEYS
+#define _OSH_SCORING_PARSE_KEYS
+
+/* list of keys used in detect.dat */
+// clang-format off
+#define OSH_SCORING_KEY_FILTER    "filter"
+#define OSH_SCORING_KEY_GEOMETRY  "geometry"
+#define OSH_SCORING_KEY_OUTPUT    "output"
+#define OSH_SCORING_KEY_NAME      "name"
+
+/* filter predicates */
+#define OSH_SCORING_KEY_Z         "z"
+#define OSH_SCORING_KEY_A         "a"
+#define OSH_SCORING_KEY_GEN       "gen"
+#define OSH_SCORING_KEY_ID        "id"
+#define OSH_SCORING_KEY_E         "e"
+#define OSH_SCORING_KEY_ENUC      "enuc"
+
+/* geometry types and their keys */
+#define OSH_SCORING_KEY_MESH      "mesh"
+#define OSH_SCORING_KEY_X         "x"
+#define OSH_SCORING_KEY_Y         "y"
+#define OSH_SCORING_KEY_CYL       "cyl"
+#define OSH_SCORING_KEY_SPH       "sph"
+#define OSH_SCORING_KEY_R         "r"
+#define OSH_SCORING_KEY_PHI       "phi"
+#define OSH_SCORING_KEY_THETA     "theta"
+#define OSH_SCORING_KEY_CENTER    "center"
+#define OSH_SCORING_KEY_ZONE      "zone"
+#define OSH_SCORING_KEY_VOLUME    "volume"
+#define OSH_SCORING_KEY_PLANE     "plane"
+#define OSH_SCORING_KEY_POINT     "point"
+#define OSH_SCORING_KEY_NORMAL    "normal"
+
+/* output */
+#define OSH_SCORING_KEY_FILENAME  "filename"
+#define OSH_SCORING_KEY_GEO       "geo"
+#define OSH_SCORING_KEY_QUANTITY  "quantity"
+
+/* quantities */
+#define OSH_SCORING_KEY_ENERGY    "energy"
+#define OSH_SCORING_KEY_FLUENCE   "fluence"
+#define OSH_SCORING_KEY_DOSE      "dose"
+#define OSH_SCORING_KEY_LETT      "lett"
+#define OSH_SCORING_KEY_LETD      "letd"
+#define OSH_SCORING_KEY_SPECTRUM  "spectrum"
+#define OSH_SCORING_KEY_PHSP      "phsp"
+// clang-format on
+
+#endif /* !_OSH_SCORING_PARSE_KEYS */
@@ -0,0 +1,270 @@
+#include "scoring/osh_scoring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_rc.h"
+#include "io/osh_phsp.h"
+#include "particle/osh_particle.h"
+#include "scoring/_osh_scoring.h"
+#include "transport/osh_transport.h"
+
+/* zone recorded by a phase-space output */
+static int _in_zones(struct scoring_phsp const *ph, int zone) {
+    size_t z;
+
+    if (zone < 0 || (size_t) zone >= ph->nzt)
+        return 0;
+    z = (size_t) zone;
+    return (ph->zbits[z >> 6] >> (z & 63)) & 1u;
+}
+
+/* crossing of a step along the plane normal, returns 0 if none, else 1 and the fraction t of the step */
+static int _plane_cross(struct scoring_plane const *pl, struct step const *st, double *t) {
+    double a, b;
+
+    a = pl->n[0] * st->p[0] + pl->n[1] * st->p[1] + pl->n[2] * st->p[2] - pl->d;
+    b = pl->n[0] * st->q[0] + pl->n[1] * st->q[1] + pl->n[2] * st->q[2] - pl->d;
+    /* a step ending on the plane is recorded, the next one starting there is not */
+    if (!(a < 0.0 && b >= 0.0))
+        return 0;
+    *t = a / (a - b);
+    return 1;
+}
+
+/* room for one more record, NULL if out of memory */
+static struct osh_phsp_record *_push(struct scoring_phsp_buf *ph) {
+    struct osh_phsp_record *t;
+    size_t cap;
+
+    if (ph->n == ph->cap) {
+        cap = ph->cap ? 2 * ph->cap : OSH_PHSP_PIECE;
+        t = realloc(ph->rec, cap * sizeof(*ph->rec));
+        if (!t)
+            return NULL;
+        ph->rec = t;
+        ph->cap = cap;
+    }
+    return &ph->rec[ph->n++];
+}
+
+void _osh_scoring_phsp(struct scoring_buffer *buf, struct particle const *part, struct scoring_step const *s) {
+    struct scoring_workspace const *sw = buf->sw;
+    struct step const *st = s->st;
+    struct scoring_page const *pg;
+    struct scoring_geo const *g;
+    struct osh_phsp_record *r;
+    double t;
+    size_t k;
+    int i;
+
+    for (k = 0; k < sw->nphsp; k++) {
+        pg = &sw->pages[sw->phsp[k].page];
+        if (pg->fmask & ~s->mask)
+            continue;
+        g = &sw->geos[pg->geo];
+        if (g->type == OSH_SCORING_GEO_PLANE) {
+            if (!_plane_cross(&g->plane, st, &t))
+                continue;
+        } else {
+            /* leaving one of the zones */
+            if (!st->cross || !_in_zones(&sw->phsp[k], st->zone))
+                continue;
+            t = 1.0;
+        }
+
+        r = _push(&buf->ph[k]);
+        if (!r) {
+            buf->rc = OSH_ENOMEM;
+            continue;
+        }
+        for (i = 0; i < 3; i++) {
+            r->p[i] = st->p[i] + t * (st->q[i] - st->p[i]);
+            r->v[i] = st->v[i];
+        }
+        r->e = st->p[3] + t * (st->q[3] - st->p[3]);
+        r->wt = part->weight;
+        r->amass = part->amass;
+        r->amu = part->amu;
+        r->id = part->id;
+        r->z = part->z;
+        r->a = part->a;
+        r->gen = part->gen;
+        r->pdg = part->pdg;
+    }
+}
+
+int _osh_scoring_phsp_init(struct scoring_workspace *sw) {
+    struct scoring_geo const *g;
+    struct scoring_phsp *ph;
+    struct scoring_phsp_queue *q;
+    size_t i, k, z;
+
+    if (sw->nphsp == 0)
+        return OSH_OK;
+
+    for (k = 0; k < sw->nphsp; k++) {
+        ph = &sw->phsp[k];
+        g = &sw->geos[sw->pages[ph->page].geo];
+        if (g->type != OSH_SCORING_GEO_ZONE)
+            continue;
+        for (i = 0; i < g->zone.n; i++)
+            if (g->zone.ids[i] + 1 > ph->nzt)
+                ph->nzt = g->zone.ids[i] + 1;
+        ph->zbits = calloc((ph->nzt + 63) / 64, sizeof(*ph->zbits));
+        if (!ph->zbits)
+            return OSH_ENOMEM;
+        for (i = 0; i < g->zone.n; i++) {
+            z = g->zone.ids[i];
+            ph->zbits[z >> 6] |= (uint64_t) 1 << (z & 63);
+        }
+    }
+
+    q = calloc(1, sizeof(*q));
+    if (!q)
+        return OSH_ENOMEM;
+    osh_thread_mutex_init(&q->lock);
+    q->rc = OSH_OK;
+    sw->phq = q;
+    return OSH_OK;
+}
+
+/* write the records of an item, opening the file first */
+static int _write_item(struct scoring_workspace *sw, struct scoring_phsp_item const *it) {
+    struct scoring_phsp *ph = &sw->phsp[it->k];
+    int rc;
+
+    if (!ph->w.fp) {
+        rc = osh_phsp_open(&ph->w, sw->outputs[sw->pages[ph->page].output].filename);
+        if (rc != OSH_OK)
+            return rc;
+    }
+    return osh_phsp_write(&ph->w, it->rec, it->n);
+}
+
+/* the writer thread, takes the whole queue at a time until it is empty */
+static void _writer(void *arg) {
+    struct scoring_workspace *sw = arg;
+    struct scoring_phsp_queue *q = sw->phq;
+    struct scoring_phsp_item *it;
+    size_t i, n;
+    int rc, rc1;
+
+    osh_thread_mutex_lock(&q->lock);
+    while (q->n > 0) {
+        it = q->item;
+        n = q->n;
+        q->item = NULL;
+        q->n = q->cap = 0;
+        osh_thread_mutex_unlock(&q->lock);
+
+        rc = OSH_OK;
+        for (i = 0; i < n; i++) {
+            rc1 = _write_item(sw, &it[i]);
+            if (rc == OSH_OK)
+                rc = rc1;
+            free(it[i].rec);
+        }
+        free(it);
+
+        osh_thread_mutex_lock(&q->lock);
+        if (q->rc == OSH_OK)
+            q->rc = rc;
+    }
+    q->busy = 0;
+    osh_thread_mutex_unlock(&q->lock);
+}
+
+void _osh_scoring_phsp_merge(struct scoring_workspace *sw, struct scoring_buffer *buf) {
+    struct scoring_phsp_queue *q = sw->phq;
+    struct scoring_phsp_buf *b;
+    struct scoring_phsp_item *t;
+    size_t k, cap;
+    int start;
+
+    osh_thread_mutex_lock(&q->lock);
+    for (k = 0; k < sw->nphsp; k++) {
+        b = &buf->ph[k];
+        if (b->n == 0)
+            continue;
+        if (q->n == q->cap) {
+            cap = q->cap ? 2 * q->cap : 16;
+            t = realloc(q->item, cap * sizeof(*t));
+            if (!t) {
+                if (q->rc == OSH_OK)
+                    q->rc = OSH_ENOMEM;
+                continue;
+            }
+            q->item = t;
+            q->cap = cap;
+        }
+        /* the records change hands, the buffer starts a new array */
+        q->item[q->n].k = k;
+        q->item[q->n].rec = b->rec;
+        q->item[q->n].n = b->n;
+        q->n++;
+        b->rec = NULL;
+        b->n = b->cap = 0;
+    }
+    start = (q->n > 0 && !q->busy);
+    if (start)
+        q->busy = 1;
+    osh_thread_mutex_unlock(&q->lock);
+
+    if (start) {
+        /* the previous writer has left its loop, it only remains to be joined */
+        osh_thread_join(&q->th);
+        osh_thread_start(&q->th, _writer, sw);
+    }
+}
+
+int _osh_scoring_phsp_close(struct scoring_workspace *sw) {
+    struct scoring_phsp_queue *q = sw->phq;
+    struct scoring_phsp *ph;
+    size_t k;
+    int rc, rc1;
+
+    if (!q)
+        return OSH_OK;
+    osh_thread_join(&q->th);
+    if (q->n > 0) {
+        q->busy = 1;
+        _writer(sw);
+    }
+
+    rc = q->rc;
+    for (k = 0; k < sw->nphsp; k++) {
+        ph = &sw->phsp[k];
+        rc1 = OSH_OK;
+        if (!ph->w.fp)
+            rc1 = osh_phsp_open(&ph->w, sw->outputs[sw->pages[ph->page].output].filename);
+        if (rc1 == OSH_OK)
+            rc1 = osh_phsp_close(&ph->w, sw->nprim);
+        if (rc == OSH_OK)
+            rc = rc1;
+    }
+    return rc;
+}
+
+void _osh_scoring_phsp_free(struct scoring_workspace *sw) {
+    struct scoring_phsp_queue *q = sw->phq;
+    size_t k;
+
+    if (q) {
+        osh_thread_join(&q->th);
+        for (k = 0; k < q->n; k++)
+            free(q->item[k].rec);
+        free(q->item);
+        osh_thread_mutex_destroy(&q->lock);
+        free(q);
+        sw->phq = NULL;
+    }
+    if (sw->phsp)
+        for (k = 0; k < sw->nphsp; k++) {
+            osh_phsp_discard(&sw->phsp[k].w);
+            free(sw->phsp[k].zbits);
+        }
+    free(sw->phsp);
+    sw->phsp = NULL;
+    sw->nphsp = 0;
+}
@@ -0,0 +1,381 @@
+#include <math.h>
+
+#include "common/osh_const.h"
+#include "scoring/_osh_scoring.h"
+#include "scoring/osh_scoring.h"
+#include "transport/osh_transport.h"
+
+#define NEVENT 64 /* crossings collected before a part of a step is split in halves */
+#define EPS 1e-12 /* relative tolerance of angles and degenerate lines */
+
+/* a step relative to the center, x(t) = p + t d for t in [0, 1] */
+struct line {
+    double p[3];
+    double d[3];
+    double a, b, c; /* squared distance to the axis (cylinder) or center (sphere) is a t^2 + b t + c */
+    double tm;      /* where it is smallest */
+    double smin;    /* and its value there */
+};
+
+/* crossings within a part (ta, tb) of the step, unordered */
+struct events {
+    double t[NEVENT];
+    int n;
+    int full; /* some did not fit */
+};
+
+static void _event(struct events *ev, double t, double ta, double tb) {
+    if (!(t > ta && t < tb))
+        return;
+    if (ev->n == NEVENT) {
+        ev->full = 1;
+        return;
+    }
+    ev->t[ev->n++] = t;
+}
+
+static double _s(struct line const *l, double t) {
+    return (l->a * t + l->b) * t + l->c;
+}
+
+/* azimuth of x in [0, 2 pi) */
+static double _phi(double const *x) {
+    double phi = atan2(x[1], x[0]);
+
+    return (phi < 0.0) ? phi + 2.0 * OSH_M_PI : phi;
+}
+
+/* bin and 1 / volume at x relative to the center, returns 0 outside the mesh */
+static int _bin(struct scoring_geo const *g, double const *x, size_t *bin, double *inv_vol) {
+    struct scoring_mesh const *m = &g->mesh;
+    double u[3], r, z;
+    size_t i[3];
+    int a;
+
+    if (g->type == OSH_SCORING_GEO_CYL) {
+        u[0] = hypot(x[0], x[1]);
+        u[1] = _phi(x);
+        u[2] = x[2];
+    } else {
+        r = sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+        z = (r > 0.0) ? x[2] / r : 1.0;
+        u[0] = r;
+        u[1] = acos((z > 1.0) ? 1.0 : (z < -1.0) ? -1.0 : z);
+        u[2] = _phi(x);
+        /* the -z axis belongs to the last polar bin when that closes the sphere */
+        if (u[1] >= m->x1[1] && m->x1[1] >= OSH_M_PI * (1.0 - EPS))
+            u[1] = m->x1[1] - 0.5 / m->inv_d[1];
+    }
+    for (a = 0; a < 3; a++) {
+        u[a] = (u[a] - m->x0[a]) * m->inv_d[a];
+        if (!(u[a] >= 0.0 && u[a] < (double) m->n[a]))
+            return 0;
+        i[a] = (size_t) u[a];
+    }
+    *bin = i[0] + m->n[0] * (i[1] + m->n[1] * i[2]);
+    *inv_vol = (g->type == OSH_SCORING_GEO_CYL) ? m->ivol[i[0]] : m->ivol[i[0] + m->n[0] * i[1]];
+    return 1;
+}
+
+/* first and last boundary k / inv_d of an axis with edges in [lo, hi], returns 0 if there are none */
+static int _range(struct scoring_mesh const *m, int ax, double lo, double hi, size_t *k0, size_t *k1) {
+    double u0 = ceil((lo - m->x0[ax]) * m->inv_d[ax]);
+    double u1 = floor((hi - m->x0[ax]) * m->inv_d[ax]);
+
+    if (u0 < 0.0)
+        u0 = 0.0;
+    if (u1 > (double) m->n[ax])
+        u1 = (double) m->n[ax];
+    if (!(u0 <= u1))
+        return 0;
+    *k0 = (size_t) u0;
+    *k1 = (size_t) u1;
+    return 1;
+}
+
+/* crossings of the cylinders or spheres of radius x0 + k / inv_d */
+static void _r_events(struct scoring_mesh const *m, struct line const *l, double ta, double tb, struct events *ev) {
+    double t, s0, s1, r, h;
+    size_t k, k0, k1;
+
+    if (!(l->a > 0.0))
+        return;
+    t = (l->tm < ta) ? ta : (l->tm > tb) ? tb : l->tm;
+    s0 = _s(l, ta);
+    s1 = _s(l, tb);
+    if (!_range(m, 0, sqrt(fmax(_s(l, t), 0.0)), sqrt(fmax(fmax(s0, s1), 0.0)), &k0, &k1))
+        return;
+    for (k = k0; k <= k1; k++) {
+        r = m->x0[0] + (double) k / m->inv_d[0];
+        if (r <= 0.0)
+            continue;
+        h = sqrt(fmax(r * r - l->smin, 0.0) / l->a);
+        _event(ev, l->tm - h, ta, tb);
+        _event(ev, l->tm + h, ta, tb);
+    }
+}
+
+/* crossings of the planes z = x0 + k / inv_d of the cylinder */
+static void _z_events(struct scoring_mesh const *m, struct line const *l, double ta, double tb, struct events *ev) {
+    double za, zb;
+    size_t k, k0, k1;
+
+    if (l->d[2] == 0.0)
+        return;
+    za = l->p[2] + ta * l->d[2];
+    zb = l->p[2] + tb * l->d[2];
+    if (!_range(m, 2, fmin(za, zb), fmax(za, zb), &k0, &k1))
+        return;
+    for (k = k0; k <= k1; k++)
+        _event(ev, (m->x0[2] + (double) k / m->inv_d[2] - l->p[2]) / l->d[2], ta, tb);
+}
+
+/*
+ * Crossings of the half planes phi = x0 + k / inv_d of axis ax. Seen from
+ * the z axis a straight line sweeps less than pi, so every half plane within
+ * the sweep is crossed once, and the full plane it belongs to tells where.
+ */
+static void _phi_events(struct scoring_mesh const *m,
+                        int ax,
+                        struct line const *l,
+                        double ta,
+                        double tb,
+                        struct events *ev) {
+    double xa[2], xb[2], ua, ub, u, u0, u1, v, beta, den, axy, cross;
+    double width = m->x1[ax] - m->x0[ax];
+    double twopi = 2.0 * OSH_M_PI;
+    int a;
+
+    if (m->n[ax] == 1 && width >= twopi * (1.0 - EPS))
+        return;
+    for (a = 0; a < 2; a++) {
+        xa[a] = l->p[a] + ta * l->d[a];
+        xb[a] = l->p[a] + tb * l->d[a];
+    }
+
+    /* a line through the axis jumps by pi where it meets it */
+    axy = l->d[0] * l->d[0] + l->d[1] * l->d[1];
+    cross = l->p[0] * l->d[1] - l->p[1] * l->d[0];
+    if (axy > 0.0 && cross * cross <= EPS * EPS * axy * (l->p[0] * l->p[0] + l->p[1] * l->p[1] + axy)) {
+        _event(ev, -(l->p[0] * l->d[0] + l->p[1] * l->d[1]) / axy, ta, tb);
+        return;
+    }
+
+    /* sweep from ua to ub, as angles from x0 unwrapped, and the boundaries j / inv_d within it */
+    ua = fmod(_phi(xa) - m->x0[ax], twopi);
+    if (ua < 0.0)
+        ua += twopi;
+    ub = ua + atan2(xa[0] * xb[1] - xa[1] * xb[0], xa[0] * xb[0] + xa[1] * xb[1]);
+    u0 = ceil(fmin(ua, ub) * m->inv_d[ax]);
+    u1 = floor(fmax(ua, ub) * m->inv_d[ax]);
+    for (u = u0; u <= u1; u += 1.0) {
+        /* only the edges of the mesh, the unwrapped angle may be beyond them */
+        v = u / m->inv_d[ax];
+        beta = fmod(v, twopi);
+        if (beta < 0.0)
+            beta += twopi;
+        if (beta > width * (1.0 + EPS) && beta < twopi * (1.0 - EPS))
+            continue;
+        beta = m->x0[ax] + v;
+        den = cos(beta) * l->d[1] - sin(beta) * l->d[0];
+        if (den != 0.0)
+            _event(ev, (sin(beta) * l->p[0] - cos(beta) * l->p[1]) / den, ta, tb);
+    }
+}
+
+/* polar angle at t, -1 at the center */
+static double _theta(struct line const *l, double t) {
+    double s = _s(l, t);
+    double z;
+
+    if (!(s > 0.0))
+        return -1.0;
+    z = (l->p[2] + t * l->d[2]) / sqrt(s);
+    return acos((z > 1.0) ? 1.0 : (z < -1.0) ? -1.0 : z);
+}
+
+/*
+ * Crossings of the cones theta = x0 + k / inv_d of the sphere. On a cone
+ * z^2 = cos^2 theta r^2, a quadratic in t, on the side of the xy plane
+ * given by the sign of cos theta. Along a line the polar angle has at most
+ * one extremum, which bounds the cones to try.
+ */
+static void _theta_events(struct scoring_mesh const *m,
+                          struct line const *l,
+                          double ta,
+                          double tb,
+                          struct events *ev) {
+    double pz = l->p[2], dz = l->d[2];
+    double lo, hi, th, ct, c2, qa, qb, qc, disc, q, den, t[2];
+    size_t k, k0, k1;
+    int i, nt;
+
+    if (m->n[1] == 1 && m->x0[1] <= EPS && m->x1[1] >= OSH_M_PI * (1.0 - EPS))
+        return;
+
+    /* a line through the center flips to the opposite angle there */
+    if (l->a > 0.0 && l->smin <= EPS * EPS * (l->c + l->a)) {
+        _event(ev, l->tm, ta, tb);
+        return;
+    }
+
+    lo = _theta(l, ta);
+    hi = _theta(l, tb);
+    if (lo > hi) {
+        th = lo;
+        lo = hi;
+        hi = th;
+    }
+    den = dz * 0.5 * l->b - pz * l->a;
+    if (den != 0.0) {
+        th = (pz * 0.5 * l->b - dz * l->c) / den;
+        if (th > ta && th < tb) {
+            th = _theta(l, th);
+            lo = fmin(lo, th);
+            hi = fmax(hi, th);
+        }
+    }
+    if (lo < 0.0) {
+        lo = 0.0;
+        hi = OSH_M_PI;
+    }
+    if (!_range(m, 1, lo, hi, &k0, &k1))
+        return;
+
+    for (k = k0; k <= k1; k++) {
+        th = m->x0[1] + (double) k / m->inv_d[1];
+        if (th <= OSH_M_PI * EPS || th >= OSH_M_PI * (1.0 - EPS))
+            continue;
+        ct = cos(th);
+        c2 = ct * ct;
+        qa = dz * dz - c2 * l->a;
+        qb = 2.0 * pz * dz - c2 * l->b;
+        qc = pz * pz - c2 * l->c;
+        nt = 0;
+        if (fabs(qa) <= EPS * (dz * dz + c2 * l->a)) {
+            if (qb != 0.0)
+                t[nt++] = -qc / qb;
+        } else {
+            disc = sqrt(fmax(qb * qb - 4.0 * qa * qc, 0.0));
+            q = -0.5 * (qb + ((qb < 0.0) ? -disc : disc));
+            t[nt++] = q / qa;
+            if (q != 0.0)
+                t[nt++] = qc / q;
+        }
+        for (i = 0; i < nt; i++)
+            if ((pz + t[i] * dz) * ct >= 0.0)
+                _event(ev, t[i], ta, tb);
+    }
+}
+
+static void _sort(double *x, int n) {
+    double y;
+    int i, j;
+
+    for (i = 1; i < n; i++) {
+        y = x[i];
+        for (j = i; j > 0 && x[j - 1] > y; j--)
+            x[j] = x[j - 1];
+        x[j] = y;
+    }
+}
+
+/* score the part (ta, tb) of the step, cut at every crossing */
+static void _part(struct scoring_buffer *buf,
+                  struct scoring_geo const *g,
+                  struct scoring_step const *s,
+                  struct line const *l,
+                  double ta,
+                  double tb) {
+    struct scoring_mesh const *m = &g->mesh;
+    struct events ev;
+    double t, tn, tc, x[3], inv_vol;
+    size_t bin;
+    int i, a;
+
+    ev.n = 0;
+    ev.full = 0;
+    _r_events(m, l, ta, tb, &ev);
+    if (g->type == OSH_SCORING_GEO_CYL) {
+        _phi_events(m, 1, l, ta, tb, &ev);
+        _z_events(m, l, ta, tb, &ev);
+    } else {
+        _theta_events(m, l, ta, tb, &ev);
+        _phi_events(m, 2, l, ta, tb, &ev);
+    }
+    /* crossings which coincide, as cones through the center, cannot be split apart */
+    if (ev.full && tb - ta > EPS) {
+        tc = 0.5 * (ta + tb);
+        _part(buf, g, s, l, ta, tc);
+        _part(buf, g, s, l, tc, tb);
+        return;
+    }
+    _sort(ev.t, ev.n);
+
+    t = ta;
+    for (i = 0; i <= ev.n; i++) {
+        tn = (i < ev.n) ? ev.t[i] : tb;
+        if (!(tn > t))
+            continue;
+        tc = 0.5 * (t + tn);
+        for (a = 0; a < 3; a++)
+            x[a] = l->p[a] + tc * l->d[a];
+        if (_bin(g, x, &bin, &inv_vol))
+            _osh_scoring_add(buf, g, s, bin, (tn - t) * s->st->ds, (tn - t) * s->st->de, inv_vol);
+        t = tn;
+    }
+}
+
+void _osh_scoring_radial(struct scoring_buffer *buf, struct scoring_geo const *g, struct scoring_step const *s) {
+    struct scoring_mesh const *m = &g->mesh;
+    struct step const *st = s->st;
+    struct line l;
+    double ta, tb, h, r;
+    size_t bin;
+    int a, na;
+
+    for (a = 0; a < 3; a++) {
+        l.p[a] = st->p[a] - m->c[a];
+        l.d[a] = st->q[a] - st->p[a];
+    }
+    if (st->ds <= 0.0) {
+        if (_bin(g, l.p, &bin, &h))
+            _osh_scoring_add(buf, g, s, bin, st->ds, st->de, h);
+        return;
+    }
+
+    na = (g->type == OSH_SCORING_GEO_CYL) ? 2 : 3;
+    l.a = l.b = l.c = 0.0;
+    for (a = 0; a < na; a++) {
+        l.a += l.d[a] * l.d[a];
+        l.b += 2.0 * l.p[a] * l.d[a];
+        l.c += l.p[a] * l.p[a];
+    }
+    l.tm = (l.a > 0.0) ? -0.5 * l.b / l.a : 0.0;
+    l.smin = fmax(_s(&l, l.tm), 0.0);
+
+    /* clip to the outer radius, and a cylinder to its length */
+    ta = 0.0;
+    tb = 1.0;
+    r = m->x1[0];
+    if (l.smin > r * r)
+        return;
+    if (l.a > 0.0) {
+        h = sqrt((r * r - l.smin) / l.a);
+        ta = fmax(ta, l.tm - h);
+        tb = fmin(tb, l.tm + h);
+    }
+    if (g->type == OSH_SCORING_GEO_CYL) {
+        if (l.d[2] == 0.0) {
+            if (!(l.p[2] >= m->x0[2] && l.p[2] < m->x1[2]))
+                return;
+        } else {
+            ta = fmax(ta, fmin((m->x0[2] - l.p[2]) / l.d[2], (m->x1[2] - l.p[2]) / l.d[2]));
+            tb = fmin(tb, fmax((m->x0[2] - l.p[2]) / l.d[2], (m->x1[2] - l.p[2]) / l.d[2]));
+        }
+    }
+    if (!(ta < tb))
+        return;
+
+    _part(buf, g, s, &l, ta, tb);
+}
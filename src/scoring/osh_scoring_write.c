@@ -0,0 +1,418 @@
+#include "scoring/osh_scoring.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_atomic.h"
+#include "common/osh_const.h"
+#include "common/osh_logger.h"
+#include "common/osh_rc.h"
+#include "io/osh_bdo.h"
+#include "io/osh_partial.h"
+#include "scoring/_osh_scoring.h"
+
+#ifndef OSH_VERSION
+#define OSH_VERSION "unknown"
+#endif
+
+/* a result to write, the merged one or a snapshot, in blocks */
+struct wresult {
+    double *const *sum;
+    double *const *sum2;
+    uint64_t nprim;
+    size_t offset; /* first bin of the page being written */
+    size_t nw;     /* LET: bins of the numerators, the weights follow */
+};
+
+/* fills of the streamed records, first is the bin within the page */
+static void _fill_mean(void *data, size_t first, size_t n, double *x) {
+    struct wresult const *r = data;
+    double f = (r->nprim > 0) ? 1.0 / (double) r->nprim : 1.0;
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        x[i] = _osh_scoring_get(r->sum, r->offset + first + i) * f;
+}
+
+static void _fill_err(void *data, size_t first, size_t n, double *x) {
+    struct wresult const *r = data;
+
+    _osh_scoring_stderr(r->sum, r->sum2, r->nprim, r->offset + first, n, x);
+}
+
+/* LET averaged over all histories, 0 where nothing was scored */
+static void _fill_let(void *data, size_t first, size_t n, double *x) {
+    struct wresult const *r = data;
+    double w;
+    size_t i, b;
+
+    for (i = 0; i < n; i++) {
+        b = r->offset + first + i;
+        w = _osh_scoring_get(r->sum, b + r->nw);
+        x[i] = (w > 0.0) ? _osh_scoring_get(r->sum, b) / w : 0.0;
+    }
+}
+
+/* the result seen from a page */
+static void _page_result(struct wresult const *r, struct scoring_page const *pg, size_t nw, struct wresult *p) {
+    *p = *r;
+    p->offset = pg->offset;
+    p->nw = nw;
+}
+
+/* names of the filters of a page, separated by blanks */
+static void _filter_names(struct scoring_workspace const *sw, uint64_t fmask, char *s) {
+    uint64_t m;
+    int i;
+
+    s[0] = '\0';
+    for (m = fmask; m; m &= m - 1) {
+        i = osh_scoring_ctz64(m);
+        if (s[0])
+            strcat(s, " ");
+        strcat(s, sw->filters[i].name);
+    }
+}
+
+static void _write_mesh(struct osh_bdo_writer *w, struct scoring_geo const *g) {
+    int64_t n[3];
+    double lo[3], hi[3];
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        n[i] = (int64_t) g->mesh.n[i];
+        lo[i] = g->mesh.x0[i];
+        hi[i] = g->mesh.x1[i];
+        /* angles in degrees, as in detect.dat */
+        if ((g->type == OSH_SCORING_GEO_CYL && i == 1) || (g->type == OSH_SCORING_GEO_SPH && i > 0)) {
+            lo[i] /= OSH_M_PI_180;
+            hi[i] /= OSH_M_PI_180;
+        }
+    }
+    osh_bdo_i64(w, OSH_BDO_TAG_GEO_N, n, 3);
+    osh_bdo_f64(w, OSH_BDO_TAG_GEO_MIN, lo, 3);
+    osh_bdo_f64(w, OSH_BDO_TAG_GEO_MAX, hi, 3);
+    if (g->type != OSH_SCORING_GEO_MESH)
+        osh_bdo_f64(w, OSH_BDO_TAG_GEO_CENTER, g->mesh.c, 3);
+}
+
+static void _write_zones(struct osh_bdo_writer *w, struct scoring_zone const *z) {
+    int64_t *ids;
+    size_t i;
+
+    ids = malloc(z->n * sizeof(*ids));
+    if (!ids) {
+        if (w->rc == OSH_OK)
+            w->rc = OSH_ENOMEM; /* the file is dropped on close */
+        return;
+    }
+    for (i = 0; i < z->n; i++)
+        ids[i] = (int64_t) z->ids[i];
+    osh_bdo_i64(w, OSH_BDO_TAG_GEO_ZONES, ids, z->n);
+    free(ids);
+}
+
+static int _write_output(struct scoring_workspace const *sw, size_t k, struct wresult const *r) {
+    struct scoring_output const *o = &sw->outputs[k];
+    struct scoring_geo const *g = &sw->geos[o->geo];
+    struct scoring_page const *pg;
+    struct osh_bdo_writer w;
+    struct wresult p;
+    char names[OSH_SCORING_MAXFILTER * OSH_SCORING_NAMELEN];
+    int64_t x[1];
+    double e[3];
+    size_t i;
+    int rc;
+
+    rc = osh_bdo_open(&w, o->filename, sw->codec);
+    if (rc != OSH_OK)
+        return rc;
+
+    osh_bdo_str(&w, OSH_BDO_TAG_VERSION, OSH_VERSION);
+    x[0] = (int64_t) r->nprim;
+    osh_bdo_i64(&w, OSH_BDO_TAG_NPRIM, x, 1);
+
+    x[0] = g->type;
+    osh_bdo_i64(&w, OSH_BDO_TAG_GEO_TYPE, x, 1);
+    osh_bdo_str(&w, OSH_BDO_TAG_GEO_NAME, g->name);
+    if (g->type == OSH_SCORING_GEO_ZONE)
+        _write_zones(&w, &g->zone);
+    else
+        _write_mesh(&w, g);
+
+    for (i = o->page; i < o->page + o->npages; i++) {
+        pg = &sw->pages[i];
+        x[0] = pg->quantity;
+        osh_bdo_i64(&w, OSH_BDO_TAG_PAGE, x, 1);
+        if (pg->fmask) {
+            _filter_names(sw, pg->fmask, names);
+            osh_bdo_str(&w, OSH_BDO_TAG_PAGE_FILTER, names);
+        }
+        if (pg->quantity == OSH_SCORING_QTY_SPECTRUM) {
+            e[0] = pg->emin;
+            e[1] = pg->emax;
+            e[2] = (double) pg->ne;
+            osh_bdo_f64(&w, OSH_BDO_TAG_PAGE_EAXIS, e, 3);
+        }
+        if (pg->quantity == OSH_SCORING_QTY_LETT || pg->quantity == OSH_SCORING_QTY_LETD) {
+            /* a ratio of sums, no error */
+            _page_result(r, pg, g->nbins, &p);
+            osh_bdo_f64_stream(&w, OSH_BDO_TAG_PAGE_DATA, g->nbins, _fill_let, &p);
+            continue;
+        }
+        _page_result(r, pg, 0, &p);
+        osh_bdo_f64_stream(&w, OSH_BDO_TAG_PAGE_DATA, pg->nbins, _fill_mean, &p);
+        osh_bdo_f64_stream(&w, OSH_BDO_TAG_PAGE_ERROR, pg->nbins, _fill_err, &p);
+    }
+
+    return osh_bdo_close(&w);
+}
+
+/* write all outputs, returns the first error */
+static int _write(struct scoring_workspace const *sw, struct wresult const *r) {
+    size_t i;
+    int rc, rc1;
+
+    rc = OSH_OK;
+    for (i = 0; i < sw->noutputs; i++) {
+        /* phase-space files are streamed by merging */
+        if (sw->pages[sw->outputs[i].page].quantity == OSH_SCORING_QTY_PHSP)
+            continue;
+        rc1 = _write_output(sw, i, r);
+        if (rc == OSH_OK)
+            rc = rc1;
+    }
+    return rc;
+}
+
+/* wait for the last snapshot and log what became of the snapshots */
+static void _snapshot_finish(struct scoring_workspace *sw) {
+    osh_thread_join(&sw->snap.th);
+    if (sw->snap.nskip > 0)
+        osh_info("%lu snapshots skipped while the previous one was written\n", (unsigned long) sw->snap.nskip);
+    if (sw->snap.rc != OSH_OK)
+        osh_warn("snapshots failed: %s\n", osh_strerr(sw->snap.rc));
+}
+
+int osh_scoring_write(struct scoring_workspace *sw) {
+    struct wresult r;
+    int rc, rc1;
+
+    _snapshot_finish(sw);
+    r.sum = sw->sum;
+    r.sum2 = sw->sum2;
+    r.nprim = sw->nprim;
+    r.offset = r.nw = 0;
+    rc = _write(sw, &r);
+    rc1 = _osh_scoring_phsp_close(sw);
+    return (rc != OSH_OK) ? rc : rc1;
+}
+
+/* fills of the blocks of a partial result */
+static void _fill_sum(void *data, size_t first, size_t n, double *x) {
+    struct wresult const *r = data;
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        x[i] = _osh_scoring_get(r->sum, r->offset + first + i);
+}
+
+static void _fill_sum2(void *data, size_t first, size_t n, double *x) {
+    struct wresult const *r = data;
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        x[i] = _osh_scoring_get(r->sum2, r->offset + first + i);
+}
+
+/* name of the block of a page in a partial result */
+static void _partial_name(size_t page, char *name) {
+    snprintf(name, OSH_PARTIAL_NAMELEN, "page %lu", (unsigned long) page);
+}
+
+int osh_scoring_write_partial(struct scoring_workspace *sw, const char *path) {
+    struct osh_partial_writer w;
+    struct wresult r, p;
+    char name[OSH_PARTIAL_NAMELEN];
+    size_t i, nb;
+    int rc, rc1;
+
+    _snapshot_finish(sw);
+    r.sum = sw->sum;
+    r.sum2 = sw->sum2;
+    r.nprim = sw->nprim;
+    r.offset = r.nw = 0;
+
+    nb = 0;
+    for (i = 0; i < sw->npages; i++)
+        if (sw->pages[i].quantity != OSH_SCORING_QTY_PHSP)
+            nb++;
+
+    rc = osh_partial_open(&w, path, sw->nprim, nb);
+    if (rc == OSH_OK) {
+        for (i = 0; i < sw->npages; i++) {
+            if (sw->pages[i].quantity == OSH_SCORING_QTY_PHSP)
+                continue;
+            _page_result(&r, &sw->pages[i], 0, &p);
+            _partial_name(i, name);
+            osh_partial_block(&w, name, sw->pages[i].nbins, _fill_sum, _fill_sum2, &p);
+        }
+        rc = osh_partial_close(&w);
+    }
+    rc1 = _osh_scoring_phsp_close(sw);
+    return (rc != OSH_OK) ? rc : rc1;
+}
+
+/* set a bin of the merged result, allocating its block */
+static int _set(struct scoring_workspace *sw, size_t bin, double sum, double sum2) {
+    size_t b = bin >> OSH_SCORING_BLOCK_SHIFT;
+
+    if (!sw->sum[b]) {
+        if (sum == 0.0 && sum2 == 0.0)
+            return OSH_OK;
+        sw->sum[b] = calloc(OSH_SCORING_BLOCK, sizeof(**sw->sum));
+        sw->sum2[b] = calloc(OSH_SCORING_BLOCK, sizeof(**sw->sum2));
+        if (!sw->sum[b] || !sw->sum2[b]) {
+            free(sw->sum[b]);
+            free(sw->sum2[b]);
+            sw->sum[b] = sw->sum2[b] = NULL;
+            return OSH_ENOMEM;
+        }
+    }
+    sw->sum[b][bin & (OSH_SCORING_BLOCK - 1)] = sum;
+    sw->sum2[b][bin & (OSH_SCORING_BLOCK - 1)] = sum2;
+    return OSH_OK;
+}
+
+int osh_scoring_read_partial(struct scoring_workspace *sw, const char *path) {
+    struct osh_partial_block *b;
+    struct scoring_page const *pg;
+    char name[OSH_PARTIAL_NAMELEN];
+    uint64_t nprim;
+    size_t nb, i, j, k;
+    int rc;
+
+    rc = osh_partial_read(path, &nprim, &b, &nb);
+    if (rc != OSH_OK)
+        return rc;
+
+    /* one block per page, as written by osh_scoring_write_partial() */
+    k = 0;
+    for (i = 0; i < sw->npages && rc == OSH_OK; i++) {
+        pg = &sw->pages[i];
+        if (pg->quantity == OSH_SCORING_QTY_PHSP)
+            continue;
+        _partial_name(i, name);
+        if (k == nb || strcmp(b[k].name, name) != 0 || b[k].n != pg->nbins || !b[k].sum2)
+            rc = OSH_EINVAL;
+        k++;
+    }
+    if (rc == OSH_OK && k != nb)
+        rc = OSH_EINVAL;
+    if (rc != OSH_OK) {
+        osh_partial_free(b, nb);
+        return rc;
+    }
+
+    /* phase-space files are complete as the jobs wrote them */
+    _osh_scoring_phsp_free(sw);
+
+    for (i = 0; i < sw->nblk; i++) {
+        if (sw->sum[i]) {
+            memset(sw->sum[i], 0, OSH_SCORING_BLOCK * sizeof(**sw->sum));
+            memset(sw->sum2[i], 0, OSH_SCORING_BLOCK * sizeof(**sw->sum2));
+        }
+    }
+    k = 0;
+    for (i = 0; i < sw->npages && rc == OSH_OK; i++) {
+        pg = &sw->pages[i];
+        if (pg->quantity == OSH_SCORING_QTY_PHSP)
+            continue;
+        for (j = 0; j < pg->nbins && rc == OSH_OK; j++)
+            rc = _set(sw, pg->offset + j, b[k].sum[j], b[k].sum2[j]);
+        k++;
+    }
+    sw->nprim = nprim;
+
+    osh_partial_free(b, nb);
+    return rc;
+}
+
+static void _snapshot_write(void *arg) {
+    struct scoring_snapshot *s = arg;
+    struct wresult r;
+    int rc;
+
+    r.sum = s->sum;
+    r.sum2 = s->sum2;
+    r.nprim = s->nprim;
+    r.offset = r.nw = 0;
+    rc = _write(s->sw, &r);
+    if (rc != OSH_OK) {
+        osh_warn("snapshot of %llu primaries not written: %s\n", (unsigned long long) s->nprim, osh_strerr(rc));
+        if (s->rc == OSH_OK)
+            s->rc = rc;
+    }
+    osh_atomic_store(&s->busy, 0);
+}
+
+int osh_scoring_snapshot(struct scoring_workspace *sw) {
+    struct scoring_snapshot *s = &sw->snap;
+    size_t b;
+
+    if (osh_atomic_load(&s->busy)) {
+        s->nskip++;
+        return OSH_ESTATE;
+    }
+    osh_thread_join(&s->th);
+
+    if (!s->sum) {
+        s->sum = calloc(sw->nblk + 1, sizeof(*s->sum));
+        s->sum2 = calloc(sw->nblk + 1, sizeof(*s->sum2));
+        if (!s->sum || !s->sum2) {
+            free(s->sum);
+            free(s->sum2);
+            s->sum = s->sum2 = NULL;
+            return OSH_ENOMEM;
+        }
+        s->nblk = sw->nblk;
+    }
+    /* only the blocks of the result, a block once scored stays */
+    for (b = 0; b < sw->nblk; b++) {
+        if (!sw->sum[b])
+            continue;
+        if (!s->sum[b]) {
+            s->sum[b] = malloc(OSH_SCORING_BLOCK * sizeof(**s->sum));
+            s->sum2[b] = malloc(OSH_SCORING_BLOCK * sizeof(**s->sum2));
+            if (!s->sum[b] || !s->sum2[b]) {
+                free(s->sum[b]);
+                free(s->sum2[b]);
+                s->sum[b] = s->sum2[b] = NULL;
+                return OSH_ENOMEM;
+            }
+        }
+        memcpy(s->sum[b], sw->sum[b], OSH_SCORING_BLOCK * sizeof(**s->sum));
+        memcpy(s->sum2[b], sw->sum2[b], OSH_SCORING_BLOCK * sizeof(**s->sum2));
+    }
+    s->nprim = sw->nprim;
+    s->sw = sw;
+
+    osh_atomic_store(&s->busy, 1);
+    osh_thread_start(&s->th, _snapshot_write, s);
+    return OSH_OK;
+}
+
+void _osh_scoring_snapshot_free(struct scoring_snapshot *s) {
+    size_t b;
+
+    osh_thread_join(&s->th);
+    if (s->sum)
+        for (b = 0; b < s->nblk; b++) {
+            free(s->sum[b]);
+            free(s->sum2[b]);
+        }
+    free(s->sum);
+    free(s->sum2);
+    memset(s, 0, sizeof(*s));
+}
@@ -0,0 +1,126 @@
+#ifndef _OSH_TRANSPORT_STEP
+#define _OSH_TRANSPORT_STEP
+
+/*
+ * Step helpers shared by the history based and the event based transport
+ * loops, so both modes make identical steps. Internal to src/transport.
+ */
+
+#include <string.h>
+
+#include "gemca/osh_gemca2.h"
+#include "particle/osh_particle.h"
+#include "transport/osh_transport.h"
+#include "transport/osh_transport_engine.h"
+
+/* zone containing the point p, NULL outside all zones */
+static inline struct zone *_locate(struct gemca_workspace *g, double const p[3], double const v[3]) {
+    struct ray r;
+    size_t id;
+
+    memcpy(r.p, p, sizeof(r.p));
+    memcpy(r.cp, v, sizeof(r.cp));
+    r.system = 1;
+
+    id = osh_gemca_zone(*g, r);
+    if (id == 0)
+        return NULL;
+    return g->zones[id - 1]; /* zone IDs start at 1 */
+}
+
+/* medium and density of zone z, black hole outside all zones */
+static inline void _zone_medium(struct transport_workspace const *tw, struct zone const *z, int *medium, double *rho) {
+    if (!z) {
+        *medium = OSH_TRANSPORT_MEDIUM_BLACKHOLE;
+        *rho = 0.0;
+        return;
+    }
+    *medium = (int) z->medium;
+    if (*medium == OSH_TRANSPORT_MEDIUM_BLACKHOLE || *medium == OSH_TRANSPORT_MEDIUM_VACUUM)
+        *rho = 0.0;
+    else
+        *rho = tw->phys.density(tw->phys.data, *medium);
+}
+
+/* kinetic energy cutoff of a particle [MeV] */
+static inline double _ecut(struct transport_workspace const *tw, struct particle const *part) {
+    return tw->tcut * ((part->a > 1) ? (double) part->a : 1.0);
+}
+
+/*
+ * Length ds and mean energy loss de of the next step at energy e > 0, with
+ * dgeo the distance to the zone boundary. Returns 1 if the step ends on the
+ * boundary. The mean energy loss is exact from the CSDA range hooks if
+ * given, else it uses the stopping power at mid-step energy.
+ */
+static inline int _step_length(struct transport_workspace const *tw,
+                               struct particle const *part,
+                               int medium,
+                               double rho,
+                               double e,
+                               double dgeo,
+                               double *ds,
+                               double *de) {
+    struct transport_physics const *ph = &tw->phys;
+    double dedx, demax;
+    double s, d, r;
+    int cross;
+
+    s = dgeo;
+    d = 0.0;
+    cross = 1;
+    if (medium != OSH_TRANSPORT_MEDIUM_VACUUM) {
+        dedx = ph->dedx(ph->data, part, medium, e) * rho;
+        demax = tw->deltae * e;
+        if (demax < tw->demin)
+            demax = tw->demin;
+        if (dedx * dgeo > demax) {
+            s = demax / dedx;
+            cross = 0;
+        }
+        if (ph->range && dedx > 0.0) {
+            r = ph->range(ph->data, part, medium, e);
+            d = (rho * s < r) ? e - ph->erange(ph->data, part, medium, r - rho * s) : e;
+            if (d < 0.0)
+                d = 0.0;
+            if (d >= e) /* exactly at the end of the range */
+                s = r / rho;
+        } else {
+            d = dedx * s;
+            if (d < e)
+                d = ph->dedx(ph->data, part, medium, e - 0.5 * d) * rho * s;
+            if (d >= e) /* the particle stops within this step */
+                s *= e / d;
+        }
+        if (d >= e) {
+            d = e;
+            cross = 0;
+        }
+    }
+
+    *ds = s;
+    *de = d;
+    return cross;
+}
+
+/* apply the straggling hook to a step holding the mean energy loss, returns the energy loss */
+static inline double _step_eloss(struct transport_workspace const *tw,
+                                 struct particle const *part,
+                                 struct step *st,
+                                 struct osh_rng *rng) {
+    double de;
+
+    de = st->de;
+    if (tw->phys.eloss && de > 0.0) {
+        de = tw->phys.eloss(tw->phys.data, part, st, rng);
+        if (de < 0.0)
+            de = 0.0;
+        if (de > st->p[3])
+            de = st->p[3];
+        st->de = de;
+    }
+    st->q[3] = st->p[3] - de;
+    return de;
+}
+
+#endif /* !_OSH_TRANSPORT_STEP */
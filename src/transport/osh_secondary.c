@@ -0,0 +1,169 @@
+#include "transport/osh_secondary.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_atomic.h"
+
+int osh_secondary_stack_init(struct secondary_stack *s, size_t capacity) {
+    memset(s, 0, sizeof(*s));
+    while (s->cap < capacity) {
+        if (osh_secondary_stack_grow(s) != OSH_OK) {
+            osh_secondary_stack_free(s);
+            return OSH_ENOMEM;
+        }
+    }
+    return OSH_OK;
+}
+
+void osh_secondary_stack_free(struct secondary_stack *s) {
+    size_t i;
+
+    for (i = 0; i < s->nchunk; i++)
+        free(s->chunk[i]);
+    free(s->chunk);
+    memset(s, 0, sizeof(*s));
+}
+
+int osh_secondary_stack_grow(struct secondary_stack *s) {
+    struct secondary **list;
+    size_t m;
+
+    if (s->nchunk == s->maxchunk) {
+        m = s->maxchunk ? 2 * s->maxchunk : 8;
+        list = realloc(s->chunk, m * sizeof(*list));
+        if (!list)
+            return OSH_ENOMEM;
+        s->chunk = list;
+        s->maxchunk = m;
+    }
+
+    s->chunk[s->nchunk] = malloc(OSH_SECONDARY_CHUNK * sizeof(struct secondary));
+    if (!s->chunk[s->nchunk])
+        return OSH_ENOMEM;
+    s->nchunk++;
+    s->cap += OSH_SECONDARY_CHUNK;
+
+    return OSH_OK;
+}
+
+static struct secondary_ring *ring_alloc(int64_t size) {
+    struct secondary_ring *r;
+
+    r = malloc(sizeof(*r) + (size_t) size * sizeof(struct secondary));
+    if (!r)
+        return NULL;
+    r->prev = NULL;
+    r->mask = size - 1;
+    return r;
+}
+
+int osh_secondary_deque_init(struct secondary_deque *d, size_t capacity) {
+    int64_t size;
+
+    memset(d, 0, sizeof(*d));
+    size = 64;
+    while ((size_t) size < capacity)
+        size *= 2;
+
+    d->ring = ring_alloc(size);
+    if (!d->ring)
+        return OSH_ENOMEM;
+
+    return OSH_OK;
+}
+
+void osh_secondary_deque_free(struct secondary_deque *d) {
+    struct secondary_ring *r;
+    struct secondary_ring *prev;
+
+    for (r = d->ring; r; r = prev) {
+        prev = r->prev;
+        free(r);
+    }
+    d->ring = NULL;
+    d->top = 0;
+    d->bottom = 0;
+}
+
+int osh_secondary_deque_push(struct secondary_deque *d, struct secondary const *x) {
+    struct secondary_ring *r;
+    struct secondary_ring *big;
+    int64_t b, t, i;
+
+    b = osh_atomic_load_relaxed(&d->bottom);
+    t = osh_atomic_load(&d->top);
+    r = d->ring; /* only the owner writes ring */
+
+    if (b - t > r->mask) {
+        /* full: copy the live entries into a buffer of twice the size. The old one is kept,
+           thieves which loaded it before the switch still read valid entries from it. */
+        big = ring_alloc(2 * (r->mask + 1));
+        if (!big)
+            return OSH_ENOMEM;
+        for (i = t; i < b; i++)
+            big->item[i & big->mask] = r->item[i & r->mask];
+        big->prev = r;
+        osh_atomic_store_ptr((void *volatile *) &d->ring, big);
+        r = big;
+    }
+
+    r->item[b & r->mask] = *x;
+    osh_atomic_fence_release();
+    osh_atomic_store_relaxed(&d->bottom, b + 1);
+
+    return OSH_OK;
+}
+
+int osh_secondary_deque_pop(struct secondary_deque *d, struct secondary *x) {
+    struct secondary_ring *r;
+    int64_t b, t;
+    int got;
+
+    b = osh_atomic_load_relaxed(&d->bottom) - 1;
+    r = d->ring;
+    osh_atomic_store_relaxed(&d->bottom, b);
+    osh_atomic_fence();
+    t = osh_atomic_load_relaxed(&d->top);
+
+    if (t > b) { /* empty */
+        osh_atomic_store_relaxed(&d->bottom, b + 1);
+        return 0;
+    }
+
+    *x = r->item[b & r->mask];
+    got = 1;
+    if (t == b) {
+        /* last entry: race against thieves for it */
+        if (!osh_atomic_cas(&d->top, t, t + 1))
+            got = 0;
+        osh_atomic_store_relaxed(&d->bottom, b + 1);
+    }
+
+    return got;
+}
+
+int osh_secondary_deque_steal(struct secondary_deque *d, struct secondary *x) {
+    struct secondary_ring *r;
+    int64_t b, t;
+
+    t = osh_atomic_load(&d->top);
+    osh_atomic_fence();
+    b = osh_atomic_load(&d->bottom);
+
+    if (t >= b)
+        return 0;
+
+    /* the copy may be torn if the entry is taken by someone else meanwhile, it is then discarded */
+    r = osh_atomic_load_ptr((void *const volatile *) &d->ring);
+    *x = r->item[t & r->mask];
+
+    return osh_atomic_cas(&d->top, t, t + 1);
+}
+
+size_t osh_secondary_deque_size(struct secondary_deque *d) {
+    int64_t n;
+
+    n = osh_atomic_load(&d->bottom) - osh_atomic_load(&d->top);
+    return (n > 0) ? (size_t) n : 0;
+}
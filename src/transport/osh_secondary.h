@@ -0,0 +1,205 @@
+#ifndef _OSH_SECONDARY
+#define _OSH_SECONDARY
+
+/**
+ * @file osh_secondary.h
+ * @brief Banks of secondary particles waiting to be transported
+ *
+ * Two variants:
+ *
+ * - struct secondary_stack: a LIFO bank owned by one thread. Storage is an
+ *   arena of fixed size chunks which is only ever grown, so a push is a
+ *   bounds check and a pointer increment once the bank has reached the size
+ *   of the largest shower, and pointers to entries stay valid while the
+ *   bank grows.
+ *
+ * - struct secondary_deque: a work-stealing deque (Chase and Lev 2005, with
+ *   the memory orderings of Le et al. 2013). The owner pushes and pops at
+ *   the bottom like a stack; other threads may steal the oldest entries from
+ *   the top without locks, so a thread with a large shower hands work to idle
+ *   threads. Entries are copied in and out.
+ *
+ * Neither variant allocates memory per push, except when the bank grows.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common/osh_alloc.h"
+#include "common/osh_rc.h"
+#include "particle/osh_particle.h"
+#include "transport/osh_transport.h"
+
+#define OSH_SECONDARY_CHUNK_SHIFT 10                                  /* log2 of the entries per arena chunk */
+#define OSH_SECONDARY_CHUNK ((size_t) 1 << OSH_SECONDARY_CHUNK_SHIFT) /* entries per arena chunk */
+
+/**
+ * @struct secondary
+ *
+ * @brief A banked particle with its phase space.
+ */
+struct secondary {
+    struct particle part; /* particle type, weight, generation and primary number */
+    struct position pos;  /* position, energy, direction, zone and medium where it was created */
+};
+
+/**
+ * @struct secondary_stack
+ *
+ * @brief Per-thread LIFO bank of secondaries.
+ */
+struct secondary_stack {
+    struct secondary **chunk; /* arena chunks, OSH_SECONDARY_CHUNK entries each */
+    size_t n;                 /* number of banked entries */
+    size_t cap;               /* number of entries in allocated chunks */
+    size_t nchunk;            /* number of allocated chunks */
+    size_t maxchunk;          /* length of the chunk pointer list */
+    size_t high;              /* largest n seen, for sizing */
+};
+
+/**
+ * @brief Initialise an empty secondary stack.
+ *
+ * @param[out] s Stack to initialise.
+ * @param[in] capacity Number of entries to preallocate, may be 0.
+ *
+ * @returns OSH_OK or OSH_ENOMEM.
+ */
+int osh_secondary_stack_init(struct secondary_stack *s, size_t capacity);
+
+/**
+ * @brief Free the storage of a secondary stack.
+ *
+ * @param[in] s Stack.
+ */
+void osh_secondary_stack_free(struct secondary_stack *s);
+
+/**
+ * @brief Add a chunk to a full stack. Called by osh_secondary_push().
+ *
+ * @param[in] s Stack.
+ *
+ * @returns OSH_OK or OSH_ENOMEM.
+ */
+int osh_secondary_stack_grow(struct secondary_stack *s);
+
+/**
+ * @brief Reserve the next entry on top of the stack.
+ *
+ * The caller fills the returned entry in place.
+ *
+ * @param[in] s Stack.
+ *
+ * @returns Pointer to the new top entry, or NULL if the stack could not grow.
+ */
+static inline struct secondary *osh_secondary_push(struct secondary_stack *s) {
+    size_t i;
+
+    if (s->n == s->cap && osh_secondary_stack_grow(s) != OSH_OK)
+        return NULL;
+    i = s->n++;
+    if (s->n > s->high)
+        s->high = s->n;
+    return &s->chunk[i >> OSH_SECONDARY_CHUNK_SHIFT][i & (OSH_SECONDARY_CHUNK - 1)];
+}
+
+/**
+ * @brief Remove the top entry of the stack.
+ *
+ * @param[in] s Stack.
+ *
+ * @returns Pointer to the removed entry, valid until the next push, or NULL if the stack is empty.
+ */
+static inline struct secondary *osh_secondary_pop(struct secondary_stack *s) {
+    size_t i;
+
+    if (s->n == 0)
+        return NULL;
+    i = --s->n;
+    return &s->chunk[i >> OSH_SECONDARY_CHUNK_SHIFT][i & (OSH_SECONDARY_CHUNK - 1)];
+}
+
+/**
+ * @struct secondary_ring
+ *
+ * @brief Circular buffer of a work-stealing deque. Retired buffers are kept until the deque is freed,
+ *        since a thief may still be reading from them.
+ */
+struct secondary_ring {
+    struct secondary_ring *prev; /* previous, smaller buffer */
+    int64_t mask;                /* size - 1, size is a power of two */
+    struct secondary item[];     /* entries, indexed modulo size */
+};
+
+/**
+ * @struct secondary_deque
+ *
+ * @brief Work-stealing bank of secondaries.
+ *
+ * top and bottom sit in separate cache lines, as thieves write one and the owner the other.
+ */
+struct secondary_deque {
+    int64_t volatile top;                        /* next entry to steal, advanced by thieves */
+    char _pad0[OSH_CACHELINE - sizeof(int64_t)]; /* keeps top and bottom in separate cache lines */
+    int64_t volatile bottom;                     /* next free slot, moved by the owner only */
+    char _pad1[OSH_CACHELINE - sizeof(int64_t)];
+    struct secondary_ring *volatile ring; /* current buffer */
+};
+
+/**
+ * @brief Initialise an empty work-stealing deque.
+ *
+ * @param[out] d Deque to initialise.
+ * @param[in] capacity Number of entries to preallocate, rounded up to a power of two.
+ *
+ * @returns OSH_OK or OSH_ENOMEM.
+ */
+int osh_secondary_deque_init(struct secondary_deque *d, size_t capacity);
+
+/**
+ * @brief Free a deque. No other thread may access it.
+ *
+ * @param[in] d Deque.
+ */
+void osh_secondary_deque_free(struct secondary_deque *d);
+
+/**
+ * @brief Push an entry at the bottom. Owner thread only.
+ *
+ * @param[in] d Deque.
+ * @param[in] x Entry to copy into the deque.
+ *
+ * @returns OSH_OK, or OSH_ENOMEM if the deque could not grow.
+ */
+int osh_secondary_deque_push(struct secondary_deque *d, struct secondary const *x);
+
+/**
+ * @brief Pop the newest entry from the bottom. Owner thread only.
+ *
+ * @param[in] d Deque.
+ * @param[out] x Entry copied out of the deque.
+ *
+ * @returns 1 if an entry was taken, 0 if the deque is empty.
+ */
+int osh_secondary_deque_pop(struct secondary_deque *d, struct secondary *x);
+
+/**
+ * @brief Steal the oldest entry from the top. Any thread.
+ *
+ * @param[in] d Deque.
+ * @param[out] x Entry copied out of the deque.
+ *
+ * @returns 1 if an entry was taken, 0 if the deque is empty or another thread took it first.
+ */
+int osh_secondary_deque_steal(struct secondary_deque *d, struct secondary *x);
+
+/**
+ * @brief Number of entries in a deque. Exact only when no other thread is stealing.
+ *
+ * @param[in] d Deque.
+ *
+ * @returns Number of entries.
+ */
+size_t osh_secondary_deque_size(struct secondary_deque *d);
+
+#endif /* !_OSH_SECONDARY */
@@ -51,6 +51,7 @@ int copy_step(struct step *dest, struct step *src) {
     dest->rho = src->rho;
     dest->medium = src->medium;
     dest->zone = src->zone;
+    dest->cross = src->cross;
     dest->system = src->system;
 
     return 1;
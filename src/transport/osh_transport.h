@@ -35,6 +35,7 @@ struct step {
     double rho; /* CT-corrected density at this point [g/cm3] */
     int medium; /* medium ID at this point, -1 if unknown */
     int zone;   /* zone number at this point, -1 if unknown */
+    int cross;  /* the step ends on the boundary of its zone */
 
     int system; /* optional marker for saying what coordinate system we are in. 0 = unknown, 1 = universe ... */
 };
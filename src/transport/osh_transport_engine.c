@@ -0,0 +1,203 @@
+#include "transport/osh_transport_engine.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "beam/osh_beam.h"
+#include "common/osh_rc.h"
+#include "gemca/osh_gemca2.h"
+#include "particle/osh_particle.h"
+#include "transport/_osh_transport_step.h"
+
+int osh_transport_init(struct transport_workspace *tw,
+                       struct gemca_workspace *g,
+                       struct beam_workspace const *wb,
+                       struct transport_physics const *phys,
+                       struct transport_scorer const *scorer) {
+
+    if (!tw || !g || !phys || !phys->density || !phys->dedx || !phys->range != !phys->erange)
+        return OSH_EINVAL;
+
+    memset(tw, 0, sizeof(*tw));
+    tw->g = g;
+    tw->phys = *phys;
+    if (scorer)
+        tw->scorer = *scorer;
+
+    if (osh_secondary_stack_init(&tw->bank, OSH_SECONDARY_CHUNK) != OSH_OK)
+        return OSH_ENOMEM;
+
+    tw->deltae = OSH_TRANSPORT_DELTAE;
+    tw->demin = OSH_TRANSPORT_DEMIN;
+    tw->tcut = OSH_BEAM_TMIN0;
+    if (wb) {
+        if (wb->deltae > 0.0f)
+            tw->deltae = wb->deltae;
+        if (wb->demin > 0.0f)
+            tw->demin = wb->demin;
+        if (wb->shared && wb->shared->tcut[0] > 0.0)
+            tw->tcut = wb->shared->tcut[0];
+    }
+
+    return OSH_OK;
+}
+
+void osh_transport_free(struct transport_workspace *tw) {
+    osh_secondary_stack_free(&tw->bank);
+}
+
+/**
+ * @brief Transport one particle until it stops or escapes.
+ *
+ * @details Each pass of the loop makes one step: the step length is the
+ *          energy loss limited step or the remaining distance to the zone
+ *          boundary, whichever is shorter. The mean energy loss is evaluated
+ *          with the stopping power at the mid-step energy. Steps ending on a
+ *          boundary are pushed OSH_GEMCA_STEPLIM into the next zone before
+ *          the new zone is looked up.
+ *
+ * @param[in] tw - transport workspace
+ * @param[in] part - particle type
+ * @param[in,out] pos - starting point, final state on return
+ * @param[in] rng - RNG state for the physics hooks
+ *
+ * @returns OSH_TRANSPORT_END_*
+ */
+int osh_transport_history(struct transport_workspace *tw,
+                          struct particle const *part,
+                          struct position *pos,
+                          struct osh_rng *rng) {
+    struct step st;
+    struct zone *z;
+    struct ray r;
+    double e, emin;
+    double dgeo, ds, de;
+    size_t n;
+    int cross;
+    int end;
+    int i;
+
+    emin = _ecut(tw, part);
+
+    z = _locate(tw->g, pos->p, pos->v);
+    pos->zone = z ? (int) z->id : -1;
+    _zone_medium(tw, z, &pos->medium, &pos->rho);
+    dgeo = -1.0; /* distance to the zone boundary along v, < 0 if unknown */
+
+    for (n = 0;; n++) {
+        if (!z || pos->medium == OSH_TRANSPORT_MEDIUM_BLACKHOLE) {
+            end = OSH_TRANSPORT_END_ESCAPED;
+            break;
+        }
+
+        e = pos->p[3];
+        if (e <= emin) {
+            if (e > 0.0) { /* the residual energy is deposited on the spot, in a step of zero length */
+                n++;
+                if (tw->scorer.score) {
+                    memcpy(st.p, pos->p, sizeof(st.p));
+                    memcpy(st.q, pos->p, sizeof(st.q));
+                    memcpy(st.v, pos->v, sizeof(st.v));
+                    st.q[3] = 0.0;
+                    st.ds = 0.0;
+                    st.de = e;
+                    st.rho = pos->rho;
+                    st.medium = pos->medium;
+                    st.zone = pos->zone;
+                    st.cross = 0;
+                    st.system = pos->system;
+                    tw->scorer.score(tw->scorer.data, part, &st);
+                }
+            }
+            pos->p[3] = 0.0;
+            end = OSH_TRANSPORT_END_STOPPED;
+            break;
+        }
+
+        if (n >= OSH_TRANSPORT_MAXSTEPS) {
+            end = OSH_TRANSPORT_END_MAXSTEPS;
+            break;
+        }
+
+        if (dgeo < 0.0) {
+            memcpy(r.p, pos->p, sizeof(r.p));
+            memcpy(r.cp, pos->v, sizeof(r.cp));
+            r.system = pos->system;
+            dgeo = osh_gemca_dist(z, &r);
+            if (!isfinite(dgeo)) {
+                end = OSH_TRANSPORT_END_ESCAPED;
+                break;
+            }
+        }
+
+        cross = _step_length(tw, part, pos->medium, pos->rho, e, dgeo, &ds, &de);
+
+        for (i = 0; i < 3; i++) {
+            st.p[i] = pos->p[i];
+            st.q[i] = pos->p[i] + ds * pos->v[i];
+            st.v[i] = pos->v[i];
+        }
+        st.p[3] = e;
+        st.ds = ds;
+        st.de = de;
+        st.rho = pos->rho;
+        st.medium = pos->medium;
+        st.zone = pos->zone;
+        st.cross = cross;
+        st.system = pos->system;
+        _step_eloss(tw, part, &st, rng);
+
+        if (tw->scorer.score)
+            tw->scorer.score(tw->scorer.data, part, &st);
+
+        memcpy(pos->p, st.q, sizeof(pos->p));
+
+        if (tw->phys.scatter && pos->medium != OSH_TRANSPORT_MEDIUM_VACUUM) {
+            tw->phys.scatter(tw->phys.data, part, &st, pos->v, rng);
+            dgeo = -1.0;
+        } else {
+            dgeo -= ds;
+        }
+
+        if (cross) {
+            for (i = 0; i < 3; i++)
+                pos->p[i] += OSH_GEMCA_STEPLIM * st.v[i];
+            z = _locate(tw->g, pos->p, pos->v);
+            pos->zone = z ? (int) z->id : -1;
+            _zone_medium(tw, z, &pos->medium, &pos->rho);
+            dgeo = -1.0;
+        }
+    }
+
+    tw->nsteps += n;
+    tw->nhist++;
+
+    return end;
+}
+
+int osh_transport_primary(struct transport_workspace *tw, struct beam_spot const *spot, struct osh_rng *rng) {
+    struct particle prim;
+    struct position pos;
+    struct secondary sec;
+    struct secondary *top;
+    int end;
+
+    if (osh_beam_spot_sample(spot, rng, &pos) != OSH_OK)
+        return -1;
+
+    /* the spot particle is shared by all threads, the scorer gets a private copy */
+    prim = *spot->part;
+    if (tw->scorer.particle)
+        tw->scorer.particle(tw->scorer.data, &prim);
+    end = osh_transport_history(tw, &prim, &pos, rng);
+
+    /* the popped slot is reused by the next push, so the entry is copied out first */
+    while ((top = osh_secondary_pop(&tw->bank)) != NULL) {
+        sec = *top;
+        if (tw->scorer.particle)
+            tw->scorer.particle(tw->scorer.data, &sec.part);
+        osh_transport_history(tw, &sec.part, &sec.pos, rng);
+    }
+
+    return end;
+}
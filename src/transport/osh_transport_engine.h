@@ -0,0 +1,184 @@
+#ifndef _OSH_TRANSPORT_ENGINE
+#define _OSH_TRANSPORT_ENGINE
+
+/**
+ * @file osh_transport_engine.h
+ * @brief Condensed-history transport of charged particles through a gemca geometry
+ *
+ * A history is transported in steps. Each step is the shorter of
+ * - the energy loss limited step: the particle loses at most
+ *   max(deltae * E, demin) (beam_workspace::deltae, beam_workspace::demin),
+ * - the distance to the boundary of the current zone, osh_gemca_dist().
+ *
+ * Every step is filled into a struct step and handed to the scorer hook.
+ * Stopping powers, and optionally CSDA ranges, energy loss straggling and
+ * multiple scattering, are provided by the physics hooks, so this loop does not
+ * depend on any particular physics model.
+ *
+ * The loop does not allocate memory: all per history state lives on the
+ * stack or in the struct transport_workspace. The distance to the zone
+ * boundary is kept between steps as long as the direction does not change,
+ * so straight tracks query the geometry once per zone.
+ *
+ * Secondaries created by the physics are pushed onto tw->bank and are
+ * transported after their primary, last in first out.
+ *
+ * Media follow the SHIELD-HIT convention: medium 0 is a black hole which
+ * absorbs particles, medium 1000 is vacuum.
+ */
+
+#include <stddef.h>
+
+#include "transport/osh_secondary.h"
+#include "transport/osh_transport.h"
+
+#define OSH_TRANSPORT_MEDIUM_BLACKHOLE 0
+#define OSH_TRANSPORT_MEDIUM_VACUUM 1000
+
+#define OSH_TRANSPORT_DELTAE 0.03      /* default max. fraction of energy lost in a step */
+#define OSH_TRANSPORT_DEMIN 0.025      /* default min. energy loss limit of a step [MeV] */
+#define OSH_TRANSPORT_MAXSTEPS 1000000 /* steps after which a history is abandoned */
+
+/* how a history ended */
+#define OSH_TRANSPORT_END_STOPPED 0  /* kinetic energy fell below the cutoff */
+#define OSH_TRANSPORT_END_ESCAPED 1  /* entered a black hole or left all zones */
+#define OSH_TRANSPORT_END_MAXSTEPS 2 /* OSH_TRANSPORT_MAXSTEPS exceeded */
+
+/* forward declarations */
+struct particle;
+struct gemca_workspace;
+struct beam_workspace;
+struct beam_spot;
+struct osh_rng;
+
+/**
+ * @struct transport_physics
+ *
+ * @brief Physics hooks of the transport loop.
+ *
+ * density and dedx are required, eloss, scatter, range and erange may be NULL.
+ */
+struct transport_physics {
+    /** Density of a medium [g/cm3]. */
+    double (*density)(void *data, int medium);
+
+    /** Mass stopping power of a medium at kinetic energy e [MeV cm2/g]. */
+    double (*dedx)(void *data, struct particle const *part, int medium, double e);
+
+    /**
+     * Energy loss of a step including fluctuations [MeV]. On entry st->de holds
+     * the mean energy loss. NULL for no straggling.
+     */
+    double (*eloss)(void *data, struct particle const *part, struct step const *st, struct osh_rng *rng);
+
+    /**
+     * Deflect the direction v[3] after a step st. NULL for no multiple scattering.
+     */
+    void (*scatter)(void *data, struct particle const *part, struct step const *st, double v[3], struct osh_rng *rng);
+
+    /**
+     * CSDA range of a medium at kinetic energy e [g/cm2], and its inverse, the
+     * kinetic energy at range r [MeV]. Set both or neither. If set, the mean
+     * energy loss of a step of areal thickness t is e - erange(range(e) - t),
+     * exact for any step length, else it is taken from dedx at mid-step.
+     */
+    double (*range)(void *data, struct particle const *part, int medium, double e);
+    double (*erange)(void *data, struct particle const *part, int medium, double r);
+
+    void *data; /* passed to all hooks */
+};
+
+/**
+ * @struct transport_scorer
+ *
+ * @brief Scorer hook of the transport loop.
+ */
+struct transport_scorer {
+    /** Score a step. A particle stopping below the cutoff deposits its residual energy in a step with ds = 0. */
+    void (*score)(void *data, struct particle const *part, struct step const *st);
+
+    /** A particle starts its transport, may be NULL. Lets the scorer cache per-particle data in part. */
+    void (*particle)(void *data, struct particle *part);
+
+    void *data; /* passed to the hooks */
+};
+
+/**
+ * @struct transport_workspace
+ *
+ * @brief State of one transport loop, one per thread.
+ */
+struct transport_workspace {
+    struct gemca_workspace *g;      /* geometry */
+    struct transport_physics phys;  /* physics hooks */
+    struct transport_scorer scorer; /* scorer hook */
+    struct secondary_stack bank;    /* secondaries waiting for transport */
+    double deltae;                  /* max. fraction of energy lost in a step */
+    double demin;                   /* min. energy loss limit of a step [MeV] */
+    double tcut;                    /* kinetic energy cutoff [MeV/nucleon] */
+    size_t nhist;                   /* number of transported histories */
+    size_t nsteps;                  /* number of steps of all histories */
+};
+
+/**
+ * @brief Set up a transport loop.
+ *
+ * Step limits and the energy cutoff are taken from the beam workspace; unset
+ * (zero) values select OSH_TRANSPORT_DELTAE, OSH_TRANSPORT_DEMIN and
+ * OSH_BEAM_TMIN0.
+ *
+ * @param[out] tw Transport workspace to initialise.
+ * @param[in] g Loaded geometry.
+ * @param[in] wb Beam workspace, may be NULL for all defaults.
+ * @param[in] phys Physics hooks, density and dedx must be set.
+ * @param[in] scorer Scorer hook, may be NULL or have a NULL score function.
+ *
+ * @returns OSH_OK, OSH_EINVAL for missing hooks or geometry, or OSH_ENOMEM.
+ */
+int osh_transport_init(struct transport_workspace *tw,
+                       struct gemca_workspace *g,
+                       struct beam_workspace const *wb,
+                       struct transport_physics const *phys,
+                       struct transport_scorer const *scorer);
+
+/**
+ * @brief Free the resources of a transport loop.
+ *
+ * @param[in] tw Transport workspace.
+ */
+void osh_transport_free(struct transport_workspace *tw);
+
+/**
+ * @brief Transport one particle until it stops or escapes.
+ *
+ * pos->p[3] is the total kinetic energy [MeV]. pos->v must be a unit vector.
+ * Zone, medium and density of pos are looked up; on return pos holds the
+ * final state of the particle.
+ *
+ * @param[in] tw Transport workspace.
+ * @param[in] part Particle type.
+ * @param[in,out] pos Starting point, direction and energy; final state on return.
+ * @param[in] rng Pointer to the RNG state, used by the eloss and scatter hooks.
+ *
+ * @returns OSH_TRANSPORT_END_* telling how the history ended.
+ */
+int osh_transport_history(struct transport_workspace *tw,
+                          struct particle const *part,
+                          struct position *pos,
+                          struct osh_rng *rng);
+
+/**
+ * @brief Sample a primary from a beam spot and transport it with all its secondaries.
+ *
+ * The particle hook of the scorer is called once for the primary and once
+ * for each secondary, before its transport starts.
+ *
+ * @param[in] tw Transport workspace.
+ * @param[in] spot Beam spot, see osh_beam_spot_sample().
+ * @param[in] rng Pointer to the RNG state.
+ *
+ * @returns OSH_TRANSPORT_END_* of the primary, or -1 if the spot could not be sampled.
+ */
+int osh_transport_primary(struct transport_workspace *tw, struct beam_spot const *spot, struct osh_rng *rng);
+
+#endif /* !_OSH_TRANSPORT_ENGINE */
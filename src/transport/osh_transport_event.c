@@ -0,0 +1,443 @@
+#include "transport/osh_transport_event.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_rc.h"
+#include "gemca/osh_gemca2.h"
+#include "particle/osh_particle.h"
+#include "transport/_osh_transport_step.h"
+
+#define BANK_ALIVE -1 /* state of a particle still being transported */
+
+/* resize one array of the bank, keeping its content */
+static int _resize(void **a, size_t size, size_t n) {
+    void *x;
+
+    x = realloc(*a, size * n);
+    if (!x)
+        return OSH_ENOMEM;
+    *a = x;
+    return OSH_OK;
+}
+
+static int _bank_reserve(struct transport_bank *b, size_t cap) {
+    int rc = OSH_OK;
+
+    if (cap <= b->cap)
+        return OSH_OK;
+
+    rc |= _resize((void **) &b->x, sizeof(double), cap);
+    rc |= _resize((void **) &b->y, sizeof(double), cap);
+    rc |= _resize((void **) &b->z, sizeof(double), cap);
+    rc |= _resize((void **) &b->e, sizeof(double), cap);
+    rc |= _resize((void **) &b->u, sizeof(double), cap);
+    rc |= _resize((void **) &b->v, sizeof(double), cap);
+    rc |= _resize((void **) &b->w, sizeof(double), cap);
+    rc |= _resize((void **) &b->wt, sizeof(double), cap);
+    rc |= _resize((void **) &b->rho, sizeof(double), cap);
+    rc |= _resize((void **) &b->dgeo, sizeof(double), cap);
+    rc |= _resize((void **) &b->ds, sizeof(double), cap);
+    rc |= _resize((void **) &b->de, sizeof(double), cap);
+    rc |= _resize((void **) &b->zone, sizeof(int), cap);
+    rc |= _resize((void **) &b->medium, sizeof(int), cap);
+    rc |= _resize((void **) &b->cross, sizeof(int), cap);
+    rc |= _resize((void **) &b->state, sizeof(int), cap);
+    rc |= _resize((void **) &b->nstep, sizeof(int), cap);
+    rc |= _resize((void **) &b->part, sizeof(*b->part), cap);
+    rc |= _resize((void **) &b->_dtmp, sizeof(double), cap);
+    rc |= _resize((void **) &b->_itmp, sizeof(int), cap);
+    rc |= _resize((void **) &b->_ptmp, sizeof(*b->_ptmp), cap);
+    rc |= _resize((void **) &b->_perm, sizeof(size_t), cap);
+    if (rc != OSH_OK)
+        return OSH_ENOMEM; /* arrays which were resized stay valid, cap is left unchanged */
+
+    b->cap = cap;
+    return OSH_OK;
+}
+
+int osh_transport_bank_init(struct transport_bank *b, size_t capacity) {
+    memset(b, 0, sizeof(*b));
+    if (capacity < 64)
+        capacity = 64;
+    if (_bank_reserve(b, capacity) != OSH_OK) {
+        osh_transport_bank_free(b);
+        return OSH_ENOMEM;
+    }
+    return OSH_OK;
+}
+
+void osh_transport_bank_free(struct transport_bank *b) {
+    free(b->x);
+    free(b->y);
+    free(b->z);
+    free(b->e);
+    free(b->u);
+    free(b->v);
+    free(b->w);
+    free(b->wt);
+    free(b->rho);
+    free(b->dgeo);
+    free(b->ds);
+    free(b->de);
+    free(b->zone);
+    free(b->medium);
+    free(b->cross);
+    free(b->state);
+    free(b->nstep);
+    free((void *) b->part);
+    free(b->_dtmp);
+    free(b->_itmp);
+    free((void *) b->_ptmp);
+    free(b->_perm);
+    memset(b, 0, sizeof(*b));
+}
+
+int osh_transport_bank_add(struct transport_bank *b, struct particle const *part, struct position const *pos) {
+    size_t i;
+
+    if (b->n == b->cap && _bank_reserve(b, b->cap ? 2 * b->cap : 64) != OSH_OK)
+        return OSH_ENOMEM;
+
+    i = b->n++;
+    b->x[i] = pos->p[0];
+    b->y[i] = pos->p[1];
+    b->z[i] = pos->p[2];
+    b->e[i] = pos->p[3];
+    b->u[i] = pos->v[0];
+    b->v[i] = pos->v[1];
+    b->w[i] = pos->v[2];
+    b->wt[i] = part->weight;
+    b->part[i] = part;
+
+    /* zone and medium are looked up when the transport starts */
+    b->dgeo[i] = -1.0;
+    b->zone[i] = -1;
+    b->medium[i] = OSH_TRANSPORT_MEDIUM_BLACKHOLE;
+    b->rho[i] = 0.0;
+    b->cross[i] = 0;
+    b->state[i] = BANK_ALIVE;
+    b->nstep[i] = 0;
+
+    return OSH_OK;
+}
+
+/* look up zone, medium and density of particle i at its current position */
+static void _relocate(struct transport_workspace const *tw, struct transport_bank *b, size_t i) {
+    struct zone *z;
+    double p[3], v[3];
+
+    p[0] = b->x[i];
+    p[1] = b->y[i];
+    p[2] = b->z[i];
+    v[0] = b->u[i];
+    v[1] = b->v[i];
+    v[2] = b->w[i];
+
+    z = _locate(tw->g, p, v);
+    b->zone[i] = z ? (int) z->id : -1;
+    _zone_medium(tw, z, &b->medium[i], &b->rho[i]);
+    b->dgeo[i] = -1.0;
+}
+
+/* the step of particle i, before energy loss straggling */
+static void _bank_step(struct transport_bank const *b, size_t i, struct step *st) {
+    st->p[0] = b->x[i];
+    st->p[1] = b->y[i];
+    st->p[2] = b->z[i];
+    st->p[3] = b->e[i];
+    st->v[0] = b->u[i];
+    st->v[1] = b->v[i];
+    st->v[2] = b->w[i];
+    st->q[0] = b->x[i] + b->ds[i] * b->u[i];
+    st->q[1] = b->y[i] + b->ds[i] * b->v[i];
+    st->q[2] = b->z[i] + b->ds[i] * b->w[i];
+    st->q[3] = b->e[i] - b->de[i];
+    st->ds = b->ds[i];
+    st->de = b->de[i];
+    st->rho = b->rho[i];
+    st->medium = b->medium[i];
+    st->zone = b->zone[i];
+    st->cross = b->cross[i];
+    st->system = 1;
+}
+
+/*
+ * End of transport: escape, residual energy below the cutoff and step limit,
+ * checked in the same order as in osh_transport_history().
+ */
+static void _kernel_end(struct transport_workspace *tw, struct transport_bank *b) {
+    struct step st;
+    size_t i;
+
+    for (i = 0; i < b->n; i++) {
+        if (b->zone[i] < 0 || b->medium[i] == OSH_TRANSPORT_MEDIUM_BLACKHOLE) {
+            b->state[i] = OSH_TRANSPORT_END_ESCAPED;
+            continue;
+        }
+
+        if (b->e[i] <= _ecut(tw, b->part[i])) {
+            if (b->e[i] > 0.0) { /* residual energy deposited on the spot */
+                b->nstep[i]++;
+                if (tw->scorer.score) {
+                    b->ds[i] = 0.0;
+                    b->de[i] = b->e[i];
+                    _bank_step(b, i, &st);
+                    st.cross = 0;
+                    tw->scorer.score(tw->scorer.data, b->part[i], &st);
+                }
+            }
+            b->e[i] = 0.0;
+            b->state[i] = OSH_TRANSPORT_END_STOPPED;
+            continue;
+        }
+
+        if (b->nstep[i] >= OSH_TRANSPORT_MAXSTEPS)
+            b->state[i] = OSH_TRANSPORT_END_MAXSTEPS;
+    }
+}
+
+/*
+ * Distance to the zone boundary. gemca answers one ray at a time; the bank
+ * is sorted by zone, so consecutive queries walk the same zone tree.
+ */
+static void _kernel_geometry(struct transport_workspace *tw, struct transport_bank *b) {
+    struct ray r;
+    size_t i;
+
+    r.system = 1;
+    for (i = 0; i < b->n; i++) {
+        if (b->state[i] != BANK_ALIVE || b->dgeo[i] >= 0.0)
+            continue;
+        r.p[0] = b->x[i];
+        r.p[1] = b->y[i];
+        r.p[2] = b->z[i];
+        r.cp[0] = b->u[i];
+        r.cp[1] = b->v[i];
+        r.cp[2] = b->w[i];
+        b->dgeo[i] = osh_gemca_dist(tw->g->zones[b->zone[i] - 1], &r);
+        if (!isfinite(b->dgeo[i]))
+            b->state[i] = OSH_TRANSPORT_END_ESCAPED;
+    }
+}
+
+/* step length and mean energy loss */
+static void _kernel_eloss(struct transport_workspace *tw, struct transport_bank *b) {
+    size_t i;
+
+    for (i = 0; i < b->n; i++) {
+        if (b->state[i] != BANK_ALIVE)
+            continue;
+        b->cross[i] = _step_length(tw, b->part[i], b->medium[i], b->rho[i], b->e[i], b->dgeo[i], &b->ds[i], &b->de[i]);
+    }
+}
+
+/* straggling and scoring of the steps, then all particles are moved to the end of their step */
+static void _kernel_move(struct transport_workspace *tw, struct transport_bank *b, struct osh_rng *rng) {
+    struct step st;
+    size_t i, n;
+
+    n = b->n;
+    if (tw->phys.eloss || tw->scorer.score) {
+        for (i = 0; i < n; i++) {
+            if (b->state[i] != BANK_ALIVE)
+                continue;
+            _bank_step(b, i, &st);
+            b->de[i] = _step_eloss(tw, b->part[i], &st, rng);
+            if (tw->scorer.score)
+                tw->scorer.score(tw->scorer.data, b->part[i], &st);
+        }
+    }
+
+    /* plain array arithmetic, vectorised by the compiler */
+    for (i = 0; i < n; i++) {
+        if (b->state[i] != BANK_ALIVE)
+            continue;
+        b->x[i] += b->ds[i] * b->u[i];
+        b->y[i] += b->ds[i] * b->v[i];
+        b->z[i] += b->ds[i] * b->w[i];
+        b->e[i] -= b->de[i];
+        b->dgeo[i] -= b->ds[i];
+        b->nstep[i]++;
+    }
+}
+
+/* new directions after the step */
+static void _kernel_scatter(struct transport_workspace *tw, struct transport_bank *b, struct osh_rng *rng) {
+    struct step st;
+    double v[3];
+    size_t i;
+
+    if (!tw->phys.scatter)
+        return;
+
+    for (i = 0; i < b->n; i++) {
+        if (b->state[i] != BANK_ALIVE || b->medium[i] == OSH_TRANSPORT_MEDIUM_VACUUM)
+            continue;
+
+        /* the step as the scorer saw it, rebuilt from its end point */
+        st.q[0] = b->x[i];
+        st.q[1] = b->y[i];
+        st.q[2] = b->z[i];
+        st.q[3] = b->e[i];
+        st.p[0] = b->x[i] - b->ds[i] * b->u[i];
+        st.p[1] = b->y[i] - b->ds[i] * b->v[i];
+        st.p[2] = b->z[i] - b->ds[i] * b->w[i];
+        st.p[3] = b->e[i] + b->de[i];
+        st.v[0] = b->u[i];
+        st.v[1] = b->v[i];
+        st.v[2] = b->w[i];
+        st.ds = b->ds[i];
+        st.de = b->de[i];
+        st.rho = b->rho[i];
+        st.medium = b->medium[i];
+        st.zone = b->zone[i];
+        st.cross = b->cross[i];
+        st.system = 1;
+
+        v[0] = b->u[i];
+        v[1] = b->v[i];
+        v[2] = b->w[i];
+        tw->phys.scatter(tw->phys.data, b->part[i], &st, v, rng);
+        b->u[i] = v[0];
+        b->v[i] = v[1];
+        b->w[i] = v[2];
+        b->dgeo[i] = -1.0;
+    }
+}
+
+/*
+ * Particles on a zone boundary are pushed into the next zone. Those leaving
+ * the geometry or entering a black hole escape here, as in osh_transport_history(),
+ * so that _compact() only sees particles in a valid zone.
+ */
+static void _kernel_boundary(struct transport_workspace *tw, struct transport_bank *b) {
+    size_t i;
+
+    for (i = 0; i < b->n; i++) {
+        if (b->state[i] != BANK_ALIVE || !b->cross[i])
+            continue;
+        b->x[i] += OSH_GEMCA_STEPLIM * b->u[i];
+        b->y[i] += OSH_GEMCA_STEPLIM * b->v[i];
+        b->z[i] += OSH_GEMCA_STEPLIM * b->w[i];
+        _relocate(tw, b, i);
+        if (b->zone[i] < 0 || b->medium[i] == OSH_TRANSPORT_MEDIUM_BLACKHOLE)
+            b->state[i] = OSH_TRANSPORT_END_ESCAPED;
+    }
+}
+
+static void _permute_d(double **a, double **tmp, size_t const *perm, size_t n) {
+    double *x;
+    size_t k;
+
+    for (k = 0; k < n; k++)
+        (*tmp)[k] = (*a)[perm[k]];
+    x = *a;
+    *a = *tmp;
+    *tmp = x;
+}
+
+static void _permute_i(int **a, int **tmp, size_t const *perm, size_t n) {
+    int *x;
+    size_t k;
+
+    for (k = 0; k < n; k++)
+        (*tmp)[k] = (*a)[perm[k]];
+    x = *a;
+    *a = *tmp;
+    *tmp = x;
+}
+
+/*
+ * Remove finished particles and order the rest by next event: particles
+ * needing a geometry query first, grouped by zone, then all others. The sort
+ * is a stable counting sort over nkey = nzones + 2 keys, count has nkey + 1
+ * entries. Particles outside the geometry are finished as escaped. Returns the
+ * number of finished particles.
+ */
+static size_t _compact(struct transport_workspace *tw, struct transport_bank *b, size_t *count, size_t nkey) {
+    struct particle const **px;
+    size_t i, k, key, m, nend;
+
+    memset(count, 0, (nkey + 1) * sizeof(*count));
+    nend = 0;
+    for (i = 0; i < b->n; i++) {
+        if (b->state[i] == BANK_ALIVE && b->zone[i] < 1)
+            b->state[i] = OSH_TRANSPORT_END_ESCAPED; /* never used as a key */
+        if (b->state[i] != BANK_ALIVE) {
+            tw->nsteps += (size_t) b->nstep[i];
+            nend++;
+            continue;
+        }
+        key = (b->dgeo[i] < 0.0) ? (size_t) b->zone[i] : nkey - 1;
+        count[key + 1]++;
+    }
+    for (k = 0; k < nkey; k++)
+        count[k + 1] += count[k];
+    for (i = 0; i < b->n; i++) {
+        if (b->state[i] != BANK_ALIVE)
+            continue;
+        key = (b->dgeo[i] < 0.0) ? (size_t) b->zone[i] : nkey - 1;
+        b->_perm[count[key]++] = i;
+    }
+    m = b->n - nend;
+
+    _permute_d(&b->x, &b->_dtmp, b->_perm, m);
+    _permute_d(&b->y, &b->_dtmp, b->_perm, m);
+    _permute_d(&b->z, &b->_dtmp, b->_perm, m);
+    _permute_d(&b->e, &b->_dtmp, b->_perm, m);
+    _permute_d(&b->u, &b->_dtmp, b->_perm, m);
+    _permute_d(&b->v, &b->_dtmp, b->_perm, m);
+    _permute_d(&b->w, &b->_dtmp, b->_perm, m);
+    _permute_d(&b->wt, &b->_dtmp, b->_perm, m);
+    _permute_d(&b->rho, &b->_dtmp, b->_perm, m);
+    _permute_d(&b->dgeo, &b->_dtmp, b->_perm, m);
+    _permute_i(&b->zone, &b->_itmp, b->_perm, m);
+    _permute_i(&b->medium, &b->_itmp, b->_perm, m);
+    _permute_i(&b->nstep, &b->_itmp, b->_perm, m);
+    for (k = 0; k < m; k++)
+        b->_ptmp[k] = b->part[b->_perm[k]];
+    px = b->part;
+    b->part = b->_ptmp;
+    b->_ptmp = px;
+
+    /* ds, de, cross and state are rewritten in the next pass */
+    for (k = 0; k < m; k++)
+        b->state[k] = BANK_ALIVE;
+
+    b->n = m;
+    return nend;
+}
+
+int osh_transport_event_run(struct transport_workspace *tw, struct transport_bank *b, struct osh_rng *rng) {
+    size_t *count;
+    size_t nkey;
+    size_t i;
+
+    nkey = tw->g->nzones + 2; /* zone IDs 1..nzones, and one key for particles not needing a query */
+    count = malloc((nkey + 1) * sizeof(*count));
+    if (!count)
+        return OSH_ENOMEM;
+
+    for (i = 0; i < b->n; i++) {
+        _relocate(tw, b, i);
+        b->state[i] = BANK_ALIVE;
+        b->ds[i] = 0.0;
+        b->de[i] = 0.0;
+        b->cross[i] = 0;
+    }
+
+    while (b->n > 0) {
+        _kernel_end(tw, b);
+        _kernel_geometry(tw, b);
+        _kernel_eloss(tw, b);
+        _kernel_move(tw, b, rng);
+        _kernel_scatter(tw, b, rng);
+        _kernel_boundary(tw, b);
+        tw->nhist += _compact(tw, b, count, nkey);
+    }
+
+    free(count);
+    return OSH_OK;
+}
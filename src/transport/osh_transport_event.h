@@ -0,0 +1,120 @@
+#ifndef _OSH_TRANSPORT_EVENT
+#define _OSH_TRANSPORT_EVENT
+
+/**
+ * @file osh_transport_event.h
+ * @brief Event based transport of particle banks
+ *
+ * Instead of following one particle from start to end, all particles of a
+ * bank advance by one step at a time. Each pass runs a sequence of kernels,
+ * each over all particles which need it:
+ *
+ * 1. geometry: distance to the zone boundary, for particles which changed
+ *    zone or direction,
+ * 2. energy loss: step length and mean energy loss,
+ * 3. scoring and move: the step is handed to the scorer as a struct step,
+ *    then positions and energies are advanced,
+ * 4. scattering: new directions, if a scatter hook is set,
+ * 5. boundary crossing: zone, medium and density of particles which
+ *    reached a boundary.
+ *
+ * Stopped and escaped particles are then removed, and the remaining ones
+ * are sorted by their next event: particles needing a geometry query come
+ * first, grouped by zone, so the next geometry kernel walks one zone tree
+ * at a time.
+ *
+ * The bank is a structure of arrays, so the move kernel is a plain loop
+ * the compiler vectorises. Steps follow the same rules as
+ * osh_transport_history(), so with deterministic physics both modes
+ * produce the same steps per particle, only in a different order. With
+ * straggling or scattering the random numbers are drawn in a different
+ * order than in history mode.
+ */
+
+#include <stddef.h>
+
+#include "transport/osh_transport.h"
+#include "transport/osh_transport_engine.h"
+
+/* forward declarations */
+struct particle;
+struct osh_rng;
+
+/**
+ * @struct transport_bank
+ *
+ * @brief Particles of an event based transport, as a structure of arrays.
+ */
+struct transport_bank {
+    double *x;                    /* position [cm] */
+    double *y;                    /* position [cm] */
+    double *z;                    /* position [cm] */
+    double *e;                    /* total kinetic energy [MeV] */
+    double *u;                    /* direction cosine along x */
+    double *v;                    /* direction cosine along y */
+    double *w;                    /* direction cosine along z */
+    double *wt;                   /* statistical weight */
+    double *rho;                  /* density at the position [g/cm3] */
+    double *dgeo;                 /* distance to the zone boundary [cm], < 0 if unknown */
+    double *ds;                   /* length of the current step [cm] */
+    double *de;                   /* energy loss of the current step [MeV] */
+    int *zone;                    /* zone ID, -1 outside all zones */
+    int *medium;                  /* medium ID */
+    int *cross;                   /* current step ends on a zone boundary */
+    int *state;                   /* -1 while alive, else OSH_TRANSPORT_END_* */
+    int *nstep;                   /* number of steps made */
+    struct particle const **part; /* particle type */
+
+    /* scratch buffers for sorting, same length as the arrays above */
+    double *_dtmp;
+    int *_itmp;
+    struct particle const **_ptmp;
+    size_t *_perm;
+
+    size_t n;   /* number of particles */
+    size_t cap; /* allocated length of all arrays */
+};
+
+/**
+ * @brief Initialise an empty bank.
+ *
+ * @param[out] b Bank to initialise.
+ * @param[in] capacity Number of particles to allocate room for.
+ *
+ * @returns OSH_OK or OSH_ENOMEM.
+ */
+int osh_transport_bank_init(struct transport_bank *b, size_t capacity);
+
+/**
+ * @brief Free the arrays of a bank.
+ *
+ * @param[in] b Bank.
+ */
+void osh_transport_bank_free(struct transport_bank *b);
+
+/**
+ * @brief Add a particle to a bank, growing it if needed.
+ *
+ * @param[in] b Bank.
+ * @param[in] part Particle type, must stay valid until the bank is transported.
+ * @param[in] pos Starting point, direction and total kinetic energy.
+ *
+ * @returns OSH_OK or OSH_ENOMEM.
+ */
+int osh_transport_bank_add(struct transport_bank *b, struct particle const *part, struct position const *pos);
+
+/**
+ * @brief Transport all particles of a bank until they have stopped or escaped.
+ *
+ * The bank is empty on return. Steps are scored through tw->scorer as in
+ * osh_transport_history(), and tw->nhist and tw->nsteps are updated.
+ *
+ * @param[in] tw Transport workspace.
+ * @param[in] b Bank of particles.
+ * @param[in] rng Pointer to the RNG state, used by the eloss and scatter hooks.
+ *
+ * @returns OSH_OK or OSH_ENOMEM.
+ */
+int osh_transport_event_run(struct transport_workspace *tw, struct transport_bank *b, struct osh_rng *rng);
+
+#endif /* !_OSH_TRANSPORT_EVENT */
@@ -0,0 +1,312 @@
+#include "transport/osh_transport_run.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "beam/osh_beam.h"
+#include "common/osh_alloc.h"
+#include "common/osh_atomic.h"
+#include "common/osh_rc.h"
+#include "common/osh_thread.h"
+#include "random/osh_rng_pool.h"
+
+/* shared state of the workers of one run */
+struct run_state {
+    int64_t volatile next;                       /* next chunk to hand out */
+    char _pad0[OSH_CACHELINE - sizeof(int64_t)]; /* workers hammer next, keep it apart from the rest */
+    int64_t volatile rc;                         /* first error of any worker */
+
+    struct transport_run *run;
+    struct osh_rng_pool pool; /* one RNG slot per worker */
+    size_t *start;            /* chunk i holds the primaries start[i] .. start[i+1]-1 */
+    size_t nchunks;
+    double *cum; /* cumulative spot weights, nspots entries */
+
+    /* tally buffers, guarded by lock */
+    struct osh_thread_mutex lock;
+    void **pend;   /* finished buffers waiting for their turn to be merged, by chunk */
+    void **spare;  /* merged buffers, ready for reuse */
+    size_t nspare; /* number of spare buffers */
+    size_t commit; /* next chunk to merge */
+    size_t nsaved; /* multiples of nsave primaries saved */
+
+    size_t nhist;
+    size_t nsteps;
+};
+
+int osh_transport_run_init(struct transport_run *run,
+                           struct gemca_workspace *g,
+                           struct beam_workspace const *wb,
+                           struct transport_physics const *phys,
+                           struct transport_tally const *tally) {
+
+    if (!run || !g || !wb || !phys || !phys->density || !phys->dedx || !phys->range != !phys->erange)
+        return OSH_EINVAL;
+
+    memset(run, 0, sizeof(*run));
+    run->g = g;
+    run->wb = wb;
+    run->phys = *phys;
+    if (tally)
+        run->tally = *tally;
+
+    run->spots = wb->spots;
+    run->nspots = wb->nspots;
+    run->nstat = wb->nstat;
+    run->chunk_min = 1;
+    run->nsave = wb->nsave;
+    run->seed = (uint64_t) (uint32_t) wb->rndseed;
+    run->offset = (uint64_t) (uint32_t) wb->rndoffset;
+    run->rng_type = OSH_RNG_TYPE_PCG32;
+    run->rng_mode = OSH_TRANSPORT_RNG_HISTORY;
+    run->nthreads = 0;
+
+    return OSH_OK;
+}
+
+int osh_transport_run_slice(struct transport_run *run, size_t job, size_t njobs) {
+    size_t q, r;
+
+    if (njobs == 0 || job >= njobs)
+        return OSH_EINVAL;
+
+    q = run->nstat / njobs;
+    r = run->nstat % njobs;
+    run->first += job * q + ((job < r) ? job : r);
+    run->nstat = q + ((job < r) ? 1 : 0);
+
+    return OSH_OK;
+}
+
+/* cut nstat primaries into chunks of decreasing length, returns the number of chunks */
+static size_t _chunks(size_t nstat, size_t chunk_min, size_t *start) {
+    size_t n, s, len;
+
+    n = 0;
+    for (s = 0; s < nstat; s += len) {
+        len = (nstat - s + OSH_TRANSPORT_RUN_GUIDE - 1) / OSH_TRANSPORT_RUN_GUIDE;
+        if (len < chunk_min)
+            len = chunk_min;
+        if (len > nstat - s)
+            len = nstat - s;
+        if (start)
+            start[n] = s;
+        n++;
+    }
+    if (start)
+        start[n] = nstat;
+    return n;
+}
+
+/* pick a spot, weighted by spot->wt; uniform if no spot has a positive weight */
+static struct beam_spot const *_spot(struct run_state const *rs, struct osh_rng *rng) {
+    struct transport_run const *run = rs->run;
+    double u;
+    size_t lo, hi, mid;
+
+    if (run->nspots == 1)
+        return &run->spots[0];
+
+    u = osh_rng_double(rng) * rs->cum[run->nspots - 1];
+    lo = 0;
+    hi = run->nspots - 1;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (rs->cum[mid] > u)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return &run->spots[lo];
+}
+
+static void _fail(struct run_state *rs, int rc) {
+    osh_atomic_cas(&rs->rc, OSH_OK, rc);
+}
+
+/*
+ * Get an empty tally buffer, a spare one or a new one. Never waits: finished
+ * buffers stay in line for the merge while their workers go on with fresh
+ * ones, so a slow chunk holds back the merge but not the other workers.
+ */
+static void *_buf_get(struct run_state *rs) {
+    struct transport_tally const *t = &rs->run->tally;
+    void *buf;
+
+    osh_thread_mutex_lock(&rs->lock);
+    if (rs->nspare > 0) {
+        buf = rs->spare[--rs->nspare];
+        osh_thread_mutex_unlock(&rs->lock);
+        return buf;
+    }
+    osh_thread_mutex_unlock(&rs->lock);
+
+    buf = t->alloc(t->ctx);
+    if (!buf)
+        _fail(rs, OSH_ENOMEM);
+    return buf;
+}
+
+/* return an unused buffer */
+static void _buf_put(struct run_state *rs, void *buf) {
+    osh_thread_mutex_lock(&rs->lock);
+    rs->spare[rs->nspare++] = buf;
+    osh_thread_mutex_unlock(&rs->lock);
+}
+
+/* hand in the buffer of chunk c, and merge all buffers which are now next in line */
+static void _commit(struct run_state *rs, size_t c, void *buf) {
+    struct transport_tally const *t = &rs->run->tally;
+
+    osh_thread_mutex_lock(&rs->lock);
+    rs->pend[c] = buf;
+    while (rs->commit < rs->nchunks && rs->pend[rs->commit]) {
+        buf = rs->pend[rs->commit];
+        rs->pend[rs->commit] = NULL;
+        t->merge(t->ctx, buf);
+        rs->spare[rs->nspare++] = buf;
+        rs->commit++;
+    }
+    /* the final result is the caller's to write */
+    if (rs->run->nsave > 0 && t->save && rs->commit < rs->nchunks &&
+        rs->start[rs->commit] / rs->run->nsave > rs->nsaved) {
+        rs->nsaved = rs->start[rs->commit] / rs->run->nsave;
+        t->save(t->ctx);
+    }
+    osh_thread_mutex_unlock(&rs->lock);
+}
+
+static void _worker(void *arg, int id) {
+    struct run_state *rs = arg;
+    struct transport_run const *run = rs->run;
+    struct transport_workspace tw;
+    struct osh_rng *rng;
+    void *buf;
+    size_t c, k;
+    int64_t i;
+
+    if (osh_transport_init(&tw, run->g, run->wb, &run->phys, NULL) != OSH_OK) {
+        _fail(rs, OSH_ENOMEM);
+        return;
+    }
+    tw.scorer.score = run->tally.score;
+    tw.scorer.particle = run->tally.particle;
+
+    rng = osh_rng_pool_get(&rs->pool, (uint32_t) id);
+    while (osh_atomic_load(&rs->rc) == OSH_OK) {
+        /* the buffer first, so a failed allocation leaves no chunk claimed */
+        buf = NULL;
+        if (run->tally.alloc) {
+            buf = _buf_get(rs);
+            if (!buf)
+                break;
+        }
+
+        i = osh_atomic_fetch_add(&rs->next, 1);
+        if (i >= (int64_t) rs->nchunks) {
+            if (buf)
+                _buf_put(rs, buf);
+            break;
+        }
+        c = (size_t) i;
+
+        tw.scorer.data = buf;
+        for (k = rs->start[c]; k < rs->start[c + 1]; k++) {
+            if (run->rng_mode == OSH_TRANSPORT_RNG_HISTORY)
+                rng = osh_rng_pool_history(&rs->pool, (uint32_t) id, (uint64_t) (run->first + k));
+            if (buf && run->tally.history)
+                run->tally.history(buf);
+            osh_transport_primary(&tw, _spot(rs, rng), rng);
+        }
+
+        if (buf)
+            _commit(rs, c, buf);
+    }
+
+    osh_thread_mutex_lock(&rs->lock);
+    rs->nhist += tw.nhist;
+    rs->nsteps += tw.nsteps;
+    osh_thread_mutex_unlock(&rs->lock);
+
+    osh_transport_free(&tw);
+}
+
+static void _state_free(struct run_state *rs) {
+    struct transport_tally const *t = &rs->run->tally;
+    size_t i;
+
+    if (t->free) {
+        if (rs->pend)
+            for (i = 0; i < rs->nchunks; i++)
+                if (rs->pend[i])
+                    t->free(t->ctx, rs->pend[i]);
+        for (i = 0; i < rs->nspare; i++)
+            t->free(t->ctx, rs->spare[i]);
+    }
+    free(rs->pend);
+    free(rs->spare);
+    free(rs->start);
+    free(rs->cum);
+    osh_rng_pool_free(&rs->pool);
+    osh_thread_mutex_destroy(&rs->lock);
+    osh_aligned_free(rs);
+}
+
+int osh_transport_run(struct transport_run *run) {
+    struct run_state *rs;
+    double w;
+    size_t i;
+    int nthreads;
+    int rc;
+
+    if (!run->spots || run->nspots == 0)
+        return OSH_EINVAL;
+    if (run->tally.alloc && (!run->tally.score || !run->tally.merge || !run->tally.free))
+        return OSH_EINVAL;
+
+    nthreads = (run->nthreads > 0) ? run->nthreads : osh_thread_ncpu();
+    if (run->chunk_min == 0)
+        run->chunk_min = 1;
+
+    rs = osh_aligned_alloc(OSH_CACHELINE, sizeof(*rs));
+    if (!rs)
+        return OSH_ENOMEM;
+    memset(rs, 0, sizeof(*rs));
+    rs->run = run;
+    osh_thread_mutex_init(&rs->lock);
+
+    rs->nchunks = _chunks(run->nstat, run->chunk_min, NULL);
+    rs->start = malloc((rs->nchunks + 1) * sizeof(*rs->start));
+    rs->cum = malloc(run->nspots * sizeof(*rs->cum));
+    if (run->tally.alloc) {
+        /* a buffer is pending for a chunk, held by a worker or spare */
+        rs->pend = calloc(rs->nchunks + 1, sizeof(*rs->pend));
+        rs->spare = malloc((rs->nchunks + (size_t) nthreads) * sizeof(*rs->spare));
+    }
+    if (!rs->start || !rs->cum || (run->tally.alloc && (!rs->pend || !rs->spare)) ||
+        osh_rng_pool_init(&rs->pool, run->rng_type, run->seed, run->offset, (uint32_t) nthreads) != OSH_OK) {
+        _state_free(rs);
+        return OSH_ENOMEM;
+    }
+    _chunks(run->nstat, run->chunk_min, rs->start);
+
+    w = 0.0;
+    for (i = 0; i < run->nspots; i++) {
+        if (run->spots[i].wt > 0.0)
+            w += run->spots[i].wt;
+        rs->cum[i] = w;
+    }
+    if (w <= 0.0)
+        for (i = 0; i < run->nspots; i++)
+            rs->cum[i] = (double) (i + 1);
+
+    run->nthreads_used = osh_thread_run(nthreads, _worker, rs);
+
+    run->nchunks = rs->nchunks;
+    run->nhist = rs->nhist;
+    run->nsteps = rs->nsteps;
+    rc = (int) rs->rc;
+
+    _state_free(rs);
+    return rc;
+}
@@ -0,0 +1,154 @@
+#ifndef _OSH_TRANSPORT_RUN
+#define _OSH_TRANSPORT_RUN
+
+/**
+ * @file osh_transport_run.h
+ * @brief Multithreaded transport of all primaries of a run
+ *
+ * The primaries 0 .. nstat-1 are cut into chunks which worker threads claim
+ * one at a time. Chunks shrink towards the end of the run, the first is
+ * nstat / OSH_TRANSPORT_RUN_GUIDE primaries long and each following one is
+ * that fraction of what is left, so a few slow heavy ion histories at the
+ * end do not keep one core busy while the others idle.
+ *
+ * Each worker has its own transport workspace (and thereby its own
+ * secondary stack) and its own slot in an RNG pool. Scores of a chunk are
+ * collected in a private tally buffer, and the buffers are merged into the
+ * result in chunk order, whichever worker finishes first. A worker ahead of
+ * the merge leaves its buffer in line and goes on with a new one, so a slow
+ * chunk delays the merge but not the other workers, at the cost of one
+ * buffer per chunk waiting behind it.
+ *
+ * With nsave > 0 the tally is asked to save the result whenever the
+ * merged chunks pass another nsave primaries, at the first chunk boundary
+ * after each multiple. The save hook runs under the merge lock, so it
+ * should only take a copy and leave the writing to another thread.
+ *
+ * The chunk boundaries depend only on nstat and chunk_min, so with
+ * history-indexed random numbers (OSH_TRANSPORT_RNG_HISTORY), every history
+ * draws the same numbers, every buffer holds the same sums, and the result
+ * is bit-identical for any number of threads.
+ *
+ * A run can be spread over independent processes with
+ * osh_transport_run_slice(): each process transports its own slice of the
+ * primaries and writes a partial result (io/osh_partial.h), which are then
+ * merged with osh-merge. In history mode a primary draws the same random
+ * numbers whichever process transports it.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "random/osh_rng.h"
+#include "transport/osh_transport.h"
+#include "transport/osh_transport_engine.h"
+
+#define OSH_TRANSPORT_RUN_GUIDE 64 /* a chunk is 1/64 of the primaries not yet handed out */
+
+#define OSH_TRANSPORT_RNG_HISTORY 0 /* every primary history has its own RNG stream, reproducible */
+#define OSH_TRANSPORT_RNG_WORKER 1  /* every worker has its own RNG stream, depends on the thread count */
+
+/* forward declarations */
+struct gemca_workspace;
+struct beam_workspace;
+struct beam_spot;
+struct particle;
+
+/**
+ * @struct transport_tally
+ *
+ * @brief Scorer with per-chunk buffers.
+ *
+ * A buffer collects the steps of one chunk of primaries. It is only ever
+ * used by one thread at a time; merge() is called under a lock, one buffer
+ * at a time and in chunk order.
+ */
+struct transport_tally {
+    void *(*alloc)(void *ctx);                                                    /* new buffer, all zero, or NULL */
+    void (*score)(void *buf, struct particle const *part, struct step const *st); /* score a step into buf */
+    void (*merge)(void *ctx, void *buf); /* add buf to the result held by ctx, then zero buf */
+    void (*free)(void *ctx, void *buf);  /* release a buffer */
+    void *ctx;                           /* result of the run, passed to alloc, merge and free */
+    void (*history)(void *buf);          /* a primary history starts in buf, may be NULL */
+    void (*save)(void *ctx);             /* save an intermediate result, may be NULL */
+    void (*particle)(void *buf, struct particle *part); /* a particle starts its transport, may be NULL */
+};
+
+/**
+ * @struct transport_run
+ *
+ * @brief Settings and statistics of a multithreaded run.
+ */
+struct transport_run {
+    struct gemca_workspace *g;       /* geometry, shared read-only by all workers */
+    struct beam_workspace const *wb; /* beam, spots and transport settings */
+    struct transport_physics phys;   /* physics hooks, called concurrently from all workers */
+    struct transport_tally tally;    /* scorer, alloc == NULL for none */
+    struct beam_spot const *spots;   /* spots to sample primaries from, weighted by wt */
+    size_t nspots;                   /* number of spots */
+    size_t nstat;                    /* number of primaries */
+    size_t first;                    /* history number of the first primary, > 0 for slices */
+    size_t chunk_min;                /* smallest chunk of primaries */
+    size_t nsave;                    /* save the result every nsave primaries, 0 for never */
+    uint64_t seed;                   /* run seed */
+    uint64_t offset;                 /* job offset */
+    enum osh_rng_type rng_type;      /* RNG engine */
+    int rng_mode;                    /* OSH_TRANSPORT_RNG_* */
+    int nthreads;                    /* number of worker threads, 0 for one per CPU */
+
+    /* statistics, set by osh_transport_run() */
+    size_t nchunks;    /* number of chunks the primaries were cut into */
+    size_t nhist;      /* number of histories transported, primaries and secondaries */
+    size_t nsteps;     /* number of steps */
+    int nthreads_used; /* number of threads which ran */
+};
+
+/**
+ * @brief Initialise run settings from a beam workspace.
+ *
+ * nstat, nsave, seed, offset and the spots are taken from wb; the RNG is PCG32 in
+ * history mode and one thread per CPU is used. The caller may change any
+ * setting before calling osh_transport_run().
+ *
+ * @param[out] run Run to initialise.
+ * @param[in] g Geometry.
+ * @param[in] wb Beam workspace.
+ * @param[in] phys Physics hooks, density and dedx are required.
+ * @param[in] tally Scorer, may be NULL.
+ *
+ * @returns OSH_OK or OSH_EINVAL.
+ */
+int osh_transport_run_init(struct transport_run *run,
+                           struct gemca_workspace *g,
+                           struct beam_workspace const *wb,
+                           struct transport_physics const *phys,
+                           struct transport_tally const *tally);
+
+/**
+ * @brief Restrict a run to one slice of its primaries.
+ *
+ * The nstat primaries of the run are cut into njobs contiguous slices
+ * whose lengths differ by at most one; the run is set to slice job. Call
+ * once, after osh_transport_run_init(). If all jobs keep the same seed and
+ * offset, the slices together draw the same random numbers as one process
+ * running all primaries.
+ *
+ * @param[in,out] run Run.
+ * @param[in] job Index of this job, e.g. beam_workspace::rndoffset.
+ * @param[in] njobs Number of jobs, > job.
+ *
+ * @returns OSH_OK or OSH_EINVAL.
+ */
+int osh_transport_run_slice(struct transport_run *run, size_t job, size_t njobs);
+
+/**
+ * @brief Transport all primaries of a run.
+ *
+ * @param[in,out] run Run settings, statistics are filled in.
+ *
+ * @returns OSH_OK, OSH_EINVAL for a run without spots, or OSH_ENOMEM. On
+ *          OSH_ENOMEM the result is incomplete.
+ */
+int osh_transport_run(struct transport_run *run);
+
+#endif /* !_OSH_TRANSPORT_RUN */
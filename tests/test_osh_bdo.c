@@ -0,0 +1,150 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_rc.h"
+#include "io/osh_bdo.h"
+
+#define ASSERT_TRUE(cond)                                                                                              \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(stderr, "ASSERT FAILED: %s (%s:%d)\n", #cond, __FILE__, __LINE__);                                 \
+            exit(1);                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+#define BDO "test_bdo.bdo"
+#define NDATA 20000 /* more than one chunk */
+
+static double data[NDATA];
+
+/* i * 0.5 for the streamed record */
+static void fill_half(void *d, size_t first, size_t n, double *x) {
+    size_t i;
+
+    (void) d;
+    ASSERT_TRUE(n <= OSH_BDO_CHUNK / 8);
+    for (i = 0; i < n; i++)
+        x[i] = 0.5 * (double) (first + i);
+}
+
+static void write_file(int codec) {
+    struct osh_bdo_writer w;
+    int64_t n[3] = {10, -20, 30};
+    int i;
+
+    for (i = 0; i < NDATA; i++)
+        data[i] = (i % 100 == 0) ? 1.0 / (i + 1) : 0.0;
+
+    ASSERT_TRUE(osh_bdo_open(&w, BDO, codec) == OSH_OK);
+    ASSERT_TRUE(osh_bdo_str(&w, OSH_BDO_TAG_GEO_NAME, "MyMesh") == OSH_OK);
+    ASSERT_TRUE(osh_bdo_i64(&w, OSH_BDO_TAG_GEO_N, n, 3) == OSH_OK);
+    ASSERT_TRUE(osh_bdo_f64(&w, OSH_BDO_TAG_PAGE_DATA, data, NDATA) == OSH_OK);
+    ASSERT_TRUE(osh_bdo_f64_stream(&w, OSH_BDO_TAG_PAGE_ERROR, NDATA, fill_half, NULL) == OSH_OK);
+    ASSERT_TRUE(osh_bdo_str(&w, 1000, "") == OSH_OK); /* unknown tags are kept */
+    ASSERT_TRUE(osh_bdo_close(&w) == OSH_OK);
+}
+
+static void check_file(void) {
+    struct osh_bdo_record *r;
+    size_t nr;
+    int64_t const *x;
+    double const *d;
+    int i;
+
+    ASSERT_TRUE(osh_bdo_read(BDO, &r, &nr) == OSH_OK && nr == 5);
+    ASSERT_TRUE(r[0].tag == OSH_BDO_TAG_GEO_NAME && r[0].type == OSH_BDO_TYPE_STR);
+    ASSERT_TRUE(r[0].n == 6 && strcmp(r[0].data, "MyMesh") == 0);
+    x = r[1].data;
+    ASSERT_TRUE(r[1].type == OSH_BDO_TYPE_I64 && r[1].n == 3 && x[0] == 10 && x[1] == -20 && x[2] == 30);
+    ASSERT_TRUE(r[2].type == OSH_BDO_TYPE_F64 && r[2].n == NDATA);
+    ASSERT_TRUE(memcmp(r[2].data, data, sizeof(data)) == 0);
+    d = r[3].data;
+    ASSERT_TRUE(r[3].tag == OSH_BDO_TAG_PAGE_ERROR && r[3].n == NDATA);
+    for (i = 0; i < NDATA; i++)
+        ASSERT_TRUE(d[i] == 0.5 * i);
+    ASSERT_TRUE(r[4].tag == 1000 && r[4].n == 0 && strcmp(r[4].data, "") == 0);
+    osh_bdo_free(r, nr);
+}
+
+static void test_roundtrip(void) {
+    write_file(OSH_BDO_CODEC_NONE);
+    check_file();
+}
+
+static void test_zstd(void) {
+    struct osh_bdo_writer w;
+#ifdef OSH_HAVE_ZSTD
+    FILE *fp;
+    long len;
+
+    write_file(OSH_BDO_CODEC_ZSTD);
+    check_file();
+    /* mostly empty pages shrink */
+    fp = fopen(BDO, "rb");
+    ASSERT_TRUE(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fclose(fp);
+    ASSERT_TRUE(len < (long) (NDATA * 8));
+#else
+    ASSERT_TRUE(osh_bdo_open(&w, BDO, OSH_BDO_CODEC_ZSTD) == OSH_ENOTSUP);
+#endif
+    ASSERT_TRUE(osh_bdo_open(&w, BDO, 7) == OSH_EINVAL);
+}
+
+static void test_errors(void) {
+    struct osh_bdo_record *r;
+    size_t nr, len;
+    char *buf;
+    FILE *fp;
+
+    write_file(OSH_BDO_CODEC_NONE);
+    fp = fopen(BDO, "rb");
+    ASSERT_TRUE(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    len = (size_t) ftell(fp);
+    rewind(fp);
+    buf = malloc(len);
+    ASSERT_TRUE(buf != NULL && fread(buf, 1, len, fp) == len);
+    fclose(fp);
+
+    /* one flipped bit */
+    buf[1000] ^= 0x10;
+    fp = fopen(BDO, "wb");
+    fwrite(buf, 1, len, fp);
+    fclose(fp);
+    ASSERT_TRUE(osh_bdo_read(BDO, &r, &nr) == OSH_EPARSE && r == NULL);
+    buf[1000] ^= 0x10;
+
+    /* truncated */
+    fp = fopen(BDO, "wb");
+    fwrite(buf, 1, len / 2, fp);
+    fclose(fp);
+    ASSERT_TRUE(osh_bdo_read(BDO, &r, &nr) == OSH_EINCOMPLETE && r == NULL);
+
+    /* newer version */
+    buf[8] = 2;
+    fp = fopen(BDO, "wb");
+    fwrite(buf, 1, len, fp);
+    fclose(fp);
+    ASSERT_TRUE(osh_bdo_read(BDO, &r, &nr) == OSH_ENOTSUP);
+
+    /* not a .bdo file */
+    fp = fopen(BDO, "wb");
+    fputs("hello", fp);
+    fclose(fp);
+    ASSERT_TRUE(osh_bdo_read(BDO, &r, &nr) == OSH_EPARSE);
+
+    free(buf);
+    remove(BDO);
+}
+
+int main(void) {
+    test_roundtrip();
+    test_zstd();
+    test_errors();
+
+    return 0;
+}
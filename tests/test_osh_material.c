@@ -0,0 +1,229 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_const.h"
+#include "common/osh_rc.h"
+#include "gemca/osh_gemca2.h"
+#include "material/osh_material.h"
+#include "material/osh_material_ct.h"
+#include "particle/osh_particle.h"
+#include "physics/osh_stopping.h"
+
+#define ASSERT_TRUE(cond)                                                                                              \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(stderr, "ASSERT FAILED: %s (%s:%d)\n", #cond, __FILE__, __LINE__);                                 \
+            exit(1);                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+#define TEST_MAT01 "../../tests/res/test01/mat.dat"
+#define TEST_MAT "../../tests/res/material/mat.dat"
+#define TEST_GEO "../../tests/res/transport/geo.dat"
+#define TMP_MAT "test_material_tmp.dat"
+
+static int close_to(double x, double ref, double rel) {
+    return fabs(x - ref) <= rel * fabs(ref);
+}
+
+static void test_test01(void) {
+    struct material_workspace mw;
+    struct medium const *m;
+
+    ASSERT_TRUE(osh_material_load(TEST_MAT01, &mw) == OSH_OK);
+    ASSERT_TRUE(mw.nmedia == 1);
+    m = osh_material_medium(&mw, 1);
+    ASSERT_TRUE(m && m->id == 1 && m->icru == 276);
+    ASSERT_TRUE(m->rho == 0.9987654321);
+    ASSERT_TRUE(m->ival == 75.0 && m->state == OSH_MATERIAL_STATE_CONDENSED);
+    ASSERT_TRUE(m->nelem == 2 && m->elem[0].z == 1 && m->elem[1].z == 8);
+    ASSERT_TRUE(close_to(m->zovera, 0.55508, 1e-4));
+    ASSERT_TRUE(close_to(m->ne, m->rho * OSH_NAVOGADRO * m->zovera, 1e-12));
+    ASSERT_TRUE(close_to(m->x0, 36.08, 0.01));
+    ASSERT_TRUE(close_to(m->elem[1].natoms, 0.5 * m->elem[0].natoms, 1e-3));
+    ASSERT_TRUE(osh_material_density(&mw, 1) == 0.9987654321);
+    ASSERT_TRUE(osh_material_medium(&mw, 2) == NULL && osh_material_medium(&mw, 1000) == NULL);
+    osh_material_free(&mw);
+}
+
+static void test_media(void) {
+    struct material_workspace mw;
+    struct medium const *m;
+    struct medium const *w;
+    struct stopping_medium sm[5];
+    struct stopping_workspace sw;
+
+    ASSERT_TRUE(osh_material_load(TEST_MAT, &mw) == OSH_OK);
+    ASSERT_TRUE(mw.nmedia == 5);
+
+    /* PMMA from atoms per molecule matches ICRU 222 */
+    m = osh_material_medium(&mw, 2);
+    ASSERT_TRUE(m && m->icru == 0 && m->nelem == 3);
+    ASSERT_TRUE(close_to(m->elem[0].w, 0.080538, 1e-3));
+    ASSERT_TRUE(close_to(m->elem[1].w, 0.599848, 1e-3));
+    ASSERT_TRUE(close_to(m->elem[2].w, 0.319614, 1e-3));
+    ASSERT_TRUE(close_to(m->ival, 74.0, 0.05));
+
+    m = osh_material_medium(&mw, 3);
+    ASSERT_TRUE(m && m->state == OSH_MATERIAL_STATE_GAS && m->rho == 1.20479e-3 && m->ival == 85.7);
+    ASSERT_TRUE(close_to(m->x0, 36.62, 0.01));
+
+    m = osh_material_medium(&mw, 82);
+    ASSERT_TRUE(m && m->nelem == 1 && m->elem[0].w == 1.0 && m->ival == 823.0);
+    ASSERT_TRUE(close_to(m->elem[0].amass, 207.2, 1e-3));
+    ASSERT_TRUE(close_to(m->x0, 6.37, 0.02));
+
+    /* water by mass fractions is water */
+    m = osh_material_medium(&mw, 5);
+    w = osh_material_medium(&mw, 1);
+    ASSERT_TRUE(m && w && m->ival == 78.0);
+    ASSERT_TRUE(close_to(m->zovera, w->zovera, 1e-9) && close_to(m->x0, w->x0, 1e-9));
+
+    /* the stopping power tables take the media as they are */
+    osh_material_stopping(&mw, sm);
+    ASSERT_TRUE(sm[3].medium == 82 && sm[3].ival == 823.0 && sm[3].z == 82.0);
+    ASSERT_TRUE(osh_stopping_init(&sw, sm, mw.nmedia, 1) == OSH_OK);
+    osh_stopping_free(&sw);
+
+    osh_material_free(&mw);
+}
+
+static int load_text(const char *text) {
+    struct material_workspace mw;
+    FILE *fp;
+    int rc;
+
+    fp = fopen(TMP_MAT, "w");
+    ASSERT_TRUE(fp != NULL);
+    fputs(text, fp);
+    fclose(fp);
+    rc = osh_material_load(TMP_MAT, &mw);
+    if (rc == OSH_OK)
+        osh_material_free(&mw);
+    remove(TMP_MAT);
+    return rc;
+}
+
+static void test_errors(void) {
+    ASSERT_TRUE(load_text("MEDIUM 1\nICRU 276\nEND\n") == OSH_OK);
+    ASSERT_TRUE(load_text("MEDIUM 1\nICRU 276\n") == OSH_EPARSE);                    /* no END */
+    ASSERT_TRUE(load_text("MEDIUM 1\nICRU 276\nMEDIUM 2\nICRU 276\nEND\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("ICRU 276\n") == OSH_EPARSE);                              /* outside a block */
+    ASSERT_TRUE(load_text("MEDIUM 1\nICRU 276\nNUCLID H 2\nEND\n") == OSH_EPARSE);   /* both */
+    ASSERT_TRUE(load_text("MEDIUM 1\nICRU 9999\nEND\n") == OSH_EPARSE);              /* unknown */
+    ASSERT_TRUE(load_text("MEDIUM 1\nICRU 6\nEND\n") == OSH_EPARSE);                 /* element without RHO */
+    ASSERT_TRUE(load_text("MEDIUM 1\nNUCLID H 2\nNUCLID O -0.9\nRHO 1\nEND\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("MEDIUM 1\nNUCLID Xx 2\nRHO 1\nEND\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("MEDIUM 1\nICRU 276\nRHO -1\nEND\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("MEDIUM 1\nICRU 276\nEND\nMEDIUM 1\nICRU 276\nEND\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("MEDIUM 1000\nICRU 276\nEND\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("MEDIUM 1\nICRU 276\nFOO 1\nEND\n") == OSH_OK);           /* unknown keys are ignored */
+}
+
+static void test_init(void) {
+    struct material_workspace mw;
+    struct medium m[2];
+    struct gemca_workspace *g;
+
+    memset(m, 0, sizeof(m));
+    m[0].id = 7;
+    m[0].icru = 222;
+    m[1].id = 1;
+    m[1].rho = 2.0;
+    m[1].nelem = 1;
+    m[1].elem[0].z = 6;
+    m[1].elem[0].w = 1.0;
+    ASSERT_TRUE(osh_material_init(&mw, m, 2) == OSH_OK);
+    ASSERT_TRUE(osh_material_medium(&mw, 7)->rho == 1.19);
+    ASSERT_TRUE(osh_material_medium(&mw, 1)->ival == 78.0);
+
+    /* every zone of the geometry has a medium */
+    osh_gemca_workspace_init(&g);
+    osh_gemca_load(TEST_GEO, g);
+    ASSERT_TRUE(osh_material_check(&mw, g) == OSH_OK);
+    osh_material_free(&mw);
+
+    ASSERT_TRUE(osh_material_init(&mw, m, 1) == OSH_OK);
+    ASSERT_TRUE(osh_material_check(&mw, g) == OSH_EINVAL);
+    osh_material_free(&mw);
+    osh_gemca_workspace_free(g);
+
+    m[1].id = 7;
+    ASSERT_TRUE(osh_material_init(&mw, m, 2) == OSH_EINVAL);
+    m[1].id = 1;
+    m[1].rho = 0.0;
+    ASSERT_TRUE(osh_material_init(&mw, m, 2) == OSH_EINVAL);
+}
+
+static void test_ct(void) {
+    struct material_ct ct;
+    struct stopping_medium sm[OSH_MATERIAL_CT_NMEDIA];
+    struct stopping_workspace sw;
+    struct particle proton;
+    double rho, rho2, s, s2;
+    int medium, medium2;
+
+    ASSERT_TRUE(osh_material_ct_init(&ct, 980) == OSH_EINVAL);
+    ASSERT_TRUE(osh_material_ct_init(&ct, 100) == OSH_OK);
+    ASSERT_TRUE(ct.mw.nmedia == OSH_MATERIAL_CT_NMEDIA);
+    ASSERT_TRUE(osh_material_medium(&ct.mw, 100)->state == OSH_MATERIAL_STATE_GAS);
+
+    osh_material_ct_lookup(&ct, -1000, &medium, &rho);
+    ASSERT_TRUE(medium == 100 && close_to(rho, 0.00121, 1e-3));
+    osh_material_ct_lookup(&ct, -3000, &medium2, &rho2);
+    ASSERT_TRUE(medium2 == medium && rho2 == rho);
+    osh_material_ct_lookup(&ct, -951, &medium, &rho);
+    ASSERT_TRUE(medium == 100);
+    osh_material_ct_lookup(&ct, -950, &medium, &rho);
+    ASSERT_TRUE(medium == 101);
+    osh_material_ct_lookup(&ct, 0, &medium, &rho);
+    ASSERT_TRUE(medium == 105 && close_to(rho, 1.018, 1e-6));
+    osh_material_ct_lookup(&ct, 20, &medium, &rho);
+    ASSERT_TRUE(medium == 107 && close_to(rho, 1.03, 1e-6));
+    osh_material_ct_lookup(&ct, 1600, &medium, &rho);
+    ASSERT_TRUE(medium == 123 && close_to(rho, 1.9642, 1e-6));
+    osh_material_ct_lookup(&ct, 4000, &medium2, &rho2);
+    ASSERT_TRUE(medium2 == 123 && rho2 == rho);
+
+    /* the calibration reproduces the mean densities of the tissue intervals */
+    ASSERT_TRUE(close_to(osh_material_ct_hu2rho(100), 1.0762, 1e-4));
+    ASSERT_TRUE(close_to(osh_material_ct_hu2rho(-68), 0.95728, 1e-3));
+    /* the skeletal fit starts with the skeletal base media, at 80 HU */
+    ASSERT_TRUE(close_to(osh_material_ct_hu2rho(79), 1.003 + 1.169e-3 * 79, 1e-9));
+    ASSERT_TRUE(close_to(osh_material_ct_hu2rho(80), 1.017 + 0.592e-3 * 80, 1e-9));
+
+    /* one stopping power table per base medium, scaled by the voxel density */
+    osh_material_stopping(&ct.mw, sm);
+    ASSERT_TRUE(osh_stopping_init(&sw, sm, ct.mw.nmedia, 1) == OSH_OK);
+    ASSERT_TRUE(sw.nmedia == OSH_MATERIAL_CT_NMEDIA);
+
+    memset(&proton, 0, sizeof(proton));
+    proton.z = 1;
+    proton.a = 1;
+    proton.amu = 1.007276;
+    osh_material_ct_lookup(&ct, 300, &medium, &rho);
+    osh_material_ct_lookup(&ct, 399, &medium2, &rho2);
+    ASSERT_TRUE(medium == medium2 && rho2 > rho);
+    s = osh_stopping_dedx(&sw, &proton, medium, 100.0) * rho;
+    s2 = osh_stopping_dedx(&sw, &proton, medium2, 100.0) * rho2;
+    ASSERT_TRUE(close_to(s2 / s, rho2 / rho, 1e-12));
+
+    /* adipose tissue stops less per cm than bone */
+    osh_material_ct_lookup(&ct, -100, &medium2, &rho2);
+    ASSERT_TRUE(osh_stopping_dedx(&sw, &proton, medium2, 100.0) * rho2 < s);
+
+    osh_stopping_free(&sw);
+    osh_material_ct_free(&ct);
+}
+
+int main(void) {
+    test_test01();
+    test_media();
+    test_errors();
+    test_init();
+    test_ct();
+
+    return 0;
+}
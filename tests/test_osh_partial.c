@@ -0,0 +1,183 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_rc.h"
+#include "io/osh_partial.h"
+
+#define ASSERT_TRUE(cond)                                                                                              \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(stderr, "ASSERT FAILED: %s (%s:%d)\n", #cond, __FILE__, __LINE__);                                 \
+            exit(1);                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+#define NJOBS 3
+#define NDOSE 20000 /* more than one streaming piece */
+#define NFLU 7
+
+static const char *part_name[NJOBS] = {"test_partial_0.part", "test_partial_1.part", "test_partial_2.part"};
+#define MERGED "test_partial_merged.part"
+#define OTHER "test_partial_other.part"
+
+static double dose[NJOBS][NDOSE];
+static double dose2[NJOBS][NDOSE];
+static double flu[NJOBS][NFLU];
+
+static void fill(int job, struct osh_partial_block b[2]) {
+    for (int i = 0; i < NDOSE; i++) {
+        dose[job][i] = 0.1 * (job + 1) + 1e-3 * i;
+        dose2[job][i] = dose[job][i] * dose[job][i] / 7.0;
+    }
+    for (int i = 0; i < NFLU; i++)
+        flu[job][i] = (double) (job * 100 + i) / 3.0;
+
+    memset(b, 0, 2 * sizeof(*b));
+    strcpy(b[0].name, "dose");
+    b[0].n = NDOSE;
+    b[0].sum = dose[job];
+    b[0].sum2 = dose2[job];
+    strcpy(b[1].name, "fluence");
+    b[1].n = NFLU;
+    b[1].sum = flu[job];
+}
+
+static void test_roundtrip(void) {
+    struct osh_partial_block b[2];
+    struct osh_partial_block *r;
+    uint64_t nprim;
+    size_t nb;
+
+    fill(0, b);
+    ASSERT_TRUE(osh_partial_write(part_name[0], 1000u, b, 2) == OSH_OK);
+    ASSERT_TRUE(osh_partial_read(part_name[0], &nprim, &r, &nb) == OSH_OK);
+    ASSERT_TRUE(nprim == 1000u && nb == 2);
+    ASSERT_TRUE(strcmp(r[0].name, "dose") == 0 && r[0].n == NDOSE && r[0].sum2 != NULL);
+    ASSERT_TRUE(strcmp(r[1].name, "fluence") == 0 && r[1].n == NFLU && r[1].sum2 == NULL);
+    ASSERT_TRUE(memcmp(r[0].sum, dose[0], sizeof(dose[0])) == 0);
+    ASSERT_TRUE(memcmp(r[0].sum2, dose2[0], sizeof(dose2[0])) == 0);
+    ASSERT_TRUE(memcmp(r[1].sum, flu[0], sizeof(flu[0])) == 0);
+    osh_partial_free(r, nb);
+
+    /* names must fit with their terminating NUL */
+    memset(b[1].name, 'x', OSH_PARTIAL_NAMELEN);
+    ASSERT_TRUE(osh_partial_write(OTHER, 1u, b, 2) == OSH_EINVAL);
+}
+
+static void test_merge(void) {
+    struct osh_partial_block b[2];
+    struct osh_partial_block *r;
+    uint64_t nprim;
+    size_t nb;
+    double x;
+
+    for (int j = 0; j < NJOBS; j++) {
+        fill(j, b);
+        ASSERT_TRUE(osh_partial_write(part_name[j], 1000u + (uint64_t) j, b, 2) == OSH_OK);
+    }
+
+    ASSERT_TRUE(osh_partial_merge(MERGED, part_name, NJOBS) == OSH_OK);
+    ASSERT_TRUE(osh_partial_read(MERGED, &nprim, &r, &nb) == OSH_OK);
+    ASSERT_TRUE(nprim == 3003u && nb == 2);
+    for (int i = 0; i < NDOSE; i++) {
+        x = 0.0;
+        for (int j = 0; j < NJOBS; j++)
+            x += dose[j][i];
+        ASSERT_TRUE(r[0].sum[i] == x);
+        x = 0.0;
+        for (int j = 0; j < NJOBS; j++)
+            x += dose2[j][i];
+        ASSERT_TRUE(r[0].sum2[i] == x);
+    }
+    for (int i = 0; i < NFLU; i++)
+        ASSERT_TRUE(r[1].sum[i] == flu[0][i] + flu[1][i] + flu[2][i]);
+    osh_partial_free(r, nb);
+    remove(MERGED);
+}
+
+static void fill_ones(void *data, size_t first, size_t n, double *x) {
+    (void) data;
+    (void) first;
+    for (size_t i = 0; i < n; i++)
+        x[i] = 1.0;
+}
+
+static void test_errors(void) {
+    struct osh_partial_block b[2];
+    struct osh_partial_block *r;
+    const char *in[2];
+    uint64_t nprim;
+    size_t nb;
+    FILE *fp;
+
+    /* different layout */
+    fill(0, b);
+    b[1].n = NFLU - 1;
+    ASSERT_TRUE(osh_partial_write(OTHER, 1u, b, 2) == OSH_OK);
+    in[0] = part_name[0];
+    in[1] = OTHER;
+    ASSERT_TRUE(osh_partial_merge(MERGED, in, 2) == OSH_EINVAL);
+    ASSERT_TRUE(fopen(MERGED, "rb") == NULL);
+
+    /* one flipped bit */
+    fp = fopen(OTHER, "r+b");
+    ASSERT_TRUE(fp != NULL);
+    fseek(fp, 100, SEEK_SET);
+    fputc(0x55, fp);
+    fclose(fp);
+    ASSERT_TRUE(osh_partial_read(OTHER, &nprim, &r, &nb) == OSH_EPARSE && r == NULL);
+
+    /* truncated */
+    fill(0, b);
+    ASSERT_TRUE(osh_partial_write(OTHER, 1u, b, 2) == OSH_OK);
+    fp = fopen(OTHER, "r+b");
+    ASSERT_TRUE(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    nb = (size_t) ftell(fp);
+    fclose(fp);
+    fp = fopen(OTHER, "rb");
+    {
+        char *buf = malloc(nb);
+        ASSERT_TRUE(fread(buf, 1, nb, fp) == nb);
+        fclose(fp);
+        fp = fopen(OTHER, "wb");
+        fwrite(buf, 1, nb / 2, fp);
+        fclose(fp);
+        free(buf);
+    }
+    ASSERT_TRUE(osh_partial_read(OTHER, &nprim, &r, &nb) == OSH_EINCOMPLETE);
+    in[1] = OTHER;
+    ASSERT_TRUE(osh_partial_merge(MERGED, in, 2) == OSH_EINCOMPLETE);
+
+    /* a writer closed before all announced blocks, no file is left */
+    {
+        struct osh_partial_writer w;
+
+        remove(OTHER);
+        ASSERT_TRUE(osh_partial_open(&w, OTHER, 1u, 2) == OSH_OK);
+        ASSERT_TRUE(osh_partial_block(&w, "dose", NFLU, fill_ones, NULL, NULL) == OSH_OK);
+        ASSERT_TRUE(osh_partial_close(&w) == OSH_EINVAL);
+        ASSERT_TRUE(fopen(OTHER, "rb") == NULL);
+    }
+
+    /* not a partial result */
+    fp = fopen(OTHER, "wb");
+    fputs("OSHPARTX and some more bytes to fill a header", fp);
+    fclose(fp);
+    ASSERT_TRUE(osh_partial_read(OTHER, &nprim, &r, &nb) == OSH_EPARSE);
+    remove(OTHER);
+    ASSERT_TRUE(osh_partial_read(OTHER, &nprim, &r, &nb) == OSH_EIO);
+}
+
+int main(void) {
+    test_roundtrip();
+    test_merge();
+    test_errors();
+
+    for (int j = 0; j < NJOBS; j++)
+        remove(part_name[j]);
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "beam/osh_beam_phsp.h"
+#include "common/osh_rc.h"
+#include "io/osh_phsp.h"
+
+#define ASSERT_TRUE(cond)                                                                                              \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(stderr, "ASSERT FAILED: %s (%s:%d)\n", #cond, __FILE__, __LINE__);                                 \
+            exit(1);                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+#define PHSP "test_phsp.phsp"
+#define NREC 5000 /* more than one piece */
+
+static struct osh_phsp_record rec[NREC];
+
+static void fill(void) {
+    int i;
+
+    memset(rec, 0, sizeof(rec));
+    for (i = 0; i < NREC; i++) {
+        rec[i].p[0] = 0.5 * i;
+        rec[i].p[2] = -1.0;
+        rec[i].v[2] = 1.0;
+        rec[i].e = 100.0 + i;
+        rec[i].wt = 1.0;
+        rec[i].amass = 938.272;
+        rec[i].amu = 1.007;
+        rec[i].id = 2;
+        rec[i].z = (i % 2) ? -1 : 1;
+        rec[i].a = 1;
+        rec[i].gen = (unsigned int) (i % 3);
+        rec[i].pdg = 2212;
+    }
+}
+
+static void write_file(void) {
+    struct osh_phsp_writer w;
+
+    fill();
+    ASSERT_TRUE(osh_phsp_open(&w, PHSP) == OSH_OK);
+    ASSERT_TRUE(osh_phsp_write(&w, rec, 10) == OSH_OK);
+    ASSERT_TRUE(osh_phsp_write(&w, rec + 10, NREC - 10) == OSH_OK);
+    ASSERT_TRUE(osh_phsp_close(&w, 1234) == OSH_OK);
+}
+
+static void test_roundtrip(void) {
+    struct osh_phsp_record *r;
+    struct osh_phsp_writer w;
+    uint64_t nprim;
+    size_t n;
+
+    write_file();
+    ASSERT_TRUE(osh_phsp_read(PHSP, &nprim, &r, &n) == OSH_OK);
+    ASSERT_TRUE(n == NREC && nprim == 1234);
+    ASSERT_TRUE(r[4999].p[0] == 2499.5 && r[4999].p[2] == -1.0 && r[4999].v[2] == 1.0 && r[4999].e == 5099.0);
+    ASSERT_TRUE(r[1].z == -1 && r[2].gen == 2 && r[3].pdg == 2212 && r[3].amu == 1.007);
+    free(r);
+
+    /* a file without records */
+    ASSERT_TRUE(osh_phsp_open(&w, PHSP) == OSH_OK);
+    ASSERT_TRUE(osh_phsp_close(&w, 7) == OSH_OK);
+    ASSERT_TRUE(osh_phsp_read(PHSP, &nprim, &r, &n) == OSH_OK);
+    ASSERT_TRUE(n == 0 && nprim == 7);
+    free(r);
+    remove(PHSP);
+}
+
+static void test_beam(void) {
+    struct beam_phsp *ph;
+
+    write_file();
+    ASSERT_TRUE(osh_beam_phsp_load(&ph, PHSP) == OSH_OK);
+    ASSERT_TRUE(ph->len == NREC && ph->nprim == 1234 && strcmp(ph->fname, PHSP) == 0);
+    ASSERT_TRUE(ph->p[0][10] == 5.0 && ph->d[2][10] == 1.0 && ph->e[10] == 110.0 && ph->wt[10] == 1.0);
+    ASSERT_TRUE(ph->part[11]->z == -1 && ph->part[11]->pdg == 2212 && ph->part[11]->amass == 938.272);
+    ASSERT_TRUE(osh_beam_phsp_free(ph) == OSH_OK);
+    remove(PHSP);
+
+    ASSERT_TRUE(osh_beam_phsp_load(&ph, PHSP) == OSH_EIO && ph == NULL);
+}
+
+static void test_errors(void) {
+    struct osh_phsp_record *r;
+    uint64_t nprim;
+    size_t n, len;
+    char *buf;
+    FILE *fp;
+
+    ASSERT_TRUE(osh_phsp_read(PHSP, &nprim, &r, &n) == OSH_EIO);
+
+    write_file();
+    fp = fopen(PHSP, "rb");
+    ASSERT_TRUE(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    len = (size_t) ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    buf = malloc(len);
+    ASSERT_TRUE(buf && fread(buf, 1, len, fp) == len);
+    fclose(fp);
+    ASSERT_TRUE(len == 16 + NREC * OSH_PHSP_RECORD + 24);
+
+    /* truncated */
+    fp = fopen(PHSP, "wb");
+    fwrite(buf, 1, len - 30, fp);
+    fclose(fp);
+    ASSERT_TRUE(osh_phsp_read(PHSP, &nprim, &r, &n) == OSH_EINCOMPLETE && r == NULL);
+
+    /* one flipped byte fails the checksum */
+    buf[1000] ^= 1;
+    fp = fopen(PHSP, "wb");
+    fwrite(buf, 1, len, fp);
+    fclose(fp);
+    ASSERT_TRUE(osh_phsp_read(PHSP, &nprim, &r, &n) == OSH_EPARSE);
+    buf[1000] ^= 1;
+
+    /* not a phase-space file */
+    buf[0] = 'X';
+    fp = fopen(PHSP, "wb");
+    fwrite(buf, 1, len, fp);
+    fclose(fp);
+    ASSERT_TRUE(osh_phsp_read(PHSP, &nprim, &r, &n) == OSH_EPARSE);
+
+    free(buf);
+    remove(PHSP);
+}
+
+int main(void) {
+    test_roundtrip();
+    test_beam();
+    test_errors();
+
+    return 0;
+}
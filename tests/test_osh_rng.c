@@ -82,11 +82,83 @@ static void test_gauss01_known_values(void) {
     }
 }
 
+static void moments_check(double const *x, int n) {
+    double m = 0.0;
+    double v = 0.0;
+    int nlo = 0;
+    int ntail = 0;
+
+    for (int i = 0; i < n; ++i) {
+        m += x[i];
+        v += x[i] * x[i];
+        if (x[i] < -1.0)
+            nlo++;
+        if (fabs(x[i]) > 3.442619855899)
+            ntail++;
+    }
+    m /= n;
+    v = v / n - m * m;
+
+    /* 200k samples: sigma(mean) ~ 2.2e-3, sigma(var) ~ 3.2e-3 */
+    ASSERT_TRUE(fabs(m) < 0.015);
+    ASSERT_TRUE(fabs(v - 1.0) < 0.02);
+    /* P(x < -1) = 0.158655 */
+    ASSERT_TRUE(fabs((double) nlo / n - 0.158655) < 0.005);
+    /* P(|x| > r) = 5.76e-4, i.e. ~115 samples; the tail path must be taken */
+    ASSERT_TRUE(ntail > 60 && ntail < 180);
+}
+
+static void test_gauss01_ziggurat(void) {
+    struct osh_rng r;
+    enum { N = 200000 };
+    static double x[N];
+
+    osh_rng_init(&r, OSH_RNG_TYPE_XOSHIRO256SS, 7u, 3u);
+    osh_rng_set_gauss(&r, OSH_RNG_GAUSS_ZIGGURAT);
+    ASSERT_TRUE(r.gauss_type == OSH_RNG_GAUSS_ZIGGURAT);
+    for (int i = 0; i < N; ++i)
+        x[i] = osh_rng_gauss01(&r);
+    moments_check(x, N);
+
+    osh_rng_init(&r, OSH_RNG_TYPE_PCG32, 7u, 3u);
+    osh_rng_set_gauss(&r, OSH_RNG_GAUSS_ZIGGURAT);
+    osh_rng_gauss01_vec(&r, x, N);
+    moments_check(x, N);
+
+    /* switching back restores the polar stream */
+    osh_rng_init(&r, OSH_RNG_TYPE_PCG32, 42u, 54u);
+    osh_rng_set_gauss(&r, OSH_RNG_GAUSS_ZIGGURAT);
+    osh_rng_set_gauss(&r, OSH_RNG_GAUSS_POLAR);
+    ASSERT_TRUE(fabs(osh_rng_gauss01(&r) - 0.8010234011838121) < 1e-15);
+}
+
+static void test_gauss01f_vec(void) {
+    struct osh_rng r;
+    enum { N = 200001 }; /* odd, to cover the tail handling */
+    static float xf[N];
+    static double x[N];
+
+    osh_rng_init(&r, OSH_RNG_TYPE_XOSHIRO256SS, 9u, 4u);
+    xf[N - 1] = NAN;
+    osh_rng_gauss01f_vec(&r, xf, N);
+    for (int i = 0; i < N; ++i) {
+        ASSERT_TRUE(isfinite(xf[i]));
+        /* 24-bit uniforms truncate Box-Muller at 5.77 */
+        ASSERT_TRUE(fabsf(xf[i]) < 5.8f);
+        x[i] = xf[i];
+    }
+    moments_check(x, N);
+
+    ASSERT_TRUE(isfinite(osh_rng_gauss01f(&r)));
+}
+
 int main(void) {
     test_pcg32_known_sequence();
     test_xoshiro256ss_known_sequence();
     test_uniform_ranges();
     test_gauss01_known_values();
+    test_gauss01_ziggurat();
+    test_gauss01f_vec();
 
     return 0;
 }
@@ -0,0 +1,279 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common/osh_rc.h"
+#include "particle/osh_particle.h"
+#include "random/osh_rng.h"
+#include "random/osh_rng_dist.h"
+
+#define ASSERT_TRUE(cond)                                                                                              \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(stderr, "ASSERT FAILED: %s (%s:%d)\n", #cond, __FILE__, __LINE__);                                 \
+            exit(1);                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+#define N 100000
+
+static double bx[N];
+static double by[N];
+static double bz[N];
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(double const *) a;
+    double y = *(double const *) b;
+    return (x > y) - (x < y);
+}
+
+static void mean_var(double const *x, int n, double *m, double *v) {
+    double s = 0.0;
+    double s2 = 0.0;
+
+    for (int i = 0; i < n; ++i) {
+        s += x[i];
+        s2 += x[i] * x[i];
+    }
+    *m = s / n;
+    *v = s2 / n - (*m) * (*m);
+}
+
+static void check_iso(double const *ux, double const *uy, double const *uz, int n) {
+    double m;
+    double v;
+
+    for (int i = 0; i < n; ++i) {
+        ASSERT_TRUE(fabs(ux[i] * ux[i] + uy[i] * uy[i] + uz[i] * uz[i] - 1.0) < 1e-12);
+    }
+
+    /* each component is uniform in [-1, 1]: mean 0, variance 1/3 */
+    mean_var(ux, n, &m, &v);
+    ASSERT_TRUE(fabs(m) < 0.01 && fabs(v - 1.0 / 3.0) < 0.01);
+    mean_var(uy, n, &m, &v);
+    ASSERT_TRUE(fabs(m) < 0.01 && fabs(v - 1.0 / 3.0) < 0.01);
+    mean_var(uz, n, &m, &v);
+    ASSERT_TRUE(fabs(m) < 0.01 && fabs(v - 1.0 / 3.0) < 0.01);
+}
+
+static void test_iso(void) {
+    struct osh_rng r;
+    double u[3];
+
+    osh_rng_init(&r, OSH_RNG_TYPE_PCG32, 1u, 1u);
+    for (int i = 0; i < N; ++i) {
+        osh_rng_iso(&r, u);
+        bx[i] = u[0];
+        by[i] = u[1];
+        bz[i] = u[2];
+    }
+    check_iso(bx, by, bz, N);
+
+    osh_rng_iso_vec(&r, bx, by, bz, N);
+    check_iso(bx, by, bz, N);
+}
+
+static void test_exp(void) {
+    struct osh_rng r;
+    double m;
+    double v;
+
+    osh_rng_init(&r, OSH_RNG_TYPE_XOSHIRO256SS, 2u, 1u);
+    for (int i = 0; i < N; ++i) {
+        bx[i] = osh_rng_exp(&r, 2.0);
+        ASSERT_TRUE(bx[i] >= 0.0 && isfinite(bx[i]));
+    }
+    mean_var(bx, N, &m, &v);
+    ASSERT_TRUE(fabs(m - 2.0) < 0.03 && fabs(v - 4.0) < 0.2);
+
+    osh_rng_exp_vec(&r, 2.0, bx, N);
+    mean_var(bx, N, &m, &v);
+    ASSERT_TRUE(fabs(m - 2.0) < 0.03 && fabs(v - 4.0) < 0.2);
+}
+
+static void test_landau(void) {
+    struct osh_rng r;
+    int nneg;
+
+    /* median 1.3558, P(lambda < 0) = 0.2864 */
+    osh_rng_init(&r, OSH_RNG_TYPE_PCG32, 3u, 1u);
+    nneg = 0;
+    for (int i = 0; i < N; ++i) {
+        bx[i] = osh_rng_landau(&r);
+        ASSERT_TRUE(isfinite(bx[i]));
+        nneg += bx[i] < 0.0;
+    }
+    qsort(bx, N, sizeof(double), cmp_double);
+    ASSERT_TRUE(fabs(bx[N / 2] - 1.3558) < 0.04);
+    ASSERT_TRUE(fabs((double) nneg / N - 0.2864) < 0.006);
+
+    osh_rng_landau_vec(&r, bx, N);
+    qsort(bx, N, sizeof(double), cmp_double);
+    ASSERT_TRUE(isfinite(bx[0]) && isfinite(bx[N - 1]));
+    ASSERT_TRUE(fabs(bx[N / 2] - 1.3558) < 0.04);
+}
+
+static void test_gamma(void) {
+    struct osh_rng r;
+    double m;
+    double v;
+
+    /* mean k theta, variance k theta^2 */
+    osh_rng_init(&r, OSH_RNG_TYPE_PCG32, 4u, 1u);
+    for (int i = 0; i < N; ++i)
+        bx[i] = osh_rng_gamma(&r, 2.5, 2.0);
+    mean_var(bx, N, &m, &v);
+    ASSERT_TRUE(fabs(m - 5.0) < 0.06 && fabs(v - 10.0) < 0.4);
+
+    osh_rng_gamma_vec(&r, 0.5, 1.0, bx, N);
+    mean_var(bx, N, &m, &v);
+    ASSERT_TRUE(fabs(m - 0.5) < 0.01 && fabs(v - 0.5) < 0.03);
+
+    ASSERT_TRUE(osh_rng_gamma(&r, 0.0, 1.0) == 0.0);
+}
+
+static void test_poisson(void) {
+    static unsigned int k[N];
+    struct osh_rng r;
+    double m;
+    double v;
+    const double mean[3] = {3.0, 10.0, 250.0};
+
+    osh_rng_init(&r, OSH_RNG_TYPE_XOSHIRO256SS, 5u, 1u);
+    for (int j = 0; j < 3; ++j) {
+        for (int i = 0; i < N; ++i)
+            bx[i] = (double) osh_rng_poisson(&r, mean[j]);
+        mean_var(bx, N, &m, &v);
+        ASSERT_TRUE(fabs(m - mean[j]) < 0.02 * sqrt(mean[j]) + 0.01);
+        ASSERT_TRUE(fabs(v / mean[j] - 1.0) < 0.03);
+
+        osh_rng_poisson_vec(&r, mean[j], k, N);
+        for (int i = 0; i < N; ++i)
+            bx[i] = (double) k[i];
+        mean_var(bx, N, &m, &v);
+        ASSERT_TRUE(fabs(m - mean[j]) < 0.02 * sqrt(mean[j]) + 0.01);
+        ASSERT_TRUE(fabs(v / mean[j] - 1.0) < 0.03);
+    }
+    ASSERT_TRUE(osh_rng_poisson(&r, 0.0) == 0);
+}
+
+static void test_alias(void) {
+    static uint32_t k[N];
+    struct osh_rng r;
+    struct osh_rng_alias t;
+    const double w[5] = {1.0, 0.0, 3.0, 0.5, 5.5};
+    unsigned int cnt[5] = {0, 0, 0, 0, 0};
+    const double wbad[2] = {1.0, -1.0};
+
+    osh_rng_init(&r, OSH_RNG_TYPE_PCG32, 6u, 1u);
+    ASSERT_TRUE(osh_rng_alias_init(&t, w, 5) == OSH_OK);
+
+    for (int i = 0; i < N; ++i)
+        cnt[osh_rng_alias_sample(&t, &r)]++;
+    osh_rng_alias_vec(&t, &r, k, N);
+    for (int i = 0; i < N; ++i)
+        cnt[k[i]]++;
+
+    ASSERT_TRUE(cnt[1] == 0);
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(fabs(cnt[i] / (2.0 * N) - w[i] / 10.0) < 0.005);
+    }
+    osh_rng_alias_free(&t);
+    ASSERT_TRUE(t.bin == NULL);
+
+    ASSERT_TRUE(osh_rng_alias_init(&t, wbad, 2) == OSH_EINVAL);
+    ASSERT_TRUE(osh_rng_alias_init(&t, w, 0) == OSH_EINVAL);
+}
+
+static void test_alias_isotopes(void) {
+    struct osh_rng r;
+    struct osh_rng_alias t;
+    double w[32];
+    unsigned int first;
+    unsigned int len;
+    unsigned int n10;
+
+    /* natural boron: 10B 19.9%, 11B 80.1% */
+    first = _isotopes_idx[5];
+    len = _isotopes_len[5];
+    ASSERT_TRUE(len <= 32);
+    for (unsigned int i = 0; i < len; ++i)
+        w[i] = _isotopes[first + i].abund;
+
+    osh_rng_init(&r, OSH_RNG_TYPE_PCG32, 7u, 1u);
+    ASSERT_TRUE(osh_rng_alias_init(&t, w, len) == OSH_OK);
+
+    n10 = 0;
+    for (int i = 0; i < N; ++i) {
+        const struct isotope *iso = &_isotopes[first + osh_rng_alias_sample(&t, &r)];
+        ASSERT_TRUE(iso->z == 5 && (iso->a == 10 || iso->a == 11));
+        n10 += iso->a == 10;
+    }
+    ASSERT_TRUE(fabs((double) n10 / N - 0.199) < 0.005);
+
+    osh_rng_alias_free(&t);
+}
+
+static void test_float(void) {
+    static float fx[N];
+    static float fy[N];
+    static float fz[N];
+    struct osh_rng r;
+    float u[3];
+    double m;
+    double v;
+
+    osh_rng_init(&r, OSH_RNG_TYPE_XOSHIRO256SS, 8u, 1u);
+    for (int i = 0; i < N; ++i) {
+        osh_rng_isof(&r, u);
+        bx[i] = u[0];
+        by[i] = u[1];
+        bz[i] = u[2];
+        ASSERT_TRUE(fabs(bx[i] * bx[i] + by[i] * by[i] + bz[i] * bz[i] - 1.0) < 1e-6);
+    }
+    mean_var(bz, N, &m, &v);
+    ASSERT_TRUE(fabs(m) < 0.01 && fabs(v - 1.0 / 3.0) < 0.01);
+
+    osh_rng_isof_vec(&r, fx, fy, fz, N);
+    for (int i = 0; i < N; ++i) {
+        bx[i] = fx[i];
+        by[i] = fy[i];
+        bz[i] = fz[i];
+        ASSERT_TRUE(fabs(bx[i] * bx[i] + by[i] * by[i] + bz[i] * bz[i] - 1.0) < 1e-6);
+    }
+    mean_var(bx, N, &m, &v);
+    ASSERT_TRUE(fabs(m) < 0.01 && fabs(v - 1.0 / 3.0) < 0.01);
+    mean_var(by, N, &m, &v);
+    ASSERT_TRUE(fabs(m) < 0.01 && fabs(v - 1.0 / 3.0) < 0.01);
+    mean_var(bz, N, &m, &v);
+    ASSERT_TRUE(fabs(m) < 0.01 && fabs(v - 1.0 / 3.0) < 0.01);
+
+    for (int i = 0; i < N; ++i)
+        bx[i] = osh_rng_expf(&r, 2.0f);
+    mean_var(bx, N, &m, &v);
+    ASSERT_TRUE(fabs(m - 2.0) < 0.03 && fabs(v - 4.0) < 0.2);
+
+    /* odd count, the last element must be written too */
+    fx[N - 2] = -1.0f;
+    osh_rng_expf_vec(&r, 2.0f, fx, N - 1);
+    for (int i = 0; i < N - 1; ++i) {
+        ASSERT_TRUE(fx[i] >= 0.0f && isfinite(fx[i]));
+        bx[i] = fx[i];
+    }
+    mean_var(bx, N - 1, &m, &v);
+    ASSERT_TRUE(fabs(m - 2.0) < 0.03 && fabs(v - 4.0) < 0.2);
+}
+
+int main(void) {
+    test_iso();
+    test_exp();
+    test_float();
+    test_landau();
+    test_gamma();
+    test_poisson();
+    test_alias();
+    test_alias_isotopes();
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common/osh_rc.h"
+#include "random/osh_rng.h"
+#include "random/osh_rng_pool.h"
+
+#define ASSERT_TRUE(cond)                                                                                              \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(stderr, "ASSERT FAILED: %s (%s:%d)\n", #cond, __FILE__, __LINE__);                                 \
+            exit(1);                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+#define NW 8
+#define CKPT "test_osh_rng_pool.ckpt"
+
+static void test_layout(enum osh_rng_type type) {
+    struct osh_rng_pool pool;
+
+    ASSERT_TRUE(sizeof(union osh_rng_slot) % OSH_CACHELINE == 0);
+    ASSERT_TRUE(osh_rng_pool_init(&pool, type, 1u, 0u, NW) == OSH_OK);
+    ASSERT_TRUE(pool.n == NW);
+    for (uint32_t i = 0; i < NW; ++i) {
+        ASSERT_TRUE((uintptr_t) osh_rng_pool_get(&pool, i) % OSH_CACHELINE == 0);
+    }
+    osh_rng_pool_free(&pool);
+    ASSERT_TRUE(pool.slot == NULL);
+
+    ASSERT_TRUE(osh_rng_pool_init(&pool, type, 1u, 0u, 0) == OSH_EINVAL);
+}
+
+static void test_streams(enum osh_rng_type type) {
+    struct osh_rng_pool a;
+    struct osh_rng_pool b;
+    struct osh_rng_pool c;
+    uint64_t first[2 * NW];
+
+    /* first draws of all workers of two offsets are distinct */
+    ASSERT_TRUE(osh_rng_pool_init(&a, type, 42u, 0u, NW) == OSH_OK);
+    ASSERT_TRUE(osh_rng_pool_init(&b, type, 42u, 1u, NW) == OSH_OK);
+    for (uint32_t i = 0; i < NW; ++i) {
+        first[i] = osh_rng_u64(osh_rng_pool_get(&a, i));
+        first[NW + i] = osh_rng_u64(osh_rng_pool_get(&b, i));
+    }
+    for (int i = 0; i < 2 * NW; ++i) {
+        for (int j = i + 1; j < 2 * NW; ++j)
+            ASSERT_TRUE(first[i] != first[j]);
+    }
+
+    /* same seed and offset give the same streams */
+    ASSERT_TRUE(osh_rng_pool_init(&c, type, 42u, 1u, NW) == OSH_OK);
+    for (uint32_t i = 0; i < NW; ++i)
+        ASSERT_TRUE(osh_rng_u64(osh_rng_pool_get(&c, i)) == first[NW + i]);
+
+    osh_rng_pool_free(&a);
+    osh_rng_pool_free(&b);
+    osh_rng_pool_free(&c);
+}
+
+static void test_jump(void) {
+    struct osh_rng r;
+    struct osh_rng s;
+
+    osh_rng_init(&r, OSH_RNG_TYPE_XOSHIRO256SS, 7u, 0u);
+    s = r;
+    osh_rng_xoshiro256ss_jump(&r);
+    osh_rng_xoshiro256ss_jump(&s);
+    ASSERT_TRUE(osh_rng_u64(&r) == osh_rng_u64(&s));
+
+    osh_rng_init(&r, OSH_RNG_TYPE_XOSHIRO256SS, 7u, 0u);
+    s = r;
+    osh_rng_xoshiro256ss_jump(&r);
+    osh_rng_xoshiro256ss_long_jump(&s);
+    ASSERT_TRUE(osh_rng_u64(&r) != osh_rng_u64(&s));
+}
+
+/* advancing pcg32 by n steps is the same as drawing n numbers */
+static void test_advance(void) {
+    struct osh_rng r;
+    struct osh_rng s;
+
+    osh_rng_init(&r, OSH_RNG_TYPE_PCG32, 42u, 7u);
+    s = r;
+    for (int i = 0; i < 1000; i++)
+        osh_rng_u32(&r);
+    osh_rng_pcg32_advance(&s, 1000u);
+    ASSERT_TRUE(r.u.pcg32.state == s.u.pcg32.state);
+    ASSERT_TRUE(osh_rng_u32(&r) == osh_rng_u32(&s));
+
+    osh_rng_pcg32_advance(&s, 0u);
+    ASSERT_TRUE(r.u.pcg32.state == s.u.pcg32.state);
+}
+
+/* a history draws the same numbers on any worker, different histories and offsets differ */
+static void test_history(enum osh_rng_type type) {
+    struct osh_rng_pool a;
+    struct osh_rng_pool b;
+    uint64_t x, y;
+
+    ASSERT_TRUE(osh_rng_pool_init(&a, type, 1234u, 0u, NW) == OSH_OK);
+    ASSERT_TRUE(osh_rng_pool_init(&b, type, 1234u, 1u, NW) == OSH_OK);
+    osh_rng_set_gauss(osh_rng_pool_get(&a, 2), OSH_RNG_GAUSS_ZIGGURAT);
+
+    x = osh_rng_u64(osh_rng_pool_history(&a, 0, 17u));
+    osh_rng_u64(osh_rng_pool_get(&a, 3));
+    y = osh_rng_u64(osh_rng_pool_history(&a, 3, 17u));
+    ASSERT_TRUE(x == y);
+    ASSERT_TRUE(osh_rng_u64(osh_rng_pool_history(&a, 2, 17u)) == x);
+    ASSERT_TRUE(osh_rng_pool_get(&a, 2)->gauss_type == OSH_RNG_GAUSS_ZIGGURAT);
+
+    ASSERT_TRUE(osh_rng_u64(osh_rng_pool_history(&a, 0, 18u)) != x);
+    ASSERT_TRUE(osh_rng_u64(osh_rng_pool_history(&b, 0, 17u)) != x);
+
+    osh_rng_pool_free(&a);
+    osh_rng_pool_free(&b);
+}
+
+static void test_checkpoint(enum osh_rng_type type) {
+    struct osh_rng_pool a;
+    struct osh_rng_pool b;
+    double x[NW][16];
+    FILE *fp;
+
+    ASSERT_TRUE(osh_rng_pool_init(&a, type, 3u, 2u, NW) == OSH_OK);
+    osh_rng_set_gauss(osh_rng_pool_get(&a, 1), OSH_RNG_GAUSS_POLAR);
+    for (uint32_t i = 0; i < NW; ++i) {
+        for (int k = 0; k < 5; ++k)
+            osh_rng_gauss01(osh_rng_pool_get(&a, i));
+    }
+
+    /* an odd number of polar draws leaves a spare in worker 1 */
+    ASSERT_TRUE(osh_rng_pool_save(&a, CKPT) == OSH_OK);
+    for (uint32_t i = 0; i < NW; ++i) {
+        for (int k = 0; k < 16; ++k)
+            x[i][k] = osh_rng_gauss01(osh_rng_pool_get(&a, i));
+    }
+
+    ASSERT_TRUE(osh_rng_pool_load(&b, CKPT) == OSH_OK);
+    ASSERT_TRUE(b.n == NW && b.type == type && b.seed == 3u && b.offset == 2u);
+    for (uint32_t i = 0; i < NW; ++i) {
+        for (int k = 0; k < 16; ++k)
+            ASSERT_TRUE(osh_rng_gauss01(osh_rng_pool_get(&b, i)) == x[i][k]);
+    }
+    osh_rng_pool_free(&b);
+
+    /* a flipped byte fails the checksum */
+    fp = fopen(CKPT, "r+b");
+    ASSERT_TRUE(fp != NULL);
+    fseek(fp, 50, SEEK_SET);
+    fputc(0x5a, fp);
+    fclose(fp);
+    ASSERT_TRUE(osh_rng_pool_load(&b, CKPT) == OSH_EPARSE);
+    ASSERT_TRUE(b.slot == NULL && b.n == 0);
+
+    /* truncated file */
+    fp = fopen(CKPT, "wb");
+    ASSERT_TRUE(fp != NULL);
+    fputs("OSHRNGPL", fp);
+    fclose(fp);
+    ASSERT_TRUE(osh_rng_pool_load(&b, CKPT) == OSH_EPARSE);
+
+    remove(CKPT);
+    ASSERT_TRUE(osh_rng_pool_load(&b, CKPT) == OSH_EIO);
+
+    osh_rng_pool_free(&a);
+}
+
+int main(void) {
+    test_jump();
+
+    test_layout(OSH_RNG_TYPE_PCG32);
+    test_layout(OSH_RNG_TYPE_XOSHIRO256SS);
+    test_streams(OSH_RNG_TYPE_PCG32);
+    test_streams(OSH_RNG_TYPE_XOSHIRO256SS);
+    test_checkpoint(OSH_RNG_TYPE_PCG32);
+    test_checkpoint(OSH_RNG_TYPE_XOSHIRO256SS);
+    test_advance();
+    test_history(OSH_RNG_TYPE_PCG32);
+    test_history(OSH_RNG_TYPE_XOSHIRO256SS);
+
+    return 0;
+}
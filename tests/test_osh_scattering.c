@@ -0,0 +1,158 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_rc.h"
+#include "material/osh_material.h"
+#include "particle/osh_particle.h"
+#include "physics/osh_physics.h"
+#include "physics/osh_scattering.h"
+#include "random/osh_rng.h"
+#include "transport/osh_transport.h"
+#include "transport/osh_transport_engine.h"
+
+#define ASSERT_TRUE(cond)                                                                                              \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(stderr, "ASSERT FAILED: %s (%s:%d)\n", #cond, __FILE__, __LINE__);                                 \
+            exit(1);                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+#define TEST_MAT "../../tests/res/test01/mat.dat"
+#define NSAMPLE 200000
+
+static void test_tables(struct scattering_table const *t) {
+    double f1, f2, a, b, bb;
+    int i, k;
+
+    /* Bethe 1953, table II */
+    osh_scattering_moliere_f(0.0, &f1, &f2);
+    ASSERT_TRUE(fabs(f1 - 0.8456) < 2e-3);
+    ASSERT_TRUE(fabs(f2 - 2.4929) < 5e-3);
+    osh_scattering_moliere_f(3.0, &f1, &f2);
+    ASSERT_TRUE(f1 > 0.0 && f1 < 0.05);
+
+    /* B of b */
+    for (i = 0; i < (int) t->nbb; i++) {
+        bb = t->bb[i];
+        ASSERT_TRUE(fabs(bb - log(bb) - (t->bmin + i / t->inv_db)) < 1e-10);
+    }
+
+    for (i = 0; i < OSH_SCATTERING_NB; i++) {
+        b = 1.0 / (1.0 / OSH_SCATTERING_BMAX + i / t->inv_dib);
+        a = osh_scattering_quantile(t, b, 0.0);
+        ASSERT_TRUE(a == 0.0);
+        for (k = 1; k <= OSH_SCATTERING_NU; k++) {
+            bb = osh_scattering_quantile(t, b, (double) k / OSH_SCATTERING_NU);
+            ASSERT_TRUE(bb > a);
+            a = bb;
+        }
+        ASSERT_TRUE(a <= 2.0 * OSH_SCATTERING_RMAX);
+    }
+
+    /* the core approaches the Gaussian term, 1 - exp(-x^2), for large B */
+    for (k = 1; k < 10; k++) {
+        a = osh_scattering_quantile(t, OSH_SCATTERING_BMAX, 0.1 * k);
+        ASSERT_TRUE(fabs(a / sqrt(-log(1.0 - 0.1 * k)) - 1.0) < 0.05);
+    }
+}
+
+static void test_hook(void) {
+    struct material_workspace mw;
+    struct physics_workspace pw;
+    struct transport_physics ph;
+    struct scattering_medium sm;
+    struct particle p;
+    struct step st;
+    struct osh_rng rng;
+    double v[3], theta0, x, s2;
+    int mode, k, n;
+
+    memset(&p, 0, sizeof(p));
+    p.z = 1;
+    p.a = 1;
+    p.amu = 1.00728;
+    memset(&st, 0, sizeof(st));
+    st.medium = 1;
+    st.rho = 1.0;
+    st.ds = 0.1;
+    st.p[3] = 100.0;
+
+    ASSERT_TRUE(osh_material_load(TEST_MAT, &mw) == OSH_OK);
+    ASSERT_TRUE(osh_physics_init(&pw, &mw, 1, OSH_STRAGGLING_OFF, 3) == OSH_EINVAL);
+
+    /* 1 mm of water at 100 MeV */
+    osh_scattering_medium(&mw.media[0], &sm);
+    ASSERT_TRUE(fabs(sm.x0 - 36.08) < 0.5);
+    theta0 = osh_scattering_highland(&sm, 1, p.amu, st.p[3], st.ds);
+    ASSERT_TRUE(fabs(theta0 / 3.15e-3 - 1.0) < 0.05);
+
+    for (mode = OSH_SCATTERING_OFF; mode <= OSH_SCATTERING_MOLIERE; mode++) {
+        ASSERT_TRUE(osh_physics_init(&pw, &mw, 1, OSH_STRAGGLING_OFF, mode) == OSH_OK);
+        osh_physics_hooks(&pw, &ph);
+        if (mode == OSH_SCATTERING_OFF) {
+            ASSERT_TRUE(ph.scatter == NULL);
+            osh_physics_free(&pw);
+            continue;
+        }
+
+        /* directions stay unit vectors */
+        osh_rng_init(&rng, OSH_RNG_TYPE_PCG32, 1, 0);
+        v[0] = 0.6;
+        v[1] = 0.0;
+        v[2] = 0.8;
+        for (k = 0; k < 1000; k++) {
+            ph.scatter(ph.data, &p, &st, v, &rng);
+            ASSERT_TRUE(fabs(v[0] * v[0] + v[1] * v[1] + v[2] * v[2] - 1.0) < 1e-12);
+        }
+
+        /* projected angle along the x axis */
+        s2 = 0.0;
+        n = 0;
+        for (k = 0; k < NSAMPLE; k++) {
+            v[0] = 0.0;
+            v[1] = 0.0;
+            v[2] = 1.0;
+            ph.scatter(ph.data, &p, &st, v, &rng);
+            x = v[0] / v[2];
+            s2 += x * x;
+            if (fabs(x) < theta0)
+                n++;
+        }
+        s2 = sqrt(s2 / NSAMPLE);
+        if (mode == OSH_SCATTERING_GAUSS) {
+            ASSERT_TRUE(fabs(s2 / theta0 - 1.0) < 0.01);
+        } else {
+            /* Highland fits the central Moliere distribution, the single scattering tail widens the rms */
+            ASSERT_TRUE(fabs((double) n / NSAMPLE - 0.6827) < 0.03);
+            ASSERT_TRUE(s2 > theta0);
+        }
+
+        /* neutral particles are not deflected */
+        p.z = 0;
+        v[0] = 0.0;
+        v[1] = 0.0;
+        v[2] = 1.0;
+        ph.scatter(ph.data, &p, &st, v, &rng);
+        ASSERT_TRUE(v[2] == 1.0);
+        p.z = 1;
+
+        osh_physics_free(&pw);
+    }
+
+    osh_material_free(&mw);
+}
+
+int main(void) {
+    struct scattering_table t;
+
+    ASSERT_TRUE(osh_scattering_init(&t) == OSH_OK);
+    test_tables(&t);
+    osh_scattering_free(&t);
+
+    test_hook();
+
+    return 0;
+}
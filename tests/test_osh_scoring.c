@@ -0,0 +1,1163 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "beam/osh_beam.h"
+#include "common/osh_const.h"
+#include "common/osh_rc.h"
+#include "gemca/osh_gemca2.h"
+#include "io/osh_bdo.h"
+#include "io/osh_partial.h"
+#include "io/osh_phsp.h"
+#include "particle/osh_particle.h"
+#include "scoring/osh_scoring.h"
+#include "scoring/osh_scoring_filter.h"
+#include "transport/osh_transport.h"
+#include "transport/osh_transport_engine.h"
+#include "transport/osh_transport_run.h"
+
+#define ASSERT_TRUE(cond)                                                                                              \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(stderr, "ASSERT FAILED: %s (%s:%d)\n", #cond, __FILE__, __LINE__);                                 \
+            exit(1);                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+#define TEST_DETECT "../../tests/res/test01/detect.dat"
+#define TEST_TMP "test_osh_scoring.dat"
+#define TEST_GEO "../../tests/res/transport/geo.dat"
+#define TEST_BDO "test_osh_scoring.bdo"
+#define TEST_PHSP "test_osh_scoring.phsp"
+#define TEST_PARTIAL "test_osh_scoring.partial"
+
+static void set_particle(struct particle *p, int z, unsigned int a, unsigned int gen) {
+    memset(p, 0, sizeof(*p));
+    p->id = OSH_PART_HADRON;
+    p->z = z;
+    p->a = a;
+    p->gen = gen;
+}
+
+static void set_step(struct step *st, double z0, double z1, double e, double de) {
+    memset(st, 0, sizeof(*st));
+    st->p[2] = z0;
+    st->q[2] = z1;
+    st->v[2] = 1.0;
+    st->p[3] = e;
+    st->q[3] = e - de;
+    st->ds = z1 - z0;
+    st->de = de;
+    st->rho = 1.0;
+    st->medium = 1;
+}
+
+/* write a detect.dat and try to load it */
+static int load_text(const char *text) {
+    struct scoring_workspace sw;
+    FILE *f;
+    int rc;
+
+    f = fopen(TEST_TMP, "w");
+    ASSERT_TRUE(f != NULL);
+    fputs(text, f);
+    fclose(f);
+    rc = osh_scoring_load(TEST_TMP, &sw);
+    if (rc == OSH_OK)
+        osh_scoring_free(&sw);
+    remove(TEST_TMP);
+    return rc;
+}
+
+static void test_filters(void) {
+    struct scoring_filter f[3];
+    struct scoring_filter_table ft;
+    struct particle p;
+
+    memset(f, 0, sizeof(f));
+    /* charged, not protons */
+    f[0].pred[0] = (struct scoring_pred) {OSH_SCORING_VAR_Z, OSH_SCORING_OP_NE, 0.0};
+    f[0].pred[1] = (struct scoring_pred) {OSH_SCORING_VAR_Z, OSH_SCORING_OP_GE, 2.0};
+    f[0].npred = 2;
+    /* secondaries from 10 to 100 MeV/nucleon */
+    f[1].pred[0] = (struct scoring_pred) {OSH_SCORING_VAR_GEN, OSH_SCORING_OP_GT, 0.0};
+    f[1].pred[1] = (struct scoring_pred) {OSH_SCORING_VAR_ENUC, OSH_SCORING_OP_GE, 10.0};
+    f[1].pred[2] = (struct scoring_pred) {OSH_SCORING_VAR_ENUC, OSH_SCORING_OP_LT, 100.0};
+    f[1].npred = 3;
+    /* heavy */
+    f[2].pred[0] = (struct scoring_pred) {OSH_SCORING_VAR_A, OSH_SCORING_OP_GT, 100.0};
+    f[2].npred = 1;
+    ASSERT_TRUE(osh_scoring_filter_compile(&ft, f, 3) == OSH_OK);
+    ASSERT_TRUE(ft.all == 7u && ft.dyn == 2u);
+
+    set_particle(&p, 1, 1, 0);
+    ASSERT_TRUE(osh_scoring_filter_mask(&ft, &p, 50.0) == 0u);
+    set_particle(&p, 6, 12, 2);
+    ASSERT_TRUE(osh_scoring_filter_mask(&ft, &p, 600.0) == 3u);
+    ASSERT_TRUE(osh_scoring_filter_mask(&ft, &p, 1200.0) == 1u); /* 100 MeV/nucleon is excluded */
+    ASSERT_TRUE(osh_scoring_filter_mask(&ft, &p, 119.9) == 1u);
+
+    /* values beyond the tables are clamped */
+    set_particle(&p, 150, 400, 100000);
+    ASSERT_TRUE(osh_scoring_filter_mask(&ft, &p, 3.0e4) == 7u);
+    set_particle(&p, 150, 4000, 100000);
+    ASSERT_TRUE(osh_scoring_filter_mask(&ft, &p, 3.0e4) == 5u);
+
+    /* constants must be integral and inside the tables, energies may not use != */
+    f[2].pred[0].value = 100.5;
+    ASSERT_TRUE(osh_scoring_filter_compile(&ft, f, 3) == OSH_EINVAL);
+    f[2].pred[0].value = OSH_SCORING_AMAX;
+    ASSERT_TRUE(osh_scoring_filter_compile(&ft, f, 3) == OSH_EINVAL);
+    f[2].pred[0] = (struct scoring_pred) {OSH_SCORING_VAR_E, OSH_SCORING_OP_NE, 1.0};
+    ASSERT_TRUE(osh_scoring_filter_compile(&ft, f, 3) == OSH_EINVAL);
+}
+
+static void test_load(void) {
+    struct scoring_workspace sw;
+    struct scoring_buffer *buf;
+    struct transport_tally t;
+    struct particle p;
+    struct step st;
+    size_t i;
+
+    ASSERT_TRUE(osh_scoring_load(TEST_DETECT, &sw) == OSH_OK);
+    ASSERT_TRUE(sw.nfilters == 2 && sw.ngeos == 1 && sw.noutputs == 2 && sw.npages == 4);
+    ASSERT_TRUE(strcmp(sw.filters[0].name, "MyFilter") == 0 && sw.filters[0].npred == 3);
+    ASSERT_TRUE(sw.geos[0].type == OSH_SCORING_GEO_MESH && sw.geos[0].nbins == 10 && sw.geos[0].npages == 4);
+    ASSERT_TRUE(fabs(sw.geos[0].mesh.vol - 4.0) < 1e-12);
+    ASSERT_TRUE(strcmp(sw.outputs[1].filename, "NB_msh_fluence.bdo") == 0);
+    ASSERT_TRUE(sw.outputs[1].page == 1 && sw.outputs[1].npages == 3);
+    ASSERT_TRUE(sw.pages[3].quantity == OSH_SCORING_QTY_FLUENCE && sw.pages[3].fmask == 3u);
+    ASSERT_TRUE(sw.pages[3].offset == 30 && sw.nbins == 40);
+
+    buf = osh_scoring_buffer_alloc(&sw);
+    ASSERT_TRUE(buf != NULL);
+
+    /* a proton in the first bin: energy and fluence, no filtered fluence */
+    set_particle(&p, 1, 1, 0);
+    set_step(&st, 3.0, 3.2, 100.0, 1.5);
+    osh_scoring_score(buf, &p, &st);
+    ASSERT_TRUE(osh_scoring_buffer_value(buf, 0) == 1.5 && osh_scoring_buffer_value(buf, 10) == 1.5);
+    ASSERT_TRUE(fabs(osh_scoring_buffer_value(buf, 20) - 0.05) < 1e-15);
+    ASSERT_TRUE(osh_scoring_buffer_value(buf, 30) == 0.0);
+
+    /* primary carbon-12 passes both filters in bin 5, a secondary one does not */
+    set_particle(&p, 6, 12, 0);
+    set_step(&st, 21.0, 21.4, 1000.0, 20.0);
+    osh_scoring_score(buf, &p, &st);
+    ASSERT_TRUE(fabs(osh_scoring_buffer_value(buf, 35) - 0.1) < 1e-15);
+    p.gen = 1;
+    osh_scoring_score(buf, &p, &st);
+    ASSERT_TRUE(fabs(osh_scoring_buffer_value(buf, 35) - 0.1) < 1e-15 && fabs(osh_scoring_buffer_value(buf, 25) - 0.2) < 1e-15);
+
+    /* outside the mesh */
+    set_step(&st, 41.0, 41.4, 1000.0, 20.0);
+    osh_scoring_score(buf, &p, &st);
+    set_step(&st, -0.4, -0.2, 1000.0, 20.0);
+    osh_scoring_score(buf, &p, &st);
+    ASSERT_TRUE(osh_scoring_buffer_value(buf, 0) == 1.5 && osh_scoring_buffer_value(buf, 9) == 0.0);
+
+    osh_scoring_merge(&sw, buf);
+    ASSERT_TRUE(osh_scoring_sum(&sw, 0) == 1.5 && osh_scoring_sum(&sw, 5) == 40.0 &&
+                fabs(osh_scoring_sum(&sw, 35) - 0.1) < 1e-15);
+    for (i = 0; i < sw.nbins; i++)
+        ASSERT_TRUE(osh_scoring_buffer_value(buf, i) == 0.0);
+    osh_scoring_buffer_free(buf);
+
+    /* the tally of a run */
+    osh_scoring_tally(&sw, &t);
+    ASSERT_TRUE(t.ctx == &sw && t.score == osh_scoring_score && t.history == osh_scoring_history);
+    ASSERT_TRUE(t.particle == osh_scoring_particle);
+    buf = t.alloc(t.ctx);
+    ASSERT_TRUE(buf != NULL);
+    t.score(buf, &p, &st);
+    set_step(&st, 0.0, 1.0, 100.0, 2.0);
+    t.score(buf, &p, &st);
+    t.merge(t.ctx, buf);
+    ASSERT_TRUE(osh_scoring_sum(&sw, 0) == 3.5);
+    t.free(t.ctx, buf);
+
+    osh_scoring_free(&sw);
+}
+
+static void test_particle(void) {
+    struct scoring_workspace sw;
+    struct scoring_buffer *buf;
+    struct particle p;
+    struct step st;
+
+    ASSERT_TRUE(osh_scoring_load(TEST_DETECT, &sw) == OSH_OK);
+    buf = osh_scoring_buffer_alloc(&sw);
+    ASSERT_TRUE(buf != NULL);
+
+    /* primary carbon-12 in bin 5, its static mask cached when it starts */
+    set_particle(&p, 6, 12, 0);
+    set_step(&st, 21.0, 21.4, 1000.0, 20.0);
+    osh_scoring_particle(buf, &p);
+    ASSERT_TRUE(p.sft == &sw.ft && p.smask == osh_scoring_filter_static(&sw.ft, &p) && p.smask != 0u);
+    osh_scoring_score(buf, &p, &st);
+    ASSERT_TRUE(fabs(osh_scoring_buffer_value(buf, 35) - 0.1) < 1e-15);
+
+    /* steps take the cached mask, only the energy predicates are checked */
+    p.smask = 0u;
+    osh_scoring_score(buf, &p, &st);
+    ASSERT_TRUE(fabs(osh_scoring_buffer_value(buf, 35) - 0.1) < 1e-15 && fabs(osh_scoring_buffer_value(buf, 25) - 0.2) < 1e-15);
+    set_step(&st, 21.0, 21.4, 0.05, 0.01);
+    p.smask = osh_scoring_filter_static(&sw.ft, &p);
+    osh_scoring_score(buf, &p, &st);
+    ASSERT_TRUE(fabs(osh_scoring_buffer_value(buf, 35) - 0.1) < 1e-15);
+
+    /* a mask cached for another filter table is ignored */
+    set_step(&st, 21.0, 21.4, 1000.0, 20.0);
+    p.smask = 0u;
+    p.sft = &p;
+    osh_scoring_score(buf, &p, &st);
+    ASSERT_TRUE(fabs(osh_scoring_buffer_value(buf, 35) - 0.2) < 1e-15);
+
+    osh_scoring_buffer_free(buf);
+    osh_scoring_free(&sw);
+}
+
+/* a geometry with an ENERGY and a FLUENCE page, defined in code, c is the center of a cylinder or sphere */
+static void geo_setup(struct scoring_workspace *sw,
+                      int type,
+                      double const x0[3],
+                      double const x1[3],
+                      size_t const n[3],
+                      double const c[3]) {
+    static struct scoring_geo g;
+    static struct scoring_page pg[2];
+    static struct scoring_output o;
+    static char filename[] = TEST_BDO;
+
+    memset(sw, 0, sizeof(*sw));
+    memset(&g, 0, sizeof(g));
+    memset(pg, 0, sizeof(pg));
+    memset(&o, 0, sizeof(o));
+    g.type = type;
+    if (c)
+        memcpy(g.mesh.c, c, sizeof(g.mesh.c));
+    memcpy(g.mesh.x0, x0, sizeof(g.mesh.x0));
+    memcpy(g.mesh.x1, x1, sizeof(g.mesh.x1));
+    memcpy(g.mesh.n, n, sizeof(g.mesh.n));
+    pg[0].quantity = OSH_SCORING_QTY_ENERGY;
+    pg[1].quantity = OSH_SCORING_QTY_FLUENCE;
+    o.filename = filename;
+    o.npages = 2;
+    sw->geos = &g;
+    sw->ngeos = 1;
+    sw->pages = pg;
+    sw->npages = 2;
+    sw->outputs = &o;
+    sw->noutputs = 1;
+    ASSERT_TRUE(osh_scoring_compile(sw) == OSH_OK);
+}
+
+static void mesh_setup(struct scoring_workspace *sw, double const x0[3], double const x1[3], size_t const n[3]) {
+    geo_setup(sw, OSH_SCORING_GEO_MESH, x0, x1, n, NULL);
+}
+
+static void mesh_free(struct scoring_workspace *sw) {
+    size_t b;
+
+    osh_thread_join(&sw->snap.th);
+    for (b = 0; sw->snap.sum && b < sw->snap.nblk; b++) {
+        free(sw->snap.sum[b]);
+        free(sw->snap.sum2[b]);
+    }
+    free(sw->snap.sum);
+    free(sw->snap.sum2);
+    for (b = 0; b < sw->nblk; b++) {
+        free(sw->sum[b]);
+        free(sw->sum2[b]);
+    }
+    free(sw->sum);
+    free(sw->sum2);
+    free(sw->geos[0].pages);
+    free(sw->geos[0].mesh.ivol);
+}
+
+static double dist(double const p[3], double const q[3]) {
+    return sqrt((q[0] - p[0]) * (q[0] - p[0]) + (q[1] - p[1]) * (q[1] - p[1]) + (q[2] - p[2]) * (q[2] - p[2]));
+}
+
+/* track length of p -> q in each bin by fine subdivision */
+static void brute(struct scoring_mesh const *m, double const p[3], double const q[3], double *len) {
+    const int nsub = 20000;
+    double x[3], u;
+    size_t i[3];
+    int k, a, in;
+
+    for (k = 0; k < nsub; k++) {
+        in = 1;
+        for (a = 0; a < 3; a++) {
+            x[a] = p[a] + (k + 0.5) / nsub * (q[a] - p[a]);
+            u = (x[a] - m->x0[a]) * m->inv_d[a];
+            in = in && u >= 0.0 && u < (double) m->n[a];
+            i[a] = in ? (size_t) u : 0;
+        }
+        if (in)
+            len[i[0] + m->n[0] * (i[1] + m->n[1] * i[2])] += dist(p, q) / nsub;
+    }
+}
+
+static void test_mesh(void) {
+    const double x0[3] = {-1.0, -1.0, 0.0};
+    const double x1[3] = {1.0, 2.0, 5.0};
+    const size_t n[3] = {4, 3, 5};
+    struct scoring_workspace sw;
+    struct scoring_buffer *buf;
+    struct particle p;
+    struct step st;
+    double len[60];
+    uint64_t r = 12345;
+    size_t nb, i;
+    int k, a;
+
+    mesh_setup(&sw, x0, x1, n);
+    nb = sw.geos[0].nbins;
+    ASSERT_TRUE(nb == 60 && sw.geos[0].mesh.vol == 0.5);
+    buf = osh_scoring_buffer_alloc(&sw);
+    ASSERT_TRUE(buf != NULL);
+    set_particle(&p, 1, 1, 0);
+
+    /* random steps, partly outside the mesh, against fine subdivision */
+    for (k = 0; k < 200; k++) {
+        memset(&st, 0, sizeof(st));
+        for (a = 0; a < 3; a++) {
+            r = r * 6364136223846793005ULL + 1442695040888963407ULL;
+            st.p[a] = -2.0 + 9.0 * (double) (r >> 11) / 9007199254740992.0;
+            r = r * 6364136223846793005ULL + 1442695040888963407ULL;
+            st.q[a] = st.p[a] + (k < 100 ? 3.0 : 0.3) * ((double) (r >> 11) / 9007199254740992.0 - 0.5);
+        }
+        if (k % 10 == 0)
+            st.q[k % 3] = st.p[k % 3]; /* parallel to a bin plane */
+        if (k % 20 == 0)
+            st.p[0] = st.q[0] = 0.5; /* on a bin plane */
+        st.ds = dist(st.p, st.q);
+        st.de = 2.0 * st.ds;
+        st.rho = 1.0;
+
+        osh_scoring_score(buf, &p, &st);
+        memset(len, 0, sizeof(len));
+        brute(&sw.geos[0].mesh, st.p, st.q, len);
+        for (i = 0; i < nb; i++) {
+            ASSERT_TRUE(fabs(osh_scoring_buffer_value(buf, nb + i) * 0.5 - len[i]) < 2e-4 * st.ds + 1e-12);
+            ASSERT_TRUE(fabs(osh_scoring_buffer_value(buf, i) - 2.0 * osh_scoring_buffer_value(buf, nb + i) * 0.5) < 1e-12);
+        }
+        osh_scoring_buffer_clear(buf);
+    }
+
+    /* a step through the whole mesh along its diagonal, exact total */
+    memset(&st, 0, sizeof(st));
+    st.p[0] = -1.5;
+    st.p[1] = -1.75;
+    st.p[2] = -1.25;
+    st.q[0] = 1.5;
+    st.q[1] = 2.75;
+    st.q[2] = 6.25;
+    st.ds = dist(st.p, st.q);
+    st.de = 1.0;
+    osh_scoring_score(buf, &p, &st);
+    for (i = 0, len[0] = 0.0; i < nb; i++)
+        len[0] += osh_scoring_buffer_value(buf, i);
+    ASSERT_TRUE(fabs(len[0] - 4.0 / 6.0) < 1e-12);
+    ASSERT_TRUE(osh_scoring_buffer_value(buf, 0) > 0.0 && osh_scoring_buffer_value(buf, nb - 1) > 0.0);
+
+    osh_scoring_buffer_free(buf);
+    mesh_free(&sw);
+}
+
+/* bin of a point of a cylinder or sphere, and its volume, returns 0 outside */
+static int radial_bin(struct scoring_geo const *g, double const x[3], size_t *bin, double *vol) {
+    struct scoring_mesh const *m = &g->mesh;
+    double y[3], u[3], w[3], lo[3];
+    size_t i[3];
+    int a;
+
+    for (a = 0; a < 3; a++)
+        y[a] = x[a] - m->c[a];
+    u[0] = (g->type == OSH_SCORING_GEO_CYL) ? hypot(y[0], y[1]) : sqrt(y[0] * y[0] + y[1] * y[1] + y[2] * y[2]);
+    u[g->type == OSH_SCORING_GEO_CYL ? 1 : 2] = atan2(y[1], y[0]) + (y[1] < 0.0 ? 2.0 * OSH_M_PI : 0.0);
+    if (g->type == OSH_SCORING_GEO_CYL)
+        u[2] = y[2];
+    else
+        u[1] = acos(y[2] / u[0]);
+    for (a = 0; a < 3; a++) {
+        w[a] = (m->x1[a] - m->x0[a]) / (double) m->n[a];
+        if (!(u[a] >= m->x0[a] && u[a] < m->x1[a]))
+            return 0;
+        i[a] = (size_t) ((u[a] - m->x0[a]) / w[a]);
+        lo[a] = m->x0[a] + (double) i[a] * w[a];
+    }
+    *bin = i[0] + m->n[0] * (i[1] + m->n[1] * i[2]);
+    if (g->type == OSH_SCORING_GEO_CYL)
+        *vol = 0.5 * w[1] * ((lo[0] + w[0]) * (lo[0] + w[0]) - lo[0] * lo[0]) * w[2];
+    else
+        *vol = (pow(lo[0] + w[0], 3) - pow(lo[0], 3)) / 3.0 * (cos(lo[1]) - cos(lo[1] + w[1])) * w[2];
+    return 1;
+}
+
+/* random steps through a cylinder or sphere against fine subdivision */
+static void radial_steps(int type, double const x0[3], double const x1[3], size_t const n[3], double const c[3]) {
+    const int nsub = 20000;
+    struct scoring_workspace sw;
+    struct scoring_buffer *buf;
+    struct particle p;
+    struct step st;
+    double len[64], vol[64], x[3], v, sum;
+    uint64_t r = 4242;
+    size_t nb, i, bin;
+    int k, a, j;
+
+    geo_setup(&sw, type, x0, x1, n, c);
+    nb = sw.geos[0].nbins;
+    ASSERT_TRUE(nb <= 64);
+    buf = osh_scoring_buffer_alloc(&sw);
+    ASSERT_TRUE(buf != NULL);
+    set_particle(&p, 1, 1, 0);
+
+    for (k = 0; k < 300; k++) {
+        memset(&st, 0, sizeof(st));
+        for (a = 0; a < 3; a++) {
+            r = r * 6364136223846793005ULL + 1442695040888963407ULL;
+            st.p[a] = c[a] - 3.0 + 6.0 * (double) (r >> 11) / 9007199254740992.0;
+            r = r * 6364136223846793005ULL + 1442695040888963407ULL;
+            st.q[a] = st.p[a] + (k < 150 ? 5.0 : 0.5) * ((double) (r >> 11) / 9007199254740992.0 - 0.5);
+        }
+        if (k % 20 == 0)
+            for (a = 0; a < 3; a++)
+                st.q[a] = 2.0 * c[a] - st.p[a]; /* through the center */
+        if (k % 20 == 5) {
+            st.q[0] = st.p[0]; /* parallel to z */
+            st.q[1] = st.p[1];
+        }
+        if (k % 20 == 10)
+            st.q[2] = st.p[2]; /* parallel to the xy plane */
+        st.ds = dist(st.p, st.q);
+        st.de = 2.0 * st.ds;
+        st.rho = 1.0;
+        osh_scoring_score(buf, &p, &st);
+
+        memset(len, 0, sizeof(len));
+        memset(vol, 0, sizeof(vol));
+        for (j = 0; j < nsub; j++) {
+            for (a = 0; a < 3; a++)
+                x[a] = st.p[a] + (j + 0.5) / nsub * (st.q[a] - st.p[a]);
+            if (radial_bin(&sw.geos[0], x, &bin, &v)) {
+                len[bin] += st.ds / nsub;
+                vol[bin] = v;
+            }
+        }
+        for (i = 0, sum = 0.0; i < nb; i++) {
+            ASSERT_TRUE(fabs(osh_scoring_buffer_value(buf, nb + i) * vol[i] - len[i]) < 3e-4 * st.ds + 1e-12);
+            sum += osh_scoring_buffer_value(buf, i);
+        }
+        for (i = 0, v = 0.0; i < nb; i++)
+            v += len[i];
+        ASSERT_TRUE(fabs(sum - 2.0 * v) < 2e-3 * st.ds + 1e-12);
+        osh_scoring_buffer_clear(buf);
+    }
+
+    osh_scoring_buffer_free(buf);
+    mesh_free(&sw);
+}
+
+static void test_radial(void) {
+    const double cx0[3] = {0.0, 30.0 * OSH_M_PI / 180.0, -1.0};
+    const double cx1[3] = {2.0, 300.0 * OSH_M_PI / 180.0, 2.0};
+    const size_t cn[3] = {4, 3, 3};
+    const double cc[3] = {0.5, -0.25, 0.5};
+    const double sx0[3] = {0.5, 20.0 * OSH_M_PI / 180.0, 0.0};
+    const double sx1[3] = {2.5, OSH_M_PI, 2.0 * OSH_M_PI};
+    const size_t sn[3] = {4, 4, 3};
+    const double sc[3] = {0.3, 0.2, -0.1};
+    const double ball0[3] = {0.0, 0.0, 0.0};
+    const double ball1[3] = {2.0, OSH_M_PI, 2.0 * OSH_M_PI};
+    const size_t balln[3] = {2, 1, 1};
+    struct scoring_workspace sw;
+    struct scoring_buffer *buf;
+    struct particle p;
+    struct step st;
+
+    radial_steps(OSH_SCORING_GEO_CYL, cx0, cx1, cn, cc);
+    radial_steps(OSH_SCORING_GEO_SPH, sx0, sx1, sn, sc);
+
+    /* a diameter of a ball, 2 cm in the inner shell and 2 cm in the outer one */
+    geo_setup(&sw, OSH_SCORING_GEO_SPH, ball0, ball1, balln, sc);
+    ASSERT_TRUE(fabs(1.0 / sw.geos[0].mesh.ivol[0] - 4.0 / 3.0 * OSH_M_PI) < 1e-12);
+    buf = osh_scoring_buffer_alloc(&sw);
+    ASSERT_TRUE(buf != NULL);
+    set_particle(&p, 1, 1, 0);
+    set_step(&st, sc[2] - 3.0, sc[2] + 3.0, 100.0, 6.0);
+    st.p[0] = st.q[0] = sc[0];
+    st.p[1] = st.q[1] = sc[1];
+    osh_scoring_score(buf, &p, &st);
+    ASSERT_TRUE(fabs(osh_scoring_buffer_value(buf, 0) - 2.0) < 1e-12);
+    ASSERT_TRUE(fabs(osh_scoring_buffer_value(buf, 1) - 2.0) < 1e-12);
+    osh_scoring_buffer_free(buf);
+    mesh_free(&sw);
+}
+
+/* steps in zones, looked up through the zone table */
+static void test_zone(void) {
+    struct scoring_workspace sw;
+    struct scoring_buffer *buf;
+    struct osh_bdo_record *rec;
+    struct particle p;
+    struct step st;
+    int64_t const *x;
+    size_t nr;
+    FILE *f;
+
+    f = fopen(TEST_TMP, "w");
+    ASSERT_TRUE(f != NULL);
+    fputs("Geometry Zone\n Name A\n Zone 2 5\n Zone 3\n Volume 2.0 4.0 8.0\n"
+          "Geometry Zone\n Name B\n Zone 5\n"
+          "Output\n Filename " TEST_BDO "\n Geo A\n Quantity ENERGY\n Quantity FLUENCE\n"
+          "Output\n Filename b.bdo\n Geo B\n Quantity ENERGY\n",
+          f);
+    fclose(f);
+    ASSERT_TRUE(osh_scoring_load(TEST_TMP, &sw) == OSH_OK);
+    remove(TEST_TMP);
+    ASSERT_TRUE(sw.geos[0].nbins == 3 && sw.nbins == 7 && sw.nzt == 6);
+    ASSERT_TRUE(sw.zstart[5] - sw.zstart[4] == 0 && sw.zstart[6] - sw.zstart[5] == 2);
+
+    buf = osh_scoring_buffer_alloc(&sw);
+    ASSERT_TRUE(buf != NULL);
+    set_particle(&p, 1, 1, 0);
+    set_step(&st, 0.0, 1.0, 100.0, 3.0);
+    st.zone = 5;
+    osh_scoring_score(buf, &p, &st);
+    st.zone = 3;
+    osh_scoring_score(buf, &p, &st);
+    st.zone = 4; /* scored by no geometry */
+    osh_scoring_score(buf, &p, &st);
+    st.zone = 9; /* beyond the table */
+    osh_scoring_score(buf, &p, &st);
+    st.zone = -1;
+    osh_scoring_score(buf, &p, &st);
+
+    /* A: ENERGY bins 0..2, FLUENCE bins 3..5, B: ENERGY bin 6 */
+    ASSERT_TRUE(osh_scoring_buffer_value(buf, 0) == 0.0);
+    ASSERT_TRUE(osh_scoring_buffer_value(buf, 1) == 3.0 && osh_scoring_buffer_value(buf, 2) == 3.0);
+    ASSERT_TRUE(osh_scoring_buffer_value(buf, 4) == 0.25 && osh_scoring_buffer_value(buf, 5) == 0.125);
+    ASSERT_TRUE(osh_scoring_buffer_value(buf, 6) == 3.0);
+
+    osh_scoring_merge(&sw, buf);
+    ASSERT_TRUE(osh_scoring_write(&sw) == OSH_OK);
+    ASSERT_TRUE(osh_bdo_read(TEST_BDO, &rec, &nr) == OSH_OK);
+    ASSERT_TRUE(rec[4].tag == OSH_BDO_TAG_GEO_ZONES && rec[4].n == 3);
+    x = rec[4].data;
+    ASSERT_TRUE(x[0] == 2 && x[1] == 5 && x[2] == 3);
+    osh_bdo_free(rec, nr);
+    remove(TEST_BDO);
+    remove("b.bdo");
+
+    osh_scoring_buffer_free(buf);
+    osh_scoring_free(&sw);
+}
+
+/* phase-space records at a plane and on leaving a zone, flushed in merge order */
+static void test_phsp(void) {
+    struct scoring_workspace sw;
+    struct scoring_buffer *buf[2];
+    struct osh_phsp_record *r;
+    struct particle p;
+    struct step st;
+    uint64_t nprim;
+    size_t n;
+    FILE *f;
+
+    f = fopen(TEST_TMP, "w");
+    ASSERT_TRUE(f != NULL);
+    fputs("Filter\n Name P\n Z = 1\n"
+          "Geometry Plane\n Name Exit\n Point 0 0 10\n Normal 0 0 2\n"
+          "Geometry Zone\n Name Z\n Zone 3\n"
+          "Geometry Mesh\n Name M\n X -1 1 1\n Y -1 1 1\n Z 0 20 1\n"
+          "Output\n Filename " TEST_PHSP "\n Geo Exit\n Quantity PHSP P\n"
+          "Output\n Filename z.phsp\n Geo Z\n Quantity PHSP\n"
+          "Output\n Filename " TEST_BDO "\n Geo M\n Quantity ENERGY\n",
+          f);
+    fclose(f);
+    ASSERT_TRUE(osh_scoring_load(TEST_TMP, &sw) == OSH_OK);
+    remove(TEST_TMP);
+    ASSERT_TRUE(sw.nphsp == 2 && sw.nbins == 1 && sw.geos[0].plane.n[2] == 1.0 && sw.geos[0].plane.d == 10.0);
+
+    buf[0] = osh_scoring_buffer_alloc(&sw);
+    buf[1] = osh_scoring_buffer_alloc(&sw);
+    ASSERT_TRUE(buf[0] != NULL && buf[1] != NULL);
+
+    /* recorded half way with the energy at the plane */
+    osh_scoring_history(buf[0]);
+    set_particle(&p, 1, 1, 0);
+    set_step(&st, 5.0, 15.0, 100.0, 10.0);
+    osh_scoring_score(buf[0], &p, &st);
+    /* backwards, and a particle rejected by the filter */
+    set_step(&st, 15.0, 5.0, 100.0, 10.0);
+    st.v[2] = -1.0;
+    osh_scoring_score(buf[0], &p, &st);
+    set_particle(&p, 6, 12, 1);
+    set_step(&st, 5.0, 15.0, 100.0, 10.0);
+    osh_scoring_score(buf[0], &p, &st);
+    /* leaving zone 3, then a step within it */
+    set_particle(&p, 1, 1, 0);
+    set_step(&st, 0.0, 1.0, 50.0, 2.0);
+    st.zone = 3;
+    st.cross = 1;
+    osh_scoring_score(buf[0], &p, &st);
+    st.cross = 0;
+    osh_scoring_score(buf[0], &p, &st);
+
+    /* a step ending on the plane is recorded, the next one is not */
+    osh_scoring_history(buf[1]);
+    set_step(&st, 8.0, 10.0, 20.0, 1.0);
+    osh_scoring_score(buf[1], &p, &st);
+    set_step(&st, 10.0, 12.0, 19.0, 1.0);
+    osh_scoring_score(buf[1], &p, &st);
+    ASSERT_TRUE(buf[0]->ph[0].n == 1 && buf[0]->ph[1].n == 1 && buf[1]->ph[0].n == 1 && buf[1]->ph[1].n == 0);
+
+    osh_scoring_merge(&sw, buf[0]);
+    osh_scoring_merge(&sw, buf[1]);
+    ASSERT_TRUE(sw.rc == OSH_OK && sw.nprim == 2);
+    ASSERT_TRUE(osh_scoring_write(&sw) == OSH_OK);
+
+    ASSERT_TRUE(osh_phsp_read(TEST_PHSP, &nprim, &r, &n) == OSH_OK);
+    ASSERT_TRUE(n == 2 && nprim == 2);
+    ASSERT_TRUE(r[0].p[2] == 10.0 && r[0].e == 95.0 && r[0].v[2] == 1.0 && r[0].z == 1);
+    ASSERT_TRUE(r[1].p[2] == 10.0 && r[1].e == 19.0);
+    free(r);
+    ASSERT_TRUE(osh_phsp_read("z.phsp", &nprim, &r, &n) == OSH_OK);
+    ASSERT_TRUE(n == 1 && r[0].p[2] == 1.0 && r[0].e == 48.0);
+    free(r);
+    remove(TEST_PHSP);
+    remove("z.phsp");
+    remove(TEST_BDO);
+
+    osh_scoring_buffer_free(buf[0]);
+    osh_scoring_buffer_free(buf[1]);
+    osh_scoring_free(&sw);
+}
+
+/* LET averages and a spectrum in one mesh bin */
+static void test_let(void) {
+    struct scoring_workspace sw;
+    struct scoring_buffer *buf;
+    struct osh_bdo_record *rec;
+    struct particle p;
+    struct step st;
+    double const *x;
+    size_t nr;
+    FILE *f;
+
+    f = fopen(TEST_TMP, "w");
+    ASSERT_TRUE(f != NULL);
+    fputs("Geometry Mesh\n Name M\n X 0 1 1\n Y 0 1 1\n Z 0 2 2\n"
+          "Output\n Filename " TEST_BDO "\n Geo M\n Quantity LETt\n Quantity LETd\n Quantity SPECTRUM 1 100 2\n",
+          f);
+    fclose(f);
+    ASSERT_TRUE(osh_scoring_load(TEST_TMP, &sw) == OSH_OK);
+    remove(TEST_TMP);
+    ASSERT_TRUE(sw.pages[0].nbins == 4 && sw.pages[2].nbins == 4 && sw.spectrum);
+
+    buf = osh_scoring_buffer_alloc(&sw);
+    ASSERT_TRUE(buf != NULL);
+    set_particle(&p, 1, 1, 0);
+    set_step(&st, 0.0, 0.5, 50.0, 1.0); /* 0.2 keV/um at 49.5 MeV */
+    osh_scoring_score(buf, &p, &st);
+    set_step(&st, 0.0, 0.5, 6.5, 3.0); /* 0.6 keV/um at 5 MeV */
+    osh_scoring_score(buf, &p, &st);
+    set_step(&st, 0.3, 0.3, 2.0, 2.0); /* residual energy deposited in place, no LET */
+    osh_scoring_score(buf, &p, &st);
+
+    /* numerators, then weights, of the two z bins */
+    ASSERT_TRUE(fabs(osh_scoring_buffer_value(buf, 0) - 0.4) < 1e-12 && osh_scoring_buffer_value(buf, 2) == 1.0);
+    ASSERT_TRUE(fabs(osh_scoring_buffer_value(buf, 4) - 2.0) < 1e-12 && osh_scoring_buffer_value(buf, 6) == 4.0);
+    ASSERT_TRUE(osh_scoring_buffer_value(buf, 1) == 0.0 && osh_scoring_buffer_value(buf, 3) == 0.0);
+    /* energy bins of z bin 0 */
+    ASSERT_TRUE(osh_scoring_buffer_value(buf, 8) == 0.5 && osh_scoring_buffer_value(buf, 9) == 0.5);
+    ASSERT_TRUE(osh_scoring_buffer_value(buf, 10) == 0.0 && osh_scoring_buffer_value(buf, 11) == 0.0);
+
+    osh_scoring_merge(&sw, buf);
+    ASSERT_TRUE(osh_scoring_write(&sw) == OSH_OK);
+    ASSERT_TRUE(osh_bdo_read(TEST_BDO, &rec, &nr) == OSH_OK && nr == 15);
+    x = rec[8].data;
+    ASSERT_TRUE(rec[8].tag == OSH_BDO_TAG_PAGE_DATA && rec[8].n == 2 && fabs(x[0] - 0.4) < 1e-12 && x[1] == 0.0);
+    x = rec[10].data;
+    ASSERT_TRUE(rec[10].tag == OSH_BDO_TAG_PAGE_DATA && fabs(x[0] - 0.5) < 1e-12);
+    x = rec[12].data;
+    ASSERT_TRUE(rec[12].tag == OSH_BDO_TAG_PAGE_EAXIS && x[0] == 1.0 && x[1] == 100.0 && x[2] == 2.0);
+    ASSERT_TRUE(rec[13].tag == OSH_BDO_TAG_PAGE_DATA && rec[13].n == 4 && rec[14].tag == OSH_BDO_TAG_PAGE_ERROR);
+    osh_bdo_free(rec, nr);
+    remove(TEST_BDO);
+
+    osh_scoring_buffer_free(buf);
+    osh_scoring_free(&sw);
+}
+
+/* per history sums of squares, across buffers and with histories skipping bins */
+static void test_stderr(void) {
+    const double x0[3] = {0.0, 0.0, 0.0};
+    const double x1[3] = {1.0, 1.0, 2.0};
+    const size_t n[3] = {1, 1, 2};
+    const double de[4] = {1.0, 2.0, 3.0, 6.0}; /* per history in bin 0 */
+    struct scoring_workspace sw;
+    struct scoring_buffer *buf[2];
+    struct particle p;
+    struct step st;
+    struct osh_bdo_record *r;
+    double err[2];
+    size_t nr;
+    int h, k;
+
+    mesh_setup(&sw, x0, x1, n);
+    buf[0] = osh_scoring_buffer_alloc(&sw);
+    buf[1] = osh_scoring_buffer_alloc(&sw);
+    ASSERT_TRUE(buf[0] != NULL && buf[1] != NULL);
+    set_particle(&p, 1, 1, 0);
+
+    /* two histories per buffer, each deposits in bin 0 in two halves, only the first of a buffer in bin 1 */
+    for (h = 0; h < 4; h++) {
+        osh_scoring_history(buf[h / 2]);
+        for (k = 0; k < 2; k++) {
+            set_step(&st, 0.2, 0.6, 100.0, 0.5 * de[h]);
+            osh_scoring_score(buf[h / 2], &p, &st);
+        }
+        if (h % 2 == 0) {
+            set_step(&st, 1.2, 1.6, 100.0, 1.0);
+            osh_scoring_score(buf[h / 2], &p, &st);
+        }
+    }
+    ASSERT_TRUE(osh_scoring_buffer_value(buf[0], 0) == 3.0 && osh_scoring_buffer_value(buf[1], 0) == 9.0);
+    osh_scoring_merge(&sw, buf[0]);
+    osh_scoring_merge(&sw, buf[1]);
+    ASSERT_TRUE(sw.nprim == 4 && osh_scoring_sum(&sw, 0) == 12.0 && osh_scoring_sum2(&sw, 0) == 50.0);
+    ASSERT_TRUE(osh_scoring_sum(&sw, 1) == 2.0 && osh_scoring_sum2(&sw, 1) == 2.0);
+
+    /* mean 3 and 0.5, variance of the samples 14/3 and 1/3 */
+    osh_scoring_stderr(&sw, 0, err);
+    ASSERT_TRUE(fabs(err[0] - sqrt(14.0 / 12.0)) < 1e-14 && fabs(err[1] - sqrt(1.0 / 12.0)) < 1e-14);
+
+    /* written as the geometry, then per page the mean per primary and its error */
+    ASSERT_TRUE(osh_scoring_write(&sw) == OSH_OK);
+    ASSERT_TRUE(osh_bdo_read(TEST_BDO, &r, &nr) == OSH_OK && nr == 13);
+    ASSERT_TRUE(r[1].tag == OSH_BDO_TAG_NPRIM && ((int64_t *) r[1].data)[0] == 4);
+    ASSERT_TRUE(r[6].tag == OSH_BDO_TAG_GEO_MAX && ((double *) r[6].data)[2] == 2.0);
+    ASSERT_TRUE(r[7].tag == OSH_BDO_TAG_PAGE && ((int64_t *) r[7].data)[0] == OSH_SCORING_QTY_ENERGY);
+    ASSERT_TRUE(r[8].tag == OSH_BDO_TAG_PAGE_DATA && r[8].n == 2 && ((double *) r[8].data)[0] == 3.0);
+    ASSERT_TRUE(r[9].tag == OSH_BDO_TAG_PAGE_ERROR && memcmp(r[9].data, err, sizeof(err)) == 0);
+    ASSERT_TRUE(r[12].tag == OSH_BDO_TAG_PAGE_ERROR);
+    osh_bdo_free(r, nr);
+    remove(TEST_BDO);
+
+    osh_scoring_buffer_free(buf[0]);
+    osh_scoring_buffer_free(buf[1]);
+    mesh_free(&sw);
+}
+
+/* partial results of two jobs, merged, give the sums of a single run */
+static void test_partial(void) {
+    const double x0[3] = {0.0, 0.0, 0.0};
+    const double x1[3] = {1.0, 1.0, 2.0};
+    const size_t n[3] = {1, 1, 2};
+    const size_t n3[3] = {1, 1, 3};
+    const char *part[2] = {"test_osh_scoring_0.partial", "test_osh_scoring_1.partial"};
+    struct scoring_workspace sw;
+    struct scoring_buffer *buf;
+    struct particle p;
+    struct step st;
+    double sum[4], sum2[4];
+    size_t i;
+    int h, j;
+
+    set_particle(&p, 1, 1, 0);
+    /* job 0 and job 1 take every other history, the third run all of them */
+    for (j = 0; j < 3; j++) {
+        mesh_setup(&sw, x0, x1, n);
+        buf = osh_scoring_buffer_alloc(&sw);
+        ASSERT_TRUE(buf != NULL);
+        for (h = 0; h < 6; h++) {
+            if (j < 2 && h % 2 != j)
+                continue;
+            osh_scoring_history(buf);
+            set_step(&st, 0.1 * h, 0.1 * h + 1.2, 100.0, 0.5 + h);
+            osh_scoring_score(buf, &p, &st);
+        }
+        osh_scoring_merge(&sw, buf);
+        if (j < 2) {
+            ASSERT_TRUE(osh_scoring_write_partial(&sw, part[j]) == OSH_OK);
+        } else {
+            ASSERT_TRUE(sw.nbins == 4);
+            for (i = 0; i < 4; i++) {
+                sum[i] = osh_scoring_sum(&sw, i);
+                sum2[i] = osh_scoring_sum2(&sw, i);
+            }
+        }
+        osh_scoring_buffer_free(buf);
+        mesh_free(&sw);
+    }
+
+    ASSERT_TRUE(osh_partial_merge(TEST_PARTIAL, part, 2) == OSH_OK);
+    mesh_setup(&sw, x0, x1, n);
+    ASSERT_TRUE(osh_scoring_read_partial(&sw, TEST_PARTIAL) == OSH_OK);
+    ASSERT_TRUE(sw.nprim == 6);
+    for (i = 0; i < 4; i++) {
+        ASSERT_TRUE(sum[i] > 0.0 && fabs(osh_scoring_sum(&sw, i) - sum[i]) < 1e-12 * sum[i]);
+        ASSERT_TRUE(fabs(osh_scoring_sum2(&sw, i) - sum2[i]) < 1e-12 * sum2[i]);
+    }
+    mesh_free(&sw);
+
+    /* a partial result of another detector is refused */
+    mesh_setup(&sw, x0, x1, n3);
+    ASSERT_TRUE(osh_scoring_read_partial(&sw, TEST_PARTIAL) == OSH_EINVAL);
+    mesh_free(&sw);
+
+    remove(part[0]);
+    remove(part[1]);
+    remove(TEST_PARTIAL);
+}
+
+/* a pencil beam through a large mesh only allocates the blocks it touches */
+static void test_sparse(void) {
+    const double x0[3] = {-10.0, -10.0, 0.0};
+    const double x1[3] = {10.0, 10.0, 20.0};
+    const size_t n[3] = {256, 256, 64};
+    struct scoring_workspace sw;
+    struct scoring_buffer *buf;
+    struct particle p;
+    struct step st;
+    double e;
+    size_t i, k;
+
+    mesh_setup(&sw, x0, x1, n);
+    ASSERT_TRUE(sw.nbins == 2 * 256 * 256 * 64);
+    buf = osh_scoring_buffer_alloc(&sw);
+    ASSERT_TRUE(buf != NULL && buf->slab == NULL && buf->nalloc == 0);
+    set_particle(&p, 1, 1, 0);
+
+    for (k = 0; k < 2; k++) {
+        for (i = 0; i < 200; i++) {
+            set_step(&st, 0.1 * i, 0.1 * (i + 1), 100.0, 0.5);
+            st.p[0] = st.q[0] = 0.01;
+            st.p[1] = st.q[1] = 0.01;
+            osh_scoring_score(buf, &p, &st);
+        }
+        /* one block per depth bin and page */
+        ASSERT_TRUE(buf->ntouched == 128 && buf->nalloc == 128);
+        osh_scoring_merge(&sw, buf);
+        ASSERT_TRUE(buf->ntouched == 0 && buf->nalloc == 128);
+    }
+
+    e = 0.0;
+    for (i = 0; i < sw.geos[0].nbins; i++)
+        e += osh_scoring_sum(&sw, i);
+    ASSERT_TRUE(fabs(e - 200.0) < 1e-9 && sw.rc == OSH_OK);
+    /* the merged result is as sparse as the buffer */
+    for (i = 0, k = 0; i < sw.nblk; i++)
+        k += (sw.sum[i] != NULL);
+    ASSERT_TRUE(k == 128);
+
+    osh_scoring_buffer_free(buf);
+    mesh_free(&sw);
+}
+
+static double water_density(void *data, int medium) {
+    (void) data;
+    (void) medium;
+    return 1.0;
+}
+
+static double water_dedx(void *data, struct particle const *part, int medium, double e) {
+    (void) data;
+    (void) part;
+    (void) medium;
+    return 300.0 / (e + 10.0);
+}
+
+/* multithreaded runs into sparse buffers give the same result for any number of threads */
+static void test_run(void) {
+    const double x0[3] = {-10.0, -10.0, 0.0};
+    const double x1[3] = {10.0, 10.0, 20.0};
+    const size_t n[3] = {200, 200, 100};
+    struct transport_physics ph = {water_density, water_dedx, NULL, NULL, NULL, NULL, NULL};
+    struct gemca_workspace *g;
+    struct beam_workspace wb;
+    struct beam_spot spot;
+    struct particle p;
+    struct scoring_workspace sw;
+    struct transport_tally t;
+    struct transport_run r;
+    struct osh_bdo_record *rec;
+    double *ref, *ref2, *err;
+    double e;
+    size_t i, nr;
+
+    osh_gemca_workspace_init(&g);
+    osh_gemca_load(TEST_GEO, g);
+
+    set_particle(&p, 1, 1, 0);
+    p.amass = 938.272;
+    p.amu = 1.00728;
+    memset(&spot, 0, sizeof(spot));
+    spot.part = &p;
+    spot.p[2] = -5.0;
+    spot.t0 = 100.0;
+    spot.size[0] = 0.3;
+    spot.size[1] = 0.3;
+    spot.wt = 1.0;
+    spot.shape = OSH_BEAM_SHAPE_GAUSSIAN;
+    memset(&wb, 0, sizeof(wb));
+    wb.spots = &spot;
+    wb.nspots = 1;
+    wb.nstat = 400;
+    wb.rndseed = 3;
+    wb.nsave = 100;
+
+    mesh_setup(&sw, x0, x1, n);
+    osh_scoring_tally(&sw, &t);
+    ASSERT_TRUE(osh_transport_run_init(&r, g, &wb, &ph, &t) == OSH_OK);
+    r.nthreads = 1;
+    ASSERT_TRUE(osh_transport_run(&r) == OSH_OK && sw.rc == OSH_OK);
+    ref = malloc(sw.nbins * sizeof(*ref));
+    ASSERT_TRUE(ref != NULL);
+    for (i = 0; i < sw.nbins; i++)
+        ref[i] = osh_scoring_sum(&sw, i);
+
+    /* the beam stops inside the mesh, less energy lost outside or below the cutoff */
+    e = 0.0;
+    for (i = 0; i < sw.geos[0].nbins; i++)
+        e += ref[i];
+    ASSERT_TRUE(e > 0.99 * 400.0 * 100.0 && e <= 400.0 * 100.0);
+    ASSERT_TRUE(sw.nprim == 400);
+
+    ref2 = malloc(sw.nbins * sizeof(*ref2));
+    ASSERT_TRUE(ref2 != NULL);
+    for (i = 0; i < sw.nbins; i++)
+        ref2[i] = osh_scoring_sum2(&sw, i);
+
+    /* protons of one energy all deposit about the same in the depth bins they cross */
+    err = malloc(sw.pages[0].nbins * sizeof(*err));
+    ASSERT_TRUE(err != NULL);
+    osh_scoring_stderr(&sw, 0, err);
+    for (i = 0; i < sw.pages[0].nbins; i++)
+        ASSERT_TRUE(err[i] >= 0.0 && err[i] <= sqrt(ref2[i] / 400.0 / 399.0) + 1e-12);
+
+    for (i = 0; i < sw.nblk; i++)
+        if (sw.sum[i]) {
+            memset(sw.sum[i], 0, OSH_SCORING_BLOCK * sizeof(**sw.sum));
+            memset(sw.sum2[i], 0, OSH_SCORING_BLOCK * sizeof(**sw.sum2));
+        }
+    sw.nprim = 0;
+    r.nthreads = 4;
+    ASSERT_TRUE(osh_transport_run(&r) == OSH_OK && sw.rc == OSH_OK);
+    for (i = 0; i < sw.nbins; i++)
+        ASSERT_TRUE(osh_scoring_sum(&sw, i) == ref[i] && osh_scoring_sum2(&sw, i) == ref2[i]);
+    ASSERT_TRUE(sw.nprim == 400);
+
+    /* snapshots were taken on the way, the final write leaves the whole result */
+    ASSERT_TRUE(r.nsave == 100 && sw.snap.nprim >= 100 && sw.snap.nprim < 400);
+    ASSERT_TRUE(osh_scoring_write(&sw) == OSH_OK && sw.snap.rc == OSH_OK);
+    ASSERT_TRUE(osh_bdo_read(TEST_BDO, &rec, &nr) == OSH_OK && nr == 13);
+    ASSERT_TRUE(((int64_t *) rec[1].data)[0] == 400);
+    osh_bdo_free(rec, nr);
+    remove(TEST_BDO);
+
+    free(ref);
+    free(ref2);
+    free(err);
+    mesh_free(&sw);
+    osh_gemca_workspace_free(g);
+}
+
+/* whole file into memory */
+static unsigned char *read_file(const char *path, size_t *len) {
+    unsigned char *b;
+    FILE *f;
+
+    f = fopen(path, "rb");
+    ASSERT_TRUE(f != NULL);
+    fseek(f, 0, SEEK_END);
+    *len = (size_t) ftell(f);
+    fseek(f, 0, SEEK_SET);
+    b = malloc(*len + 1);
+    ASSERT_TRUE(b != NULL && fread(b, 1, *len, f) == *len);
+    fclose(f);
+    return b;
+}
+
+/* phase-space files of multithreaded runs are the same for any number of threads */
+static void test_phsp_run(void) {
+    struct transport_physics ph = {water_density, water_dedx, NULL, NULL, NULL, NULL, NULL};
+    struct gemca_workspace *g;
+    struct beam_workspace wb;
+    struct beam_spot spot;
+    struct particle p;
+    struct scoring_workspace sw;
+    struct transport_tally t;
+    struct transport_run r;
+    struct osh_phsp_record *rec;
+    unsigned char *ref[2], *b;
+    size_t len[2], n, nb, i, k;
+    uint64_t nprim;
+    int nthreads[] = {1, 3, 8};
+    const char *name[2] = {TEST_PHSP, "z.phsp"};
+    FILE *f;
+
+    osh_gemca_workspace_init(&g);
+    osh_gemca_load(TEST_GEO, g);
+
+    set_particle(&p, 1, 1, 0);
+    p.amass = 938.272;
+    p.amu = 1.00728;
+    memset(&spot, 0, sizeof(spot));
+    spot.part = &p;
+    spot.p[2] = -5.0;
+    spot.t0 = 100.0;
+    spot.size[0] = 0.3;
+    spot.size[1] = 0.3;
+    spot.wt = 1.0;
+    spot.shape = OSH_BEAM_SHAPE_GAUSSIAN;
+    memset(&wb, 0, sizeof(wb));
+    wb.spots = &spot;
+    wb.nspots = 1;
+    wb.nstat = 400;
+    wb.rndseed = 3;
+
+    /* a plane in the water, and the exit of the vacuum zone into it */
+    f = fopen(TEST_TMP, "w");
+    ASSERT_TRUE(f != NULL);
+    fputs("Geometry Plane\n Name P\n Point 0 0 1\n Normal 0 0 1\n"
+          "Geometry Zone\n Name V\n Zone 2\n"
+          "Output\n Filename " TEST_PHSP "\n Geo P\n Quantity PHSP\n"
+          "Output\n Filename z.phsp\n Geo V\n Quantity PHSP\n",
+          f);
+    fclose(f);
+    ASSERT_TRUE(osh_scoring_load(TEST_TMP, &sw) == OSH_OK);
+    remove(TEST_TMP);
+    osh_scoring_tally(&sw, &t);
+
+    for (i = 0; i < sizeof(nthreads) / sizeof(nthreads[0]); i++) {
+        sw.nprim = 0;
+        ASSERT_TRUE(osh_transport_run_init(&r, g, &wb, &ph, &t) == OSH_OK);
+        r.nthreads = nthreads[i];
+        ASSERT_TRUE(osh_transport_run(&r) == OSH_OK && sw.rc == OSH_OK);
+        ASSERT_TRUE(r.nchunks > 1);
+        ASSERT_TRUE(osh_scoring_write(&sw) == OSH_OK);
+
+        for (k = 0; k < 2; k++) {
+            if (i == 0) {
+                /* every proton crosses each surface once */
+                ASSERT_TRUE(osh_phsp_read(name[k], &nprim, &rec, &n) == OSH_OK);
+                ASSERT_TRUE(n == 400 && nprim == 400);
+                ASSERT_TRUE(rec[0].p[2] == ((k == 0) ? 1.0 : 0.0) && rec[0].v[2] == 1.0);
+                ASSERT_TRUE((k == 0) ? rec[0].e < 100.0 : rec[0].e == 100.0);
+                free(rec);
+                ref[k] = read_file(name[k], &len[k]);
+                continue;
+            }
+            b = read_file(name[k], &nb);
+            ASSERT_TRUE(nb == len[k] && memcmp(b, ref[k], nb) == 0);
+            free(b);
+        }
+    }
+    for (k = 0; k < 2; k++) {
+        free(ref[k]);
+        remove(name[k]);
+    }
+
+    osh_scoring_free(&sw);
+    osh_gemca_workspace_free(g);
+}
+
+/* a snapshot which cannot be written is kept in snap.rc */
+static void test_snapshot(void) {
+    struct scoring_workspace sw;
+    FILE *f;
+
+    f = fopen(TEST_TMP, "w");
+    ASSERT_TRUE(f != NULL);
+    fputs("Geometry Mesh\n Name M\n X 0 1 1\n Y 0 1 1\n Z 0 1 1\n"
+          "Output\n Filename no_such_dir/a.bdo\n Geo M\n Quantity DOSE\n",
+          f);
+    fclose(f);
+    ASSERT_TRUE(osh_scoring_load(TEST_TMP, &sw) == OSH_OK);
+    remove(TEST_TMP);
+
+    ASSERT_TRUE(osh_scoring_snapshot(&sw) == OSH_OK);
+    ASSERT_TRUE(osh_scoring_write(&sw) == OSH_EIO);
+    ASSERT_TRUE(sw.snap.rc == OSH_EIO);
+    osh_scoring_free(&sw);
+}
+
+static void test_errors(void) {
+    ASSERT_TRUE(load_text("Geometry Mesh\n Name M\n X 0 1 1\n Y 0 1 1\n Z 0 1 1\n"
+                          "Output\n Filename a.bdo\n Geo M\n Quantity DOSE\n") == OSH_OK);
+
+    /* unknown filter, filters must be defined first */
+    ASSERT_TRUE(load_text("Geometry Mesh\n Name M\n X 0 1 1\n Y 0 1 1\n Z 0 1 1\n"
+                          "Output\n Filename a.bdo\n Geo M\n Quantity DOSE F\n"
+                          "Filter\n Name F\n Z = 1\n") == OSH_EPARSE);
+    /* missing axis */
+    ASSERT_TRUE(load_text("Geometry Mesh\n Name M\n X 0 1 1\n Y 0 1 1\n") == OSH_EPARSE);
+    /* duplicate names */
+    ASSERT_TRUE(load_text("Filter\n Name F\n Z = 1\nFilter\n Name f\n A = 1\n") == OSH_EPARSE);
+    /* bad conditions */
+    ASSERT_TRUE(load_text("Filter\n Name F\n Z ~ 1\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("Filter\n Name F\n E != 1\n") == OSH_EPARSE);
+    /* unknown geometry and quantity, output without pages */
+    ASSERT_TRUE(load_text("Geometry Torus\n Name T\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("Geometry Mesh\n Name M\n X 0 1 1\n Y 0 1 1\n Z 0 1 1\n"
+                          "Output\n Filename a.bdo\n Geo M\n Quantity HEAT\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("Geometry Mesh\n Name M\n X 0 1 1\n Y 0 1 1\n Z 0 1 1\n"
+                          "Output\n Filename a.bdo\n Geo M\n") == OSH_EPARSE);
+    /* cylinders and spheres */
+    ASSERT_TRUE(load_text("Geometry Cyl\n Name C\n R 0 5 5\n Phi 0 360 4\n Z 0 10 10\n Center 1 2 3\n"
+                          "Geometry Sph\n Name S\n R 1 5 4\n Theta 0 90 2\n"
+                          "Output\n Filename a.bdo\n Geo S\n Quantity DOSE\n") == OSH_OK);
+    ASSERT_TRUE(load_text("Geometry Cyl\n Name C\n R 0 5 5\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("Geometry Cyl\n Name C\n R -1 5 5\n Z 0 1 1\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("Geometry Sph\n Name S\n R 0 5 5\n Theta 0 190 2\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("Geometry Sph\n Name S\n R 0 5 5\n Center 1 2\n") == OSH_EPARSE);
+    /* zones */
+    ASSERT_TRUE(load_text("Geometry Zone\n Name Z\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("Geometry Zone\n Name Z\n Zone 1 2 1\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("Geometry Zone\n Name Z\n Zone 0\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("Geometry Zone\n Name Z\n Zone 1 2\n Volume 1.0\n") == OSH_EPARSE);
+    /* spectrum axis */
+    ASSERT_TRUE(load_text("Geometry Mesh\n Name M\n X 0 1 1\n Y 0 1 1\n Z 0 1 1\n"
+                          "Output\n Filename a.bdo\n Geo M\n Quantity SPECTRUM 0 10 5\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("Geometry Mesh\n Name M\n X 0 1 1\n Y 0 1 1\n Z 0 1 1\n"
+                          "Output\n Filename a.bdo\n Geo M\n Quantity SPECTRUM 1 10\n") == OSH_EPARSE);
+    /* planes and phase-space outputs */
+    ASSERT_TRUE(load_text("Geometry Plane\n Name P\n Point 0 0 1\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("Geometry Plane\n Name P\n Normal 0 0 0\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("Geometry Plane\n Name P\n Normal 0 0 1\n"
+                          "Output\n Filename a.bdo\n Geo P\n Quantity DOSE\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("Geometry Zone\n Name Z\n Zone 1\n"
+                          "Output\n Filename a.phsp\n Geo Z\n Quantity PHSP\n Quantity ENERGY\n") == OSH_EPARSE);
+    ASSERT_TRUE(load_text("Geometry Mesh\n Name M\n X 0 1 1\n Y 0 1 1\n Z 0 1 1\n"
+                          "Output\n Filename a.phsp\n Geo M\n Quantity PHSP\n") == OSH_EPARSE);
+    /* keys outside of blocks */
+    ASSERT_TRUE(load_text("Name F\n") == OSH_EPARSE);
+}
+
+int main(void) {
+    test_filters();
+    test_load();
+    test_particle();
+    test_mesh();
+    test_radial();
+    test_zone();
+    test_phsp();
+    test_let();
+    test_stderr();
+    test_partial();
+    test_sparse();
+    test_run();
+    test_phsp_run();
+    test_snapshot();
+    test_errors();
+
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common/osh_rc.h"
+#include "transport/osh_secondary.h"
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+#define ASSERT_TRUE(cond)                                                                                              \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(stderr, "ASSERT FAILED: %s (%s:%d)\n", #cond, __FILE__, __LINE__);                                 \
+            exit(1);                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+#define NITEMS 100000
+#define NTHIEVES 3
+
+static void test_stack(void) {
+    struct secondary_stack s;
+    struct secondary *x;
+    struct secondary *first;
+    size_t n;
+
+    ASSERT_TRUE(osh_secondary_stack_init(&s, 10) == OSH_OK);
+    ASSERT_TRUE(s.cap == OSH_SECONDARY_CHUNK && s.n == 0);
+    ASSERT_TRUE(osh_secondary_pop(&s) == NULL);
+
+    /* several chunks deep, entries keep their address while the arena grows */
+    n = 3 * OSH_SECONDARY_CHUNK + 17;
+    first = osh_secondary_push(&s);
+    first->part.nprim = 0;
+    for (size_t i = 1; i < n; i++) {
+        x = osh_secondary_push(&s);
+        ASSERT_TRUE(x != NULL);
+        x->part.nprim = (unsigned int) i;
+        x->pos.p[3] = (double) i;
+    }
+    ASSERT_TRUE(first->part.nprim == 0);
+    ASSERT_TRUE(s.n == n && s.high == n && s.nchunk == 4);
+
+    /* last in, first out */
+    for (size_t i = n; i-- > 0;) {
+        x = osh_secondary_pop(&s);
+        ASSERT_TRUE(x != NULL && x->part.nprim == i);
+    }
+    ASSERT_TRUE(osh_secondary_pop(&s) == NULL);
+
+    /* the arena is reused, no further chunks */
+    for (size_t i = 0; i < n; i++)
+        osh_secondary_push(&s);
+    ASSERT_TRUE(s.nchunk == 4);
+
+    osh_secondary_stack_free(&s);
+    ASSERT_TRUE(s.chunk == NULL && s.n == 0);
+}
+
+static void test_deque(void) {
+    struct secondary_deque d;
+    struct secondary x;
+
+    ASSERT_TRUE(osh_secondary_deque_init(&d, 10) == OSH_OK);
+    ASSERT_TRUE(osh_secondary_deque_pop(&d, &x) == 0);
+    ASSERT_TRUE(osh_secondary_deque_steal(&d, &x) == 0);
+
+    /* grows past the initial 64 entries */
+    for (int i = 0; i < 1000; i++) {
+        x.part.nprim = (unsigned int) i;
+        ASSERT_TRUE(osh_secondary_deque_push(&d, &x) == OSH_OK);
+    }
+    ASSERT_TRUE(osh_secondary_deque_size(&d) == 1000);
+
+    /* owner pops the newest, thieves steal the oldest */
+    ASSERT_TRUE(osh_secondary_deque_pop(&d, &x) == 1 && x.part.nprim == 999);
+    ASSERT_TRUE(osh_secondary_deque_steal(&d, &x) == 1 && x.part.nprim == 0);
+    ASSERT_TRUE(osh_secondary_deque_steal(&d, &x) == 1 && x.part.nprim == 1);
+    for (int i = 998; i >= 2; i--)
+        ASSERT_TRUE(osh_secondary_deque_pop(&d, &x) == 1 && x.part.nprim == (unsigned int) i);
+    ASSERT_TRUE(osh_secondary_deque_pop(&d, &x) == 0);
+    ASSERT_TRUE(osh_secondary_deque_size(&d) == 0);
+
+    osh_secondary_deque_free(&d);
+}
+
+#if !defined(_WIN32)
+
+struct thief {
+    struct secondary_deque *d;
+    unsigned char *seen;
+    int volatile *done;
+    long n;
+};
+
+static void *thief_run(void *arg) {
+    struct thief *t = arg;
+    struct secondary x;
+
+    for (;;) {
+        if (osh_secondary_deque_steal(t->d, &x)) {
+            ASSERT_TRUE(x.part.nprim < NITEMS && x.pos.p[0] == (double) x.part.nprim);
+            t->seen[x.part.nprim]++;
+            t->n++;
+        } else if (__atomic_load_n(t->done, __ATOMIC_ACQUIRE) && osh_secondary_deque_size(t->d) == 0) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* every entry is taken exactly once, by the owner or by one of the thieves */
+static void test_deque_threads(void) {
+    static unsigned char seen[NTHIEVES + 1][NITEMS];
+    struct secondary_deque d;
+    struct secondary x;
+    struct thief t[NTHIEVES];
+    pthread_t th[NTHIEVES];
+    int volatile done = 0;
+    long nown = 0;
+    long total;
+
+    ASSERT_TRUE(osh_secondary_deque_init(&d, 0) == OSH_OK);
+    for (int i = 0; i < NTHIEVES; i++) {
+        t[i].d = &d;
+        t[i].seen = seen[i + 1];
+        t[i].done = &done;
+        t[i].n = 0;
+        ASSERT_TRUE(pthread_create(&th[i], NULL, thief_run, &t[i]) == 0);
+    }
+
+    /* the owner pushes in bursts and pops some of its own work in between */
+    for (int i = 0; i < NITEMS; i++) {
+        x.part.nprim = (unsigned int) i;
+        x.pos.p[0] = (double) i;
+        ASSERT_TRUE(osh_secondary_deque_push(&d, &x) == OSH_OK);
+        if (i % 3 == 0 && osh_secondary_deque_pop(&d, &x)) {
+            seen[0][x.part.nprim]++;
+            nown++;
+        }
+    }
+    while (osh_secondary_deque_pop(&d, &x)) {
+        seen[0][x.part.nprim]++;
+        nown++;
+    }
+    __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+
+    total = nown;
+    for (int i = 0; i < NTHIEVES; i++) {
+        pthread_join(th[i], NULL);
+        total += t[i].n;
+    }
+    ASSERT_TRUE(total == NITEMS);
+    for (int k = 0; k < NITEMS; k++) {
+        int c = 0;
+        for (int i = 0; i <= NTHIEVES; i++)
+            c += seen[i][k];
+        ASSERT_TRUE(c == 1);
+    }
+
+    osh_secondary_deque_free(&d);
+}
+
+#endif
+
+int main(void) {
+    test_stack();
+    test_deque();
+#if !defined(_WIN32)
+    test_deque_threads();
+#endif
+    return 0;
+}
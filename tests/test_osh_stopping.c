@@ -0,0 +1,155 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_alloc.h"
+#include "common/osh_rc.h"
+#include "particle/osh_particle.h"
+#include "physics/osh_stopping.h"
+
+#define ASSERT_TRUE(cond)                                                                                              \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(stderr, "ASSERT FAILED: %s (%s:%d)\n", #cond, __FILE__, __LINE__);                                 \
+            exit(1);                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+#define MED_WATER 1
+#define MED_LEAD 7
+
+static struct stopping_medium media[2] = {
+    {MED_WATER, 1.0, 0.55509, 7.22, 75.0},
+    {MED_LEAD, 11.35, 0.39575, 82.0, 823.0},
+};
+
+static void particle(struct particle *p, int z, unsigned int a, double amu) {
+    memset(p, 0, sizeof(*p));
+    p->amu = amu;
+    p->amass = amu * 931.49410242;
+    p->weight = 1.0;
+    p->id = OSH_PART_HADRON;
+    p->z = z;
+    p->a = a;
+}
+
+static int close_to(double x, double ref, double rel) {
+    return fabs(x - ref) <= rel * fabs(ref);
+}
+
+static void test_init(void) {
+    struct stopping_workspace sw;
+    struct stopping_medium m[2];
+
+    m[0] = media[0];
+    m[1] = media[0];
+    ASSERT_TRUE(osh_stopping_init(&sw, m, 2, 1) == OSH_EINVAL); /* duplicate */
+    m[1].medium = 1000;
+    ASSERT_TRUE(osh_stopping_init(&sw, m, 2, 1) == OSH_EINVAL); /* vacuum */
+    m[1].medium = 2;
+    m[1].ival = 0.0;
+    ASSERT_TRUE(osh_stopping_init(&sw, m, 2, 1) == OSH_EINVAL);
+    ASSERT_TRUE(osh_stopping_init(&sw, media, 2, 0) == OSH_EINVAL);
+
+    ASSERT_TRUE(osh_stopping_init(&sw, media, 2, 6) == OSH_OK);
+    ASSERT_TRUE(sw.n == 7 * OSH_STOPPING_NDEC + 1);
+    ASSERT_TRUE(sw.stride % (OSH_CACHELINE / sizeof(double)) == 0);
+    ASSERT_TRUE((uintptr_t) sw.dedx % OSH_CACHELINE == 0 && (uintptr_t) sw.lnr % OSH_CACHELINE == 0);
+    osh_stopping_free(&sw);
+}
+
+/* protons in water against PSTAR (I = 75 eV) */
+static void test_water(struct stopping_workspace *sw) {
+    struct particle p;
+
+    particle(&p, 1, 1, 1.00728);
+
+    ASSERT_TRUE(close_to(osh_stopping_dedx(sw, &p, MED_WATER, 10.0), 45.67, 0.01));
+    ASSERT_TRUE(close_to(osh_stopping_dedx(sw, &p, MED_WATER, 100.0), 7.289, 0.01));
+    ASSERT_TRUE(close_to(osh_stopping_dedx(sw, &p, MED_WATER, 1000.0), 2.211, 0.01));
+    ASSERT_TRUE(close_to(osh_stopping_range(sw, &p, MED_WATER, 10.0), 0.1230, 0.02));
+    ASSERT_TRUE(close_to(osh_stopping_range(sw, &p, MED_WATER, 100.0), 7.718, 0.005));
+    ASSERT_TRUE(close_to(osh_stopping_range(sw, &p, MED_WATER, 200.0), 25.96, 0.005));
+
+    /* lead stops harder per cm, but less per g/cm2 */
+    ASSERT_TRUE(osh_stopping_dedx(sw, &p, MED_LEAD, 100.0) < osh_stopping_dedx(sw, &p, MED_WATER, 100.0));
+}
+
+/* tables follow the model, ranges grow and invert */
+static void test_tables(struct stopping_workspace *sw) {
+    struct particle p[3];
+    double e, r, rlast, s, m;
+    int med[2] = {MED_WATER, MED_LEAD};
+
+    particle(&p[0], 1, 1, 1.00728);
+    particle(&p[1], 6, 12, 11.9967);
+    particle(&p[2], -1, 0, 0.149834); /* pi- */
+
+    for (int k = 0; k < 3; k++) {
+        for (int j = 0; j < 2; j++) {
+            rlast = 0.0;
+            for (e = 1e-4; e < 1e5; e *= 1.07) {
+                s = osh_stopping_dedx(sw, &p[k], med[j], e * p[k].amu);
+                r = osh_stopping_range(sw, &p[k], med[j], e * p[k].amu);
+                ASSERT_TRUE(s > 0.0 && r > rlast);
+                rlast = r;
+                ASSERT_TRUE(close_to(osh_stopping_erange(sw, &p[k], med[j], r), e * p[k].amu, 1e-12));
+
+                if (e > OSH_STOPPING_TMIN && e < OSH_STOPPING_TMAX) {
+                    m = osh_stopping_bethe(&media[j], p[k].z, e);
+                    ASSERT_TRUE(close_to(s, m, 2e-3)); /* worst at the kink of the low energy model */
+                }
+            }
+        }
+    }
+    ASSERT_TRUE(osh_stopping_erange(sw, &p[0], MED_WATER, 0.0) == 0.0);
+    ASSERT_TRUE(osh_stopping_range(sw, &p[0], MED_WATER, 0.0) == 0.0);
+}
+
+/* one table per charge, mass scaling of the range */
+static void test_scaling(struct stopping_workspace *sw) {
+    struct particle p, he, c, n;
+    double rp, rc;
+
+    particle(&p, 1, 1, 1.00728);
+    particle(&he, 2, 4, 4.00151);
+    particle(&c, 6, 12, 11.9967);
+
+    /* fully stripped at 200 MeV/u: z^2 times the proton */
+    ASSERT_TRUE(close_to(osh_stopping_dedx(sw, &he, MED_WATER, 200.0 * he.amu),
+                         4.0 * osh_stopping_dedx(sw, &p, MED_WATER, 200.0 * p.amu), 1e-3));
+
+    rp = osh_stopping_range(sw, &p, MED_WATER, 200.0 * p.amu);
+    rc = osh_stopping_range(sw, &c, MED_WATER, 200.0 * c.amu);
+    ASSERT_TRUE(close_to(rc, rp * (c.amu / 36.0) / p.amu, 0.01));
+
+    /* the effective charge lowers the stopping power of slow ions */
+    ASSERT_TRUE(osh_stopping_dedx(sw, &c, MED_WATER, 0.5 * c.amu) <
+                36.0 * osh_stopping_dedx(sw, &p, MED_WATER, 0.5 * p.amu));
+
+    /* neutral particles, charges and media without tables */
+    particle(&n, 0, 1, 1.00866);
+    ASSERT_TRUE(osh_stopping_dedx(sw, &n, MED_WATER, 100.0) == 0.0);
+    ASSERT_TRUE(osh_stopping_range(sw, &n, MED_WATER, 100.0) == HUGE_VAL);
+    ASSERT_TRUE(osh_stopping_erange(sw, &n, MED_WATER, 1.0) == 0.0);
+    particle(&n, 8, 16, 15.9905);
+    ASSERT_TRUE(osh_stopping_dedx(sw, &n, MED_WATER, 100.0) == 0.0);
+    ASSERT_TRUE(osh_stopping_dedx(sw, &p, 2, 100.0) == 0.0);
+    ASSERT_TRUE(osh_stopping_dedx(sw, &p, 1000, 100.0) == 0.0);
+}
+
+int main(void) {
+    struct stopping_workspace sw;
+
+    test_init();
+
+    ASSERT_TRUE(osh_stopping_init(&sw, media, 2, 6) == OSH_OK);
+    test_water(&sw);
+    test_tables(&sw);
+    test_scaling(&sw);
+    osh_stopping_free(&sw);
+
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/osh_rc.h"
+#include "material/osh_material.h"
+#include "particle/osh_particle.h"
+#include "physics/osh_physics.h"
+#include "physics/osh_straggling.h"
+#include "random/osh_rng.h"
+#include "transport/osh_transport.h"
+#include "transport/osh_transport_engine.h"
+
+#define ASSERT_TRUE(cond)                                                                                              \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(stderr, "ASSERT FAILED: %s (%s:%d)\n", #cond, __FILE__, __LINE__);                                 \
+            exit(1);                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+#define TEST_MAT "../../tests/res/test01/mat.dat"
+#define NSAMPLE 200000
+
+/* mean and variance of the piecewise linear quantile function */
+static void moments(struct straggling_table const *t, double kappa, double beta2, double *mean, double *var) {
+    double a, b;
+    int k;
+
+    *mean = 0.0;
+    *var = 0.0;
+    for (k = 0; k < OSH_STRAGGLING_NU; k++) {
+        a = osh_straggling_quantile(t, kappa, beta2, (double) k / OSH_STRAGGLING_NU);
+        b = osh_straggling_quantile(t, kappa, beta2, (double) (k + 1) / OSH_STRAGGLING_NU);
+        *mean += 0.5 * (a + b) / OSH_STRAGGLING_NU;
+        *var += (a * a + a * b + b * b) / 3.0 / OSH_STRAGGLING_NU;
+    }
+}
+
+static void test_tables(struct straggling_table const *t) {
+    double kappa[] = {0.01, 0.05, 0.3, 1.0, 4.0, 10.0};
+    double beta2[] = {0.0, 0.25, 0.5, 0.95};
+    double mean, var, skew, z, q;
+    size_t i, j;
+
+    /* mean 0 and variance 1 in units of sigma, also between the grid points */
+    for (i = 0; i < sizeof(kappa) / sizeof(kappa[0]); i++) {
+        for (j = 0; j < sizeof(beta2) / sizeof(beta2[0]); j++) {
+            moments(t, kappa[i], beta2[j], &mean, &var);
+            ASSERT_TRUE(fabs(mean) < 1e-6);
+            ASSERT_TRUE(fabs(var - 1.0) < 5e-3);
+        }
+    }
+
+    /* thick layers: Gaussian with the Vavilov skewness, Cornish-Fisher expansion */
+    skew = (0.5 - 0.5 / 3.0) * 10.0 / pow(10.0 * 0.75, 1.5);
+    for (z = -2.0; z <= 2.0; z += 0.5) {
+        q = osh_straggling_quantile(t, 10.0, 0.5, 0.5 * erfc(-z / sqrt(2.0)));
+        ASSERT_TRUE(fabs(q - (z + skew / 6.0 * (z * z - 1.0))) < 0.01);
+    }
+
+    /* thin layers: median of the Landau distribution, lambda = 1.3558 */
+    q = osh_straggling_quantile(t, 0.01, 0.0, 0.5);
+    ASSERT_TRUE(fabs(q - (1.3558 + 1.0 - 0.577216 + log(0.01)) * 0.01 / sqrt(0.01)) < 0.01);
+
+    /* monotonic */
+    for (i = 0; i < OSH_STRAGGLING_NU; i++)
+        ASSERT_TRUE(osh_straggling_quantile(t, 0.2, 0.3, (double) i / OSH_STRAGGLING_NU) <
+                    osh_straggling_quantile(t, 0.2, 0.3, (double) (i + 1) / OSH_STRAGGLING_NU));
+}
+
+static void test_sample(struct straggling_table const *t) {
+    struct osh_rng rng;
+    double kappa[] = {0.001, 0.2, 3.0, 30.0};
+    double xi, tmax, beta2, sigma, x, s1, s2;
+    size_t i;
+    int k;
+
+    osh_rng_init(&rng, OSH_RNG_TYPE_PCG32, 39, 0);
+    beta2 = 0.2;
+    tmax = 0.2;
+    for (i = 0; i < sizeof(kappa) / sizeof(kappa[0]); i++) {
+        xi = kappa[i] * tmax;
+        sigma = sqrt(xi * tmax * (1.0 - 0.5 * beta2));
+        s1 = 0.0;
+        s2 = 0.0;
+        for (k = 0; k < NSAMPLE; k++) {
+            x = osh_straggling_vavilov(t, xi, tmax, beta2, &rng);
+            ASSERT_TRUE(x <= tmax * (1.0 + 1e-9) || kappa[i] > OSH_STRAGGLING_KMIN);
+            s1 += x;
+            s2 += x * x;
+        }
+        s1 /= NSAMPLE;
+        s2 = s2 / NSAMPLE - s1 * s1;
+        if (kappa[i] >= OSH_STRAGGLING_KMIN) {
+            ASSERT_TRUE(fabs(s1) < 5.0 * sigma / sqrt(NSAMPLE));
+            ASSERT_TRUE(fabs(sqrt(s2) / sigma - 1.0) < 0.02);
+        } else {
+            /* the truncated Landau distribution keeps the mean within a fraction of xi */
+            ASSERT_TRUE(fabs(s1) < xi);
+        }
+    }
+}
+
+static void test_hook(void) {
+    struct material_workspace mw;
+    struct physics_workspace pw;
+    struct transport_physics ph;
+    struct particle p;
+    struct step st;
+    struct osh_rng rng;
+    double xi, tmax, beta2, sigma, x, s1, s2;
+    int mode, k;
+
+    memset(&p, 0, sizeof(p));
+    p.z = 1;
+    p.a = 1;
+    p.amu = 1.00728;
+    memset(&st, 0, sizeof(st));
+    st.medium = 1;
+    st.rho = 1.0;
+    st.ds = 0.1;
+    st.p[3] = 100.0;
+
+    ASSERT_TRUE(osh_material_load(TEST_MAT, &mw) == OSH_OK);
+    ASSERT_TRUE(osh_physics_init(&pw, &mw, 1, 3, OSH_SCATTERING_OFF) == OSH_EINVAL);
+
+    for (mode = OSH_STRAGGLING_OFF; mode <= OSH_STRAGGLING_VAVILOV; mode++) {
+        ASSERT_TRUE(osh_physics_init(&pw, &mw, 1, mode, OSH_SCATTERING_OFF) == OSH_OK);
+        osh_physics_hooks(&pw, &ph);
+        ASSERT_TRUE(ph.density(ph.data, 1) == mw.media[0].rho && ph.density(ph.data, 2) == 0.0);
+        ASSERT_TRUE(ph.dedx(ph.data, &p, 1, 100.0) == osh_stopping_dedx(&pw.stopping, &p, 1, 100.0));
+        if (mode == OSH_STRAGGLING_OFF) {
+            ASSERT_TRUE(ph.eloss == NULL);
+            osh_physics_free(&pw);
+            continue;
+        }
+
+        /* 1 mm of water at 100 MeV, kappa ~ 0.2 */
+        st.de = ph.dedx(ph.data, &p, 1, 100.0) * st.rho * st.ds;
+        osh_straggling_params(1, p.amu, st.p[3] - 0.5 * st.de, mw.media[0].zovera, st.ds, &xi, &tmax, &beta2);
+        ASSERT_TRUE(xi / tmax > 0.1 && xi / tmax < 0.3);
+        sigma = sqrt(xi * tmax * (1.0 - 0.5 * beta2));
+
+        osh_rng_init(&rng, OSH_RNG_TYPE_PCG32, 1, 0);
+        s1 = 0.0;
+        s2 = 0.0;
+        for (k = 0; k < NSAMPLE; k++) {
+            x = ph.eloss(ph.data, &p, &st, &rng);
+            s1 += x;
+            s2 += x * x;
+        }
+        s1 /= NSAMPLE;
+        s2 = s2 / NSAMPLE - s1 * s1;
+        ASSERT_TRUE(fabs(s1 - st.de) < 5.0 * sigma / sqrt(NSAMPLE));
+        ASSERT_TRUE(fabs(sqrt(s2) / sigma - 1.0) < 0.02);
+
+        /* neutral particles keep the mean energy loss */
+        p.z = 0;
+        ASSERT_TRUE(ph.eloss(ph.data, &p, &st, &rng) == st.de);
+        p.z = 1;
+
+        osh_physics_free(&pw);
+    }
+
+    osh_material_free(&mw);
+}
+
+int main(void) {
+    struct straggling_table t;
+
+    ASSERT_TRUE(osh_straggling_init(&t) == OSH_OK);
+    test_tables(&t);
+    test_sample(&t);
+    osh_straggling_free(&t);
+
+    test_hook();
+
+    return 0;
+}
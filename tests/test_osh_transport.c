@@ -0,0 +1,378 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "beam/osh_beam.h"
+#include "common/osh_rc.h"
+#include "gemca/osh_gemca2.h"
+#include "particle/osh_particle.h"
+#include "physics/osh_stopping.h"
+#include "random/osh_rng.h"
+#include "transport/osh_transport.h"
+#include "transport/osh_transport_engine.h"
+#include "transport/osh_transport_event.h"
+
+#define ASSERT_TRUE(cond)                                                                                              \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(stderr, "ASSERT FAILED: %s (%s:%d)\n", #cond, __FILE__, __LINE__);                                 \
+            exit(1);                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+#define TEST_GEO "../../tests/res/transport/geo.dat"
+#define TEST_OPEN "../../tests/res/transport/open.dat" /* no black hole around the world */
+
+#define ZONE_WATER 3
+
+/* Bethe formula for water without shell and density corrections, I = 75 eV */
+static double water_dedx(void *data, struct particle const *part, int medium, double e) {
+    const double me = 0.51099895;
+    const double k = 0.307075;
+    const double z_a = 0.5551;
+    const double ival = 75.0e-6;
+    double g, b2, tmax, m;
+
+    (void) data;
+    (void) medium;
+
+    m = part->amass;
+    g = 1.0 + e / m;
+    b2 = 1.0 - 1.0 / (g * g);
+    tmax = 2.0 * me * b2 * g * g / (1.0 + 2.0 * g * me / m + (me / m) * (me / m));
+    return k * z_a * part->z * part->z / b2 * (0.5 * log(2.0 * me * b2 * g * g * tmax / (ival * ival)) - b2);
+}
+
+static double water_density(void *data, int medium) {
+    (void) data;
+    (void) medium;
+    return 1.0;
+}
+
+struct tally {
+    double edep;
+    double zmax;
+    double track;
+    double demax;
+    size_t nsteps;
+    int bad;
+};
+
+static void score(void *data, struct particle const *part, struct step const *st) {
+    struct tally *t = data;
+    double limit;
+
+    (void) part;
+
+    t->edep += st->de;
+    t->track += st->ds;
+    t->nsteps++;
+    if (st->q[2] > t->zmax)
+        t->zmax = st->q[2];
+
+    /* steps never leave their zone */
+    if (st->zone == ZONE_WATER && (st->p[2] < -1e-6 || st->q[2] < -1e-6))
+        t->bad++;
+    if (st->medium == OSH_TRANSPORT_MEDIUM_VACUUM && st->de != 0.0)
+        t->bad++;
+
+    /* energy loss limit, with some room for the mid-step stopping power */
+    limit = t->demax * st->p[3];
+    if (limit < OSH_TRANSPORT_DEMIN)
+        limit = OSH_TRANSPORT_DEMIN;
+    if (st->ds > 0.0 && st->de > 1.05 * limit)
+        t->bad++;
+}
+
+static void proton(struct particle *p) {
+    p->amass = 938.272;
+    p->amu = 1.00728;
+    p->weight = 1.0;
+    p->id = OSH_PART_HADRON;
+    p->z = 1;
+    p->a = 1;
+    p->gen = 0;
+    p->nprim = 0;
+    p->pdg = 2212;
+}
+
+static void test_range(struct gemca_workspace *g) {
+    struct transport_workspace tw;
+    struct transport_physics ph = {water_density, water_dedx, NULL, NULL, NULL, NULL, NULL};
+    struct transport_scorer sc = {0};
+    struct tally t = {0};
+    struct particle p;
+    struct position pos = {0};
+
+    sc.score = score;
+    sc.data = &t;
+    t.demax = OSH_TRANSPORT_DELTAE;
+    t.zmax = -1e30;
+
+    ASSERT_TRUE(osh_transport_init(&tw, g, NULL, &ph, &sc) == OSH_OK);
+    proton(&p);
+
+    pos.p[2] = -5.0;
+    pos.p[3] = 100.0;
+    pos.v[2] = 1.0;
+    pos.system = 1;
+
+    ASSERT_TRUE(osh_transport_history(&tw, &p, &pos, NULL) == OSH_TRANSPORT_END_STOPPED);
+    ASSERT_TRUE(pos.p[3] == 0.0);
+    ASSERT_TRUE(pos.zone == ZONE_WATER);
+    ASSERT_TRUE(t.bad == 0);
+
+    /* all energy deposited, CSDA range of 7.71 cm for this stopping power */
+    ASSERT_TRUE(fabs(t.edep - 100.0) < 1e-9);
+    ASSERT_TRUE(fabs(t.zmax - 7.71) < 0.03);
+    ASSERT_TRUE(fabs(t.track - (5.0 + t.zmax)) < 1e-6);
+    ASSERT_TRUE(tw.nhist == 1 && tw.nsteps == t.nsteps);
+    ASSERT_TRUE(t.nsteps > 100 && t.nsteps < 400);
+
+    osh_transport_free(&tw);
+}
+
+static void test_escape(struct gemca_workspace *g) {
+    struct transport_workspace tw;
+    struct transport_physics ph = {water_density, water_dedx, NULL, NULL, NULL, NULL, NULL};
+    struct transport_scorer sc = {0};
+    struct beam_workspace wb = {0};
+    struct beam_shared shared = {0};
+    struct beam_spot spot = {0};
+    struct tally t = {0};
+    struct particle p;
+    struct position pos = {0};
+    struct osh_rng rng;
+
+    sc.score = score;
+    sc.data = &t;
+    t.demax = 0.01;
+
+    wb.deltae = 0.01f;
+    wb.shared = &shared;
+    ASSERT_TRUE(osh_transport_init(&tw, g, &wb, &ph, &sc) == OSH_OK);
+    ASSERT_TRUE(tw.deltae == (double) 0.01f && tw.tcut == OSH_BEAM_TMIN0);
+
+    /* 250 MeV protons pass the 20 cm slab and end in the black hole */
+    proton(&p);
+    spot.part = &p;
+    spot.p[2] = -5.0;
+    spot.t0 = 250.0;
+    spot.shape = OSH_BEAM_SHAPE_GAUSSIAN;
+    spot.size[0] = 0.5;
+    spot.size[1] = 0.5;
+    osh_rng_init(&rng, OSH_RNG_TYPE_PCG32, 1u, 0u);
+
+    for (int i = 0; i < 10; ++i)
+        ASSERT_TRUE(osh_transport_primary(&tw, &spot, &rng) == OSH_TRANSPORT_END_ESCAPED);
+    ASSERT_TRUE(t.bad == 0);
+    ASSERT_TRUE(t.edep > 10 * 40.0 && t.edep < 10 * 250.0);
+    ASSERT_TRUE(tw.nhist == 10);
+
+    /* backwards, straight into the black hole */
+    t.edep = 0.0;
+    pos.p[2] = -1.0;
+    pos.p[3] = 100.0;
+    pos.v[2] = -1.0;
+    ASSERT_TRUE(osh_transport_history(&tw, &p, &pos, &rng) == OSH_TRANSPORT_END_ESCAPED);
+    ASSERT_TRUE(pos.p[3] == 100.0 && pos.medium == OSH_TRANSPORT_MEDIUM_BLACKHOLE);
+    ASSERT_TRUE(t.edep == 0.0);
+
+    spot.shape = 99;
+    ASSERT_TRUE(osh_transport_primary(&tw, &spot, &rng) == -1);
+
+    osh_transport_free(&tw);
+}
+
+/* the event based loop makes the same steps as the history based one */
+static void test_event(struct gemca_workspace *g) {
+    struct transport_workspace tw;
+    struct transport_physics ph = {water_density, water_dedx, NULL, NULL, NULL, NULL, NULL};
+    struct transport_scorer sc = {0};
+    struct transport_bank b;
+    struct tally th = {0};
+    struct tally te = {0};
+    struct particle p;
+    struct position pos[100];
+    struct position x;
+    int n = 100;
+
+    proton(&p);
+    for (int i = 0; i < n; i++) {
+        memset(&pos[i], 0, sizeof(pos[i]));
+        pos[i].p[0] = -9.0 + 0.18 * i;
+        pos[i].p[2] = -5.0;
+        pos[i].p[3] = 20.0 + 2.0 * i;
+        pos[i].v[0] = 0.01 * (i % 7);
+        pos[i].v[2] = sqrt(1.0 - pos[i].v[0] * pos[i].v[0]);
+        pos[i].system = 1;
+    }
+    pos[n - 1].v[0] = 0.0;
+    pos[n - 1].v[2] = -1.0; /* straight into the black hole */
+
+    sc.score = score;
+    th.demax = OSH_TRANSPORT_DELTAE;
+    th.zmax = -1e30;
+    te = th;
+
+    sc.data = &th;
+    ASSERT_TRUE(osh_transport_init(&tw, g, NULL, &ph, &sc) == OSH_OK);
+    for (int i = 0; i < n; i++) {
+        x = pos[i];
+        osh_transport_history(&tw, &p, &x, NULL);
+    }
+    ASSERT_TRUE(tw.nhist == (size_t) n && tw.nsteps == th.nsteps);
+    osh_transport_free(&tw);
+
+    /* a small bank, grown by osh_transport_bank_add() */
+    sc.data = &te;
+    ASSERT_TRUE(osh_transport_init(&tw, g, NULL, &ph, &sc) == OSH_OK);
+    ASSERT_TRUE(osh_transport_bank_init(&b, 10) == OSH_OK);
+    for (int i = 0; i < n; i++)
+        ASSERT_TRUE(osh_transport_bank_add(&b, &p, &pos[i]) == OSH_OK);
+    ASSERT_TRUE(b.n == (size_t) n && b.cap >= (size_t) n);
+    ASSERT_TRUE(osh_transport_event_run(&tw, &b, NULL) == OSH_OK);
+    ASSERT_TRUE(b.n == 0);
+    ASSERT_TRUE(tw.nhist == (size_t) n && tw.nsteps == te.nsteps);
+
+    ASSERT_TRUE(te.bad == 0);
+    ASSERT_TRUE(te.nsteps == th.nsteps);
+    ASSERT_TRUE(te.zmax == th.zmax);
+    ASSERT_TRUE(fabs(te.edep - th.edep) < 1e-9 * th.edep);
+    ASSERT_TRUE(fabs(te.track - th.track) < 1e-9 * th.track);
+
+    osh_transport_bank_free(&b);
+    osh_transport_free(&tw);
+}
+
+/* particles leaving a geometry without a surrounding black hole escape in both loops */
+static void test_event_open(void) {
+    struct gemca_workspace *g;
+    struct transport_workspace tw;
+    struct transport_physics ph = {water_density, water_dedx, NULL, NULL, NULL, NULL, NULL};
+    struct transport_scorer sc = {0};
+    struct transport_bank b;
+    struct tally th = {0};
+    struct tally te = {0};
+    struct particle p;
+    struct position pos[20];
+    struct position x;
+    int n = 20;
+
+    osh_gemca_workspace_init(&g);
+    osh_gemca_load(TEST_OPEN, g);
+
+    /* 250 MeV protons pass the slab, half of them go backwards */
+    proton(&p);
+    for (int i = 0; i < n; i++) {
+        memset(&pos[i], 0, sizeof(pos[i]));
+        pos[i].p[0] = -9.0 + 0.9 * i;
+        pos[i].p[2] = -5.0;
+        pos[i].p[3] = 250.0;
+        pos[i].v[2] = (i % 2) ? -1.0 : 1.0;
+        pos[i].system = 1;
+    }
+
+    sc.score = score;
+    sc.data = &th;
+    th.demax = OSH_TRANSPORT_DELTAE;
+    te = th;
+    ASSERT_TRUE(osh_transport_init(&tw, g, NULL, &ph, &sc) == OSH_OK);
+    for (int i = 0; i < n; i++) {
+        x = pos[i];
+        ASSERT_TRUE(osh_transport_history(&tw, &p, &x, NULL) == OSH_TRANSPORT_END_ESCAPED);
+        ASSERT_TRUE(x.zone < 0);
+    }
+    osh_transport_free(&tw);
+
+    sc.data = &te;
+    ASSERT_TRUE(osh_transport_init(&tw, g, NULL, &ph, &sc) == OSH_OK);
+    ASSERT_TRUE(osh_transport_bank_init(&b, (size_t) n) == OSH_OK);
+    for (int i = 0; i < n; i++)
+        ASSERT_TRUE(osh_transport_bank_add(&b, &p, &pos[i]) == OSH_OK);
+    ASSERT_TRUE(osh_transport_event_run(&tw, &b, NULL) == OSH_OK);
+    ASSERT_TRUE(b.n == 0 && tw.nhist == (size_t) n && tw.nsteps == te.nsteps);
+
+    ASSERT_TRUE(te.bad == 0 && te.nsteps == th.nsteps);
+    ASSERT_TRUE(te.edep > 10 * 40.0 && fabs(te.edep - th.edep) < 1e-9 * th.edep);
+    ASSERT_TRUE(fabs(te.track - th.track) < 1e-9 * th.track);
+
+    osh_transport_bank_free(&b);
+    osh_transport_free(&tw);
+    osh_gemca_workspace_free(g);
+}
+
+/* with the CSDA range hooks every step loses exactly the energy given by the range tables */
+static void test_csda(struct gemca_workspace *g) {
+    struct stopping_medium water = {1, 1.0, 0.55509, 7.22, 75.0};
+    struct stopping_workspace sw;
+    struct transport_workspace tw;
+    struct transport_physics ph = {water_density, osh_stopping_dedx, NULL, NULL, NULL, NULL, NULL};
+    struct transport_scorer sc = {0};
+    struct tally t = {0};
+    struct tally tm = {0};
+    struct particle p;
+    struct position pos = {0};
+    double r100;
+
+    ASSERT_TRUE(osh_stopping_init(&sw, &water, 1, 1) == OSH_OK);
+    proton(&p);
+    r100 = osh_stopping_range(&sw, &p, 1, 100.0);
+
+    /* mid-step stopping power */
+    ph.data = &sw;
+    sc.score = score;
+    sc.data = &tm;
+    tm.demax = OSH_TRANSPORT_DELTAE;
+    ASSERT_TRUE(osh_transport_init(&tw, g, NULL, &ph, &sc) == OSH_OK);
+    pos.p[2] = -5.0;
+    pos.p[3] = 100.0;
+    pos.v[2] = 1.0;
+    pos.system = 1;
+    ASSERT_TRUE(osh_transport_history(&tw, &p, &pos, NULL) == OSH_TRANSPORT_END_STOPPED);
+    osh_transport_free(&tw);
+
+    /* CSDA range */
+    ph.range = osh_stopping_range;
+    ASSERT_TRUE(osh_transport_init(&tw, g, NULL, &ph, &sc) == OSH_EINVAL);
+    ph.erange = osh_stopping_erange;
+    sc.data = &t;
+    t.demax = OSH_TRANSPORT_DELTAE;
+    ASSERT_TRUE(osh_transport_init(&tw, g, NULL, &ph, &sc) == OSH_OK);
+    memset(&pos, 0, sizeof(pos));
+    pos.p[2] = -5.0;
+    pos.p[3] = 100.0;
+    pos.v[2] = 1.0;
+    pos.system = 1;
+    ASSERT_TRUE(osh_transport_history(&tw, &p, &pos, NULL) == OSH_TRANSPORT_END_STOPPED);
+    ASSERT_TRUE(pos.p[3] == 0.0);
+    ASSERT_TRUE(t.bad == 0);
+    ASSERT_TRUE(fabs(t.edep - 100.0) < 1e-9);
+
+    /* the track ends where the residual range at the cutoff begins */
+    ASSERT_TRUE(t.zmax <= r100 + 1e-9);
+    ASSERT_TRUE(t.zmax >= r100 - osh_stopping_range(&sw, &p, 1, OSH_BEAM_TMIN0) - 1e-9);
+    ASSERT_TRUE(fabs(t.zmax - tm.zmax) < 1e-3 * r100);
+    ASSERT_TRUE(t.nsteps > 100 && t.nsteps < 400);
+
+    osh_transport_free(&tw);
+    osh_stopping_free(&sw);
+}
+
+int main(void) {
+    struct gemca_workspace *g;
+
+    osh_gemca_workspace_init(&g);
+    osh_gemca_load(TEST_GEO, g);
+
+    test_range(g);
+    test_escape(g);
+    test_event(g);
+    test_event_open();
+    test_csda(g);
+
+    osh_gemca_workspace_free(g);
+
+    return 0;
+}
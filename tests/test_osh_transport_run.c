@@ -0,0 +1,350 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "beam/osh_beam.h"
+#include "common/osh_atomic.h"
+#include "common/osh_rc.h"
+#include "common/osh_thread.h"
+#include "gemca/osh_gemca2.h"
+#include "io/osh_partial.h"
+#include "particle/osh_particle.h"
+#include "random/osh_rng.h"
+#include "transport/osh_transport.h"
+#include "transport/osh_transport_engine.h"
+#include "transport/osh_transport_run.h"
+
+#define ASSERT_TRUE(cond)                                                                                              \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            fprintf(stderr, "ASSERT FAILED: %s (%s:%d)\n", #cond, __FILE__, __LINE__);                                 \
+            exit(1);                                                                                                   \
+        }                                                                                                              \
+    } while (0)
+
+#define TEST_GEO "../../tests/res/transport/geo.dat"
+
+#define NBINS 200   /* depth bins of 1 mm */
+#define NSTAT 3000u /* primaries per run */
+
+/* Bethe formula for water without shell and density corrections, I = 75 eV */
+static double water_dedx(void *data, struct particle const *part, int medium, double e) {
+    const double me = 0.51099895;
+    const double k = 0.307075;
+    const double z_a = 0.5551;
+    const double ival = 75.0e-6;
+    double g, b2, tmax, m;
+
+    (void) data;
+    (void) medium;
+
+    m = part->amass;
+    g = 1.0 + e / m;
+    b2 = 1.0 - 1.0 / (g * g);
+    tmax = 2.0 * me * b2 * g * g / (1.0 + 2.0 * g * me / m + (me / m) * (me / m));
+    return k * z_a * part->z * part->z / b2 * (0.5 * log(2.0 * me * b2 * g * g * tmax / (ival * ival)) - b2);
+}
+
+static double water_density(void *data, int medium) {
+    (void) data;
+    (void) medium;
+    return 1.0;
+}
+
+/* crude Gaussian straggling and scattering, only so that every step draws random numbers */
+static double straggle(void *data, struct particle const *part, struct step const *st, struct osh_rng *rng) {
+    (void) data;
+    (void) part;
+    return st->de * (1.0 + 0.1 * osh_rng_gauss01(rng));
+}
+
+static void scatter(void *data, struct particle const *part, struct step const *st, double v[3], struct osh_rng *rng) {
+    double n;
+
+    (void) data;
+    (void) part;
+    (void) st;
+
+    v[0] += 0.002 * osh_rng_gauss01(rng);
+    v[1] += 0.002 * osh_rng_gauss01(rng);
+    n = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    v[0] /= n;
+    v[1] /= n;
+    v[2] /= n;
+}
+
+/* depth dose buffer */
+struct dose {
+    double edep[NBINS];
+    double total;
+    size_t nsteps;
+};
+
+static void *dose_alloc(void *ctx) {
+    (void) ctx;
+    return calloc(1, sizeof(struct dose));
+}
+
+static void dose_score(void *buf, struct particle const *part, struct step const *st) {
+    struct dose *d = buf;
+    int i;
+
+    (void) part;
+
+    d->total += st->de;
+    d->nsteps++;
+    i = (int) floor(10.0 * 0.5 * (st->p[2] + st->q[2]));
+    if (i >= 0 && i < NBINS)
+        d->edep[i] += st->de;
+}
+
+static void dose_merge(void *ctx, void *buf) {
+    struct dose *r = ctx;
+    struct dose *d = buf;
+
+    for (int i = 0; i < NBINS; i++)
+        r->edep[i] += d->edep[i];
+    r->total += d->total;
+    r->nsteps += d->nsteps;
+    memset(d, 0, sizeof(*d));
+}
+
+static void dose_free(void *ctx, void *buf) {
+    (void) ctx;
+    free(buf);
+}
+
+static void proton(struct particle *p) {
+    memset(p, 0, sizeof(*p));
+    p->amass = 938.272;
+    p->amu = 1.00728;
+    p->weight = 1.0;
+    p->id = OSH_PART_HADRON;
+    p->z = 1;
+    p->a = 1;
+    p->pdg = 2212;
+}
+
+struct setup {
+    struct gemca_workspace *g;
+    struct beam_workspace wb;
+    struct beam_spot spot[3];
+    struct particle p;
+};
+
+static void setup_init(struct setup *s, struct gemca_workspace *g) {
+    memset(s, 0, sizeof(*s));
+    s->g = g;
+    proton(&s->p);
+
+    /* three spots, the middle one twice as intense */
+    for (int i = 0; i < 3; i++) {
+        s->spot[i].part = &s->p;
+        s->spot[i].p[0] = -2.0 + 2.0 * i;
+        s->spot[i].p[2] = -5.0;
+        s->spot[i].t0 = 80.0 + 10.0 * i;
+        s->spot[i].tsigma = 1.0;
+        s->spot[i].size[0] = 0.3;
+        s->spot[i].size[1] = 0.3;
+        s->spot[i].wt = (i == 1) ? 2.0 : 1.0;
+        s->spot[i].shape = OSH_BEAM_SHAPE_GAUSSIAN;
+    }
+
+    s->wb.spots = s->spot;
+    s->wb.nspots = 3;
+    s->wb.nstat = NSTAT;
+    s->wb.rndseed = 5;
+}
+
+static int run(struct setup *s, int nthreads, int mode, enum osh_rng_type type, struct dose *d, struct transport_run *r) {
+    struct transport_physics ph = {water_density, water_dedx, straggle, scatter, NULL, NULL, NULL};
+    struct transport_tally t = {dose_alloc, dose_score, dose_merge, dose_free, NULL, NULL, NULL, NULL};
+
+    memset(d, 0, sizeof(*d));
+    t.ctx = d;
+    ASSERT_TRUE(osh_transport_run_init(r, s->g, &s->wb, &ph, &t) == OSH_OK);
+    r->nthreads = nthreads;
+    r->rng_mode = mode;
+    r->rng_type = type;
+    return osh_transport_run(r);
+}
+
+/* the same dose, bit for bit, for any number of threads */
+static void test_deterministic(struct setup *s, enum osh_rng_type type) {
+    struct transport_run r;
+    struct dose ref;
+    struct dose d;
+    int nthreads[] = {2, 3, 8};
+
+    ASSERT_TRUE(run(s, 1, OSH_TRANSPORT_RNG_HISTORY, type, &ref, &r) == OSH_OK);
+    ASSERT_TRUE(r.nthreads_used == 1);
+    ASSERT_TRUE(r.nhist == NSTAT && r.nsteps == ref.nsteps);
+    ASSERT_TRUE(r.nchunks > OSH_TRANSPORT_RUN_GUIDE);
+    ASSERT_TRUE(ref.total > NSTAT * 75.0 && ref.total < NSTAT * 95.0);
+
+    for (size_t i = 0; i < sizeof(nthreads) / sizeof(nthreads[0]); i++) {
+        ASSERT_TRUE(run(s, nthreads[i], OSH_TRANSPORT_RNG_HISTORY, type, &d, &r) == OSH_OK);
+        ASSERT_TRUE(r.nhist == NSTAT && r.nsteps == ref.nsteps);
+        ASSERT_TRUE(memcmp(&d, &ref, sizeof(d)) == 0);
+    }
+}
+
+static void test_modes(struct setup *s) {
+    struct transport_physics ph = {water_density, water_dedx, NULL, NULL, NULL, NULL, NULL};
+    struct transport_run r;
+    struct dose ref;
+    struct dose d;
+
+    ASSERT_TRUE(run(s, 1, OSH_TRANSPORT_RNG_HISTORY, OSH_RNG_TYPE_PCG32, &ref, &r) == OSH_OK);
+
+    /* worker streams: statistically the same, but not the same numbers */
+    ASSERT_TRUE(run(s, 4, OSH_TRANSPORT_RNG_WORKER, OSH_RNG_TYPE_PCG32, &d, &r) == OSH_OK);
+    ASSERT_TRUE(r.nhist == NSTAT);
+    ASSERT_TRUE(d.total != ref.total);
+    ASSERT_TRUE(fabs(d.total - ref.total) < 0.01 * ref.total);
+
+    /* another seed */
+    s->wb.rndseed = 6;
+    ASSERT_TRUE(run(s, 4, OSH_TRANSPORT_RNG_HISTORY, OSH_RNG_TYPE_PCG32, &d, &r) == OSH_OK);
+    ASSERT_TRUE(d.total != ref.total);
+    s->wb.rndseed = 5;
+
+    /* no tally, no spots */
+    ASSERT_TRUE(osh_transport_run_init(&r, s->g, &s->wb, &ph, NULL) == OSH_OK);
+    r.nthreads = 2;
+    r.chunk_min = 1000;
+    ASSERT_TRUE(osh_transport_run(&r) == OSH_OK);
+    ASSERT_TRUE(r.nchunks == 3 && r.nhist == NSTAT);
+
+    r.nspots = 0;
+    ASSERT_TRUE(osh_transport_run(&r) == OSH_EINVAL);
+}
+
+/* three jobs of one slice each, merged from their partial results, match a single run */
+static void test_slices(struct setup *s) {
+    const char *name[3] = {"test_slice_0.part", "test_slice_1.part", "test_slice_2.part"};
+    struct osh_partial_block b;
+    struct osh_partial_block *m;
+    struct transport_run r;
+    struct dose ref;
+    struct dose d;
+    size_t nsteps = 0;
+    uint64_t nprim;
+    size_t nb;
+
+    ASSERT_TRUE(run(s, 2, OSH_TRANSPORT_RNG_HISTORY, OSH_RNG_TYPE_PCG32, &ref, &r) == OSH_OK);
+
+    for (size_t job = 0; job < 3; job++) {
+        struct transport_physics ph = {water_density, water_dedx, straggle, scatter, NULL, NULL, NULL};
+        struct transport_tally t = {dose_alloc, dose_score, dose_merge, dose_free, NULL, NULL, NULL, NULL};
+
+        memset(&d, 0, sizeof(d));
+        t.ctx = &d;
+        ASSERT_TRUE(osh_transport_run_init(&r, s->g, &s->wb, &ph, &t) == OSH_OK);
+        ASSERT_TRUE(osh_transport_run_slice(&r, job, 3) == OSH_OK);
+        r.nthreads = 2;
+        ASSERT_TRUE(osh_transport_run(&r) == OSH_OK);
+        ASSERT_TRUE(r.nhist == NSTAT / 3);
+        nsteps += d.nsteps;
+
+        memset(&b, 0, sizeof(b));
+        strcpy(b.name, "edep");
+        b.n = NBINS;
+        b.sum = d.edep;
+        ASSERT_TRUE(osh_partial_write(name[job], r.nhist, &b, 1) == OSH_OK);
+    }
+    ASSERT_TRUE(nsteps == ref.nsteps);
+
+    ASSERT_TRUE(osh_partial_merge("test_slice.part", name, 3) == OSH_OK);
+    ASSERT_TRUE(osh_partial_read("test_slice.part", &nprim, &m, &nb) == OSH_OK);
+    ASSERT_TRUE(nprim == NSTAT && nb == 1 && m[0].n == NBINS);
+    for (int i = 0; i < NBINS; i++)
+        ASSERT_TRUE(fabs(m[0].sum[i] - ref.edep[i]) <= 1e-9 * ref.total);
+    osh_partial_free(m, nb);
+
+    for (int i = 0; i < 3; i++)
+        remove(name[i]);
+    remove("test_slice.part");
+
+    ASSERT_TRUE(osh_transport_run_slice(&r, 3, 3) == OSH_EINVAL);
+}
+
+/* the first buffer handed out holds up its chunk until all other chunks have started */
+static struct {
+    int64_t volatile nbuf;   /* buffers allocated */
+    int64_t volatile nother; /* histories started in other buffers */
+    void *volatile buf;      /* the slow buffer */
+    int64_t target;          /* histories of all other chunks */
+    int held;                /* the slow chunk was held up */
+    int passed;              /* ... and the other chunks went on meanwhile */
+} slow;
+
+static void *slow_alloc(void *ctx) {
+    void *buf = dose_alloc(ctx);
+
+    if (buf && osh_atomic_fetch_add(&slow.nbuf, 1) == 0)
+        osh_atomic_store_ptr(&slow.buf, buf);
+    return buf;
+}
+
+static void slow_history(void *buf) {
+    time_t t0;
+
+    if (buf != osh_atomic_load_ptr(&slow.buf) || slow.held) {
+        osh_atomic_fetch_add(&slow.nother, 1);
+        return;
+    }
+    slow.held = 1;
+    t0 = time(NULL);
+    while (osh_atomic_load(&slow.nother) < slow.target && time(NULL) - t0 < 30)
+        osh_thread_yield();
+    slow.passed = (osh_atomic_load(&slow.nother) >= slow.target);
+}
+
+/* a slow chunk does not keep the other workers waiting for the merge */
+static void test_slow(struct setup *s) {
+    struct transport_physics ph = {water_density, water_dedx, straggle, scatter, NULL, NULL, NULL};
+    struct transport_tally t = {slow_alloc, dose_score, dose_merge, dose_free, NULL, slow_history, NULL, NULL};
+    struct transport_run r;
+    struct dose ref;
+    struct dose d;
+
+    /* fewer primaries than OSH_TRANSPORT_RUN_GUIDE, chunks of one primary each */
+    s->wb.nstat = 60;
+    ASSERT_TRUE(run(s, 1, OSH_TRANSPORT_RNG_HISTORY, OSH_RNG_TYPE_PCG32, &ref, &r) == OSH_OK);
+    ASSERT_TRUE(r.nchunks == 60);
+
+    memset(&slow, 0, sizeof(slow));
+    slow.target = 59;
+    memset(&d, 0, sizeof(d));
+    t.ctx = &d;
+    ASSERT_TRUE(osh_transport_run_init(&r, s->g, &s->wb, &ph, &t) == OSH_OK);
+    r.nthreads = 4;
+    ASSERT_TRUE(osh_transport_run(&r) == OSH_OK);
+    if (r.nthreads_used > 1)
+        ASSERT_TRUE(slow.held && slow.passed);
+    /* the merge still went in chunk order */
+    ASSERT_TRUE(memcmp(&d, &ref, sizeof(d)) == 0);
+    s->wb.nstat = NSTAT;
+}
+
+int main(void) {
+    struct gemca_workspace *g;
+    struct setup s;
+
+    osh_gemca_workspace_init(&g);
+    osh_gemca_load(TEST_GEO, g);
+
+    setup_init(&s, g);
+    test_deterministic(&s, OSH_RNG_TYPE_PCG32);
+    test_deterministic(&s, OSH_RNG_TYPE_XOSHIRO256SS);
+    test_modes(&s);
+    test_slices(&s);
+    test_slow(&s);
+
+    osh_gemca_workspace_free(g);
+
+    return 0;
+}